@@ -0,0 +1,213 @@
+/*
+Culling utilities
+- BoundingSphere and AABB (Axis Aligned Bounding Box) of a Model, calculated from the vertices of its meshes
+- Frustum class: the 6 planes of a view frustum, extracted from a view-projection matrix, and the tests of bounding volumes against the frustum
+- tests for the culling of the shadow casters: against the frustum of the light (extended towards the light), and against the camera frustum considering the volume "swept" by the shadow of the object
+
+The planes are extracted using the method of Gribb and Hartmann: each plane is a combination of the rows of the view-projection matrix.
+The normals of the planes point inside the frustum: a point is inside if its signed distance from all the planes is >= 0.
+
+N.B.) the tests are conservative: an object can be classified as visible even if it is actually outside the frustum (e.g., a large sphere near a corner of the frustum),
+but an object inside the frustum is never classified as not visible
+
+see:
+https://www.gamedevs.org/uploads/fast-extraction-viewing-frustum-planes-from-world-view-projection-matrix.pdf
+https://learnopengl.com/Guest-Articles/2021/Scene/Frustum-Culling
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+#include <cfloat>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include <utils/model.h>
+
+// bounding sphere (center and radius)
+struct BoundingSphere {
+    glm::vec3 center;
+    float radius;
+};
+
+// axis aligned bounding box (minimum and maximum corners)
+struct AABB {
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+//////////////////////////////////////////
+// AABB of all the meshes of a model (in model coordinates)
+inline AABB ComputeModelAABB(const Model& model)
+{
+    AABB box;
+    box.min = glm::vec3(FLT_MAX);
+    box.max = glm::vec3(-FLT_MAX);
+    for (size_t m = 0; m < model.meshes.size(); m++)
+    {
+        const vector<Vertex>& vertices = model.meshes[m].vertices;
+        for (size_t v = 0; v < vertices.size(); v++)
+        {
+            box.min = glm::min(box.min, vertices[v].Position);
+            box.max = glm::max(box.max, vertices[v].Position);
+        }
+    }
+    return box;
+}
+
+//////////////////////////////////////////
+// bounding sphere of a model (in model coordinates): we use the center of the AABB, and the distance of the farthest vertex
+inline BoundingSphere ComputeModelBoundingSphere(const Model& model)
+{
+    AABB box = ComputeModelAABB(model);
+    BoundingSphere sphere;
+    sphere.center = (box.min + box.max) * 0.5f;
+    sphere.radius = 0.0f;
+    for (size_t m = 0; m < model.meshes.size(); m++)
+    {
+        const vector<Vertex>& vertices = model.meshes[m].vertices;
+        for (size_t v = 0; v < vertices.size(); v++)
+            sphere.radius = glm::max(sphere.radius, glm::length(vertices[v].Position - sphere.center));
+    }
+    return sphere;
+}
+
+//////////////////////////////////////////
+// we transform a bounding sphere in world coordinates: the radius is scaled by the maximum scale factor of the matrix
+inline BoundingSphere TransformBoundingSphere(const BoundingSphere& sphere, const glm::mat4& modelMatrix)
+{
+    BoundingSphere world;
+    world.center = glm::vec3(modelMatrix * glm::vec4(sphere.center, 1.0f));
+    float sx = glm::dot(glm::vec3(modelMatrix[0]), glm::vec3(modelMatrix[0]));
+    float sy = glm::dot(glm::vec3(modelMatrix[1]), glm::vec3(modelMatrix[1]));
+    float sz = glm::dot(glm::vec3(modelMatrix[2]), glm::vec3(modelMatrix[2]));
+    world.radius = sphere.radius * sqrtf(glm::max(sx, glm::max(sy, sz)));
+    return world;
+}
+
+//////////////////////////////////////////
+// we transform an AABB in world coordinates (the result is the AABB of the transformed box)
+// method of Arvo: https://www.realtimerendering.com/resources/GraphicsGems/gems/TransBox.c
+inline AABB TransformAABB(const AABB& box, const glm::mat4& modelMatrix)
+{
+    glm::vec3 center = (box.min + box.max) * 0.5f;
+    glm::vec3 extent = (box.max - box.min) * 0.5f;
+    glm::vec3 worldCenter = glm::vec3(modelMatrix * glm::vec4(center, 1.0f));
+    glm::vec3 worldExtent = glm::abs(glm::vec3(modelMatrix[0])) * extent.x
+                          + glm::abs(glm::vec3(modelMatrix[1])) * extent.y
+                          + glm::abs(glm::vec3(modelMatrix[2])) * extent.z;
+    AABB world;
+    world.min = worldCenter - worldExtent;
+    world.max = worldCenter + worldExtent;
+    return world;
+}
+
+// names of the planes of the frustum
+enum frustum_planes{ LEFT_PLANE, RIGHT_PLANE, BOTTOM_PLANE, TOP_PLANE, NEAR_PLANE, FAR_PLANE};
+
+/////////////////// FRUSTUM class ///////////////////////
+class Frustum
+{
+public:
+    // planes (xyz = normal pointing inside the frustum, w = distance). A point p is inside the plane if dot(xyz, p) + w >= 0
+    glm::vec4 planes[6];
+
+    Frustum() {}
+
+    // constructor: we extract the planes from the matrix
+    Frustum(const glm::mat4& viewProjection)
+    {
+        this->Extract(viewProjection);
+    }
+
+    //////////////////////////////////////////
+    // extraction of the planes using the method of Gribb and Hartmann
+    // N.B.) GLM matrices are column-major: m[c][r] -> the i-th row is (m[0][i], m[1][i], m[2][i], m[3][i])
+    void Extract(const glm::mat4& m)
+    {
+        glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+        this->planes[LEFT_PLANE] = row3 + row0;
+        this->planes[RIGHT_PLANE] = row3 - row0;
+        this->planes[BOTTOM_PLANE] = row3 + row1;
+        this->planes[TOP_PLANE] = row3 - row1;
+        this->planes[NEAR_PLANE] = row3 + row2;
+        this->planes[FAR_PLANE] = row3 - row2;
+
+        // we normalize the planes, in order to have actual distances in the tests with the spheres
+        for (int i = 0; i < 6; i++)
+            this->planes[i] /= glm::length(glm::vec3(this->planes[i]));
+    }
+
+    //////////////////////////////////////////
+    // signed distance of a point from a plane
+    float Distance(int plane, const glm::vec3& point) const
+    {
+        return glm::dot(glm::vec3(this->planes[plane]), point) + this->planes[plane].w;
+    }
+
+    //////////////////////////////////////////
+    // the sphere is visible if it is not completely "behind" one of the planes
+    bool IsVisible(const BoundingSphere& sphere) const
+    {
+        for (int i = 0; i < 6; i++)
+        {
+            if (this->Distance(i, sphere.center) < -sphere.radius)
+                return false;
+        }
+        return true;
+    }
+
+    //////////////////////////////////////////
+    // the box is visible if, for each plane, its "most inside" corner (= the p-vertex) is inside the plane
+    bool IsVisible(const AABB& box) const
+    {
+        for (int i = 0; i < 6; i++)
+        {
+            glm::vec3 n = glm::vec3(this->planes[i]);
+            glm::vec3 p(n.x >= 0.0f ? box.max.x : box.min.x,
+                        n.y >= 0.0f ? box.max.y : box.min.y,
+                        n.z >= 0.0f ? box.max.z : box.min.z);
+            if (glm::dot(n, p) + this->planes[i].w < 0.0f)
+                return false;
+        }
+        return true;
+    }
+    //////////////////////////////////////////
+    // test of a shadow caster against the frustum of a light: the near plane is not considered, because the objects between the light and the near plane
+    // can cast shadows inside the frustum (they must be rendered with GL_DEPTH_CLAMP enabled, otherwise they are clipped)
+    bool IsCasterVisible(const BoundingSphere& sphere) const
+    {
+        for (int i = 0; i < 6; i++)
+        {
+            if (i != NEAR_PLANE && this->Distance(i, sphere.center) < -sphere.radius)
+                return false;
+        }
+        return true;
+    }
+};
+
+//////////////////////////////////////////
+// receiver-aware culling of a shadow caster: the shadow of the object can fall only inside the volume swept by its bounding sphere along the direction of the light
+// (a capsule from the center of the sphere to center + sweep). If the capsule is completely outside the camera frustum, the shadow is never visible
+// N.B.) the distance from a plane is linear along the segment, so it is enough to test the two extremes
+inline bool IsShadowVisible(const Frustum& cameraFrustum, const BoundingSphere& sphere, const glm::vec3& sweep)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        float d0 = cameraFrustum.Distance(i, sphere.center);
+        float d1 = cameraFrustum.Distance(i, sphere.center + sweep);
+        if (glm::max(d0, d1) < -sphere.radius)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,468 @@
+/*
+Draw commands classes
+- MeshBatch: the meshes of several Model instances are merged in a single VBO/EBO/VAO, so that they can be drawn with a single API call
+- DrawCommandList: a flat list of DrawElementsIndirectCommand records + per-draw data (model and normal matrices, diffuse color), which is submitted:
+    - on OpenGL >= 4.3: with a single glMultiDrawElementsIndirect call, reading the commands from a GL_DRAW_INDIRECT_BUFFER
+    - on OpenGL 4.1: with a loop of glDrawElementsBaseVertex calls over the same list of commands
+
+The per-draw data are saved in a Texture Buffer Object (available since OpenGL 3.1), and they are fetched in the vertex shader using the index of the draw.
+The index of the draw is provided to the vertex shader by an instanced vertex attribute (location = 5, divisor = 1):
+    - on OpenGL >= 4.3, the "baseInstance" field of each command is set to the index of the draw, thus the attribute read by each draw is different
+      (this is the "classic" alternative to gl_DrawID, which is available only in OpenGL 4.6 or with the ARB_shader_draw_parameters extension)
+    - on OpenGL 4.1, the attribute array is disabled, and the index is set as the "current" value of the generic attribute before each draw call
+
+- InstanceBuffer: a buffer of model matrices (e.g., the InstanceArray written by the Motion States of the rigid bodies, see include/utils/instance_motion_state.h),
+  used as instanced vertex attribute (locations INSTANCE_MATRIX_LOCATION ... +3, divisor = 1) to draw all the copies of a model of a MeshBatch with a single
+  glDrawElementsInstancedBaseVertex call for each mesh (available on OpenGL 4.1). Only the modified range of the matrices is uploaded at each frame
+
+N.B. 1) the per-draw data must be read in the vertex shader using a samplerBuffer: see 23_multidraw.vert in lecture06b
+N.B. 2) all the meshes of a batch share the same VAO: the vertex format must be the same (in our case, the Vertex structure of mesh.h)
+
+see:
+https://www.khronos.org/opengl/wiki/Vertex_Rendering#Indirect_rendering
+https://www.khronos.org/opengl/wiki/Buffer_Texture
+https://www.g-truc.net/post-0518.html
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <utils/model.h>
+
+// location of the vertex attribute used for the index of the draw
+#define DRAW_ID_LOCATION 5
+// first location of the instanced model matrix (4 locations, one for each column)
+#define INSTANCE_MATRIX_LOCATION 6
+
+// structure of an indirect command, as defined by the OpenGL specifications (the order of the fields is mandatory)
+struct DrawElementsIndirectCommand {
+    GLuint count; // number of indices
+    GLuint instanceCount; // number of instances
+    GLuint firstIndex; // offset (in indices) inside the EBO
+    GLint baseVertex; // value added to each index
+    GLuint baseInstance; // first instance -> we use it as index of the draw
+};
+
+// range of a single mesh inside the buffers of a MeshBatch
+struct MeshRange {
+    GLuint count;
+    GLuint firstIndex;
+    GLint baseVertex;
+};
+
+// per-draw data: we use 8 vec4 for each draw (= 8 texels in the Texture Buffer Object)
+struct DrawData {
+    // model matrix (4 columns)
+    glm::vec4 modelMatrix[4];
+    // normal matrix (3 columns, the 4th component is not used)
+    glm::vec4 normalMatrix[3];
+    // diffuse color (the 4th component is not used)
+    glm::vec4 diffuseColor;
+};
+
+// number of texels (vec4) used for each draw
+const GLuint DRAW_DATA_TEXELS = sizeof(DrawData)/sizeof(glm::vec4);
+
+/////////////////// MESHBATCH class ///////////////////////
+class MeshBatch
+{
+public:
+    // ranges of all the meshes in the batch
+    vector<MeshRange> ranges;
+    // for each added model, the index of its first range in the ranges vector, and the number of its meshes
+    vector<GLuint> modelFirstRange;
+    vector<GLuint> modelNumRanges;
+    // VAO
+    GLuint VAO;
+
+    // MeshBatch is a "move-only" class, like Mesh (see mesh.h for details)
+    MeshBatch(const MeshBatch& copy) = delete;
+    MeshBatch& operator=(const MeshBatch&) = delete;
+
+    MeshBatch() noexcept : VAO(0), VBO(0), EBO(0), drawIDBuffer(0), drawIDCapacity(0) {}
+
+    ~MeshBatch() noexcept
+    {
+        freeGPUresources();
+    }
+
+    //////////////////////////////////////////
+    // we add all the meshes of a model to the batch. The data are copied in CPU memory, the buffers are created by the Setup method.
+    // The method returns the index to be used in DrawCommandList to refer to the model
+    GLuint AddModel(const Model& model)
+    {
+        this->modelFirstRange.push_back(this->ranges.size());
+        this->modelNumRanges.push_back(model.meshes.size());
+
+        for (GLuint i = 0; i < model.meshes.size(); i++)
+        {
+            const Mesh& mesh = model.meshes[i];
+            MeshRange range;
+            range.count = mesh.indices.size();
+            range.firstIndex = this->indices.size();
+            range.baseVertex = this->vertices.size();
+            this->ranges.push_back(range);
+
+            this->vertices.insert(this->vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+            this->indices.insert(this->indices.end(), mesh.indices.begin(), mesh.indices.end());
+        }
+        return this->modelFirstRange.size()-1;
+    }
+
+    //////////////////////////////////////////
+    // we create the buffers, using the same layout of the Mesh class for the vertex attributes
+    void Setup()
+    {
+        freeGPUresources();
+
+        glGenVertexArrays(1, &this->VAO);
+        glGenBuffers(1, &this->VBO);
+        glGenBuffers(1, &this->EBO);
+        glGenBuffers(1, &this->drawIDBuffer);
+
+        glBindVertexArray(this->VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+        glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(Vertex), &this->vertices[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(GLuint), &this->indices[0], GL_STATIC_DRAW);
+
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, Normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, TexCoords));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, Tangent));
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, Bitangent));
+
+        // index of the draw: an integer attribute, which advances once per instance
+        glBindBuffer(GL_ARRAY_BUFFER, this->drawIDBuffer);
+        glVertexAttribIPointer(DRAW_ID_LOCATION, 1, GL_UNSIGNED_INT, sizeof(GLuint), (GLvoid*)0);
+        glVertexAttribDivisor(DRAW_ID_LOCATION, 1);
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+
+        this->ReserveDraws(256);
+    }
+
+    //////////////////////////////////////////
+    // the buffer with the indices of the draws must contain at least numDraws values (0, 1, 2, ..., numDraws-1)
+    void ReserveDraws(GLuint numDraws)
+    {
+        if (numDraws <= this->drawIDCapacity)
+            return;
+        // we double the capacity, in order to avoid a new allocation at each new draw
+        GLuint capacity = (this->drawIDCapacity > 0 ? this->drawIDCapacity : 256);
+        while (capacity < numDraws)
+            capacity *= 2;
+
+        vector<GLuint> ids(capacity);
+        for (GLuint i = 0; i < capacity; i++)
+            ids[i] = i;
+        glBindBuffer(GL_ARRAY_BUFFER, this->drawIDBuffer);
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(GLuint), &ids[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        this->drawIDCapacity = capacity;
+    }
+
+private:
+    // CPU copy of the merged data
+    vector<Vertex> vertices;
+    vector<GLuint> indices;
+    // VBO, EBO, and the buffer with the indices of the draws
+    GLuint VBO, EBO, drawIDBuffer;
+    GLuint drawIDCapacity;
+
+    void freeGPUresources()
+    {
+        if (this->VAO)
+        {
+            glDeleteVertexArrays(1, &this->VAO);
+            glDeleteBuffers(1, &this->VBO);
+            glDeleteBuffers(1, &this->EBO);
+            glDeleteBuffers(1, &this->drawIDBuffer);
+            this->VAO = 0;
+            this->drawIDCapacity = 0;
+        }
+    }
+};
+
+/////////////////// DRAWCOMMANDLIST class ///////////////////////
+class DrawCommandList
+{
+public:
+    // flat list of commands and of the corresponding per-draw data (same index)
+    vector<DrawElementsIndirectCommand> commands;
+    vector<DrawData> drawData;
+    // if true, the list is submitted using glMultiDrawElementsIndirect
+    GLboolean useMultiDraw;
+
+    DrawCommandList(const DrawCommandList& copy) = delete;
+    DrawCommandList& operator=(const DrawCommandList&) = delete;
+
+    //////////////////////////////////////////
+    // constructor
+    // it must be called after the initialization of GLAD: the availability of the multi-draw path is checked on the current context
+    DrawCommandList() : dataBuffer(0), dataTexture(0), indirectBuffer(0), dataCapacity(0), commandsCapacity(0)
+    {
+        this->multiDrawSupported = (GLAD_GL_VERSION_4_3 != 0);
+        this->useMultiDraw = this->multiDrawSupported;
+
+        glGenBuffers(1, &this->dataBuffer);
+        glGenTextures(1, &this->dataTexture);
+        if (this->multiDrawSupported)
+            glGenBuffers(1, &this->indirectBuffer);
+    }
+
+    ~DrawCommandList()
+    {
+        glDeleteTextures(1, &this->dataTexture);
+        glDeleteBuffers(1, &this->dataBuffer);
+        if (this->indirectBuffer)
+            glDeleteBuffers(1, &this->indirectBuffer);
+    }
+
+    // true if the current context supports glMultiDrawElementsIndirect
+    GLboolean MultiDrawSupported() const { return this->multiDrawSupported; }
+
+    //////////////////////////////////////////
+    // we empty the lists (the allocated memory is kept for the next frame)
+    void Clear()
+    {
+        this->commands.clear();
+        this->drawData.clear();
+    }
+
+    //////////////////////////////////////////
+    // we add a command for each mesh of the model (= index returned by MeshBatch::AddModel), with the same per-draw data
+    void Add(const MeshBatch& batch, GLuint model, const glm::mat4& modelMatrix, const glm::mat3& normalMatrix, const glm::vec3& diffuseColor)
+    {
+        DrawData data;
+        PackDrawData(data, modelMatrix, normalMatrix, diffuseColor);
+
+        GLuint first = batch.modelFirstRange[model];
+        GLuint last = first + batch.modelNumRanges[model];
+        for (GLuint r = first; r < last; r++)
+            this->Add(batch.ranges[r], data);
+    }
+
+    // we add a single command, with already packed per-draw data
+    void Add(const MeshRange& range, const DrawData& data)
+    {
+        DrawElementsIndirectCommand cmd;
+        cmd.count = range.count;
+        cmd.instanceCount = 1;
+        cmd.firstIndex = range.firstIndex;
+        cmd.baseVertex = range.baseVertex;
+        cmd.baseInstance = this->commands.size();
+        this->commands.push_back(cmd);
+        this->drawData.push_back(data);
+    }
+
+    //////////////////////////////////////////
+    // we set the size of the list, and we write the commands using Set.
+    // It is used when the list is filled by several threads at the same time (each thread writes a different part of the list, see draw_list_builder.h)
+    void Resize(size_t numDraws)
+    {
+        this->commands.resize(numDraws);
+        this->drawData.resize(numDraws);
+    }
+
+    void Set(size_t index, const MeshRange& range, const DrawData& data)
+    {
+        DrawElementsIndirectCommand& cmd = this->commands[index];
+        cmd.count = range.count;
+        cmd.instanceCount = 1;
+        cmd.firstIndex = range.firstIndex;
+        cmd.baseVertex = range.baseVertex;
+        cmd.baseInstance = index;
+        this->drawData[index] = data;
+    }
+
+    //////////////////////////////////////////
+    // we upload the per-draw data and we render all the commands of the list
+    // the Shader Program must be already active. textureUnit is the unit used for the samplerBuffer with the per-draw data
+    void Submit(MeshBatch& batch, GLuint program, GLuint textureUnit)
+    {
+        GLsizei numDraws = this->commands.size();
+        if (numDraws == 0)
+            return;
+
+        // upload of the per-draw data in the Texture Buffer Object
+        glBindBuffer(GL_TEXTURE_BUFFER, this->dataBuffer);
+        if ((GLuint)numDraws > this->dataCapacity)
+        {
+            this->dataCapacity = numDraws * 2;
+            glBufferData(GL_TEXTURE_BUFFER, this->dataCapacity * sizeof(DrawData), NULL, GL_STREAM_DRAW);
+        }
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, numDraws * sizeof(DrawData), &this->drawData[0]);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        glActiveTexture(GL_TEXTURE0 + textureUnit);
+        glBindTexture(GL_TEXTURE_BUFFER, this->dataTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, this->dataBuffer);
+        glUniform1i(glGetUniformLocation(program, "drawData"), textureUnit);
+
+        batch.ReserveDraws(numDraws);
+        glBindVertexArray(batch.VAO);
+
+        if (this->useMultiDraw && this->multiDrawSupported)
+        {
+            // the index of the draw is read from the instanced attribute, using baseInstance as offset
+            glEnableVertexAttribArray(DRAW_ID_LOCATION);
+
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->indirectBuffer);
+            if ((GLuint)numDraws > this->commandsCapacity)
+            {
+                this->commandsCapacity = numDraws * 2;
+                glBufferData(GL_DRAW_INDIRECT_BUFFER, this->commandsCapacity * sizeof(DrawElementsIndirectCommand), NULL, GL_STREAM_DRAW);
+            }
+            glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, numDraws * sizeof(DrawElementsIndirectCommand), &this->commands[0]);
+
+            // a single API call for the whole list
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (GLvoid*)0, numDraws, 0);
+
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        }
+        else
+        {
+            // OpenGL 4.1 fallback: baseInstance is not available, so we disable the attribute array, and we set the index of the draw as the current value of the generic attribute
+            glDisableVertexAttribArray(DRAW_ID_LOCATION);
+            for (GLsizei i = 0; i < numDraws; i++)
+            {
+                const DrawElementsIndirectCommand& cmd = this->commands[i];
+                glVertexAttribI1ui(DRAW_ID_LOCATION, cmd.baseInstance);
+                glDrawElementsBaseVertex(GL_TRIANGLES, cmd.count, GL_UNSIGNED_INT, (GLvoid*)(cmd.firstIndex * sizeof(GLuint)), cmd.baseVertex);
+            }
+        }
+
+        glBindVertexArray(0);
+    }
+
+    //////////////////////////////////////////
+    // we convert the matrices and the color to the layout used in the Texture Buffer Object
+    static void PackDrawData(DrawData& data, const glm::mat4& modelMatrix, const glm::mat3& normalMatrix, const glm::vec3& diffuseColor)
+    {
+        for (int c = 0; c < 4; c++)
+            data.modelMatrix[c] = modelMatrix[c];
+        for (int c = 0; c < 3; c++)
+            data.normalMatrix[c] = glm::vec4(normalMatrix[c], 0.0f);
+        data.diffuseColor = glm::vec4(diffuseColor, 1.0f);
+    }
+
+private:
+    GLboolean multiDrawSupported;
+    // buffer and texture for the per-draw data
+    GLuint dataBuffer, dataTexture;
+    // buffer for the indirect commands
+    GLuint indirectBuffer;
+    // number of draws which can be saved in the currently allocated buffers
+    GLuint dataCapacity, commandsCapacity;
+};
+
+/////////////////// INSTANCEBUFFER class ///////////////////////
+class InstanceBuffer
+{
+public:
+    // number of matrices which can be saved in the currently allocated buffer
+    size_t capacity;
+
+    InstanceBuffer(const InstanceBuffer& copy) = delete;
+    InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+    //////////////////////////////////////////
+    // constructor (the buffer is created at the first upload)
+    InstanceBuffer() : capacity(0), VBO(0) {}
+
+    ~InstanceBuffer()
+    {
+        this->Clear();
+    }
+
+    //////////////////////////////////////////
+    // we upload the matrices in the range [dirtyBegin, dirtyEnd). If the buffer is too small, we allocate a larger buffer, and we upload all the "count" matrices
+    void Upload(const glm::mat4* matrices, size_t count, size_t dirtyBegin, size_t dirtyEnd)
+    {
+        if (this->VBO == 0)
+            glGenBuffers(1, &this->VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+        if (count > this->capacity)
+        {
+            // we double the capacity, in order to avoid a new allocation for each new instance
+            size_t capacity = (this->capacity > 0 ? this->capacity : 256);
+            while (capacity < count)
+                capacity *= 2;
+            glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(glm::mat4), NULL, GL_DYNAMIC_DRAW);
+            this->capacity = capacity;
+            dirtyBegin = 0;
+            dirtyEnd = count;
+        }
+        if (dirtyEnd > count)
+            dirtyEnd = count;
+        if (dirtyBegin < dirtyEnd)
+            glBufferSubData(GL_ARRAY_BUFFER, dirtyBegin * sizeof(glm::mat4), (dirtyEnd - dirtyBegin) * sizeof(glm::mat4), matrices + dirtyBegin);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    //////////////////////////////////////////
+    // we draw "count" instances of a model of the batch (= index returned by MeshBatch::AddModel), one for each matrix of the buffer
+    // the Shader Program must read the model matrix from the instanced attribute (see 40_instanced.vert in lecture06b)
+    void Draw(const MeshBatch& batch, GLuint model, GLsizei count) const
+    {
+        if (count == 0 || this->VBO == 0)
+            return;
+        glBindVertexArray(batch.VAO);
+        // the model matrix uses 4 consecutive locations, with a column in each one
+        glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+        for (GLuint c = 0; c < 4; c++)
+        {
+            glEnableVertexAttribArray(INSTANCE_MATRIX_LOCATION + c);
+            glVertexAttribPointer(INSTANCE_MATRIX_LOCATION + c, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (GLvoid*)(c * sizeof(glm::vec4)));
+            glVertexAttribDivisor(INSTANCE_MATRIX_LOCATION + c, 1);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        // the index of the draw is not used: we disable it, because its buffer could be smaller than the number of instances (DrawCommandList::Submit enables it again)
+        glDisableVertexAttribArray(DRAW_ID_LOCATION);
+
+        GLuint first = batch.modelFirstRange[model];
+        GLuint last = first + batch.modelNumRanges[model];
+        for (GLuint r = first; r < last; r++)
+        {
+            const MeshRange& range = batch.ranges[r];
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.count, GL_UNSIGNED_INT, (GLvoid*)(range.firstIndex * sizeof(GLuint)), count, range.baseVertex);
+        }
+
+        for (GLuint c = 0; c < 4; c++)
+            glDisableVertexAttribArray(INSTANCE_MATRIX_LOCATION + c);
+        glBindVertexArray(0);
+    }
+
+    //////////////////////////////////////////
+    // we delete the buffer
+    void Clear()
+    {
+        if (this->VBO != 0)
+            glDeleteBuffers(1, &this->VBO);
+        this->VBO = 0;
+        this->capacity = 0;
+    }
+
+private:
+    GLuint VBO;
+};
@@ -0,0 +1,179 @@
+/*
+DrawListBuilder class
+- multithreaded building of the list of commands (DrawCommandList, see draw_commands.h) for a frame
+- the CPU work of the frame (acquisition of the transformations, frustum culling, calculation of the normal matrices, packing of the per-draw data, sorting) is split in jobs, executed by the JobSystem (see job_system.h)
+- the main thread (the only one with the OpenGL context) has only to "replay" the resulting flat list of commands, using DrawCommandList::Submit
+
+The objects are split in chunks of "grain" objects. The building is performed in two parallel steps:
+1) for each chunk, a job acquires the data of the objects (using a function provided by the application), it applies frustum culling, and it packs the per-draw data of the visible objects in a local list. It also counts the commands needed by each model of the MeshBatch.
+2) after a (serial, and very fast) prefix sum on the counters, each job knows where to write its commands in the final list, which is sorted by model (= a counting sort). Thus, the jobs can write the final list at the same time, without synchronization.
+
+If an OcclusionBuffer is set (see occlusion.h), the objects passing frustum culling are tested also against the occluders rasterized in the buffer.
+The buffer must be already rasterized (with its pyramid built) before calling Build: during the building, it is only read by the jobs.
+
+The function provided by the application must have the signature:
+    void fetch(size_t index, RenderItem& item)
+and it is called by different threads at the same time: it must not modify shared data, and it must NOT call OpenGL functions.
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include <utils/draw_commands.h>
+#include <utils/culling.h>
+#include <utils/occlusion.h>
+#include <utils/job_system.h>
+
+// data of an object to render in the current frame
+struct RenderItem {
+    // index of the model in the MeshBatch
+    GLuint model;
+    // transformation of the object
+    glm::mat4 modelMatrix;
+    // color of the object
+    glm::vec3 diffuseColor;
+    // bounding sphere of the model (in model coordinates)
+    BoundingSphere bounds;
+};
+
+/////////////////// DRAWLISTBUILDER class ///////////////////////
+class DrawListBuilder
+{
+public:
+    // number of objects in each job
+    size_t grain;
+    // statistics of the last built frame
+    size_t numItems, numVisible, numCommands, numOccluded;
+    // if not null, the objects are tested also against the occluders of the buffer
+    const OcclusionBuffer* occlusion;
+
+    DrawListBuilder(size_t grain = 64) : grain(grain), numItems(0), numVisible(0), numCommands(0), numOccluded(0), occlusion(nullptr) {}
+
+    //////////////////////////////////////////
+    // we build the list of commands for numItems objects. The data of each object are provided by the fetch function
+    template<typename Fetch>
+    void Build(JobSystem& jobs, size_t numItems, Fetch fetch, const MeshBatch& batch,
+               const glm::mat4& view, const glm::mat4& projection, DrawCommandList& list)
+    {
+        size_t numModels = batch.modelFirstRange.size();
+        size_t numChunks = (numItems + this->grain - 1) / this->grain;
+        if (this->chunks.size() < numChunks)
+            this->chunks.resize(numChunks);
+
+        // the frustum of the camera, in world coordinates
+        Frustum frustum(projection * view);
+        size_t grain = this->grain;
+        vector<Chunk>& chunks = this->chunks;
+        const OcclusionBuffer* occlusion = this->occlusion;
+
+        ////// STEP 1: acquisition of the data, culling, packing (a job for each chunk)
+        jobs.ParallelFor(numChunks, 1, [&](size_t firstChunk, size_t lastChunk)
+        {
+            RenderItem item;
+            for (size_t c = firstChunk; c < lastChunk; c++)
+            {
+                Chunk& chunk = chunks[c];
+                chunk.visible.clear();
+                chunk.counts.assign(numModels, 0);
+                chunk.occluded = 0;
+
+                size_t end = (c+1)*grain < numItems ? (c+1)*grain : numItems;
+                for (size_t i = c*grain; i < end; i++)
+                {
+                    fetch(i, item);
+
+                    // frustum culling using the bounding sphere in world coordinates
+                    BoundingSphere worldBounds = TransformBoundingSphere(item.bounds, item.modelMatrix);
+                    if (!frustum.IsVisible(worldBounds))
+                        continue;
+
+                    // occlusion culling
+                    if (occlusion && !occlusion->IsVisible(worldBounds))
+                    {
+                        chunk.occluded++;
+                        continue;
+                    }
+
+                    VisibleItem v;
+                    v.model = item.model;
+                    glm::mat3 normalMatrix = glm::inverseTranspose(glm::mat3(view*item.modelMatrix));
+                    DrawCommandList::PackDrawData(v.data, item.modelMatrix, normalMatrix, item.diffuseColor);
+                    chunk.visible.push_back(v);
+                    chunk.counts[item.model] += batch.modelNumRanges[item.model];
+                }
+            }
+        });
+
+        ////// prefix sum: for each chunk and model, we calculate the position of the first command in the final list
+        // the commands are sorted by model, and, inside the same model, by chunk (= in the original order of the objects)
+        size_t total = 0;
+        this->numVisible = 0;
+        this->numOccluded = 0;
+        for (size_t m = 0; m < numModels; m++)
+        {
+            for (size_t c = 0; c < numChunks; c++)
+            {
+                size_t count = chunks[c].counts[m];
+                chunks[c].counts[m] = total;
+                total += count;
+            }
+        }
+        for (size_t c = 0; c < numChunks; c++)
+        {
+            this->numVisible += chunks[c].visible.size();
+            this->numOccluded += chunks[c].occluded;
+        }
+
+        ////// STEP 2: each job writes its commands in its own part of the final list
+        list.Resize(total);
+        jobs.ParallelFor(numChunks, 1, [&](size_t firstChunk, size_t lastChunk)
+        {
+            for (size_t c = firstChunk; c < lastChunk; c++)
+            {
+                Chunk& chunk = chunks[c];
+                for (size_t v = 0; v < chunk.visible.size(); v++)
+                {
+                    const VisibleItem& item = chunk.visible[v];
+                    GLuint first = batch.modelFirstRange[item.model];
+                    GLuint last = first + batch.modelNumRanges[item.model];
+                    for (GLuint r = first; r < last; r++)
+                        list.Set(chunk.counts[item.model]++, batch.ranges[r], item.data);
+                }
+            }
+        });
+
+        this->numItems = numItems;
+        this->numCommands = total;
+    }
+
+private:
+    // a visible object, with its packed per-draw data
+    struct VisibleItem {
+        GLuint model;
+        DrawData data;
+    };
+
+    // local data of a job: the visible objects, and the number of commands for each model (after the prefix sum, the position in the final list)
+    struct Chunk {
+        vector<VisibleItem> visible;
+        vector<size_t> counts;
+        // number of objects culled by the occlusion test
+        size_t occluded;
+    };
+
+    // the chunks are kept between frames, to avoid new allocations at each frame
+    vector<Chunk> chunks;
+};
@@ -0,0 +1,158 @@
+/*
+Packed environment container (".renv" files)
+- a cube map in a single file: the 6 faces of all the levels of the mipmap chain, as 8 bit RGB or half float RGB (for HDR environments).
+  The files are created by the environment converter (tools/environment_converter), from the folders of 6 images or from an equirectangular image
+- as the ".rtex" files (include/utils/texture_container.h), the file is designed to be memory mapped: the data of each level contain the 6 faces one after the other
+  (in the OpenGL order +X, -X, +Y, -Y, +Z, -Z), so a level can be uploaded with a single call (glTextureSubImage3D, with OpenGL 4.5) directly from the mapped memory,
+  without decoding any image
+
+Layout of the file:
+    EnvironmentFileHeader                  (magic "RENV", version, format, size of the faces of level 0, number of levels)
+    EnvironmentFileLevel[numLevels]        (offset from the beginning of the file, size in bytes of the 6 faces and size of the faces of each level)
+    data of the levels                     (level 0 = largest level, each one aligned to 16 bytes)
+
+The file also contains the functions to find the images of the faces in a folder: the cube maps of the course use two naming conventions
+(posx, negx, posy, negy, posz, negz or right, left, top, bottom, front, back), with .jpg or .png images.
+
+see:
+https://www.khronos.org/opengl/wiki/Cubemap_Texture
+https://registry.khronos.org/KTX/specs/1.0/ktxspec.v1.html
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <utils/texture_container.h>
+
+// version of the format: files with a different version are rejected by the loader, and they must be converted again
+#define ENVIRONMENT_FILE_VERSION 1
+
+// formats of the texels
+enum environment_file_formats {
+    ENVIRONMENT_FORMAT_RGB8 = 1,    // 3 bytes for each texel
+    ENVIRONMENT_FORMAT_RGB16F = 2   // 3 half floats (6 bytes) for each texel
+};
+
+// header of the file
+struct EnvironmentFileHeader {
+    char magic[4];          // "RENV"
+    uint32_t version;
+    uint32_t format;        // one of environment_file_formats
+    uint32_t faceSize;      // width and height of the faces of level 0
+    uint32_t numLevels;
+    uint32_t reserved[3];
+};
+
+// description of a level (6 faces)
+struct EnvironmentFileLevel {
+    uint32_t offset;        // from the beginning of the file
+    uint32_t size;          // in bytes, for all the 6 faces
+    uint32_t faceSize;
+    uint32_t reserved;
+};
+
+// names of the faces (without extension) in the naming conventions of the cube maps of the course, in the order of the faces of OpenGL (+X, -X, +Y, -Y, +Z, -Z)
+static const char* cubeFaceConventions[2][6] = {
+    { "posx", "negx", "posy", "negy", "posz", "negz" },
+    { "right", "left", "top", "bottom", "front", "back" }
+};
+static const char* cubeFaceExtensions[2] = { ".jpg", ".png" };
+
+//////////////////////////////////////////
+// modification time of a file (-1 if the file does not exist)
+inline long long FileModificationTime(const string& path)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+        return -1;
+    return (long long)info.st_mtime;
+}
+
+//////////////////////////////////////////
+// paths of the 6 faces of the cube map in "folder" (which must end with a separator): we search for the first face with all the combinations
+// of naming convention and extension. If no face is found, we return the paths of the first convention (the loading will report the error)
+inline vector<string> CubeFacePaths(const string& folder)
+{
+    int convention = 0, extension = 0;
+    for (int c = 0; c < 2; c++)
+        for (int e = 0; e < 2; e++)
+        {
+            if (FileModificationTime(folder + cubeFaceConventions[c][0] + cubeFaceExtensions[e]) >= 0)
+            {
+                convention = c;
+                extension = e;
+                c = e = 2;
+            }
+        }
+    vector<string> paths(6);
+    for (int f = 0; f < 6; f++)
+        paths[f] = folder + cubeFaceConventions[convention][f] + cubeFaceExtensions[extension];
+    return paths;
+}
+
+//////////////////////////////////////////
+// size in bytes of a texel
+inline uint32_t EnvironmentTexelSize(uint32_t format)
+{
+    return (format == ENVIRONMENT_FORMAT_RGB16F ? 6 : 3);
+}
+
+//////////////////////////////////////////
+// conversion of a float to half float (IEEE 754 binary16), with rounding to the nearest value. The values too large are clamped to the maximum half float,
+// the values too small are flushed to 0
+inline uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, 4);
+    uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+    if (exponent <= 0)
+        return sign;
+    if (exponent >= 31)
+        return (uint16_t)(sign | 0x7BFF);
+    uint16_t half = (uint16_t)(sign | (exponent << 10) | (mantissa >> 13));
+    // rounding: the carry can propagate to the exponent, which is correct
+    if (mantissa & 0x1000)
+        half++;
+    return ((half & 0x7FFF) >= 0x7C00 ? (uint16_t)(sign | 0x7BFF) : half);
+}
+
+//////////////////////////////////////////
+// we validate the header and the table of the levels of a mapped file. It returns the header, or nullptr if the file is not valid
+inline const EnvironmentFileHeader* ValidateEnvironmentFile(const MappedFile& file)
+{
+    if (file.Data() == nullptr || file.Size() < sizeof(EnvironmentFileHeader))
+        return nullptr;
+    const EnvironmentFileHeader* header = (const EnvironmentFileHeader*)file.Data();
+    if (memcmp(header->magic, "RENV", 4) != 0 || header->version != ENVIRONMENT_FILE_VERSION || header->numLevels == 0
+        || (header->format != ENVIRONMENT_FORMAT_RGB8 && header->format != ENVIRONMENT_FORMAT_RGB16F))
+        return nullptr;
+    if (file.Size() < sizeof(EnvironmentFileHeader) + header->numLevels * sizeof(EnvironmentFileLevel))
+        return nullptr;
+    // each level must contain the 6 faces, and it must be inside the file
+    const EnvironmentFileLevel* levels = (const EnvironmentFileLevel*)(file.Data() + sizeof(EnvironmentFileHeader));
+    for (uint32_t l = 0; l < header->numLevels; l++)
+    {
+        if (levels[l].size != 6 * levels[l].faceSize * levels[l].faceSize * EnvironmentTexelSize(header->format))
+            return nullptr;
+        if ((size_t)levels[l].offset + levels[l].size > file.Size())
+            return nullptr;
+    }
+    return header;
+}
@@ -0,0 +1,99 @@
+/*
+FrameStats class
+- collection of per-frame statistics (number of draw calls, culled objects, CPU times, etc)
+- the values are averaged over an interval of time (1 second by default), and then printed on the console
+
+Usage:
+    stats.Add("draws", numDraws);   // during the frame, for each value to collect
+    stats.EndFrame();               // at the end of the frame: every "interval" seconds, the averages are printed and the values are reset
+
+FrameStats::Now() returns the current time in milliseconds, and it can be used to measure CPU times.
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+
+/////////////////// FRAMESTATS class ///////////////////////
+class FrameStats
+{
+public:
+    // if false, the values are collected but not printed
+    bool enabled;
+
+    //////////////////////////////////////////
+    // constructor
+    FrameStats(double interval = 1.0) : enabled(true), interval(interval * 1000.0), numFrames(0)
+    {
+        this->start = Now();
+    }
+
+    //////////////////////////////////////////
+    // current time, in milliseconds
+    static double Now()
+    {
+        return chrono::duration<double, milli>(chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    //////////////////////////////////////////
+    // we add a value to the statistics of the current frame (the values with the same name are summed)
+    void Add(const string& name, double value)
+    {
+        for (size_t i = 0; i < this->names.size(); i++)
+        {
+            if (this->names[i] == name)
+            {
+                this->values[i] += value;
+                return;
+            }
+        }
+        // the values are printed in the order of their first insertion
+        this->names.push_back(name);
+        this->values.push_back(value);
+    }
+
+    //////////////////////////////////////////
+    // end of the frame: if the interval has passed, we print the averages, and we reset the values
+    void EndFrame()
+    {
+        this->numFrames++;
+        double now = Now();
+        if (now - this->start < this->interval)
+            return;
+
+        if (this->enabled)
+        {
+            cout << "[stats] fps: " << fixed << setprecision(1) << (this->numFrames * 1000.0 / (now - this->start));
+            for (size_t i = 0; i < this->names.size(); i++)
+                cout << " | " << this->names[i] << ": " << setprecision(2) << (this->values[i] / this->numFrames);
+            cout << endl;
+        }
+
+        for (size_t i = 0; i < this->values.size(); i++)
+            this->values[i] = 0.0;
+        this->numFrames = 0;
+        this->start = now;
+    }
+
+private:
+    // interval of time between two prints (in milliseconds)
+    double interval;
+    double start;
+    unsigned int numFrames;
+    // names and accumulated values of the statistics
+    vector<string> names;
+    vector<double> values;
+};
@@ -0,0 +1,166 @@
+/*
+GBuffer class
+- creation of the Frame Buffer Object used as G-buffer in deferred shading
+- the geometry pass saves, for each pixel, the data needed to apply the illumination model in a later lighting pass
+
+Layout of the G-buffer:
+- color attachment 0 (RGBA16F): normal in view coordinates (xyz), roughness alpha of GGX (w)
+- color attachment 1 (RGBA8): diffuse color (xyz), Fresnel reflectance at normal incidence F0 (w)
+- color attachment 2 (RGBA16F): Ka, Kd, Ks, shininess of Blinn-Phong
+- depth attachment (24 bit): depth of the fragment. The position in view coordinates is reconstructed in the lighting pass, using the inverse of the projection matrix
+
+The lighting pass renders in a second FBO (lightFBO), with a color texture and a copy of the depth of the G-buffer (BindForLighting()): the light volumes can
+then use the depth test against the visible surfaces, without reading and testing the same depth texture (which would be a feedback loop). At the end,
+ResolveLighting() copies the result in the default framebuffer.
+
+N.B. 1) the normal is saved with 16 bit floating point components, to avoid banding in the specular highlights. The shininess is saved in a floating point texture too, because it can be larger than 1
+N.B. 2) the textures use GL_NEAREST filtering: in the lighting pass we read exactly the data of the pixel, without interpolations
+
+see:
+https://learnopengl.com/Advanced-Lighting/Deferred-Shading
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <iostream>
+
+// names of the textures of the G-buffer
+enum gbuffer_textures{ GBUFFER_NORMAL, GBUFFER_ALBEDO, GBUFFER_MATERIAL, GBUFFER_DEPTH, GBUFFER_NUM_TEXTURES};
+
+/////////////////// GBUFFER class ///////////////////////
+class GBuffer
+{
+public:
+    // the Frame Buffer Object
+    GLuint FBO;
+    // the textures of the G-buffer
+    GLuint textures[GBUFFER_NUM_TEXTURES];
+    // dimensions of the G-buffer
+    GLuint width, height;
+    // the Frame Buffer Object of the lighting pass, with its color texture and its depth buffer (a copy of the depth of the G-buffer)
+    GLuint lightFBO, lightTexture, lightDepth;
+
+    // GBuffer is not copyable (the destructor deletes the OpenGL objects)
+    GBuffer(const GBuffer& copy) = delete;
+    GBuffer& operator=(const GBuffer&) = delete;
+
+    //////////////////////////////////////////
+    // constructor: we create the textures and the FBO
+    GBuffer(GLuint width, GLuint height) : width(width), height(height)
+    {
+        glGenFramebuffers(1, &this->FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
+
+        glGenTextures(GBUFFER_NUM_TEXTURES, this->textures);
+        this->CreateTexture(GBUFFER_NORMAL, GL_RGBA16F, GL_RGBA, GL_FLOAT, GL_COLOR_ATTACHMENT0);
+        this->CreateTexture(GBUFFER_ALBEDO, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT1);
+        this->CreateTexture(GBUFFER_MATERIAL, GL_RGBA16F, GL_RGBA, GL_FLOAT, GL_COLOR_ATTACHMENT2);
+        this->CreateTexture(GBUFFER_DEPTH, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT, GL_DEPTH_ATTACHMENT);
+
+        // the fragment shader of the geometry pass writes on 3 color attachments
+        GLenum attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+        glDrawBuffers(3, attachments);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::GBUFFER:: Framebuffer is not complete!" << std::endl;
+
+        // FBO of the lighting pass: the depth buffer has the same format of the depth of the G-buffer, as required by glBlitFramebuffer
+        glGenFramebuffers(1, &this->lightFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, this->lightFBO);
+        glGenTextures(1, &this->lightTexture);
+        glBindTexture(GL_TEXTURE_2D, this->lightTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, this->width, this->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->lightTexture, 0);
+        glGenRenderbuffers(1, &this->lightDepth);
+        glBindRenderbuffer(GL_RENDERBUFFER, this->lightDepth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, this->width, this->height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, this->lightDepth);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::GBUFFER:: Lighting framebuffer is not complete!" << std::endl;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    //////////////////////////////////////////
+    // destructor
+    ~GBuffer()
+    {
+        glDeleteTextures(GBUFFER_NUM_TEXTURES, this->textures);
+        glDeleteFramebuffers(1, &this->FBO);
+        glDeleteTextures(1, &this->lightTexture);
+        glDeleteRenderbuffers(1, &this->lightDepth);
+        glDeleteFramebuffers(1, &this->lightFBO);
+    }
+
+    //////////////////////////////////////////
+    // we bind the G-buffer as the destination of the rendering (geometry pass)
+    void BindForWriting()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
+        glViewport(0, 0, this->width, this->height);
+    }
+
+    //////////////////////////////////////////
+    // we copy the depth of the G-buffer in the depth buffer of the lighting pass, and we bind its FBO as the destination of the rendering
+    // the color texture is cleared with the current clear color
+    void BindForLighting()
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, this->FBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->lightFBO);
+        glBlitFramebuffer(0, 0, this->width, this->height, 0, 0, this->width, this->height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, this->lightFBO);
+        glViewport(0, 0, this->width, this->height);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+
+    //////////////////////////////////////////
+    // we copy the result of the lighting pass in the default framebuffer
+    void ResolveLighting()
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, this->lightFBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, this->width, this->height, 0, 0, this->width, this->height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    //////////////////////////////////////////
+    // we bind the textures of the G-buffer to the texture units [firstUnit, firstUnit + GBUFFER_NUM_TEXTURES) (lighting pass)
+    // the samplers in the shader must have the names used below
+    void BindForReading(GLuint program, GLuint firstUnit = 0)
+    {
+        const char* names[GBUFFER_NUM_TEXTURES] = { "gNormal", "gAlbedo", "gMaterial", "gDepth" };
+        for (GLuint i = 0; i < GBUFFER_NUM_TEXTURES; i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+            glBindTexture(GL_TEXTURE_2D, this->textures[i]);
+            glUniform1i(glGetUniformLocation(program, names[i]), firstUnit + i);
+        }
+    }
+
+private:
+    //////////////////////////////////////////
+    // we create a texture of the G-buffer, and we attach it to the FBO
+    void CreateTexture(GLuint index, GLint internalFormat, GLenum format, GLenum type, GLenum attachment)
+    {
+        glBindTexture(GL_TEXTURE_2D, this->textures[index]);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, this->width, this->height, 0, format, type, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, this->textures[index], 0);
+    }
+};
@@ -0,0 +1,672 @@
+/*
+Image Based Lighting baker
+- CPU precomputation (multi-threaded, using a JobSystem) of the data needed to use a cube map as a source of ambient lighting with the GGX model:
+    - the irradiance of the environment (diffuse component), projected on the first 9 Spherical Harmonics (3 bands): the coefficients are already convolved with the
+      cosine lobe and divided by PI, so the shader obtains the diffuse contribution with a dot product with the SH basis of the normal, without any texture fetch
+    - the "pre-filtered" environment (specular component): a cube map with a mipmap chain, where level l contains the environment convolved with the GGX lobe of
+      alpha = l / (numLevels-1). The convolution uses importance sampling of the GGX distribution, and each sample is read from the mipmap level of the source
+      with the same solid angle of the sample (filtered importance sampling), to avoid noise with a few samples
+    - the "split-sum" BRDF look-up table: a 2D table, indexed by (N.V, alpha), with the scale and the bias to apply to F0 to obtain the integral of the specular BRDF
+      on the hemisphere. It does not depend on the environment, so there is only one table for all the cube maps
+  At runtime, the GGX shader needs only 1 fetch of the pre-filtered cube map and 1 fetch of the table for the specular component
+- the results are saved in binary files (".ibl"), used as a cache: the baking is repeated only if the cache is missing, if it has been created with different
+  parameters, or if it is older than the images of the cube map
+
+The cube maps are loaded from the 6 images of the faces (named posx, negx, posy, negy, posz, negz or right, left, top, bottom, front, back), with extension .jpg or .png.
+The functions to sample, resample and filter the cube maps on the CPU (CubeImage) are used also by the environment converter (tools/environment_converter).
+Following the other shaders of the course, the values of the images are used directly as radiance (without gamma decoding), in [0,1].
+
+N.B. 1) the implementation of stb_image must be included in the application (#define STB_IMAGE_IMPLEMENTATION before including stb_image.h)
+N.B. 2) in this code, alpha is the GGX parameter used directly by the shaders of the course (D = alpha^2 / (PI * ((N.H)^2 * (alpha^2 - 1) + 1)^2)),
+        and the k factor of the Schlick-GGX geometric term for IBL is alpha^2/2
+N.B. 3) this file does not call OpenGL functions: the upload of the baked data is in include/utils/image_based_lighting.h, and the baking can be done also offline with tools/ibl_baker
+
+see:
+https://cdn2.unrealengine.com/Resources/files/2013SiggraphPresentationsNotes-26915738.pdf
+https://learnopengl.com/PBR/IBL/Specular-IBL
+https://graphics.stanford.edu/papers/envmap/envmap.pdf
+https://developer.nvidia.com/gpugems/gpugems3/part-iii-rendering/chapter-20-gpu-based-importance-sampling
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "stb_image/stb_image.h"
+
+#include <glm/glm.hpp>
+
+#include <utils/job_system.h>
+#include <utils/environment_container.h>
+
+// version of the cache files: files with a different version are baked again
+#define IBL_FILE_VERSION 1
+
+// content of a cache file
+enum ibl_file_types {
+    IBL_FILE_ENVIRONMENT = 1,   // SH coefficients + pre-filtered cube map
+    IBL_FILE_BRDF_LUT = 2       // split-sum BRDF table
+};
+
+// header of a cache file. It is followed by:
+// - IBL_FILE_ENVIRONMENT: 27 floats (9 RGB SH coefficients), and the levels of the pre-filtered cube map (for each level, the 6 faces in the OpenGL order, RGB floats)
+// - IBL_FILE_BRDF_LUT: size x size RG floats
+struct IBLFileHeader {
+    char magic[4];          // "RIBL"
+    uint32_t version;
+    uint32_t type;          // one of ibl_file_types
+    uint32_t size;          // size of the level 0 of the cube map, or of the table
+    uint32_t numLevels;
+    uint32_t numSamples;    // samples used by the importance sampling
+    uint32_t reserved[2];
+};
+
+// parameters of the baking
+struct IBLSettings {
+    int specularSize;       // size of the faces of the level 0 of the pre-filtered cube map
+    int numLevels;          // number of levels of the pre-filtered cube map (the last one is for alpha = 1)
+    int numSamples;         // samples for each texel of the pre-filtered cube map
+    int lutSize;            // size of the BRDF table
+    int lutSamples;         // samples for each texel of the BRDF table
+    IBLSettings() : specularSize(128), numLevels(6), numSamples(128), lutSize(64), lutSamples(512) {}
+};
+
+// a cube map in memory: for each face, size x size RGB floats (the first row is the row with t = 0 in OpenGL)
+struct CubeImage {
+    int size;
+    vector<float> faces[6];
+    CubeImage() : size(0) {}
+};
+
+// the baked data of an environment
+struct EnvironmentIBL {
+    // SH coefficients (RGB) of the irradiance, already convolved with the cosine lobe and divided by PI
+    float sh[27];
+    // levels of the pre-filtered cube map
+    vector<CubeImage> specular;
+};
+
+//////////////////////////////////////////
+// conversion between sRGB encoded values and linear values, both in [0,1]
+inline float SRGBValueToLinear(float c)
+{
+    return (c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f));
+}
+
+inline float LinearToSRGBValue(float c)
+{
+    return (c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f);
+}
+
+//////////////////////////////////////////
+// direction corresponding to the point (sc, tc) (in [-1,1]) of a face of the cube map, following the conventions of the OpenGL specification
+inline glm::vec3 CubeDirection(int face, float sc, float tc)
+{
+    glm::vec3 d;
+    switch (face)
+    {
+        case 0: d = glm::vec3(1.0f, -tc, -sc); break;
+        case 1: d = glm::vec3(-1.0f, -tc, sc); break;
+        case 2: d = glm::vec3(sc, 1.0f, tc); break;
+        case 3: d = glm::vec3(sc, -1.0f, -tc); break;
+        case 4: d = glm::vec3(sc, -tc, 1.0f); break;
+        default: d = glm::vec3(-sc, -tc, -1.0f); break;
+    }
+    return glm::normalize(d);
+}
+
+//////////////////////////////////////////
+// face of the cube map and coordinates (s, t) in [0,1] corresponding to a direction (inverse of CubeDirection)
+inline void CubeCoordinates(const glm::vec3& d, int& face, float& s, float& t)
+{
+    glm::vec3 a = glm::abs(d);
+    float ma, sc, tc;
+    if (a.x >= a.y && a.x >= a.z)
+    {
+        face = (d.x > 0.0f ? 0 : 1);
+        ma = a.x;
+        sc = (d.x > 0.0f ? -d.z : d.z);
+        tc = -d.y;
+    }
+    else if (a.y >= a.z)
+    {
+        face = (d.y > 0.0f ? 2 : 3);
+        ma = a.y;
+        sc = d.x;
+        tc = (d.y > 0.0f ? d.z : -d.z);
+    }
+    else
+    {
+        face = (d.z > 0.0f ? 4 : 5);
+        ma = a.z;
+        sc = (d.z > 0.0f ? d.x : -d.x);
+        tc = -d.y;
+    }
+    s = 0.5f * (sc / ma + 1.0f);
+    t = 0.5f * (tc / ma + 1.0f);
+}
+
+//////////////////////////////////////////
+// bilinear sampling of a cube map in a direction (the coordinates are clamped at the borders of each face)
+inline glm::vec3 SampleCube(const CubeImage& cube, const glm::vec3& d)
+{
+    int face;
+    float s, t;
+    CubeCoordinates(d, face, s, t);
+    float fx = s * cube.size - 0.5f, fy = t * cube.size - 0.5f;
+    fx = glm::clamp(fx, 0.0f, (float)(cube.size - 1));
+    fy = glm::clamp(fy, 0.0f, (float)(cube.size - 1));
+    int x0 = (int)fx, y0 = (int)fy;
+    int x1 = (x0 + 1 < cube.size ? x0 + 1 : x0), y1 = (y0 + 1 < cube.size ? y0 + 1 : y0);
+    float tx = fx - x0, ty = fy - y0;
+    const float* p = &cube.faces[face][0];
+    const float* p00 = p + ((size_t)y0 * cube.size + x0) * 3;
+    const float* p01 = p + ((size_t)y0 * cube.size + x1) * 3;
+    const float* p10 = p + ((size_t)y1 * cube.size + x0) * 3;
+    const float* p11 = p + ((size_t)y1 * cube.size + x1) * 3;
+    glm::vec3 top = glm::mix(glm::vec3(p00[0], p00[1], p00[2]), glm::vec3(p01[0], p01[1], p01[2]), tx);
+    glm::vec3 bottom = glm::mix(glm::vec3(p10[0], p10[1], p10[2]), glm::vec3(p11[0], p11[1], p11[2]), tx);
+    return glm::mix(top, bottom, ty);
+}
+
+//////////////////////////////////////////
+// trilinear sampling of a mipmap chain of cube maps (level 0 = largest)
+inline glm::vec3 SampleCubeLod(const vector<CubeImage>& chain, const glm::vec3& d, float lod)
+{
+    lod = glm::clamp(lod, 0.0f, (float)(chain.size() - 1));
+    int l0 = (int)lod;
+    int l1 = (l0 + 1 < (int)chain.size() ? l0 + 1 : l0);
+    return glm::mix(SampleCube(chain[l0], d), SampleCube(chain[l1], d), lod - l0);
+}
+
+//////////////////////////////////////////
+// we load the 6 images of a cube map (decoded in parallel), converting them to RGB floats. The faces must be square, with the same size
+inline bool LoadCubeImage(const vector<string>& paths, CubeImage& cube, JobSystem* jobs)
+{
+    vector<unsigned char*> pixels(6, nullptr);
+    vector<int> sizes(12, 0);
+    auto decode = [&paths, &pixels, &sizes](size_t begin, size_t end)
+    {
+        for (size_t f = begin; f < end; f++)
+        {
+            int channels;
+            pixels[f] = stbi_load(paths[f].c_str(), &sizes[2*f], &sizes[2*f+1], &channels, 3);
+        }
+    };
+    if (jobs != nullptr)
+        jobs->ParallelFor(6, 1, decode);
+    else
+        decode(0, 6);
+
+    bool valid = true;
+    for (int f = 0; f < 6; f++)
+    {
+        if (pixels[f] == nullptr)
+        {
+            std::cout << "Failed to load cube map face: " << paths[f] << std::endl;
+            valid = false;
+        }
+        else if (sizes[2*f] != sizes[2*f+1] || sizes[2*f] != sizes[0])
+        {
+            std::cout << "The faces of the cube map must be square, with the same size: " << paths[f] << std::endl;
+            valid = false;
+        }
+    }
+    if (valid)
+    {
+        cube.size = sizes[0];
+        for (int f = 0; f < 6; f++)
+        {
+            size_t count = (size_t)cube.size * cube.size * 3;
+            cube.faces[f].resize(count);
+            for (size_t i = 0; i < count; i++)
+                cube.faces[f][i] = pixels[f][i] / 255.0f;
+        }
+    }
+    for (int f = 0; f < 6; f++)
+        stbi_image_free(pixels[f]);
+    return valid;
+}
+
+//////////////////////////////////////////
+// we create the mipmap chain of a cube map (2x2 box filter), until the 1x1 level
+// if gammaCorrect is true, the values are sRGB encoded, and they are averaged in linear space (as in DownsampleImage() of the texture baker)
+inline void BuildCubeMipChain(const CubeImage& base, vector<CubeImage>& chain, bool gammaCorrect = false)
+{
+    chain.assign(1, base);
+    if (gammaCorrect)
+    {
+        for (int f = 0; f < 6; f++)
+            for (size_t i = 0; i < chain[0].faces[f].size(); i++)
+                chain[0].faces[f][i] = SRGBValueToLinear(chain[0].faces[f][i]);
+    }
+    while (chain.back().size > 1)
+    {
+        const CubeImage& src = chain.back();
+        CubeImage dst;
+        dst.size = src.size / 2;
+        for (int f = 0; f < 6; f++)
+        {
+            dst.faces[f].resize((size_t)dst.size * dst.size * 3);
+            for (int y = 0; y < dst.size; y++)
+                for (int x = 0; x < dst.size; x++)
+                    for (int c = 0; c < 3; c++)
+                    {
+                        const float* p = &src.faces[f][c];
+                        size_t row0 = (size_t)(2*y) * src.size, row1 = (size_t)(2*y+1) * src.size;
+                        dst.faces[f][((size_t)y * dst.size + x) * 3 + c] = 0.25f * (p[(row0 + 2*x) * 3] + p[(row0 + 2*x+1) * 3] + p[(row1 + 2*x) * 3] + p[(row1 + 2*x+1) * 3]);
+                    }
+        }
+        chain.push_back(dst);
+    }
+    if (gammaCorrect)
+    {
+        for (size_t l = 0; l < chain.size(); l++)
+            for (int f = 0; f < 6; f++)
+                for (size_t i = 0; i < chain[l].faces[f].size(); i++)
+                    chain[l].faces[f][i] = (l == 0 ? base.faces[f][i] : LinearToSRGBValue(chain[l].faces[f][i]));
+    }
+}
+
+//////////////////////////////////////////
+// we resample a cube map to faces of size x size, with a bilinear filter (the source should be the level of its mipmap chain with the closest size)
+inline void ResampleCube(const CubeImage& source, int size, CubeImage& cube, JobSystem* jobs)
+{
+    cube.size = size;
+    for (int f = 0; f < 6; f++)
+        cube.faces[f].resize((size_t)size * size * 3);
+    auto resample = [&source, &cube, size](size_t begin, size_t end)
+    {
+        for (size_t row = begin; row < end; row++)
+        {
+            int f = (int)(row / size), y = (int)(row % size);
+            for (int x = 0; x < size; x++)
+            {
+                glm::vec3 color = SampleCube(source, CubeDirection(f, 2.0f * (x + 0.5f) / size - 1.0f, 2.0f * (y + 0.5f) / size - 1.0f));
+                float* out = &cube.faces[f][((size_t)y * size + x) * 3];
+                out[0] = color.r;
+                out[1] = color.g;
+                out[2] = color.b;
+            }
+        }
+    };
+    if (jobs != nullptr)
+        jobs->ParallelFor((size_t)6 * size, 16, resample);
+    else
+        resample(0, (size_t)6 * size);
+}
+
+//////////////////////////////////////////
+// we convert an equirectangular (latitude-longitude) image (RGB floats, w x h) to a cube map with faces of size x size, with a bilinear filter.
+// The center of the image is the -Z direction, the top row is the +Y direction
+inline void EquirectangularToCube(const float* pixels, int w, int h, int size, CubeImage& cube, JobSystem* jobs)
+{
+    cube.size = size;
+    for (int f = 0; f < 6; f++)
+        cube.faces[f].resize((size_t)size * size * 3);
+    auto convert = [pixels, w, h, &cube, size](size_t begin, size_t end)
+    {
+        for (size_t row = begin; row < end; row++)
+        {
+            int f = (int)(row / size), y = (int)(row % size);
+            for (int x = 0; x < size; x++)
+            {
+                glm::vec3 d = CubeDirection(f, 2.0f * (x + 0.5f) / size - 1.0f, 2.0f * (y + 0.5f) / size - 1.0f);
+                // longitude and latitude of the direction, in [0,1]
+                float u = atan2f(d.x, -d.z) / (2.0f * 3.14159265f) + 0.5f;
+                float v = acosf(glm::clamp(d.y, -1.0f, 1.0f)) / 3.14159265f;
+                float fx = u * w - 0.5f, fy = glm::clamp(v * h - 0.5f, 0.0f, (float)(h - 1));
+                // the longitude wraps around, the latitude is clamped
+                int x0 = (int)floorf(fx), y0 = (int)fy;
+                float tx = fx - x0, ty = fy - y0;
+                int x1 = (x0 + 1) % w, y1 = (y0 + 1 < h ? y0 + 1 : y0);
+                x0 = (x0 + w) % w;
+                float* out = &cube.faces[f][((size_t)y * size + x) * 3];
+                for (int c = 0; c < 3; c++)
+                {
+                    float top = pixels[((size_t)y0 * w + x0) * 3 + c] * (1.0f - tx) + pixels[((size_t)y0 * w + x1) * 3 + c] * tx;
+                    float bottom = pixels[((size_t)y1 * w + x0) * 3 + c] * (1.0f - tx) + pixels[((size_t)y1 * w + x1) * 3 + c] * tx;
+                    out[c] = top * (1.0f - ty) + bottom * ty;
+                }
+            }
+        }
+    };
+    if (jobs != nullptr)
+        jobs->ParallelFor((size_t)6 * size, 16, convert);
+    else
+        convert(0, (size_t)6 * size);
+}
+
+//////////////////////////////////////////
+// projection of the environment on the first 9 real Spherical Harmonics. Each texel is weighted by its solid angle.
+// The faces are processed in parallel, and then the partial sums are added. The coefficients are convolved with the cosine lobe
+// (factors PI, 2PI/3, PI/4 for the 3 bands) and divided by PI, so the shader evaluates directly the irradiance divided by PI
+inline void ProjectSH9(const CubeImage& cube, float sh[27], JobSystem* jobs)
+{
+    vector<double> partial(6 * 27, 0.0);
+    auto project = [&cube, &partial](size_t begin, size_t end)
+    {
+        for (size_t f = begin; f < end; f++)
+        {
+            double* sum = &partial[f * 27];
+            for (int y = 0; y < cube.size; y++)
+            {
+                float tc = 2.0f * (y + 0.5f) / cube.size - 1.0f;
+                for (int x = 0; x < cube.size; x++)
+                {
+                    float sc = 2.0f * (x + 0.5f) / cube.size - 1.0f;
+                    // solid angle of the texel (approximation, valid for small texels)
+                    float r2 = 1.0f + sc * sc + tc * tc;
+                    float weight = 4.0f / ((float)cube.size * cube.size * r2 * sqrtf(r2));
+                    glm::vec3 d = CubeDirection((int)f, sc, tc);
+                    float basis[9] = { 0.282095f,
+                                       0.488603f * d.y, 0.488603f * d.z, 0.488603f * d.x,
+                                       1.092548f * d.x * d.y, 1.092548f * d.y * d.z, 0.315392f * (3.0f * d.z * d.z - 1.0f),
+                                       1.092548f * d.x * d.z, 0.546274f * (d.x * d.x - d.y * d.y) };
+                    const float* texel = &cube.faces[f][((size_t)y * cube.size + x) * 3];
+                    for (int i = 0; i < 9; i++)
+                        for (int c = 0; c < 3; c++)
+                            sum[i * 3 + c] += (double)texel[c] * basis[i] * weight;
+                }
+            }
+        }
+    };
+    if (jobs != nullptr)
+        jobs->ParallelFor(6, 1, project);
+    else
+        project(0, 6);
+
+    // convolution with the cosine lobe, divided by PI
+    const float band[9] = { 1.0f, 2.0f/3.0f, 2.0f/3.0f, 2.0f/3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+    for (int i = 0; i < 27; i++)
+    {
+        double total = 0.0;
+        for (int f = 0; f < 6; f++)
+            total += partial[f * 27 + i];
+        sh[i] = (float)total * band[i / 3];
+    }
+}
+
+//////////////////////////////////////////
+// i-th point of the Hammersley sequence of n points in [0,1]^2 (the second coordinate is the radical inverse in base 2)
+inline glm::vec2 Hammersley(uint32_t i, uint32_t n)
+{
+    uint32_t bits = i;
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return glm::vec2((float)i / n, bits * 2.3283064365386963e-10f);
+}
+
+//////////////////////////////////////////
+// half vector sampled from the GGX distribution, in tangent space (Z = normal), for the point u of [0,1]^2
+inline glm::vec3 ImportanceSampleGGX(const glm::vec2& u, float alpha)
+{
+    float phi = 2.0f * 3.14159265f * u.x;
+    float cosTheta = sqrtf((1.0f - u.y) / (1.0f + (alpha * alpha - 1.0f) * u.y));
+    float sinTheta = sqrtf(1.0f - cosTheta * cosTheta);
+    return glm::vec3(sinTheta * cosf(phi), sinTheta * sinf(phi), cosTheta);
+}
+
+//////////////////////////////////////////
+// we calculate the pre-filtered cube map: level l is the convolution of the environment with the GGX lobe of alpha = l / (numLevels-1),
+// with the assumption N = V = R. The texels of all the faces of a level are processed in parallel, a row for each job.
+// The half vectors of the samples are the same for all the texels of a level: they are calculated once, in tangent space
+inline void PrefilterGGX(const vector<CubeImage>& source, const IBLSettings& settings, vector<CubeImage>& levels, JobSystem* jobs)
+{
+    levels.assign(settings.numLevels, CubeImage());
+    // solid angle of a texel of the level 0 of the source
+    float texelSolidAngle = 4.0f * 3.14159265f / (6.0f * source[0].size * source[0].size);
+    for (int l = 0; l < settings.numLevels; l++)
+    {
+        CubeImage& level = levels[l];
+        level.size = (settings.specularSize >> l > 0 ? settings.specularSize >> l : 1);
+        for (int f = 0; f < 6; f++)
+            level.faces[f].resize((size_t)level.size * level.size * 3);
+        float alpha = (settings.numLevels > 1 ? (float)l / (settings.numLevels - 1) : 0.0f);
+
+        // samples of the level: half vector, and level of the source to read (filtered importance sampling)
+        vector<glm::vec3> halfVectors;
+        vector<float> lods;
+        if (l > 0)
+        {
+            for (int i = 0; i < settings.numSamples; i++)
+            {
+                glm::vec3 H = ImportanceSampleGGX(Hammersley(i, settings.numSamples), alpha);
+                // with N = V, pdf = D(H) * N.H / (4 * V.H) = D(H) / 4
+                float a2 = alpha * alpha;
+                float denom = H.z * H.z * (a2 - 1.0f) + 1.0f;
+                float pdf = a2 / (3.14159265f * denom * denom) / 4.0f;
+                float sampleSolidAngle = 1.0f / (settings.numSamples * pdf + 0.0001f);
+                halfVectors.push_back(H);
+                lods.push_back(0.5f * log2f(sampleSolidAngle / texelSolidAngle) + 1.0f);
+            }
+        }
+        // for alpha = 0, the convolution does not change the environment: we resample the source at the resolution of the level
+        float baseLod = log2f((float)source[0].size / level.size);
+
+        auto filter = [&source, &level, &halfVectors, &lods, baseLod](size_t begin, size_t end)
+        {
+            for (size_t row = begin; row < end; row++)
+            {
+                int f = (int)(row / level.size), y = (int)(row % level.size);
+                float tc = 2.0f * (y + 0.5f) / level.size - 1.0f;
+                for (int x = 0; x < level.size; x++)
+                {
+                    float sc = 2.0f * (x + 0.5f) / level.size - 1.0f;
+                    glm::vec3 N = CubeDirection(f, sc, tc);
+                    glm::vec3 color(0.0f);
+                    if (halfVectors.empty())
+                        color = SampleCubeLod(source, N, baseLod);
+                    else
+                    {
+                        // tangent space of the normal
+                        glm::vec3 up = (fabsf(N.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f));
+                        glm::vec3 T = glm::normalize(glm::cross(up, N));
+                        glm::vec3 B = glm::cross(N, T);
+                        float totalWeight = 0.0f;
+                        for (size_t i = 0; i < halfVectors.size(); i++)
+                        {
+                            glm::vec3 H = T * halfVectors[i].x + B * halfVectors[i].y + N * halfVectors[i].z;
+                            // V = N -> L = reflect(-N, H)
+                            glm::vec3 L = 2.0f * halfVectors[i].z * H - N;
+                            float NdotL = glm::dot(N, L);
+                            if (NdotL > 0.0f)
+                            {
+                                color += SampleCubeLod(source, L, lods[i]) * NdotL;
+                                totalWeight += NdotL;
+                            }
+                        }
+                        color /= (totalWeight > 0.0f ? totalWeight : 1.0f);
+                    }
+                    float* out = &level.faces[f][((size_t)y * level.size + x) * 3];
+                    out[0] = color.r;
+                    out[1] = color.g;
+                    out[2] = color.b;
+                }
+            }
+        };
+        if (jobs != nullptr)
+            jobs->ParallelFor((size_t)6 * level.size, 1, filter);
+        else
+            filter(0, (size_t)6 * level.size);
+    }
+}
+
+//////////////////////////////////////////
+// we calculate the split-sum BRDF table: for each N.V (x axis) and alpha (y axis), the scale and the bias of F0 (RG channels).
+// The rows of the table are calculated in parallel
+inline void IntegrateBRDF(const IBLSettings& settings, vector<float>& lut, JobSystem* jobs)
+{
+    int size = settings.lutSize, numSamples = settings.lutSamples;
+    lut.assign((size_t)size * size * 2, 0.0f);
+    auto integrate = [size, numSamples, &lut](size_t begin, size_t end)
+    {
+        for (size_t y = begin; y < end; y++)
+        {
+            float alpha = (y + 0.5f) / size;
+            // Schlick-GGX geometric term, with k for Image Based Lighting
+            float k = (alpha * alpha) / 2.0f;
+            for (int x = 0; x < size; x++)
+            {
+                float NdotV = (x + 0.5f) / size;
+                glm::vec3 V(sqrtf(1.0f - NdotV * NdotV), 0.0f, NdotV);
+                float A = 0.0f, B = 0.0f;
+                for (int i = 0; i < numSamples; i++)
+                {
+                    glm::vec3 H = ImportanceSampleGGX(Hammersley(i, numSamples), alpha);
+                    float VdotH = glm::dot(V, H);
+                    glm::vec3 L = 2.0f * VdotH * H - V;
+                    float NdotL = L.z;
+                    if (NdotL > 0.0f)
+                    {
+                        float G = (NdotV / (NdotV * (1.0f - k) + k)) * (NdotL / (NdotL * (1.0f - k) + k));
+                        float G_Vis = (G * glm::max(VdotH, 0.0f)) / (H.z * NdotV);
+                        float Fc = powf(1.0f - glm::max(VdotH, 0.0f), 5.0f);
+                        A += (1.0f - Fc) * G_Vis;
+                        B += Fc * G_Vis;
+                    }
+                }
+                lut[(y * size + x) * 2] = A / numSamples;
+                lut[(y * size + x) * 2 + 1] = B / numSamples;
+            }
+        }
+    };
+    if (jobs != nullptr)
+        jobs->ParallelFor(size, 1, integrate);
+    else
+        integrate(0, size);
+}
+
+//////////////////////////////////////////
+// we read the header of a cache file, and we check that it is valid for the given parameters
+inline bool ReadIBLHeader(ifstream& file, uint32_t type, uint32_t size, uint32_t numLevels, uint32_t numSamples)
+{
+    IBLFileHeader header;
+    if (!file.read((char*)&header, sizeof(header)))
+        return false;
+    return (memcmp(header.magic, "RIBL", 4) == 0 && header.version == IBL_FILE_VERSION && header.type == type && header.size == size
+            && header.numLevels == numLevels && header.numSamples == numSamples);
+}
+
+//////////////////////////////////////////
+// we write the header of a cache file
+inline void WriteIBLHeader(ofstream& file, uint32_t type, uint32_t size, uint32_t numLevels, uint32_t numSamples)
+{
+    IBLFileHeader header;
+    memcpy(header.magic, "RIBL", 4);
+    header.version = IBL_FILE_VERSION;
+    header.type = type;
+    header.size = size;
+    header.numLevels = numLevels;
+    header.numSamples = numSamples;
+    header.reserved[0] = header.reserved[1] = 0;
+    file.write((const char*)&header, sizeof(header));
+}
+
+//////////////////////////////////////////
+// we load the baked data of an environment from a cache file. It fails if the file does not exist, if it is not valid, or if it is older than "sourceTime"
+inline bool LoadEnvironmentIBL(const string& path, const IBLSettings& settings, long long sourceTime, EnvironmentIBL& environment)
+{
+    long long cacheTime = FileModificationTime(path);
+    if (cacheTime < 0 || cacheTime < sourceTime)
+        return false;
+    ifstream file(path.c_str(), ios::binary);
+    if (!ReadIBLHeader(file, IBL_FILE_ENVIRONMENT, settings.specularSize, settings.numLevels, settings.numSamples))
+        return false;
+    file.read((char*)environment.sh, sizeof(environment.sh));
+    environment.specular.assign(settings.numLevels, CubeImage());
+    for (int l = 0; l < settings.numLevels; l++)
+    {
+        CubeImage& level = environment.specular[l];
+        level.size = (settings.specularSize >> l > 0 ? settings.specularSize >> l : 1);
+        for (int f = 0; f < 6; f++)
+        {
+            level.faces[f].resize((size_t)level.size * level.size * 3);
+            file.read((char*)&level.faces[f][0], level.faces[f].size() * sizeof(float));
+        }
+    }
+    return (bool)file;
+}
+
+//////////////////////////////////////////
+// we save the baked data of an environment in a cache file
+inline bool SaveEnvironmentIBL(const string& path, const IBLSettings& settings, const EnvironmentIBL& environment)
+{
+    ofstream file(path.c_str(), ios::binary);
+    if (!file)
+        return false;
+    WriteIBLHeader(file, IBL_FILE_ENVIRONMENT, settings.specularSize, settings.numLevels, settings.numSamples);
+    file.write((const char*)environment.sh, sizeof(environment.sh));
+    for (size_t l = 0; l < environment.specular.size(); l++)
+        for (int f = 0; f < 6; f++)
+            file.write((const char*)&environment.specular[l].faces[f][0], environment.specular[l].faces[f].size() * sizeof(float));
+    return (bool)file;
+}
+
+//////////////////////////////////////////
+// we load the baked data of the cube map in "folder" from its cache file (folder + "environment.ibl"), or, if the cache is not valid,
+// we bake the data and we save them in the cache. It returns false if the cube map cannot be loaded
+inline bool BakeEnvironmentIBL(const string& folder, const IBLSettings& settings, EnvironmentIBL& environment, JobSystem* jobs, bool& fromCache)
+{
+    vector<string> paths = CubeFacePaths(folder);
+    long long sourceTime = 0;
+    for (int f = 0; f < 6; f++)
+    {
+        long long faceTime = FileModificationTime(paths[f]);
+        sourceTime = (faceTime > sourceTime ? faceTime : sourceTime);
+    }
+    string cachePath = folder + "environment.ibl";
+    fromCache = LoadEnvironmentIBL(cachePath, settings, sourceTime, environment);
+    if (fromCache)
+        return true;
+
+    CubeImage cube;
+    if (!LoadCubeImage(paths, cube, jobs))
+        return false;
+    vector<CubeImage> chain;
+    BuildCubeMipChain(cube, chain);
+    ProjectSH9(cube, environment.sh, jobs);
+    PrefilterGGX(chain, settings, environment.specular, jobs);
+    if (!SaveEnvironmentIBL(cachePath, settings, environment))
+        std::cout << "Failed to save the IBL cache: " << cachePath << std::endl;
+    return true;
+}
+
+//////////////////////////////////////////
+// we load the BRDF table from its cache file, or, if the cache is not valid, we calculate it and we save it in the cache
+inline void BakeBRDFLUT(const string& path, const IBLSettings& settings, vector<float>& lut, JobSystem* jobs, bool& fromCache)
+{
+    ifstream in(path.c_str(), ios::binary);
+    fromCache = ReadIBLHeader(in, IBL_FILE_BRDF_LUT, settings.lutSize, 1, settings.lutSamples);
+    if (fromCache)
+    {
+        lut.resize((size_t)settings.lutSize * settings.lutSize * 2);
+        fromCache = (bool)in.read((char*)&lut[0], lut.size() * sizeof(float));
+        if (fromCache)
+            return;
+    }
+    IntegrateBRDF(settings, lut, jobs);
+    ofstream out(path.c_str(), ios::binary);
+    WriteIBLHeader(out, IBL_FILE_BRDF_LUT, settings.lutSize, 1, settings.lutSamples);
+    out.write((const char*)&lut[0], lut.size() * sizeof(float));
+    if (!out)
+        std::cout << "Failed to save the BRDF table: " << path << std::endl;
+}
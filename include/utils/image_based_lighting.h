@@ -0,0 +1,144 @@
+/*
+ImageBasedLighting class
+- OpenGL side of the Image Based Lighting: it loads (or bakes, if the cache is not valid) the data calculated by the IBL baker (include/utils/ibl_baker.h), and it creates:
+    - a cube map with the pre-filtered environment for the specular component (RGB16F, with numLevels mipmap levels: the level to read is alpha * (numLevels-1))
+    - a 2D texture with the split-sum BRDF table (RG16F, indexed by (N.V, alpha))
+    - the 9 SH coefficients of the irradiance for the diffuse component, passed to the shader as an array of vec3 uniforms
+- Bind() passes everything to a Shader Program, with these names:
+    uniform samplerCube specularMap; uniform sampler2D brdfLUT; uniform vec3 shCoefficients[9]; uniform float specularLevels;
+
+Usage:
+    ImageBasedLighting ibl;
+    ibl.Load("../../textures/cube/Maskonaive2/", "../../textures/cube/brdf_lut.ibl", &jobs);
+    ...
+    ibl.Bind(shader.Program, 1, 2);     // texture units for the cube map and the table
+    ...
+    ibl.Clear();                        // before the destruction of the OpenGL context
+
+In the shader (GGX, with the split-sum approximation):
+    diffuse = Kd * albedo * SH(N)
+    specular = textureLod(specularMap, R, alpha * (specularLevels - 1.0)).rgb * (F0 * brdf.x + brdf.y), with brdf = texture(brdfLUT, vec2(N.V, alpha)).rg
+
+N.B.) GL_TEXTURE_CUBE_MAP_SEAMLESS is enabled by Load(): the pre-filtered levels are small, and without seamless filtering the borders of the faces would be visible
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include <utils/job_system.h>
+#include <utils/ibl_baker.h>
+
+/////////////////// IMAGEBASEDLIGHTING class ///////////////////////
+class ImageBasedLighting
+{
+public:
+    // pre-filtered cube map and BRDF table
+    GLuint specularMap, brdfLUT;
+    // SH coefficients of the irradiance (9 RGB values)
+    float sh[27];
+    // parameters of the baking
+    IBLSettings settings;
+
+    // ImageBasedLighting is not copyable (the destructor deletes the OpenGL textures)
+    ImageBasedLighting(const ImageBasedLighting& copy) = delete;
+    ImageBasedLighting& operator=(const ImageBasedLighting&) = delete;
+
+    //////////////////////////////////////////
+    // constructor
+    ImageBasedLighting() : specularMap(0), brdfLUT(0)
+    {
+        for (int i = 0; i < 27; i++)
+            this->sh[i] = 0.0f;
+    }
+
+    //////////////////////////////////////////
+    // destructor
+    ~ImageBasedLighting()
+    {
+        this->Clear();
+    }
+
+    //////////////////////////////////////////
+    // we load the IBL data of the cube map in "folder", and the BRDF table from "lutPath": the data are read from the cache files, or baked on the CPU
+    // (in parallel on the workers of the JobSystem) and saved in the cache. It returns false if the cube map cannot be loaded
+    bool Load(const string& folder, const string& lutPath, JobSystem* jobs)
+    {
+        this->Clear();
+        bool fromCache;
+        EnvironmentIBL environment;
+        if (!BakeEnvironmentIBL(folder, this->settings, environment, jobs, fromCache))
+            return false;
+        std::cout << "IBL data of " << folder << (fromCache ? " loaded from the cache" : " baked") << std::endl;
+        for (int i = 0; i < 27; i++)
+            this->sh[i] = environment.sh[i];
+
+        // pre-filtered cube map: we upload all the levels (the data are floats, the internal format is half float)
+        glGenTextures(1, &this->specularMap);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, this->specularMap);
+        for (size_t l = 0; l < environment.specular.size(); l++)
+        {
+            const CubeImage& level = environment.specular[l];
+            for (int f = 0; f < 6; f++)
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + f, (GLint)l, GL_RGB16F, level.size, level.size, 0, GL_RGB, GL_FLOAT, &level.faces[f][0]);
+        }
+        // the chain stops at numLevels: we tell OpenGL which levels are available
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, (GLint)environment.specular.size() - 1);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+        // BRDF table
+        vector<float> lut;
+        BakeBRDFLUT(lutPath, this->settings, lut, jobs, fromCache);
+        glGenTextures(1, &this->brdfLUT);
+        glBindTexture(GL_TEXTURE_2D, this->brdfLUT);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, this->settings.lutSize, this->settings.lutSize, 0, GL_RG, GL_FLOAT, &lut[0]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return true;
+    }
+
+    //////////////////////////////////////////
+    // we bind the textures to the given texture units, and we pass the uniforms to the Shader Program (which must be in use)
+    void Bind(GLuint program, GLuint specularUnit, GLuint lutUnit) const
+    {
+        glActiveTexture(GL_TEXTURE0 + specularUnit);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, this->specularMap);
+        glUniform1i(glGetUniformLocation(program, "specularMap"), specularUnit);
+        glActiveTexture(GL_TEXTURE0 + lutUnit);
+        glBindTexture(GL_TEXTURE_2D, this->brdfLUT);
+        glUniform1i(glGetUniformLocation(program, "brdfLUT"), lutUnit);
+        glUniform3fv(glGetUniformLocation(program, "shCoefficients"), 9, this->sh);
+        glUniform1f(glGetUniformLocation(program, "specularLevels"), (GLfloat)this->settings.numLevels);
+    }
+
+    //////////////////////////////////////////
+    // we delete the textures
+    void Clear()
+    {
+        if (this->specularMap != 0)
+            glDeleteTextures(1, &this->specularMap);
+        if (this->brdfLUT != 0)
+            glDeleteTextures(1, &this->brdfLUT);
+        this->specularMap = this->brdfLUT = 0;
+    }
+};
@@ -0,0 +1,213 @@
+/*
+InstanceArray and InstanceMotionState classes
+- InstanceMotionState is a Bullet Motion State which writes the model matrix of its rigid body (rototranslation calculated by Bullet * scale of the model)
+  directly in a slot of an InstanceArray, a contiguous array of glm::mat4. The renderer does not need to query each body, to convert the Bullet matrix
+  and to apply the scale at each frame: the array is ready to be uploaded as-is in a buffer of instanced attributes (see InstanceBuffer in include/utils/draw_commands.h)
+- Bullet calls setWorldTransform only for the active bodies: the matrices of the static bodies and of the bodies which are sleeping (i.e., they have stopped)
+  are not written again. The array keeps the range of the modified slots, so only that range must be uploaded
+- the slots are kept packed: when a Motion State is deleted, the last slot is moved in its position (with its owner), so the first Size() matrices
+  are always valid and they can be drawn with a single instanced draw call
+
+The Motion States are created by Physics::createRigidBody() when an InstanceArray is passed as parameter (see include/utils/physics.h):
+    InstanceArray cubeInstances;
+    ...
+    bulletSimulation.createRigidBody(BOX, pos, size, rot, mass, friction, restitution, &cubeInstances);
+    ...
+    // after the simulation step
+    if (cubeInstances.IsDirty())
+        ... upload the range [DirtyBegin(), DirtyEnd()) of cubeInstances.Data() ...
+    cubeInstances.ResetDirty();
+
+BodyModelMatrix() returns the model matrix of any rigid body: from its slot, if it has an InstanceMotionState, otherwise calculated from its Motion State.
+
+N.B. 1) the scale applied to the matrix is the size of the Collision Shape passed to createRigidBody: as in the lectures of the course, the models must have unit size
+N.B. 2) the InstanceArray must be destroyed after all its Motion States (i.e., after Physics::Clear())
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <btBulletDynamicsCommon.h>
+
+class InstanceMotionState;
+
+/////////////////// INSTANCEARRAY class ///////////////////////
+class InstanceArray
+{
+public:
+    // number of matrices written by the Motion States (the application can reset it, e.g. at each frame, for the statistics)
+    unsigned int updates;
+
+    // InstanceArray is not copyable (the Motion States keep a pointer to it)
+    InstanceArray(const InstanceArray& copy) = delete;
+    InstanceArray& operator=(const InstanceArray&) = delete;
+
+    //////////////////////////////////////////
+    // constructor
+    InstanceArray() : updates(0), dirtyBegin(0), dirtyEnd(0) {}
+
+    //////////////////////////////////////////
+    // number of valid matrices, and pointer to the first one
+    size_t Size() const { return this->matrices.size(); }
+    const glm::mat4* Data() const { return (this->matrices.empty() ? NULL : &this->matrices[0]); }
+
+    //////////////////////////////////////////
+    // range of the slots modified after the last call of ResetDirty()
+    bool IsDirty() const { return this->dirtyBegin < this->dirtyEnd; }
+    size_t DirtyBegin() const { return this->dirtyBegin; }
+    size_t DirtyEnd() const { return this->dirtyEnd; }
+    void ResetDirty() { this->dirtyBegin = this->dirtyEnd = 0; }
+
+private:
+    friend class InstanceMotionState;
+
+    // model matrices, and Motion State owning each slot
+    vector<glm::mat4> matrices;
+    vector<InstanceMotionState*> owners;
+    // range of the modified slots
+    size_t dirtyBegin, dirtyEnd;
+
+    //////////////////////////////////////////
+    // we add the slot of a Motion State at the end of the array
+    size_t Add(InstanceMotionState* owner)
+    {
+        this->matrices.push_back(glm::mat4(1.0f));
+        this->owners.push_back(owner);
+        return this->matrices.size() - 1;
+    }
+
+    //////////////////////////////////////////
+    // we remove a slot, moving the last slot in its position (defined after InstanceMotionState, because it updates the slot of the moved owner)
+    void Remove(size_t slot);
+
+    //////////////////////////////////////////
+    // we extend the range of the modified slots
+    void MarkDirty(size_t slot)
+    {
+        if (this->dirtyBegin == this->dirtyEnd)
+        {
+            this->dirtyBegin = slot;
+            this->dirtyEnd = slot + 1;
+        }
+        else
+        {
+            this->dirtyBegin = glm::min(this->dirtyBegin, slot);
+            this->dirtyEnd = glm::max(this->dirtyEnd, slot + 1);
+        }
+    }
+};
+
+/////////////////// INSTANCEMOTIONSTATE class ///////////////////////
+ATTRIBUTE_ALIGNED16(class) InstanceMotionState : public btMotionState
+{
+public:
+    BT_DECLARE_ALIGNED_ALLOCATOR();
+
+    //////////////////////////////////////////
+    // constructor: we take a slot in the array, and we write the initial matrix (for the static bodies, it is the only one)
+    InstanceMotionState(const btTransform& startTrans, InstanceArray* instances, glm::vec3 scale)
+        : transform(startTrans), scale(scale), instances(instances)
+    {
+        this->slot = this->instances->Add(this);
+        this->WriteMatrix();
+    }
+
+    //////////////////////////////////////////
+    // destructor: we release the slot
+    virtual ~InstanceMotionState()
+    {
+        this->instances->Remove(this->slot);
+    }
+
+    //////////////////////////////////////////
+    // Bullet asks the initial transformation of the body
+    virtual void getWorldTransform(btTransform& worldTrans) const
+    {
+        worldTrans = this->transform;
+    }
+
+    //////////////////////////////////////////
+    // Bullet gives the new transformation of an active body (interpolated, if the simulation uses a fixed time step): we write the model matrix in the slot
+    virtual void setWorldTransform(const btTransform& worldTrans)
+    {
+        this->transform = worldTrans;
+        this->WriteMatrix();
+        this->instances->updates++;
+    }
+
+    //////////////////////////////////////////
+    // model matrix of the body (with the scale of the model)
+    const glm::mat4& ModelMatrix() const { return this->instances->matrices[this->slot]; }
+
+private:
+    friend class InstanceArray;
+
+    // last transformation given by Bullet
+    btTransform transform;
+    // scale of the model
+    glm::vec3 scale;
+    // array and slot of the matrix
+    InstanceArray* instances;
+    size_t slot;
+
+    //////////////////////////////////////////
+    // we convert the Bullet transformation to a GLM matrix in the slot, and we apply the scale to the columns (= rototranslation * scale matrix)
+    void WriteMatrix()
+    {
+        glm::mat4& matrix = this->instances->matrices[this->slot];
+        this->transform.getOpenGLMatrix(glm::value_ptr(matrix));
+        matrix[0] *= this->scale.x;
+        matrix[1] *= this->scale.y;
+        matrix[2] *= this->scale.z;
+        this->instances->MarkDirty(this->slot);
+    }
+};
+
+//////////////////////////////////////////
+inline void InstanceArray::Remove(size_t slot)
+{
+    size_t last = this->matrices.size() - 1;
+    if (slot != last)
+    {
+        this->matrices[slot] = this->matrices[last];
+        this->owners[slot] = this->owners[last];
+        this->owners[slot]->slot = slot;
+        this->MarkDirty(slot);
+    }
+    this->matrices.pop_back();
+    this->owners.pop_back();
+    // the range of the modified slots must remain inside the array
+    if (this->dirtyEnd > this->matrices.size())
+        this->dirtyEnd = this->matrices.size();
+    if (this->dirtyBegin > this->dirtyEnd)
+        this->dirtyBegin = this->dirtyEnd;
+}
+
+//////////////////////////////////////////
+// model matrix of a rigid body: if its Motion State is an InstanceMotionState, we read the matrix from its slot. Otherwise (the body has been created
+// without an InstanceArray), we calculate it from the transformation of the Motion State, applying "scale"
+inline glm::mat4 BodyModelMatrix(const btRigidBody* body, glm::vec3 scale)
+{
+    const InstanceMotionState* instanceState = dynamic_cast<const InstanceMotionState*>(body->getMotionState());
+    if (instanceState != NULL)
+        return instanceState->ModelMatrix();
+    btTransform transform;
+    body->getMotionState()->getWorldTransform(transform);
+    glm::mat4 matrix;
+    transform.getOpenGLMatrix(glm::value_ptr(matrix));
+    return matrix * glm::scale(glm::mat4(1.0f), scale);
+}
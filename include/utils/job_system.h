@@ -0,0 +1,252 @@
+/*
+JobSystem class
+- a pool of worker threads, with a work-stealing scheduling of the jobs
+- each worker has its own queue of jobs: a worker takes jobs from the back of its own queue, and, when its queue is empty, it "steals" jobs from the front of the queues of the other workers
+- the thread which waits for the completion of a group of jobs (usually the main thread, which owns the OpenGL context) does not sleep, but it executes jobs too
+
+A group of jobs is identified by a JobCounter: the counter is incremented when a job is submitted, and decremented when the job is completed.
+Wait(counter) returns when all the jobs of the group have been completed.
+
+ParallelFor splits a range [0, count) in chunks of "grain" elements, and it executes a job for each chunk.
+
+N.B. 1) the jobs must NOT call OpenGL functions: the OpenGL context is current only in the main thread
+N.B. 2) the queues are protected by a mutex for each worker. Lock-free deques (e.g., Chase-Lev) are more efficient, but a lot more complex to implement correctly
+
+see:
+https://en.wikipedia.org/wiki/Work_stealing
+https://blog.molecular-matters.com/2015/08/24/job-system-2-0-lock-free-work-stealing-part-1-basics/
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+// counter of the pending jobs of a group
+typedef atomic<int> JobCounter;
+
+/////////////////// JOBSYSTEM class ///////////////////////
+class JobSystem
+{
+public:
+
+    // JobSystem is not copyable nor movable (the worker threads keep a pointer to the instance)
+    JobSystem(const JobSystem& copy) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    //////////////////////////////////////////
+    // constructor
+    // if numWorkers = 0, we create a worker for each hardware thread, except the one used by the main thread
+    JobSystem(unsigned int numWorkers = 0) : running(true), sleeping(0)
+    {
+        if (numWorkers == 0)
+        {
+            unsigned int hw = thread::hardware_concurrency();
+            numWorkers = (hw > 1 ? hw-1 : 1);
+        }
+        // we have one queue for each worker, plus one for the jobs submitted by the external threads
+        // N.B.) the number of workers is saved before the creation of the threads, because they read it while the workers vector is still growing
+        this->numWorkers = numWorkers;
+        this->queues = vector<WorkQueue>(numWorkers+1);
+        for (unsigned int i = 0; i < numWorkers; i++)
+            this->workers.push_back(thread(&JobSystem::WorkerLoop, this, i));
+    }
+
+    //////////////////////////////////////////
+    // destructor: we wake up and join all the worker threads
+    ~JobSystem()
+    {
+        {
+            unique_lock<mutex> lock(this->sleepMutex);
+            this->running = false;
+        }
+        this->wakeUp.notify_all();
+        for (size_t i = 0; i < this->workers.size(); i++)
+            this->workers[i].join();
+    }
+
+    // number of worker threads (the main thread is not included)
+    unsigned int NumWorkers() const { return this->numWorkers; }
+
+    //////////////////////////////////////////
+    // we add a job to a group (identified by the counter)
+    void Submit(JobCounter& counter, const function<void()>& job)
+    {
+        counter.fetch_add(1);
+        Job j;
+        j.work = job;
+        j.counter = &counter;
+
+        // a worker adds the new job to its own queue, other threads use the "external" queue
+        size_t q = this->CurrentQueue();
+        {
+            lock_guard<mutex> lock(this->queues[q].lock);
+            this->queues[q].jobs.push_back(j);
+        }
+
+        // if some workers are sleeping, we wake up one of them
+        if (this->sleeping.load() > 0)
+        {
+            lock_guard<mutex> lock(this->sleepMutex);
+            this->wakeUp.notify_one();
+        }
+    }
+
+    //////////////////////////////////////////
+    // we wait for the completion of all the jobs of a group. In the meanwhile, the calling thread executes the pending jobs
+    void Wait(JobCounter& counter)
+    {
+        size_t q = this->CurrentQueue();
+        while (counter.load() > 0)
+        {
+            if (!this->RunOneJob(q))
+                this_thread::yield();
+        }
+    }
+
+    //////////////////////////////////////////
+    // we execute func(begin, end) on chunks of "grain" elements of the range [0, count), and we wait for the completion of all the chunks
+    template<typename Func>
+    void ParallelFor(size_t count, size_t grain, Func func)
+    {
+        if (count == 0)
+            return;
+        if (grain == 0)
+            grain = 1;
+        // a single chunk: no need to involve the workers
+        if (count <= grain || this->numWorkers == 0)
+        {
+            func((size_t)0, count);
+            return;
+        }
+
+        JobCounter counter(0);
+        for (size_t begin = grain; begin < count; begin += grain)
+        {
+            size_t end = (begin + grain < count ? begin + grain : count);
+            this->Submit(counter, [func, begin, end]() { func(begin, end); });
+        }
+        // the calling thread executes the first chunk, and then helps with the others
+        func((size_t)0, (grain < count ? grain : count));
+        this->Wait(counter);
+    }
+
+private:
+
+    // a job: the function to execute, and the counter of its group
+    struct Job {
+        function<void()> work;
+        JobCounter* counter;
+    };
+
+    // a queue of jobs, with its mutex
+    struct WorkQueue {
+        deque<Job> jobs;
+        mutex lock;
+
+        WorkQueue() {}
+        // needed to create the vector of queues (the queues are created before the start of the workers, so we do not need to copy the jobs)
+        WorkQueue(const WorkQueue&) {}
+        WorkQueue& operator=(const WorkQueue&) { return *this; }
+    };
+
+    vector<thread> workers;
+    unsigned int numWorkers;
+    vector<WorkQueue> queues;
+
+    // management of the sleeping workers
+    bool running;
+    atomic<int> sleeping;
+    mutex sleepMutex;
+    condition_variable wakeUp;
+
+    // index of the worker (and the JobSystem instance) associated to the current thread
+    // the default value of the index is larger than any worker index -> the thread is not a worker
+    static size_t& CurrentWorker() { static thread_local size_t index = (size_t)-1; return index; }
+    static JobSystem*& CurrentSystem() { static thread_local JobSystem* system = nullptr; return system; }
+
+    // queue used by the current thread: its own queue for a worker, the "external" queue (the last one) for the other threads
+    size_t CurrentQueue()
+    {
+        return (CurrentSystem() == this && CurrentWorker() < this->numWorkers ? CurrentWorker() : this->numWorkers);
+    }
+
+    //////////////////////////////////////////
+    // we search for a job (first in queue q, then in the other queues), and we execute it. It returns false if no job is available
+    bool RunOneJob(size_t q)
+    {
+        Job job;
+        bool found = false;
+
+        // we take the most recent job of our own queue (it is probably "hot" in the cache)
+        {
+            lock_guard<mutex> lock(this->queues[q].lock);
+            if (!this->queues[q].jobs.empty())
+            {
+                job = this->queues[q].jobs.back();
+                this->queues[q].jobs.pop_back();
+                found = true;
+            }
+        }
+
+        // otherwise, we steal the oldest job from the other queues
+        for (size_t i = 1; !found && i < this->queues.size(); i++)
+        {
+            size_t victim = (q + i) % this->queues.size();
+            lock_guard<mutex> lock(this->queues[victim].lock);
+            if (!this->queues[victim].jobs.empty())
+            {
+                job = this->queues[victim].jobs.front();
+                this->queues[victim].jobs.pop_front();
+                found = true;
+            }
+        }
+
+        if (!found)
+            return false;
+
+        job.work();
+        job.counter->fetch_sub(1);
+        return true;
+    }
+
+    //////////////////////////////////////////
+    // main function of each worker thread
+    void WorkerLoop(size_t index)
+    {
+        CurrentWorker() = index;
+        CurrentSystem() = this;
+
+        while (true)
+        {
+            if (this->RunOneJob(index))
+                continue;
+
+            // no jobs available: we go to sleep, until a new job is submitted
+            unique_lock<mutex> lock(this->sleepMutex);
+            if (!this->running)
+                return;
+            this->sleeping.fetch_add(1);
+            // we wake up periodically anyway, to avoid to miss a notification sent between the search of a job and the wait
+            this->wakeUp.wait_for(lock, chrono::milliseconds(1));
+            this->sleeping.fetch_sub(1);
+            if (!this->running)
+                return;
+        }
+    }
+};
+
@@ -0,0 +1,306 @@
+/*
+LightClusters class
+- clustered light culling for forward rendering: the view frustum is split in a 3D grid of "froxels" (frustum-shaped voxels), and, for each cluster, we calculate the list of the point lights whose sphere of influence intersects it
+- in the fragment shader, each fragment finds its cluster (using its screen position and its depth), and it applies the illumination model only for the lights of the cluster
+
+The grid has dimX x dimY tiles in screen space, and dimZ slices in depth. The slices are exponentially distributed between zNear and zFar (each slice is "thicker" than the previous one, so that the clusters are more or less cubic),
+while the first slice goes from the camera to zNear. Fragments beyond zFar are assigned to the last slice.
+
+The lists are built on the CPU, at each frame:
+1) the lights are transformed in view coordinates
+2) for each slice (in parallel, using the JobSystem), we test the lights overlapping the depth range of the slice against the AABBs of the clusters of the slice.
+   The test sphere-AABB is performed on 4 clusters at the same time using SIMD instructions (see simd4.h): the AABBs are saved in SoA layout
+3) after a prefix sum on the number of lights of each cluster, the lists are compacted in a single array of indices
+
+The results are uploaded in three Texture Buffer Objects, read in the fragment shader using samplerBuffers:
+- lightData (RGBA32F): 2 texels for each light: position in view coordinates + radius, color
+- clusterData (RG32UI): for each cluster, the offset of its first light in lightIndices, and the number of lights
+- lightIndices (R32UI): the indices of the lights of each cluster
+
+N.B.) each cluster can contain at most maxLightsPerCluster lights: the exceeding lights are ignored
+
+see:
+http://www.cse.chalmers.se/~uffe/clustered_shading_preprint.pdf
+https://www.aortiz.me/2018/12/21/CG.html
+https://advances.realtimerendering.com/s2016/Siggraph2016_idTech6.pdf
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <vector>
+#include <cmath>
+#include <cfloat>
+
+#include <glm/glm.hpp>
+
+#include <utils/point_lights.h>
+#include <utils/job_system.h>
+#include <utils/simd4.h>
+
+/////////////////// LIGHTCLUSTERS class ///////////////////////
+class LightClusters
+{
+public:
+    // dimensions of the grid
+    GLuint dimX, dimY, dimZ;
+    // depth range of the exponential slices
+    float zNear, zFar;
+    // maximum number of lights in a cluster
+    GLuint maxLightsPerCluster;
+    // statistics of the last built frame: number of lights, and total number of indices in the lists
+    size_t numLights, numIndices;
+
+    LightClusters(const LightClusters& copy) = delete;
+    LightClusters& operator=(const LightClusters&) = delete;
+
+    //////////////////////////////////////////
+    // constructor: we create the Texture Buffer Objects
+    LightClusters(GLuint dimX = 16, GLuint dimY = 9, GLuint dimZ = 24, GLuint maxLightsPerCluster = 256)
+        : dimX(dimX), dimY(dimY), dimZ(dimZ), zNear(1.0f), zFar(100.0f), maxLightsPerCluster(maxLightsPerCluster), numLights(0), numIndices(0)
+    {
+        this->clustersPerSlice = dimX * dimY;
+        // each slice is padded to a multiple of 4 clusters, for the SIMD tests
+        this->paddedPerSlice = (this->clustersPerSlice + 3) & ~3u;
+        GLuint numClusters = this->clustersPerSlice * dimZ;
+        this->counts.resize(numClusters);
+        this->lists.resize(numClusters * maxLightsPerCluster);
+        this->clusterTexels.resize(numClusters * 2);
+
+        glGenBuffers(3, this->buffers);
+        glGenTextures(3, this->textures);
+        GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+        for (int i = 0; i < 3; i++)
+        {
+            glBindBuffer(GL_TEXTURE_BUFFER, this->buffers[i]);
+            glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+            glBindTexture(GL_TEXTURE_BUFFER, this->textures[i]);
+            glTexBuffer(GL_TEXTURE_BUFFER, formats[i], this->buffers[i]);
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+
+    ~LightClusters()
+    {
+        glDeleteTextures(3, this->textures);
+        glDeleteBuffers(3, this->buffers);
+    }
+
+    //////////////////////////////////////////
+    // we calculate the AABBs (in view coordinates) of the clusters. It must be called when the projection changes
+    // fovY is in radians
+    void SetProjection(float fovY, float aspect, float zNear, float zFar)
+    {
+        this->zNear = zNear;
+        this->zFar = zFar;
+
+        float tanY = tanf(fovY * 0.5f);
+        float tanX = tanY * aspect;
+
+        for (int i = 0; i < 6; i++)
+            this->bounds[i].assign(this->paddedPerSlice * this->dimZ, 0.0f);
+
+        for (GLuint z = 0; z < this->dimZ; z++)
+        {
+            float d0 = this->SliceDepth(z);
+            float d1 = this->SliceDepth(z+1);
+            for (GLuint c = 0; c < this->paddedPerSlice; c++)
+            {
+                GLuint index = z * this->paddedPerSlice + c;
+                // padding: an "empty" box, which never intersects a sphere
+                if (c >= this->clustersPerSlice)
+                {
+                    this->bounds[0][index] = this->bounds[1][index] = this->bounds[2][index] = FLT_MAX;
+                    this->bounds[3][index] = this->bounds[4][index] = this->bounds[5][index] = -FLT_MAX;
+                    continue;
+                }
+                GLuint x = c % this->dimX;
+                GLuint y = c / this->dimX;
+                // borders of the tile in Normalized Device Coordinates
+                float x0 = -1.0f + 2.0f * x / this->dimX, x1 = -1.0f + 2.0f * (x+1) / this->dimX;
+                float y0 = -1.0f + 2.0f * y / this->dimY, y1 = -1.0f + 2.0f * (y+1) / this->dimY;
+                // the cluster is a frustum: its AABB contains the 4 corners of the tile at the near and far depths of the slice
+                float minX = glm::min(glm::min(x0*tanX*d0, x0*tanX*d1), glm::min(x1*tanX*d0, x1*tanX*d1));
+                float maxX = glm::max(glm::max(x0*tanX*d0, x0*tanX*d1), glm::max(x1*tanX*d0, x1*tanX*d1));
+                float minY = glm::min(glm::min(y0*tanY*d0, y0*tanY*d1), glm::min(y1*tanY*d0, y1*tanY*d1));
+                float maxY = glm::max(glm::max(y0*tanY*d0, y0*tanY*d1), glm::max(y1*tanY*d0, y1*tanY*d1));
+                this->bounds[0][index] = minX;
+                this->bounds[1][index] = minY;
+                // the camera looks towards the negative z axis
+                this->bounds[2][index] = -d1;
+                this->bounds[3][index] = maxX;
+                this->bounds[4][index] = maxY;
+                this->bounds[5][index] = -d0;
+            }
+        }
+    }
+
+    //////////////////////////////////////////
+    // we build the lists of lights of all the clusters
+    void Build(JobSystem& jobs, const vector<PointLight>& lights, const glm::mat4& view)
+    {
+        size_t n = lights.size();
+        this->numLights = n;
+        this->lightTexels.resize(n * 2);
+
+        // 1) lights in view coordinates (xyz = position, w = radius), and colors
+        jobs.ParallelFor(n, 256, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                this->lightTexels[2*i] = glm::vec4(glm::vec3(view * glm::vec4(lights[i].position, 1.0f)), lights[i].radius);
+                this->lightTexels[2*i+1] = glm::vec4(lights[i].color, 0.0f);
+            }
+        });
+
+        // 2) binning: a job for each slice. Each job writes only the counters and the lists of the clusters of its slice
+        jobs.ParallelFor(this->dimZ, 1, [&](size_t firstSlice, size_t lastSlice)
+        {
+            for (size_t z = firstSlice; z < lastSlice; z++)
+                this->BinSlice((GLuint)z);
+        });
+
+        // 3) prefix sum on the counters, and compaction of the lists
+        GLuint numClusters = this->clustersPerSlice * this->dimZ;
+        GLuint total = 0;
+        for (GLuint c = 0; c < numClusters; c++)
+        {
+            this->clusterTexels[2*c] = total;
+            this->clusterTexels[2*c+1] = this->counts[c];
+            total += this->counts[c];
+        }
+        this->indices.resize(total);
+        jobs.ParallelFor(numClusters, 256, [&](size_t begin, size_t end)
+        {
+            for (size_t c = begin; c < end; c++)
+            {
+                const GLuint* src = &this->lists[c * this->maxLightsPerCluster];
+                GLuint offset = this->clusterTexels[2*c];
+                for (GLuint i = 0; i < this->counts[c]; i++)
+                    this->indices[offset + i] = src[i];
+            }
+        });
+        this->numIndices = total;
+    }
+
+    //////////////////////////////////////////
+    // we upload the lists in the Texture Buffer Objects (it must be called by the thread with the OpenGL context)
+    void Upload()
+    {
+        this->UploadBuffer(0, this->lightTexels.size() * sizeof(glm::vec4), this->lightTexels.empty() ? NULL : &this->lightTexels[0]);
+        this->UploadBuffer(1, this->clusterTexels.size() * sizeof(GLuint), &this->clusterTexels[0]);
+        this->UploadBuffer(2, this->indices.size() * sizeof(GLuint), this->indices.empty() ? NULL : &this->indices[0]);
+    }
+
+    //////////////////////////////////////////
+    // we bind the Texture Buffer Objects to the texture units [firstUnit, firstUnit+3), and we set the uniforms used by the shader to find the cluster of a fragment
+    // the Shader Program must be already active. width and height are the dimensions of the viewport
+    void Bind(GLuint program, GLuint firstUnit, GLuint width, GLuint height)
+    {
+        const char* names[3] = { "lightData", "clusterData", "lightIndices" };
+        for (GLuint i = 0; i < 3; i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+            glBindTexture(GL_TEXTURE_BUFFER, this->textures[i]);
+            glUniform1i(glGetUniformLocation(program, names[i]), firstUnit + i);
+        }
+        glUniform3i(glGetUniformLocation(program, "clusterDims"), this->dimX, this->dimY, this->dimZ);
+        glUniform2f(glGetUniformLocation(program, "screenSize"), (GLfloat)width, (GLfloat)height);
+        glUniform1f(glGetUniformLocation(program, "clusterNear"), this->zNear);
+        glUniform1f(glGetUniformLocation(program, "clusterFar"), this->zFar);
+    }
+
+private:
+    GLuint clustersPerSlice, paddedPerSlice;
+    // AABBs of the clusters in SoA layout: minX, minY, minZ, maxX, maxY, maxZ
+    vector<float> bounds[6];
+    // number of lights, and list of lights (with maxLightsPerCluster elements) of each cluster
+    vector<GLuint> counts;
+    vector<GLuint> lists;
+    // data to upload in the Texture Buffer Objects
+    vector<glm::vec4> lightTexels;
+    vector<GLuint> clusterTexels;
+    vector<GLuint> indices;
+
+    GLuint buffers[3];
+    GLuint textures[3];
+
+    //////////////////////////////////////////
+    // depth of the near border of a slice (slice = dimZ -> far border of the last slice)
+    // N.B.) the same formula is inverted in the fragment shader to find the slice of a fragment
+    float SliceDepth(GLuint slice) const
+    {
+        if (slice == 0)
+            return 0.0f;
+        return this->zNear * powf(this->zFar / this->zNear, (float)(slice-1) / (this->dimZ-1));
+    }
+
+    //////////////////////////////////////////
+    // we test all the lights against the clusters of a slice
+    void BinSlice(GLuint z)
+    {
+        GLuint* sliceCounts = &this->counts[z * this->clustersPerSlice];
+        for (GLuint c = 0; c < this->clustersPerSlice; c++)
+            sliceCounts[c] = 0;
+
+        // the last slice contains all the fragments beyond zFar
+        float sliceNear = this->SliceDepth(z);
+        float sliceFar = (z == this->dimZ-1 ? FLT_MAX : this->SliceDepth(z+1));
+        const float* b[6];
+        for (int i = 0; i < 6; i++)
+            b[i] = &this->bounds[i][z * this->paddedPerSlice];
+
+        for (GLuint l = 0; l < this->numLights; l++)
+        {
+            const glm::vec4& light = this->lightTexels[2*l];
+            float depth = -light.z;
+            // fast rejection of the lights which do not overlap the depth range of the slice
+            if (depth + light.w < sliceNear || depth - light.w > sliceFar)
+                continue;
+
+            float4 cx = Set1(light.x), cy = Set1(light.y), cz = Set1(light.z);
+            float4 r2 = Set1(light.w * light.w);
+            float4 zero = Set1(0.0f);
+
+            // we test 4 clusters at the same time: squared distance between the center of the sphere and the AABB, compared with the squared radius
+            for (GLuint c = 0; c < this->paddedPerSlice; c += 4)
+            {
+                float4 dx = Max(Max(Load(b[0]+c) - cx, cx - Load(b[3]+c)), zero);
+                float4 dy = Max(Max(Load(b[1]+c) - cy, cy - Load(b[4]+c)), zero);
+                float4 dz = Max(Max(Load(b[2]+c) - cz, cz - Load(b[5]+c)), zero);
+                int mask = MoveMask(CmpLE(dx*dx + dy*dy + dz*dz, r2));
+                while (mask)
+                {
+                    // index of the lowest bit set
+                    int bit = 0;
+                    while (!(mask & (1 << bit)))
+                        bit++;
+                    mask &= ~(1 << bit);
+
+                    GLuint cluster = z * this->clustersPerSlice + c + bit;
+                    if (sliceCounts[c + bit] < this->maxLightsPerCluster)
+                        this->lists[cluster * this->maxLightsPerCluster + sliceCounts[c + bit]++] = l;
+                }
+            }
+        }
+    }
+
+    //////////////////////////////////////////
+    // upload of the data of a Texture Buffer Object (the previous storage is "orphaned", to avoid waiting for the GPU)
+    void UploadBuffer(int i, size_t size, const void* data)
+    {
+        glBindBuffer(GL_TEXTURE_BUFFER, this->buffers[i]);
+        // a buffer with size 0 is not valid as a texture: we always allocate some bytes
+        glBufferData(GL_TEXTURE_BUFFER, size > 0 ? size : 16, data, GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+};
@@ -0,0 +1,323 @@
+/*
+MaterialLibrary class
+- the textures of the materials are packed in the layers of 2D texture arrays (GL_TEXTURE_2D_ARRAY), instead of being separate 2D textures.
+  A draw call selects the texture of its material with a layer index (a uniform, or a per-instance attribute), and the texture arrays are bound once:
+  the draws using materials of the same array do not need any change of texture binding between them, and they can be merged with instancing or multi-draw
+- all the layers of a texture array must have the same size and the same format: the images are resized to square "buckets", with the size equal to the smallest
+  power of two containing the image (clamped to maxSize), and they are converted to RGBA (or to a single channel, for the grayscale images).
+  There is a texture array for each combination of size and format, and each array has as many layers as the materials in its bucket
+- the images are decoded (and resized) on the CPU when a material is added, and uploaded by Build(): if new materials are added after Build(),
+  the arrays of their buckets are created again at the next call of Build() (the resized images are kept in memory for this reason)
+- the mipmaps of the arrays are generated by OpenGL, and the wrapping mode is GL_REPEAT
+
+Usage:
+    MaterialLibrary materials(512);
+    GLuint grid = materials.Add("../../textures/UV_Grid_Sm.png");
+    GLuint soil = materials.Add("../../textures/SoilCracked.png");
+    materials.Build();
+    ...
+    // in the shader: uniform sampler2DArray materialTextures; uniform int materialLayer; texture(materialTextures, vec3(UV, materialLayer))
+    GLuint bound = 0;
+    bound = materials.Bind(grid, 1, layerLocation, bound);      // it binds the array only if it is different from "bound", and it sets the layer
+    ...
+    materials.Clear();                                          // before the destruction of the OpenGL context
+
+N.B. 1) the implementation of stb_image must be included in the application (#define STB_IMAGE_IMPLEMENTATION before including stb_image.h)
+N.B. 2) resizing the images to a common size changes their resolution: maxSize should be chosen considering the largest image needed by the application,
+        and images with very different sizes end up in different arrays anyway
+N.B. 3) in GLSL, the index of the layer is a float coordinate which is rounded to the nearest integer: no filtering is applied between the layers
+
+see:
+https://www.khronos.org/opengl/wiki/Array_Texture
+https://developer.nvidia.com/content/how-modern-opengl-can-radically-reduce-driver-overhead-0
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+
+#include "stb_image/stb_image.h"
+
+#include <utils/texture_compression.h>
+
+// a material: the texture array which contains its texture, and its layer in the array
+struct Material {
+    GLuint bucket;      // index of the bucket (= of the texture array)
+    GLint layer;
+};
+
+/////////////////// MATERIALLIBRARY class ///////////////////////
+class MaterialLibrary
+{
+public:
+    // maximum size of the layers: larger images are reduced to this size
+    GLint maxSize;
+
+    // MaterialLibrary is not copyable (the destructor deletes the OpenGL textures)
+    MaterialLibrary(const MaterialLibrary& copy) = delete;
+    MaterialLibrary& operator=(const MaterialLibrary&) = delete;
+
+    //////////////////////////////////////////
+    // constructor
+    MaterialLibrary(GLint maxSize = 1024) : maxSize(maxSize) {}
+
+    //////////////////////////////////////////
+    // destructor
+    ~MaterialLibrary()
+    {
+        this->Clear();
+    }
+
+    //////////////////////////////////////////
+    // we add the material with the image in "path", and we return its index. A path already added returns the same material.
+    // The image is decoded and resized immediately, but it is uploaded only by Build(). If the image cannot be loaded, the material uses a white layer
+    GLuint Add(const string& path)
+    {
+        map<string, GLuint>::iterator cached = this->paths.find(path);
+        if (cached != this->paths.end())
+            return cached->second;
+
+        int w, h, channels;
+        unsigned char* pixels = stbi_load(path.c_str(), &w, &h, &channels, 0);
+        vector<unsigned char> image;
+        if (pixels == nullptr)
+        {
+            std::cout << "Failed to load texture: " << path << std::endl;
+            w = h = channels = 1;
+            image.assign(1, 255);
+        }
+        else
+        {
+            image.assign(pixels, pixels + (size_t)w * h * channels);
+            stbi_image_free(pixels);
+        }
+
+        // the images with 1-2 channels (grayscale) use a single channel, the others are converted to RGBA
+        GLint layerChannels = (channels <= 2 ? 1 : 4);
+        if (channels != layerChannels)
+            image = ConvertChannels(image, w, h, channels, layerChannels);
+
+        // the size of the bucket: the smallest power of two containing the image, up to maxSize
+        GLint size = 1;
+        while (size < w || size < h)
+            size *= 2;
+        if (size > this->maxSize)
+            size = this->maxSize;
+        ResizeImage(image, w, h, layerChannels, size);
+
+        // we search for a bucket with the same size and format, and we add a layer to it
+        GLuint bucket = 0;
+        while (bucket < this->buckets.size() && (this->buckets[bucket].size != size || this->buckets[bucket].channels != layerChannels))
+            bucket++;
+        if (bucket == this->buckets.size())
+        {
+            Bucket newBucket;
+            newBucket.size = size;
+            newBucket.channels = layerChannels;
+            this->buckets.push_back(newBucket);
+        }
+        Bucket& target = this->buckets[bucket];
+        target.layers.push_back(vector<unsigned char>());
+        target.layers.back().swap(image);
+        target.dirty = true;
+
+        Material material;
+        material.bucket = bucket;
+        material.layer = (GLint)target.layers.size() - 1;
+        this->materials.push_back(material);
+        GLuint index = (GLuint)this->materials.size() - 1;
+        this->paths[path] = index;
+        return index;
+    }
+
+    //////////////////////////////////////////
+    // we create (or create again) the texture arrays of the buckets which have new layers
+    void Build()
+    {
+        for (size_t b = 0; b < this->buckets.size(); b++)
+        {
+            Bucket& bucket = this->buckets[b];
+            if (!bucket.dirty)
+                continue;
+            if (bucket.texture != 0)
+                glDeleteTextures(1, &bucket.texture);
+
+            GLenum internalFormat = (bucket.channels == 1 ? GL_R8 : GL_RGBA8);
+            GLenum format = (bucket.channels == 1 ? GL_RED : GL_RGBA);
+            GLsizei numLayers = (GLsizei)bucket.layers.size();
+            glGenTextures(1, &bucket.texture);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, bucket.texture);
+            // we allocate the whole array, and then we copy the images in the layers
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internalFormat, bucket.size, bucket.size, numLayers, 0, format, GL_UNSIGNED_BYTE, NULL);
+            for (GLsizei l = 0; l < numLayers; l++)
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, l, bucket.size, bucket.size, 1, format, GL_UNSIGNED_BYTE, &bucket.layers[l][0]);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            // the mipmaps are generated for each layer independently
+            glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+            // single channel textures are replicated on the RGB channels, as in TextureManager
+            if (bucket.channels == 1)
+            {
+                GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+                glTexParameteriv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+            }
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+            bucket.dirty = false;
+        }
+    }
+
+    //////////////////////////////////////////
+    // we prepare the drawing of a material: we bind its texture array to the texture unit "unit" only if it is different from "bound" (the array currently bound
+    // to that unit), and we pass its layer to the uniform in "layerLocation". It returns the array bound to the unit after the call
+    GLuint Bind(GLuint material, GLuint unit, GLint layerLocation, GLuint bound) const
+    {
+        const Material& m = this->materials[material];
+        GLuint texture = this->buckets[m.bucket].texture;
+        if (texture != bound)
+        {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        }
+        glUniform1i(layerLocation, m.layer);
+        return texture;
+    }
+
+    //////////////////////////////////////////
+    // we delete the texture arrays and the materials
+    void Clear()
+    {
+        for (size_t b = 0; b < this->buckets.size(); b++)
+        {
+            if (this->buckets[b].texture != 0)
+                glDeleteTextures(1, &this->buckets[b].texture);
+        }
+        this->buckets.clear();
+        this->materials.clear();
+        this->paths.clear();
+    }
+
+    // material with the given index
+    const Material& Get(GLuint material) const { return this->materials[material]; }
+    // texture array of a material
+    GLuint Texture(GLuint material) const { return this->buckets[this->materials[material].bucket].texture; }
+    // number of materials, and of texture arrays
+    size_t NumMaterials() const { return this->materials.size(); }
+    size_t NumBuckets() const { return this->buckets.size(); }
+
+    //////////////////////////////////////////
+    // estimated GPU memory of the texture arrays (in bytes, with the mipmaps)
+    size_t MemorySize() const
+    {
+        size_t bytes = 0;
+        for (size_t b = 0; b < this->buckets.size(); b++)
+            bytes += (size_t)this->buckets[b].size * this->buckets[b].size * this->buckets[b].channels * this->buckets[b].layers.size() * 4 / 3;
+        return bytes;
+    }
+
+    //////////////////////////////////////////
+    // we print on console the buckets of the library
+    void PrintStats() const
+    {
+        std::cout << "Materials: " << this->materials.size() << " in " << this->buckets.size() << " texture arrays (";
+        for (size_t b = 0; b < this->buckets.size(); b++)
+            std::cout << (b > 0 ? ", " : "") << this->buckets[b].size << "x" << this->buckets[b].size << (this->buckets[b].channels == 1 ? " R" : " RGBA") << " x " << this->buckets[b].layers.size();
+        std::cout << ") - GPU memory: " << (this->MemorySize() / 1024) << " KB" << std::endl;
+    }
+
+private:
+    // a texture array, with the images of its layers
+    struct Bucket {
+        GLint size, channels;
+        vector<vector<unsigned char> > layers;
+        GLuint texture;
+        bool dirty;
+        Bucket() : size(0), channels(0), texture(0), dirty(false) {}
+    };
+
+    vector<Bucket> buckets;
+    vector<Material> materials;
+    // materials already added, for each path
+    map<string, GLuint> paths;
+
+    //////////////////////////////////////////
+    // we convert an image to a different number of channels (1 = the first channel, 4 = RGB with alpha = 255 if the image has no alpha)
+    static vector<unsigned char> ConvertChannels(const vector<unsigned char>& src, int w, int h, int channels, int newChannels)
+    {
+        vector<unsigned char> dst((size_t)w * h * newChannels);
+        for (size_t p = 0; p < (size_t)w * h; p++)
+        {
+            const unsigned char* in = &src[p * channels];
+            unsigned char* out = &dst[p * newChannels];
+            if (newChannels == 1)
+                out[0] = in[0];
+            else
+            {
+                out[0] = in[0];
+                out[1] = (channels >= 3 ? in[1] : in[0]);
+                out[2] = (channels >= 3 ? in[2] : in[0]);
+                out[3] = (channels == 4 ? in[3] : 255);
+            }
+        }
+        return dst;
+    }
+
+    //////////////////////////////////////////
+    // we resize an image to size x size: first we halve it (with the gamma-correct box filter of the texture baker) while it is at least twice the
+    // final size, and then we resample it with a bilinear filter. In this way, also a large reduction considers all the texels of the image
+    static void ResizeImage(vector<unsigned char>& image, int& w, int& h, int channels, int size)
+    {
+        while (w >= 2 * size && h >= 2 * size)
+        {
+            vector<unsigned char> next;
+            int nw, nh;
+            DownsampleImage(image, w, h, channels, (channels >= 3), next, nw, nh);
+            image.swap(next);
+            w = nw;
+            h = nh;
+        }
+        if (w == size && h == size)
+            return;
+
+        vector<unsigned char> dst((size_t)size * size * channels);
+        float sx = (float)w / size, sy = (float)h / size;
+        for (int y = 0; y < size; y++)
+        {
+            // coordinates of the center of the texel in the source image
+            float fy = (y + 0.5f) * sy - 0.5f;
+            fy = (fy < 0.0f ? 0.0f : fy);
+            int y0 = MinInt((int)fy, h - 1), y1 = MinInt(y0 + 1, h - 1);
+            float ty = fy - y0;
+            for (int x = 0; x < size; x++)
+            {
+                float fx = (x + 0.5f) * sx - 0.5f;
+                fx = (fx < 0.0f ? 0.0f : fx);
+                int x0 = MinInt((int)fx, w - 1), x1 = MinInt(x0 + 1, w - 1);
+                float tx = fx - x0;
+                for (int c = 0; c < channels; c++)
+                {
+                    float top = image[((size_t)y0 * w + x0) * channels + c] * (1.0f - tx) + image[((size_t)y0 * w + x1) * channels + c] * tx;
+                    float bottom = image[((size_t)y1 * w + x0) * channels + c] * (1.0f - tx) + image[((size_t)y1 * w + x1) * channels + c] * tx;
+                    dst[((size_t)y * size + x) * channels + c] = (unsigned char)(top * (1.0f - ty) + bottom * ty + 0.5f);
+                }
+            }
+        }
+        image.swap(dst);
+        w = h = size;
+    }
+};
@@ -0,0 +1,296 @@
+/*
+Simplex noise on the CPU
+- C++ port of the 3D simplex noise of Ian McEwan, Ashima Arts (the "snoise" function used in the procedural shaders of the course): the code follows the GLSL
+  implementation operation by operation (same permutation polynomial, same mapping of the gradients on the octahedron, same constants), so the values are
+  the same of the shader up to the floating point rounding of the GPU
+- SIMD: the noise is written once as a template on the type of the values. With float it evaluates a single point, with NoiseFloat4 it evaluates 4 points
+  at the same time (one for each lane of an SSE2 register; without SSE2, NoiseFloat4 is a plain array of 4 floats, and the compiler can still vectorize it).
+  The lanes are independent: the scalar and the SIMD versions give exactly the same values
+- fractal sum of octaves (fBm/turbulence), with the same loop of the Turbulence subroutines of the shaders (each octave has half power and double frequency)
+- baking of noise textures (2D, or 3D with the third dimension used as time), with the texels calculated in parallel using a JobSystem.
+  The textures can be made tileable: the noise is not periodic, so we blend the noise with copies of itself translated by one period, with weights which
+  go linearly from 1 to 0 along the period (the result repeats exactly, but the contrast is slightly reduced in the middle of the period)
+
+Usage:
+    float n = SimplexNoise(x, y, z);                        // scalar
+    NoiseFloat4 n4 = SimplexNoise(NoiseFloat4(x0, x1, x2, x3), NoiseFloat4(y...), NoiseFloat4(z...));   // 4 points
+    vector<NoiseChannel> channels(1, NoiseChannel(NOISE_FBM, 0.0f, 0.0f));
+    vector<float> data;
+    BakeNoise(512, 1, 1.0f, channels, frequency, harmonics, NOISE_TILE_NONE, data, &jobs);     // 512x512 texels, 1 channel
+
+see:
+https://github.com/stegu/webgl-noise
+https://weber.itn.liu.se/~stegu/simplexnoise/simplexnoise.pdf
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <vector>
+#include <cmath>
+
+#include <utils/job_system.h>
+
+// SSE2 is always available on x86-64
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define NOISE_SSE2
+    #include <emmintrin.h>
+#endif
+
+// types of noise of a channel of a baked texture
+enum noise_types {
+    NOISE_SIMPLEX = 0,      // a single octave
+    NOISE_FBM = 1,          // sum of octaves (Turbulence subroutine)
+    NOISE_FBM_ABS = 2       // sum of the absolute values of the octaves (TurbulenceAbs subroutine)
+};
+
+// dimensions of a baked texture which are made tileable
+enum noise_tiling {
+    NOISE_TILE_NONE = 0,
+    NOISE_TILE_UV = 1,      // the texture repeats in UV, with period 1
+    NOISE_TILE_TIME = 2     // the 3D texture repeats along the time
+};
+
+/////////////////// NOISEFLOAT4 class ///////////////////////
+// 4 floats, with the operations needed by the noise
+struct NoiseFloat4
+{
+#ifdef NOISE_SSE2
+    __m128 v;
+    NoiseFloat4() {}
+    NoiseFloat4(__m128 v) : v(v) {}
+    NoiseFloat4(float s) : v(_mm_set1_ps(s)) {}
+    NoiseFloat4(float a, float b, float c, float d) : v(_mm_setr_ps(a, b, c, d)) {}
+    float operator[](int i) const { float f[4]; _mm_storeu_ps(f, this->v); return f[i]; }
+#else
+    float v[4];
+    NoiseFloat4() {}
+    NoiseFloat4(float s) { v[0] = v[1] = v[2] = v[3] = s; }
+    NoiseFloat4(float a, float b, float c, float d) { v[0] = a; v[1] = b; v[2] = c; v[3] = d; }
+    float operator[](int i) const { return this->v[i]; }
+#endif
+};
+
+#ifdef NOISE_SSE2
+inline NoiseFloat4 operator+(const NoiseFloat4& a, const NoiseFloat4& b) { return NoiseFloat4(_mm_add_ps(a.v, b.v)); }
+inline NoiseFloat4 operator-(const NoiseFloat4& a, const NoiseFloat4& b) { return NoiseFloat4(_mm_sub_ps(a.v, b.v)); }
+inline NoiseFloat4 operator*(const NoiseFloat4& a, const NoiseFloat4& b) { return NoiseFloat4(_mm_mul_ps(a.v, b.v)); }
+inline NoiseFloat4 Min(const NoiseFloat4& a, const NoiseFloat4& b) { return NoiseFloat4(_mm_min_ps(a.v, b.v)); }
+inline NoiseFloat4 Max(const NoiseFloat4& a, const NoiseFloat4& b) { return NoiseFloat4(_mm_max_ps(a.v, b.v)); }
+inline NoiseFloat4 Abs(const NoiseFloat4& a) { return NoiseFloat4(_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)); }
+// GLSL step(edge, x): 1 if x >= edge, 0 otherwise
+inline NoiseFloat4 Step(const NoiseFloat4& edge, const NoiseFloat4& x) { return NoiseFloat4(_mm_and_ps(_mm_cmpge_ps(x.v, edge.v), _mm_set1_ps(1.0f))); }
+// SSE2 has no floor: we truncate, and we subtract 1 where the truncation has rounded up (negative values)
+inline NoiseFloat4 Floor(const NoiseFloat4& a)
+{
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+    return NoiseFloat4(_mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1.0f))));
+}
+#else
+inline NoiseFloat4 operator+(const NoiseFloat4& a, const NoiseFloat4& b) { return NoiseFloat4(a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]); }
+inline NoiseFloat4 operator-(const NoiseFloat4& a, const NoiseFloat4& b) { return NoiseFloat4(a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]); }
+inline NoiseFloat4 operator*(const NoiseFloat4& a, const NoiseFloat4& b) { return NoiseFloat4(a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]); }
+inline NoiseFloat4 Min(const NoiseFloat4& a, const NoiseFloat4& b) { return NoiseFloat4(fminf(a.v[0], b.v[0]), fminf(a.v[1], b.v[1]), fminf(a.v[2], b.v[2]), fminf(a.v[3], b.v[3])); }
+inline NoiseFloat4 Max(const NoiseFloat4& a, const NoiseFloat4& b) { return NoiseFloat4(fmaxf(a.v[0], b.v[0]), fmaxf(a.v[1], b.v[1]), fmaxf(a.v[2], b.v[2]), fmaxf(a.v[3], b.v[3])); }
+inline NoiseFloat4 Abs(const NoiseFloat4& a) { return NoiseFloat4(fabsf(a.v[0]), fabsf(a.v[1]), fabsf(a.v[2]), fabsf(a.v[3])); }
+inline NoiseFloat4 Step(const NoiseFloat4& edge, const NoiseFloat4& x)
+{
+    return NoiseFloat4(x.v[0] >= edge.v[0] ? 1.0f : 0.0f, x.v[1] >= edge.v[1] ? 1.0f : 0.0f, x.v[2] >= edge.v[2] ? 1.0f : 0.0f, x.v[3] >= edge.v[3] ? 1.0f : 0.0f);
+}
+inline NoiseFloat4 Floor(const NoiseFloat4& a) { return NoiseFloat4(floorf(a.v[0]), floorf(a.v[1]), floorf(a.v[2]), floorf(a.v[3])); }
+#endif
+
+// the same operations for a single float
+inline float Min(float a, float b) { return (a < b ? a : b); }
+inline float Max(float a, float b) { return (a > b ? a : b); }
+inline float Abs(float a) { return fabsf(a); }
+inline float Step(float edge, float x) { return (x >= edge ? 1.0f : 0.0f); }
+inline float Floor(float a) { return floorf(a); }
+
+//////////////////////////////////////////
+// helper functions of the noise (as in the GLSL code)
+template<typename T> inline T NoiseMod289(const T& x)
+{
+    return x - Floor(x * T(1.0f / 289.0f)) * T(289.0f);
+}
+
+template<typename T> inline T NoisePermute(const T& x)
+{
+    return NoiseMod289((x * T(34.0f) + T(1.0f)) * x);
+}
+
+template<typename T> inline T NoiseTaylorInvSqrt(const T& r)
+{
+    return T(1.79284291400159f) - T(0.85373472095314f) * r;
+}
+
+//////////////////////////////////////////
+// 3D simplex noise (values in about [-1,1]). The GLSL vectors (vec3 of the point, vec4 of the 4 corners of the simplex) are written component by component:
+// each component is a T, so with T = NoiseFloat4 we process 4 different points
+template<typename T> inline T SimplexNoise(const T& vx, const T& vy, const T& vz)
+{
+    const T Cx(1.0f / 6.0f), Cy(1.0f / 3.0f);
+
+    // First corner
+    T s = vx * Cy + vy * Cy + vz * Cy;
+    T ix = Floor(vx + s), iy = Floor(vy + s), iz = Floor(vz + s);
+    T t = ix * Cx + iy * Cx + iz * Cx;
+    T x0[3] = { vx - ix + t, vy - iy + t, vz - iz + t };
+
+    // Other corners
+    T gx = Step(x0[1], x0[0]), gy = Step(x0[2], x0[1]), gz = Step(x0[0], x0[2]);
+    T lx = T(1.0f) - gx, ly = T(1.0f) - gy, lz = T(1.0f) - gz;
+    T i1[3] = { Min(gx, lz), Min(gy, lx), Min(gz, ly) };
+    T i2[3] = { Max(gx, lz), Max(gy, lx), Max(gz, ly) };
+
+    // offsets of the 4 corners from the first one
+    T corners[4][3];
+    for (int c = 0; c < 3; c++)
+    {
+        corners[0][c] = x0[c];
+        corners[1][c] = x0[c] - i1[c] + Cx;
+        corners[2][c] = x0[c] - i2[c] + Cy;
+        corners[3][c] = x0[c] - T(0.5f);
+    }
+
+    // Permutations
+    ix = NoiseMod289(ix);
+    iy = NoiseMod289(iy);
+    iz = NoiseMod289(iz);
+    T offsetX[4] = { T(0.0f), i1[0], i2[0], T(1.0f) };
+    T offsetY[4] = { T(0.0f), i1[1], i2[1], T(1.0f) };
+    T offsetZ[4] = { T(0.0f), i1[2], i2[2], T(1.0f) };
+
+    // Gradients: 7x7 points over a square, mapped onto an octahedron
+    const float n_ = 0.142857142857f; // 1.0/7.0
+    const T nsx(n_ * 2.0f - 0.0f), nsy(n_ * 0.5f - 1.0f), nsz(n_ * 1.0f - 0.0f);
+
+    T result(0.0f);
+    for (int k = 0; k < 4; k++)
+    {
+        T p = NoisePermute(NoisePermute(NoisePermute(iz + offsetZ[k]) + iy + offsetY[k]) + ix + offsetX[k]);
+        T j = p - T(49.0f) * Floor(p * nsz * nsz);  //  mod(p,7*7)
+        T x_ = Floor(j * nsz);
+        T y_ = Floor(j - T(7.0f) * x_);    // mod(j,N)
+        T x = x_ * nsx + nsy;
+        T y = y_ * nsx + nsy;
+        T h = T(1.0f) - Abs(x) - Abs(y);
+        T sh = T(0.0f) - Step(h, T(0.0f));
+        // gradient of the corner
+        T px = x + (Floor(x) * T(2.0f) + T(1.0f)) * sh;
+        T py = y + (Floor(y) * T(2.0f) + T(1.0f)) * sh;
+        T pz = h;
+
+        // Normalise gradients
+        T norm = NoiseTaylorInvSqrt(px * px + py * py + pz * pz);
+        px = px * norm;
+        py = py * norm;
+        pz = pz * norm;
+
+        // Mix final noise value
+        const T* xk = corners[k];
+        T m = Max(T(0.6f) - (xk[0] * xk[0] + xk[1] * xk[1] + xk[2] * xk[2]), T(0.0f));
+        m = m * m;
+        result = result + (m * m) * (px * xk[0] + py * xk[1] + pz * xk[2]);
+    }
+    return T(42.0f) * result;
+}
+
+//////////////////////////////////////////
+// sum of "harmonics" octaves of the noise in (u,v,z), with the first octave at "frequency": each octave has half power and double frequency
+// (the same loop of the Turbulence subroutines, with power = 1). If absolute is true, we sum the absolute values of the octaves
+template<typename T> inline T FractalNoise(const T& u, const T& v, const T& z, float frequency, int harmonics, bool absolute)
+{
+    T value(0.0f);
+    float p = 1.0f, f = frequency;
+    for (int i = 0; i < harmonics; i++)
+    {
+        T n = SimplexNoise(u * T(f), v * T(f), z);
+        value = value + T(p) * (absolute ? Abs(n) : n);
+        p *= 0.5f;
+        f *= 2.0f;
+    }
+    return value;
+}
+
+// a channel of a baked texture: type of noise, and third coordinate of the noise (z + zSpeed * time)
+struct NoiseChannel {
+    int type;
+    float z, zSpeed;
+    NoiseChannel(int type, float z, float zSpeed) : type(type), z(z), zSpeed(zSpeed) {}
+};
+
+//////////////////////////////////////////
+// value of a channel in (u,v) at the given time
+template<typename T> inline T EvaluateNoiseChannel(const NoiseChannel& channel, const T& u, const T& v, float time, float frequency, int harmonics)
+{
+    T z(channel.z + channel.zSpeed * time);
+    if (channel.type == NOISE_SIMPLEX)
+        return SimplexNoise(u * T(frequency), v * T(frequency), z);
+    return FractalNoise(u, v, z, frequency, harmonics, channel.type == NOISE_FBM_ABS);
+}
+
+//////////////////////////////////////////
+// value of a channel in (u,v) at the given time, made periodic in UV (period 1) and/or in time (period "period") if requested.
+// The periodic version blends the values in the point and in the points translated by one period
+template<typename T> inline T EvaluateTileableNoise(const NoiseChannel& channel, const T& u, const T& v, float time, float period, float frequency, int harmonics, unsigned int tiling)
+{
+    T value(0.0f);
+    int tilesU = (tiling & NOISE_TILE_UV ? 2 : 1), tilesT = (tiling & NOISE_TILE_TIME ? 2 : 1);
+    for (int dt = 0; dt < tilesT; dt++)
+    {
+        float wt = (tilesT == 1 ? 1.0f : (dt == 0 ? 1.0f - time / period : time / period));
+        for (int du = 0; du < tilesU; du++)
+            for (int dv = 0; dv < tilesU; dv++)
+            {
+                T w(wt);
+                if (tilesU == 2)
+                    w = w * (du == 0 ? T(1.0f) - u : u) * (dv == 0 ? T(1.0f) - v : v);
+                value = value + w * EvaluateNoiseChannel(channel, u - T((float)du), v - T((float)dv), time - dt * period, frequency, harmonics);
+            }
+    }
+    return value;
+}
+
+//////////////////////////////////////////
+// we bake a texture of size x size x depth texels, with the channels interleaved (channels.size() values for each texel).
+// The texel (s, t, r) contains the noise in u = (s+0.5)/size, v = (t+0.5)/size, at the time (r+0.5) * period / depth (time 0 for 2D textures, with depth = 1):
+// the texture coordinates of the centers of the texels correspond to the coordinates of the noise.
+// The rows are calculated in parallel by the workers of the JobSystem (serially, if jobs is nullptr), and each row is evaluated 4 texels at a time
+inline void BakeNoise(int size, int depth, float period, const vector<NoiseChannel>& channels, float frequency, int harmonics, unsigned int tiling,
+                      vector<float>& data, JobSystem* jobs)
+{
+    size_t numChannels = channels.size();
+    data.assign((size_t)size * size * depth * numChannels, 0.0f);
+    auto bake = [size, depth, period, &channels, frequency, harmonics, tiling, numChannels, &data](size_t begin, size_t end)
+    {
+        for (size_t row = begin; row < end; row++)
+        {
+            int r = (int)(row / size), t = (int)(row % size);
+            float time = (depth > 1 ? (r + 0.5f) * period / depth : 0.0f);
+            NoiseFloat4 v((t + 0.5f) / size);
+            for (int s = 0; s < size; s += 4)
+            {
+                NoiseFloat4 u((s + 0.5f) / size, (s + 1.5f) / size, (s + 2.5f) / size, (s + 3.5f) / size);
+                for (size_t c = 0; c < numChannels; c++)
+                {
+                    NoiseFloat4 value = EvaluateTileableNoise(channels[c], u, v, time, period, frequency, harmonics, tiling);
+                    for (int lane = 0; lane < 4 && s + lane < size; lane++)
+                        data[(row * size + s + lane) * numChannels + c] = value[lane];
+                }
+            }
+        }
+    };
+    if (jobs != nullptr)
+        jobs->ParallelFor((size_t)size * depth, 4, bake);
+    else
+        bake(0, (size_t)size * depth);
+}
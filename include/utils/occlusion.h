@@ -0,0 +1,360 @@
+/*
+Software occlusion culling
+- OccluderMesh: a simplified version of the meshes of a Model (vertex clustering), used as occluder
+- OcclusionBuffer: a low resolution depth buffer, where the occluders are rasterized on the CPU, and a hierarchical pyramid (Hi-Z) with the minimum and maximum depth of each block of pixels.
+  The bounding volumes of the objects are tested against the pyramid before the submission of the draw calls: if the bounding volume is behind all the occluders in the area of the screen it covers, the object is not rendered
+
+The rasterization uses the edge functions of the triangle, evaluated on 4 pixels at the same time using SIMD instructions (see simd4.h).
+The depth saved in the buffer is the depth in Normalized Device Coordinates, remapped in [0,1] (0 = near plane, 1 = far plane, like the OpenGL depth buffer).
+
+Test of a bounding volume:
+1) the 8 corners of the AABB are projected on the screen: we obtain the rectangle covered by the object, and its minimum depth
+2) we choose the level of the pyramid where the rectangle covers at most 2x2 texels
+3) the object is occluded if its minimum depth is larger than the maximum depth of the texels (= all the pixels in the rectangle are covered by nearer occluders)
+
+N.B. 1) the system is conservative: when it is not sure (e.g., an object crossing the near plane), the object is considered visible.
+Triangles of the occluders crossing the near plane are skipped: the occluded area is smaller, but never wrong
+N.B. 2) the simplified occluder must not be larger than the original mesh, otherwise visible objects can be culled. The vertex clustering keeps the vertices inside the AABB of the mesh, but it can slightly move the surfaces:
+use a fine grid for the simplification, or simple closed meshes (e.g., boxes) as occluders
+N.B. 3) the classes do not call any OpenGL function: they can be used (and tested) without a GPU, and the tests can be executed by several threads at the same time
+
+see:
+https://www.intel.com/content/www/us/en/developer/articles/technical/software-occlusion-culling.html
+https://fgiesen.wordpress.com/2013/02/17/optimizing-sw-occlusion-culling-index/
+https://www.gamedev.net/tutorials/programming/graphics/hierarchical-z-buffer-occlusion-culling-r3146/
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <vector>
+#include <map>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include <utils/culling.h>
+#include <utils/simd4.h>
+
+// a simplified mesh used as occluder
+struct OccluderMesh {
+    // vertices (in model coordinates) and indices of the triangles
+    vector<glm::vec3> vertices;
+    vector<GLuint> indices;
+};
+
+//////////////////////////////////////////
+// simplification of the meshes of a model using vertex clustering: the AABB of the model is divided in a grid of gridSize^3 cells,
+// all the vertices in the same cell are replaced by their average, and the triangles with two or more vertices in the same cell are removed
+// if gridSize = 0, the meshes are copied without simplification
+inline OccluderMesh SimplifyOccluder(const Model& model, GLuint gridSize)
+{
+    OccluderMesh occluder;
+    AABB box = ComputeModelAABB(model);
+    glm::vec3 extent = glm::max(box.max - box.min, glm::vec3(1e-6f));
+
+    // index of the cell -> index of the vertex in the occluder
+    map<GLuint, GLuint> cells;
+    // sum of the positions of the vertices in each cell, and their number
+    vector<glm::vec3> sums;
+    vector<GLuint> counts;
+
+    for (size_t m = 0; m < model.meshes.size(); m++)
+    {
+        const Mesh& mesh = model.meshes[m];
+        // index of the vertices of the mesh in the occluder
+        vector<GLuint> remap(mesh.vertices.size());
+        for (size_t v = 0; v < mesh.vertices.size(); v++)
+        {
+            const glm::vec3& p = mesh.vertices[v].Position;
+            GLuint cell;
+            if (gridSize == 0)
+                // no simplification: each vertex has its own "cell"
+                cell = (GLuint)sums.size();
+            else
+            {
+                glm::uvec3 c = glm::uvec3(glm::min(glm::vec3(gridSize - 1), (p - box.min) / extent * (float)gridSize));
+                cell = (c.z * gridSize + c.y) * gridSize + c.x;
+            }
+
+            map<GLuint, GLuint>::iterator it = cells.find(cell);
+            if (gridSize == 0 || it == cells.end())
+            {
+                cells[cell] = (GLuint)sums.size();
+                remap[v] = (GLuint)sums.size();
+                sums.push_back(p);
+                counts.push_back(1);
+            }
+            else
+            {
+                remap[v] = it->second;
+                sums[it->second] += p;
+                counts[it->second]++;
+            }
+        }
+
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+        {
+            GLuint a = remap[mesh.indices[i]], b = remap[mesh.indices[i+1]], c = remap[mesh.indices[i+2]];
+            // degenerate triangle: it is removed
+            if (a == b || b == c || a == c)
+                continue;
+            occluder.indices.push_back(a);
+            occluder.indices.push_back(b);
+            occluder.indices.push_back(c);
+        }
+    }
+
+    occluder.vertices.resize(sums.size());
+    for (size_t v = 0; v < sums.size(); v++)
+        occluder.vertices[v] = sums[v] / (float)counts[v];
+    return occluder;
+}
+
+/////////////////// OCCLUSIONBUFFER class ///////////////////////
+class OcclusionBuffer
+{
+public:
+    // dimensions of the depth buffer
+    GLuint width, height;
+    // statistics: number of rasterized triangles
+    // N.B.) IsVisible does not update any counter, because it can be called by several threads: the number of occluded objects must be counted by the caller
+    size_t numTriangles;
+
+    //////////////////////////////////////////
+    // constructor
+    OcclusionBuffer(GLuint width = 256, GLuint height = 128) : width(width), height(height), numTriangles(0)
+    {
+        // each row is padded to a multiple of 4 pixels, for the SIMD rasterization
+        this->stride = (width + 3) & ~3u;
+        this->depth.resize(this->stride * height);
+
+        // dimensions of the levels of the pyramid (the level 0 has the same dimensions of the depth buffer)
+        GLuint w = width, h = height;
+        while (true)
+        {
+            this->levelWidth.push_back(w);
+            this->levelHeight.push_back(h);
+            this->minDepth.push_back(vector<float>(w * h));
+            this->maxDepth.push_back(vector<float>(w * h));
+            if (w == 1 && h == 1)
+                break;
+            w = (w + 1) / 2;
+            h = (h + 1) / 2;
+        }
+        this->Clear();
+    }
+
+    //////////////////////////////////////////
+    // we clear the depth buffer (all the pixels at the far plane), and we set the view-projection matrix used for the occluders and for the tests
+    void Clear(const glm::mat4& viewProjection = glm::mat4(1.0f))
+    {
+        this->viewProjection = viewProjection;
+        for (size_t i = 0; i < this->depth.size(); i++)
+            this->depth[i] = 1.0f;
+        this->numTriangles = 0;
+    }
+
+    //////////////////////////////////////////
+    // rasterization of an occluder, with the model matrix of the object
+    void RenderOccluder(const OccluderMesh& occluder, const glm::mat4& modelMatrix)
+    {
+        glm::mat4 mvp = this->viewProjection * modelMatrix;
+
+        // we transform the vertices in clip coordinates, and then in screen coordinates (x, y in pixels, z in [0,1])
+        this->screen.resize(occluder.vertices.size());
+        this->clipped.resize(occluder.vertices.size());
+        for (size_t v = 0; v < occluder.vertices.size(); v++)
+        {
+            glm::vec4 clip = mvp * glm::vec4(occluder.vertices[v], 1.0f);
+            // vertex behind the near plane
+            this->clipped[v] = (clip.w <= 0.0f || clip.z < -clip.w);
+            if (this->clipped[v])
+                continue;
+            glm::vec3 ndc = glm::vec3(clip) / clip.w;
+            this->screen[v] = glm::vec3((ndc.x * 0.5f + 0.5f) * this->width, (ndc.y * 0.5f + 0.5f) * this->height, ndc.z * 0.5f + 0.5f);
+        }
+
+        for (size_t i = 0; i + 2 < occluder.indices.size(); i += 3)
+        {
+            GLuint a = occluder.indices[i], b = occluder.indices[i+1], c = occluder.indices[i+2];
+            // we skip the triangles crossing the near plane (conservative)
+            if (this->clipped[a] || this->clipped[b] || this->clipped[c])
+                continue;
+            this->RasterizeTriangle(this->screen[a], this->screen[b], this->screen[c]);
+        }
+    }
+
+    //////////////////////////////////////////
+    // we build the pyramid of minimum and maximum depths. It must be called after the rasterization of all the occluders, and before the tests
+    void BuildPyramid()
+    {
+        for (GLuint y = 0; y < this->height; y++)
+        {
+            for (GLuint x = 0; x < this->width; x++)
+            {
+                this->minDepth[0][y * this->width + x] = this->depth[y * this->stride + x];
+                this->maxDepth[0][y * this->width + x] = this->depth[y * this->stride + x];
+            }
+        }
+
+        for (size_t l = 1; l < this->levelWidth.size(); l++)
+        {
+            GLuint pw = this->levelWidth[l-1], ph = this->levelHeight[l-1];
+            const vector<float>& pmin = this->minDepth[l-1];
+            const vector<float>& pmax = this->maxDepth[l-1];
+            for (GLuint y = 0; y < this->levelHeight[l]; y++)
+            {
+                // with odd dimensions, the last texel of the level covers only 1 texel of the previous level
+                GLuint y0 = 2*y, y1 = glm::min(2*y+1, ph-1);
+                for (GLuint x = 0; x < this->levelWidth[l]; x++)
+                {
+                    GLuint x0 = 2*x, x1 = glm::min(2*x+1, pw-1);
+                    float mn = glm::min(glm::min(pmin[y0*pw+x0], pmin[y0*pw+x1]), glm::min(pmin[y1*pw+x0], pmin[y1*pw+x1]));
+                    float mx = glm::max(glm::max(pmax[y0*pw+x0], pmax[y0*pw+x1]), glm::max(pmax[y1*pw+x0], pmax[y1*pw+x1]));
+                    this->minDepth[l][y * this->levelWidth[l] + x] = mn;
+                    this->maxDepth[l][y * this->levelWidth[l] + x] = mx;
+                }
+            }
+        }
+    }
+
+    //////////////////////////////////////////
+    // test of an AABB (in world coordinates) against the pyramid: it returns false if the box is surely hidden by the occluders
+    bool IsVisible(const AABB& box) const
+    {
+        float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX, minZ = FLT_MAX;
+        for (int i = 0; i < 8; i++)
+        {
+            glm::vec3 corner((i & 1) ? box.max.x : box.min.x, (i & 2) ? box.max.y : box.min.y, (i & 4) ? box.max.z : box.min.z);
+            glm::vec4 clip = this->viewProjection * glm::vec4(corner, 1.0f);
+            // the box crosses the near plane: we consider it visible
+            if (clip.w <= 0.0f || clip.z < -clip.w)
+                return true;
+            glm::vec3 ndc = glm::vec3(clip) / clip.w;
+            minX = glm::min(minX, ndc.x);
+            maxX = glm::max(maxX, ndc.x);
+            minY = glm::min(minY, ndc.y);
+            maxY = glm::max(maxY, ndc.y);
+            minZ = glm::min(minZ, ndc.z * 0.5f + 0.5f);
+        }
+
+        // rectangle covered by the box, in pixels (outside the screen -> frustum culling will take care of it)
+        int x0 = (int)floorf((minX * 0.5f + 0.5f) * this->width), x1 = (int)floorf((maxX * 0.5f + 0.5f) * this->width);
+        int y0 = (int)floorf((minY * 0.5f + 0.5f) * this->height), y1 = (int)floorf((maxY * 0.5f + 0.5f) * this->height);
+        if (x1 < 0 || y1 < 0 || x0 >= (int)this->width || y0 >= (int)this->height)
+            return true;
+        x0 = glm::max(x0, 0); y0 = glm::max(y0, 0);
+        x1 = glm::min(x1, (int)this->width - 1); y1 = glm::min(y1, (int)this->height - 1);
+
+        // we choose the level where the rectangle covers at most 2x2 texels
+        size_t level = 0;
+        while (level + 1 < this->levelWidth.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+            level++;
+
+        const vector<float>& mn = this->minDepth[level];
+        const vector<float>& mx = this->maxDepth[level];
+        GLuint lw = this->levelWidth[level];
+        float farthest = 0.0f;
+        for (int y = (y0 >> level); y <= (y1 >> level); y++)
+        {
+            for (int x = (x0 >> level); x <= (x1 >> level); x++)
+            {
+                // if the box is nearer than all the occluders of a texel, it is surely visible: we can stop the test
+                if (minZ <= mn[y * lw + x])
+                    return true;
+                farthest = glm::max(farthest, mx[y * lw + x]);
+            }
+        }
+        // the box is hidden if it is behind the farthest occluder in the area
+        return minZ <= farthest;
+    }
+
+    // test of a bounding sphere (in world coordinates): we test its AABB
+    bool IsVisible(const BoundingSphere& sphere) const
+    {
+        AABB box;
+        box.min = sphere.center - glm::vec3(sphere.radius);
+        box.max = sphere.center + glm::vec3(sphere.radius);
+        return this->IsVisible(box);
+    }
+
+    // depth of a pixel (e.g., to visualize or test the buffer)
+    float Depth(GLuint x, GLuint y) const { return this->depth[y * this->stride + x]; }
+
+private:
+    // depth buffer (rows of "stride" pixels)
+    GLuint stride;
+    vector<float> depth;
+    // levels of the pyramid
+    vector<GLuint> levelWidth, levelHeight;
+    vector< vector<float> > minDepth, maxDepth;
+
+    glm::mat4 viewProjection;
+    // temporary data of the vertices of the current occluder
+    vector<glm::vec3> screen;
+    vector<bool> clipped;
+
+    //////////////////////////////////////////
+    // rasterization of a triangle (screen coordinates), using the edge functions evaluated in the centers of the pixels, 4 pixels at time
+    void RasterizeTriangle(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2)
+    {
+        // twice the signed area: with counter-clockwise front faces, the back faces have negative area, and they are skipped
+        float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+        if (area <= 0.0f)
+            return;
+
+        // bounding rectangle of the triangle, clamped to the screen
+        int minX = glm::max(0, (int)floorf(glm::min(v0.x, glm::min(v1.x, v2.x))));
+        int maxX = glm::min((int)this->width - 1, (int)ceilf(glm::max(v0.x, glm::max(v1.x, v2.x))));
+        int minY = glm::max(0, (int)floorf(glm::min(v0.y, glm::min(v1.y, v2.y))));
+        int maxY = glm::min((int)this->height - 1, (int)ceilf(glm::max(v0.y, glm::max(v1.y, v2.y))));
+        if (minX > maxX || minY > maxY)
+            return;
+        // the first pixel of each group of 4 must be aligned
+        minX &= ~3;
+        this->numTriangles++;
+
+        // edge functions: E(x,y) = A*x + B*y + C, positive inside the triangle. Each one is the (unnormalized) barycentric coordinate of the opposite vertex
+        float A0 = v1.y - v2.y, B0 = v2.x - v1.x, C0 = v1.x * v2.y - v1.y * v2.x;
+        float A1 = v2.y - v0.y, B1 = v0.x - v2.x, C1 = v2.x * v0.y - v2.y * v0.x;
+        float A2 = v0.y - v1.y, B2 = v1.x - v0.x, C2 = v0.x * v1.y - v0.y * v1.x;
+
+        // the depth is a linear function of the screen coordinates: z = (E0*z0 + E1*z1 + E2*z2) / area
+        float invArea = 1.0f / area;
+        float z0 = v0.z * invArea, z1 = v1.z * invArea, z2 = v2.z * invArea;
+
+        float4 zero = Set1(0.0f);
+        float4 offsets = Set(0.5f, 1.5f, 2.5f, 3.5f);
+        float4 a0 = Set1(A0), a1 = Set1(A1), a2 = Set1(A2);
+        float4 zz0 = Set1(z0), zz1 = Set1(z1), zz2 = Set1(z2);
+
+        for (int y = minY; y <= maxY; y++)
+        {
+            float py = y + 0.5f;
+            float* row = &this->depth[y * this->stride];
+            for (int x = minX; x <= maxX; x += 4)
+            {
+                float4 px = Set1((float)x) + offsets;
+                float4 e0 = a0 * px + Set1(B0 * py + C0);
+                float4 e1 = a1 * px + Set1(B1 * py + C1);
+                float4 e2 = a2 * px + Set1(B2 * py + C2);
+                float4 inside = And(And(CmpLE(zero, e0), CmpLE(zero, e1)), CmpLE(zero, e2));
+                if (MoveMask(inside) == 0)
+                    continue;
+                float4 z = e0 * zz0 + e1 * zz1 + e2 * zz2;
+                float4 old = Load(row + x);
+                // we keep the nearest depth
+                Store(row + x, Select(inside, Min(old, z), old));
+            }
+        }
+    }
+};
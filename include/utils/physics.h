@@ -5,6 +5,35 @@ Physics class:
 The class sets up the collision manager and the resolver of the constraints, using basic general-purposes methods provided by the library. Advanced and multithread methods are available, please consult Bullet documentation and examples
 
 createRigidBody method sets up a Box or Sphere Collision Shape. For other Shapes, you must extend the method.
+The Collision Shapes are shared: the bodies with the same type of shape and the same dimensions (quantized to SHAPE_QUANTUM) use the same btCollisionShape,
+with a reference counter (removeRigidBody() releases the shape of the body, and the shape is deleted when it is not used anymore). The local inertia of
+each shape is calculated once, for mass = 1 (for boxes and spheres, it is proportional to the mass). In this way, the memory used by the shapes depends on the number
+of different shapes, and not on the number of bodies (e.g., 25 identical cubes and all the spheres shot in lecture06b use 2 shapes)
+
+Pooled allocation: the rigid bodies and their Motion States are allocated in two pools (btPoolAllocator) of PhysicsSettings::bodyPoolSize elements, created with the world.
+The creation and the removal of bodies (e.g., the projectiles of lecture06b, see include/utils/projectile_manager.h) do not call the allocator of the system,
+and the bodies are contiguous in memory. When a pool is full, the bodies are allocated with new (and deleted with delete) as usual.
+
+Render-ready Motion States: if an InstanceArray is passed to createRigidBody, the Motion State of the body is an InstanceMotionState (see include/utils/instance_motion_state.h),
+which writes the scaled model matrix of the body in a contiguous array of matrices, ready for instanced rendering. Otherwise, a btDefaultMotionState is used.
+
+Multithreaded simulation: if PhysicsSettings::multithreaded is true, the constructor creates the multithreaded versions of the classes of Bullet
+(btDiscreteDynamicsWorldMt, a pool of constraint solvers, btCollisionDispatcherMt). The parallel loops of Bullet are executed by a task scheduler, selected with
+PhysicsSettings::scheduler, with PhysicsSettings::numThreads threads (0 = all the hardware threads):
+- PHYSICS_SCHEDULER_JOBSYSTEM: the JobSystem of the course (include/utils/job_system.h), through the JobTaskScheduler adapter below
+- PHYSICS_SCHEDULER_DEFAULT, PHYSICS_SCHEDULER_OPENMP, PHYSICS_SCHEDULER_TBB, PHYSICS_SCHEDULER_PPL: the schedulers of Bullet. They are available only if
+  Bullet has been compiled with their support: if not available, the JobSystem is used
+
+    PhysicsSettings settings;
+    settings.multithreaded = true;
+    settings.numThreads = 4;
+    Physics bulletSimulation(settings);
+
+N.B. 1) the parallel loops are executed only if the Bullet library has been compiled with BT_THREADSAFE=1: the constructor checks it, and, if the library is not
+thread-safe (e.g., the libbullet-dev package of Ubuntu/Debian, used in libs/linux), it creates the standard single-threaded world, printing a message on console
+N.B. 2) the task scheduler of Bullet is global: only one multithreaded Physics instance can exist at the same time
+N.B. 3) multithreading pays off with many bodies in contact (large stacks, piles): with few objects, the synchronization costs more than the parallel work.
+The tool in tools/physics_benchmark measures the time of a step with 1 to N threads
 
 author: Davide Gadia
 
@@ -15,46 +44,229 @@ Universita' degli Studi di Milano
 
 #pragma once
 
+// Std. Includes
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
 #include <btBulletDynamicsCommon.h>
+// multithreaded versions of the world, of the solver and of the collision dispatcher, and task schedulers
+#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
+#include <BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h>
+#include <BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h>
+#include <LinearMath/btThreads.h>
+#include <LinearMath/btPoolAllocator.h>
+
+#include <utils/job_system.h>
+#include <utils/instance_motion_state.h>
 
 
 //enum to identify the 2 considered Collision Shapes
 enum shapes{ BOX, SPHERE};
 
+// resolution of the dimensions of the Collision Shapes: the shapes with dimensions which differ less than SHAPE_QUANTUM are shared
+#define SHAPE_QUANTUM 0.0001f
+
+// key of a shared Collision Shape: type and quantized dimensions
+struct ShapeKey {
+    int type;
+    long dims[3];
+
+    bool operator<(const ShapeKey& other) const
+    {
+        if (this->type != other.type)
+            return this->type < other.type;
+        for (int i = 0; i < 3; i++)
+            if (this->dims[i] != other.dims[i])
+                return this->dims[i] < other.dims[i];
+        return false;
+    }
+};
+
+// a shared Collision Shape, with its reference counter and its local inertia for mass = 1
+struct SharedShape {
+    ShapeKey key;
+    btCollisionShape* shape;
+    int references;
+    btVector3 unitInertia;
+};
+
+// task schedulers for the multithreaded simulation
+enum physics_schedulers{ PHYSICS_SCHEDULER_JOBSYSTEM, PHYSICS_SCHEDULER_DEFAULT, PHYSICS_SCHEDULER_OPENMP, PHYSICS_SCHEDULER_TBB, PHYSICS_SCHEDULER_PPL };
+
+// configuration of the physical simulation
+struct PhysicsSettings {
+    bool multithreaded;     // true to create the multithreaded world
+    int scheduler;          // one of physics_schedulers
+    int numThreads;         // threads used by the scheduler (including the main thread): 0 = all the hardware threads
+    int bodyPoolSize;       // capacity of the pools of rigid bodies and Motion States (0 = no pools)
+
+    PhysicsSettings() : multithreaded(false), scheduler(PHYSICS_SCHEDULER_JOBSYSTEM), numThreads(0), bodyPoolSize(1024) {}
+};
+
+/////////////////// JOBTASKSCHEDULER class ///////////////////////
+// adapter to execute the parallel loops of Bullet with the JobSystem: the ranges are split in chunks of grainSize elements, executed by the workers and by the main thread
+class JobTaskScheduler : public btITaskScheduler
+{
+public:
+    // number of parallel loops received from Bullet (used to check if the library is thread-safe)
+    unsigned int numLoops;
+
+    //////////////////////////////////////////
+    // constructor
+    JobTaskScheduler(int numThreads) : btITaskScheduler("JobSystem"), numLoops(0), jobs(nullptr), numThreads(1)
+    {
+        this->setNumThreads(numThreads);
+    }
+
+    //////////////////////////////////////////
+    // destructor
+    ~JobTaskScheduler()
+    {
+        this->DestroyWorkers();
+    }
+
+    // Bullet assigns an index to each thread which calls its functions, up to BT_MAX_THREAD_COUNT
+    virtual int getMaxNumThreads() const { return BT_MAX_THREAD_COUNT; }
+    virtual int getNumThreads() const { return this->numThreads; }
+
+    //////////////////////////////////////////
+    // we create a JobSystem with numThreads-1 workers (with 1 thread, the loops are executed on the calling thread)
+    virtual void setNumThreads(int numThreads)
+    {
+        numThreads = btMax(1, btMin(numThreads, (int)BT_MAX_THREAD_COUNT));
+        if (this->jobs != nullptr && numThreads == this->numThreads)
+            return;
+        this->DestroyWorkers();
+        this->jobs = (numThreads > 1 ? new JobSystem(numThreads - 1) : nullptr);
+        this->numThreads = numThreads;
+    }
+
+    //////////////////////////////////////////
+    virtual void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body)
+    {
+        this->numLoops++;
+        if (this->jobs == nullptr)
+        {
+            body.forLoop(iBegin, iEnd);
+            return;
+        }
+        this->jobs->ParallelFor((size_t)(iEnd - iBegin), (size_t)grainSize, [&body, iBegin](size_t begin, size_t end)
+        {
+            body.forLoop(iBegin + (int)begin, iBegin + (int)end);
+        });
+    }
+
+    //////////////////////////////////////////
+    // each chunk saves its partial sum, and we add them in order (so the result does not depend on the execution order of the chunks)
+    virtual btScalar parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body)
+    {
+        this->numLoops++;
+        if (this->jobs == nullptr)
+            return body.sumLoop(iBegin, iEnd);
+        int grain = btMax(grainSize, 1);
+        vector<btScalar> sums((iEnd - iBegin + grain - 1) / grain, btScalar(0));
+        this->jobs->ParallelFor(sums.size(), 1, [&body, &sums, iBegin, iEnd, grain](size_t begin, size_t end)
+        {
+            for (size_t c = begin; c < end; c++)
+                sums[c] = body.sumLoop(iBegin + (int)c * grain, btMin(iBegin + (int)(c + 1) * grain, iEnd));
+        });
+        btScalar sum = btScalar(0);
+        for (size_t c = 0; c < sums.size(); c++)
+            sum += sums[c];
+        return sum;
+    }
+
+private:
+    JobSystem* jobs;
+    int numThreads;
+
+    //////////////////////////////////////////
+    // we destroy the workers. Bullet never reuses the index of a thread, and the Mt classes use it to access arrays of getNumThreads() elements:
+    // after the destruction of the workers we reset the counter, so the next workers receive again the indices 1 ... numThreads-1
+    void DestroyWorkers()
+    {
+        if (this->jobs == nullptr)
+            return;
+        delete this->jobs;
+        this->jobs = nullptr;
+        btResetThreadIndexCounter();
+    }
+};
+
 ///////////////////  Physics class ///////////////////////
 class Physics
 {
 public:
 
     btDiscreteDynamicsWorld* dynamicsWorld; // the main physical simulation class
-    btAlignedObjectArray<btCollisionShape*> collisionShapes; // a vector for all the Collision Shapes of the scene
+    btAlignedObjectArray<btCollisionShape*> collisionShapes; // a vector for all the (different) Collision Shapes of the scene
     btDefaultCollisionConfiguration* collisionConfiguration; // setup for the collision manager
     btCollisionDispatcher* dispatcher; // collision manager
     btBroadphaseInterface* overlappingPairCache; // method for the broadphase collision detection
-    btSequentialImpulseConstraintSolver* solver; // constraints solver
+    btConstraintSolver* solver; // constraints solver (a pool of solvers in the multithreaded world)
+    btConstraintSolver* solverMt; // multithreaded solver for the large islands (only in the multithreaded world)
+    btITaskScheduler* taskScheduler; // task scheduler of the multithreaded world
+    bool multithreaded; // true if the multithreaded world has been created
+    btPoolAllocator* bodyPool; // pool of rigid bodies
+    btPoolAllocator* motionStatePool; // pool of Motion States
 
 
     //////////////////////////////////////////
     // constructor
     // we set all the classes needed for the physical simulation
-    Physics()
+    Physics(const PhysicsSettings& settings = PhysicsSettings()) : solverMt(NULL), taskScheduler(NULL), multithreaded(false), bodyPool(NULL), motionStatePool(NULL), ownScheduler(false)
     {
+        // pools of rigid bodies and Motion States: the size of the elements is a multiple of 16 bytes, to keep the alignment required by Bullet
+        if (settings.bodyPoolSize > 0)
+        {
+            this->bodyPool = new btPoolAllocator(PoolElementSize(sizeof(btRigidBody)), settings.bodyPoolSize);
+            this->motionStatePool = new btPoolAllocator(PoolElementSize(std::max(sizeof(btDefaultMotionState), sizeof(InstanceMotionState))), settings.bodyPoolSize);
+        }
+
+        // in the multithreaded world, we first set the task scheduler, and we check that the library executes the parallel loops
+        if (settings.multithreaded)
+            this->multithreaded = this->SetupTaskScheduler(settings);
+
         // Collision configuration, to be used by the collision detection class
         // collision configuration contains default setup for memory, collision setup. Advanced users can create their own configuration.
-        this->collisionConfiguration = new btDefaultCollisionConfiguration();
+        // In the multithreaded world, we create larger pools for contacts and collision algorithms: the pools are not expanded in the parallel loops
+        btDefaultCollisionConstructionInfo constructionInfo;
+        if (this->multithreaded)
+        {
+            constructionInfo.m_defaultMaxPersistentManifoldPoolSize = 80000;
+            constructionInfo.m_defaultMaxCollisionAlgorithmPoolSize = 80000;
+        }
+        this->collisionConfiguration = new btDefaultCollisionConfiguration(constructionInfo);
 
-        // default collision dispatcher (= collision detection method). For parallel processing you can use a diffent dispatcher (see Extras/BulletMultiThreaded)
-        this->dispatcher = new btCollisionDispatcher(this->collisionConfiguration);
+        // default collision dispatcher (= collision detection method). In the multithreaded world, the narrowphase is executed in parallel on the pairs of objects
+        if (this->multithreaded)
+            this->dispatcher = new btCollisionDispatcherMt(this->collisionConfiguration);
+        else
+            this->dispatcher = new btCollisionDispatcher(this->collisionConfiguration);
 
         // btDbvtBroadphase is a good general purpose broadphase. You can also try out btAxis3Sweep.
         this->overlappingPairCache = new btDbvtBroadphase();
 
-        // we set a ODE solver, which considers forces, constraints, collisions etc., to calculate positions and rotations of the rigid bodies.
-        // the default constraint solver. For parallel processing you can use a different solver (see Extras/BulletMultiThreaded)
-        this->solver = new btSequentialImpulseConstraintSolver();
+        if (this->multithreaded)
+        {
+            // the islands (= groups of objects in contact) are solved in parallel: each thread takes a solver from the pool.
+            // The large islands are solved by a single solver, which parallelizes the iterations on the contacts
+            this->solver = new btConstraintSolverPoolMt(this->taskScheduler->getNumThreads());
+            this->solverMt = new btSequentialImpulseConstraintSolverMt();
+            this->dynamicsWorld = new btDiscreteDynamicsWorldMt(this->dispatcher,this->overlappingPairCache,(btConstraintSolverPoolMt*)this->solver,this->solverMt,this->collisionConfiguration);
+        }
+        else
+        {
+            // we set a ODE solver, which considers forces, constraints, collisions etc., to calculate positions and rotations of the rigid bodies.
+            // the default constraint solver
+            this->solver = new btSequentialImpulseConstraintSolver();
 
-        //  DynamicsWorld is the main class for the physical simulation
-        this->dynamicsWorld = new btDiscreteDynamicsWorld(this->dispatcher,this->overlappingPairCache,this->solver,this->collisionConfiguration);
+            //  DynamicsWorld is the main class for the physical simulation
+            this->dynamicsWorld = new btDiscreteDynamicsWorld(this->dispatcher,this->overlappingPairCache,this->solver,this->collisionConfiguration);
+        }
 
         // we set the gravity force
         this->dynamicsWorld->setGravity(btVector3(0.0f,-9.82f,0.0f));
@@ -63,10 +275,13 @@ public:
     //////////////////////////////////////////
     // Method for the creation of a rigid body, based on a Box or Sphere Collision Shape
     // The Collision Shape is a reference solid that approximates the shape of the actual object of the scene. The Physical simulation is applied to these solids, and the rotations and positions of these solids are used on the real models.
-    btRigidBody* createRigidBody(int type, glm::vec3 pos, glm::vec3 size, glm::vec3 rot, float m, float friction , float restitution)
+    // If "instances" is not NULL, the model matrix of the body (scaled by "size") is written in a slot of the array at each update of the body
+    btRigidBody* createRigidBody(int type, glm::vec3 pos, glm::vec3 size, glm::vec3 rot, float m, float friction , float restitution, InstanceArray* instances = NULL)
     {
 
-        btCollisionShape* cShape = NULL;
+        // we take the shared Collision Shape with the same type and dimensions (it is created if it does not exist yet)
+        SharedShape* shared = this->acquireShape(type, size);
+        btCollisionShape* cShape = shared->shape;
 
         // we convert the glm vector to a Bullet vector
         btVector3 position = btVector3(pos.x,pos.y,pos.z);
@@ -75,21 +290,6 @@ public:
         btQuaternion rotation;
         rotation.setEuler(rot.x,rot.y,rot.z);
 
-        // Box Collision shape
-        if (type == BOX)
-        {
-            // we convert the glm vector to a Bullet vector
-            btVector3 dim = btVector3(size.x,size.y,size.z);
-            // BoxShape
-            cShape = new btBoxShape(dim);
-        }
-        // Sphere Collision Shape (in this case we consider only the first component)
-        else if (type == SPHERE)
-            cShape = new btSphereShape(size.x);
-
-        // we add this Collision Shape to the vector
-        this->collisionShapes.push_back(cShape);
-
         // We set the initial transformations
         btTransform objTransform;
         objTransform.setIdentity();
@@ -101,14 +301,20 @@ public:
         btScalar mass = m;
         bool isDynamic = (mass != 0.0f);
 
-        // if it is dynamic (mass > 0) then we calculates local inertia
+        // if it is dynamic (mass > 0) then we calculates local inertia (scaling the inertia of the shape for mass = 1)
         btVector3 localInertia(0.0f,0.0f,0.0f);
         if (isDynamic)
-            cShape->calculateLocalInertia(mass,localInertia);
+            localInertia = shared->unitInertia * mass;
 
         // we initialize the Motion State of the object on the basis of the transformations
         // using the Motion State, the physical simulation will calculate the positions and rotations of the rigid body
-        btDefaultMotionState* motionState = new btDefaultMotionState(objTransform);
+        // (from the pool, if there is a free element)
+        void* memory = (this->motionStatePool != NULL ? this->motionStatePool->allocate(this->motionStatePool->getElementSize()) : NULL);
+        btMotionState* motionState;
+        if (instances != NULL)
+            motionState = (memory != NULL ? new (memory) InstanceMotionState(objTransform, instances, size) : new InstanceMotionState(objTransform, instances, size));
+        else
+            motionState = (memory != NULL ? new (memory) btDefaultMotionState(objTransform) : new btDefaultMotionState(objTransform));
 
         // we set the data structure for the rigid body
         btRigidBody::btRigidBodyConstructionInfo rbInfo(mass,motionState,cShape,localInertia);
@@ -124,8 +330,9 @@ public:
             rbInfo.m_rollingFriction = 0.3f;
         }
 
-        // we create the rigid body
-        btRigidBody* body = new btRigidBody(rbInfo);
+        // we create the rigid body (from the pool, if there is a free element)
+        memory = (this->bodyPool != NULL ? this->bodyPool->allocate(sizeof(btRigidBody)) : NULL);
+        btRigidBody* body = (memory != NULL ? new (memory) btRigidBody(rbInfo) : new btRigidBody(rbInfo));
 
         //add the body to the dynamics world
         this->dynamicsWorld->addRigidBody(body);
@@ -135,6 +342,97 @@ public:
         return body;
     }
 
+    //////////////////////////////////////////
+    // we remove a rigid body from the dynamics world, and we delete it (with its Motion State). Its Collision Shape is released
+    void removeRigidBody(btRigidBody* body)
+    {
+        this->dynamicsWorld->removeRigidBody(body);
+        this->deleteMotionState(body->getMotionState());
+        this->releaseShape(body->getCollisionShape());
+        this->deleteBody(body);
+    }
+
+    //////////////////////////////////////////
+    // we delete a rigid body: if it has been allocated in the pool, we call its destructor and we return the memory to the pool
+    void deleteBody(btRigidBody* body)
+    {
+        if (this->bodyPool != NULL && this->bodyPool->validPtr(body))
+        {
+            body->~btRigidBody();
+            this->bodyPool->freeMemory(body);
+        }
+        else
+            delete body;
+    }
+
+    //////////////////////////////////////////
+    // we delete a Motion State (allocated in the pool or with new)
+    void deleteMotionState(btMotionState* motionState)
+    {
+        if (this->motionStatePool != NULL && this->motionStatePool->validPtr(motionState))
+        {
+            motionState->~btMotionState();
+            this->motionStatePool->freeMemory(motionState);
+        }
+        else
+            delete motionState;
+    }
+
+    //////////////////////////////////////////
+    // we take a reference to the shared Collision Shape of the given type and dimensions. If it does not exist, we create it, and we calculate its local inertia
+    SharedShape* acquireShape(int type, glm::vec3 size)
+    {
+        // for spheres, we consider only the first component
+        if (type == SPHERE)
+            size = glm::vec3(size.x, 0.0f, 0.0f);
+        ShapeKey key;
+        key.type = type;
+        key.dims[0] = lround(size.x / SHAPE_QUANTUM);
+        key.dims[1] = lround(size.y / SHAPE_QUANTUM);
+        key.dims[2] = lround(size.z / SHAPE_QUANTUM);
+
+        map<ShapeKey, SharedShape>::iterator it = this->shapeCache.find(key);
+        if (it == this->shapeCache.end())
+        {
+            SharedShape shared;
+            shared.key = key;
+            shared.references = 0;
+            // Box Collision shape
+            if (type == BOX)
+                // we convert the glm vector to a Bullet vector
+                shared.shape = new btBoxShape(btVector3(key.dims[0],key.dims[1],key.dims[2]) * SHAPE_QUANTUM);
+            // Sphere Collision Shape
+            else
+                shared.shape = new btSphereShape(key.dims[0] * SHAPE_QUANTUM);
+            shared.shape->calculateLocalInertia(1.0f, shared.unitInertia);
+            it = this->shapeCache.insert(make_pair(key, shared)).first;
+            // the shape keeps a pointer to its entry of the cache (the elements of a map do not move), used to release it
+            it->second.shape->setUserPointer(&it->second);
+            // we add this Collision Shape to the vector
+            this->collisionShapes.push_back(it->second.shape);
+        }
+        it->second.references++;
+        return &it->second;
+    }
+
+    //////////////////////////////////////////
+    // we release a reference to a shared Collision Shape: when the shape is not used anymore, we delete it
+    void releaseShape(btCollisionShape* shape)
+    {
+        SharedShape* shared = (SharedShape*)shape->getUserPointer();
+        if (shared == NULL || --shared->references > 0)
+            return;
+        // (we copy the key, because it is stored in the entry we are erasing)
+        ShapeKey key = shared->key;
+        this->shapeCache.erase(key);
+        this->collisionShapes.remove(shape);
+        delete shape;
+    }
+
+    //////////////////////////////////////////
+    // number of different Collision Shapes
+    int numShapes() const { return this->collisionShapes.size(); }
+
     //////////////////////////////////////////
     // We delete the data of the physical simulation when the program ends
     void Clear()
@@ -148,10 +446,13 @@ public:
             btRigidBody* body = btRigidBody::upcast(obj);
             if (body && body->getMotionState())
             {
-                delete body->getMotionState();
+                this->deleteMotionState(body->getMotionState());
             }
             this->dynamicsWorld->removeCollisionObject( obj );
-            delete obj;
+            if (body)
+                this->deleteBody(body);
+            else
+                delete obj;
         }
 
         //delete dynamics world
@@ -159,6 +460,8 @@ public:
 
         //delete solver
         delete this->solver;
+        delete this->solverMt;
+        this->solverMt = NULL;
 
         //delete broadphase
         delete this->overlappingPairCache;
@@ -168,6 +471,89 @@ public:
 
         delete this->collisionConfiguration;
 
+        // we delete the pools
+        delete this->bodyPool;
+        delete this->motionStatePool;
+        this->bodyPool = this->motionStatePool = NULL;
+
+        // we delete the Collision Shapes
+        for (int i = 0; i < this->collisionShapes.size(); i++)
+            delete this->collisionShapes[i];
         this->collisionShapes.clear();
+        this->shapeCache.clear();
+
+        // we restore the sequential task scheduler, and we delete the scheduler we have created
+        if (this->taskScheduler != NULL)
+        {
+            btSetTaskScheduler(btGetSequentialTaskScheduler());
+            if (this->ownScheduler)
+                delete this->taskScheduler;
+            this->taskScheduler = NULL;
+        }
+    }
+
+private:
+    // shared Collision Shapes, searched by type and dimensions
+    map<ShapeKey, SharedShape> shapeCache;
+
+    // true if the task scheduler has been created by the class (the OpenMP, TBB and PPL schedulers are singletons of Bullet)
+    bool ownScheduler;
+
+    // size of the elements of a pool: we round the size of the objects to a multiple of 16 bytes
+    static int PoolElementSize(size_t size) { return (int)((size + 15) & ~(size_t)15); }
+
+    // a parallel loop which does nothing (used to check if the library executes the parallel loops)
+    struct EmptyLoop : public btIParallelForBody
+    {
+        void forLoop(int, int) const {}
+    };
+
+    //////////////////////////////////////////
+    // we create (or get) the selected task scheduler, and we set it in Bullet. If the scheduler is not available in the library, we use the JobSystem.
+    // It returns false if the library is not thread-safe: in this case, the parallel loops would be executed serially, and we use the single-threaded world
+    bool SetupTaskScheduler(const PhysicsSettings& settings)
+    {
+        int numThreads = (settings.numThreads > 0 ? settings.numThreads : (int)thread::hardware_concurrency());
+        btITaskScheduler* scheduler = NULL;
+        this->ownScheduler = false;
+        if (settings.scheduler == PHYSICS_SCHEDULER_DEFAULT)
+        {
+            scheduler = btCreateDefaultTaskScheduler();
+            this->ownScheduler = true;
+        }
+        else if (settings.scheduler == PHYSICS_SCHEDULER_OPENMP)
+            scheduler = btGetOpenMPTaskScheduler();
+        else if (settings.scheduler == PHYSICS_SCHEDULER_TBB)
+            scheduler = btGetTBBTaskScheduler();
+        else if (settings.scheduler == PHYSICS_SCHEDULER_PPL)
+            scheduler = btGetPPLTaskScheduler();
+
+        if (scheduler == NULL)
+        {
+            if (settings.scheduler != PHYSICS_SCHEDULER_JOBSYSTEM)
+                std::cout << "Physics: the selected task scheduler is not available in the Bullet library, the JobSystem is used" << std::endl;
+            scheduler = new JobTaskScheduler(numThreads);
+            this->ownScheduler = true;
+        }
+        scheduler->setNumThreads(numThreads);
+        btSetTaskScheduler(scheduler);
+        this->taskScheduler = scheduler;
+
+        // in a library compiled without BT_THREADSAFE, btParallelFor executes the loop directly, without calling the scheduler
+        JobTaskScheduler* jobScheduler = dynamic_cast<JobTaskScheduler*>(scheduler);
+        if (jobScheduler != NULL)
+        {
+            btParallelFor(0, 1, 1, EmptyLoop());
+            if (jobScheduler->numLoops == 0)
+            {
+                std::cout << "Physics: the Bullet library has been compiled without BT_THREADSAFE, the single-threaded world is used" << std::endl;
+                btSetTaskScheduler(btGetSequentialTaskScheduler());
+                delete scheduler;
+                this->taskScheduler = NULL;
+                return false;
+            }
+        }
+        std::cout << "Physics: multithreaded world, " << scheduler->getName() << " task scheduler with " << scheduler->getNumThreads() << " threads" << std::endl;
+        return true;
     }
 };
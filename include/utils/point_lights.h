@@ -0,0 +1,62 @@
+/*
+Point lights utilities
+- PointLight structure: position (in world coordinates), color and radius of influence of a point light
+- generation of a list of lights randomly placed above the ground plane, used to test rendering techniques with many lights (deferred shading, clustered shading)
+
+The radius is the distance where the contribution of the light becomes 0. In the shaders, we use a "windowed" attenuation:
+    attenuation = clamp(1 - (d/radius)^4, 0, 1)^2
+which is close to 1 near the light, and it goes smoothly to 0 at the radius. In this way, each light influences only the points inside a sphere, and we can skip the light for all the other points
+(with a physically based attenuation = 1/d^2, each light influences all the scene).
+
+see:
+https://www.unrealengine.com/en-US/blog/physically-based-shading-on-mobile (windowing function, slides of "Real Shading in Unreal Engine 4")
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <vector>
+#include <random>
+
+#include <glm/glm.hpp>
+
+// a point light
+struct PointLight {
+    // position in world coordinates
+    glm::vec3 position;
+    // color (and intensity) of the light
+    glm::vec3 color;
+    // radius of influence
+    float radius;
+};
+
+//////////////////////////////////////////
+// we add "count" lights with random position (inside the box [min, max]), color, and radius (in the range [minRadius, maxRadius])
+// the generator uses a fixed seed, so the lights are the same at each execution of the application
+inline void GenerateRandomLights(vector<PointLight>& lights, size_t count, const glm::vec3& min, const glm::vec3& max,
+                                 float minRadius, float maxRadius, unsigned int seed = 42)
+{
+    mt19937 generator(seed);
+    uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        PointLight light;
+        light.position = glm::vec3(min.x + unit(generator) * (max.x - min.x),
+                                   min.y + unit(generator) * (max.y - min.y),
+                                   min.z + unit(generator) * (max.z - min.z));
+        // saturated colors, with a low intensity: many lights overlap on the same point
+        glm::vec3 color(unit(generator), unit(generator), unit(generator));
+        light.color = 0.5f * color / glm::max(0.001f, glm::max(color.r, glm::max(color.g, color.b)));
+        light.radius = minRadius + unit(generator) * (maxRadius - minRadius);
+        lights.push_back(light);
+    }
+}
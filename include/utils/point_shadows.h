@@ -0,0 +1,158 @@
+/*
+PointShadows class
+- omnidirectional shadows for point lights, using a cube shadow map for each light
+- the cube maps of all the lights are the layers of a single cube map array (GL_TEXTURE_CUBE_MAP_ARRAY): the layer of the face f of the light i is 6*i + f
+- the cube maps are rendered with layered rendering: the whole array is attached to a single FBO, and the geometry shader (see 35_cube_shadow.geom in lecture05a) sends each triangle
+  to the faces of the cube map, setting gl_Layer. With geometry shader instancing (one invocation for each face), each object is submitted only once for each light, instead of 6 times
+- per-face caster culling: for each object, we calculate the mask of the faces whose frustum contains its bounding sphere. The object is not submitted at all if the mask is 0,
+  and the geometry shader invocations of the faces not in the mask are terminated immediately
+
+In the cube maps we save the distance between the fragment and the light, divided by the far plane (instead of the non-linear depth of the perspective projection):
+in this way, the shadow test in the fragment shader is simply a comparison between distances, with the direction from the light used as lookup vector.
+The texture uses GL_TEXTURE_COMPARE_MODE: it must be sampled with a samplerCubeArrayShadow, and each fetch is a hardware comparison with bilinear filtering of the results.
+
+see:
+https://learnopengl.com/Advanced-Lighting/Shadows/Point-Shadows
+https://www.khronos.org/opengl/wiki/Geometry_Shader#Instancing
+https://www.khronos.org/opengl/wiki/Cubemap_Texture#Cubemap_array_textures
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <utils/culling.h>
+
+/////////////////// POINTSHADOWS class ///////////////////////
+class PointShadows
+{
+public:
+    // number of lights, resolution of each face, and far plane of the projections
+    GLuint numLights, resolution;
+    GLfloat nearPlane, farPlane;
+
+    // FBO and cube map array
+    GLuint FBO, cubeArray;
+
+    // projection * view matrices of the 6 faces of each light (6 * numLights elements)
+    vector<glm::mat4> faceMatrices;
+    // frustum of each face, for the per-face culling
+    vector<Frustum> faceFrustums;
+
+    // PointShadows is not copyable (the destructor deletes the OpenGL objects)
+    PointShadows(const PointShadows& copy) = delete;
+    PointShadows& operator=(const PointShadows&) = delete;
+
+    //////////////////////////////////////////
+    // constructor: we create the cube map array and the FBO
+    PointShadows(GLuint numLights, GLuint resolution = 512, GLfloat nearPlane = 0.1f, GLfloat farPlane = 30.0f)
+        : numLights(numLights), resolution(resolution), nearPlane(nearPlane), farPlane(farPlane),
+          faceMatrices(6 * numLights), faceFrustums(6 * numLights)
+    {
+        glGenTextures(1, &this->cubeArray);
+        glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, this->cubeArray);
+        // for a cube map array, the depth of the texture is the number of faces (6 for each cube map)
+        glTexImage3D(GL_TEXTURE_CUBE_MAP_ARRAY, 0, GL_DEPTH_COMPONENT24, resolution, resolution, 6 * numLights, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        // linear filtering + comparison -> bilinear filtering of the results of the shadow test
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, 0);
+
+        // glFramebufferTexture attaches all the layers of the texture: the layer is selected by the geometry shader
+        glGenFramebuffers(1, &this->FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, this->cubeArray, 0);
+        // we do not calculate nor save color data
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::POINTSHADOWS:: Framebuffer is not complete!" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    //////////////////////////////////////////
+    // destructor
+    ~PointShadows()
+    {
+        glDeleteTextures(1, &this->cubeArray);
+        glDeleteFramebuffers(1, &this->FBO);
+    }
+
+    //////////////////////////////////////////
+    // we calculate the matrices and the frustums of the 6 faces of a light
+    // the directions and "up" vectors follow the conventions of the cube maps (+X, -X, +Y, -Y, +Z, -Z)
+    void SetLight(GLuint light, const glm::vec3& position)
+    {
+        const glm::vec3 directions[6] = { glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+                                          glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f) };
+        const glm::vec3 ups[6] = { glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+                                   glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f) };
+        // each face covers 90 degrees
+        glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, this->nearPlane, this->farPlane);
+        for (GLuint f = 0; f < 6; f++)
+        {
+            this->faceMatrices[6 * light + f] = projection * glm::lookAt(position, position + directions[f], ups[f]);
+            this->faceFrustums[6 * light + f].Extract(this->faceMatrices[6 * light + f]);
+        }
+    }
+
+    //////////////////////////////////////////
+    // mask of the faces of a light (bit f = face f) whose frustum contains the bounding sphere (in world coordinates) of an object
+    GLuint FaceMask(GLuint light, const BoundingSphere& sphere) const
+    {
+        GLuint mask = 0;
+        for (GLuint f = 0; f < 6; f++)
+        {
+            if (this->faceFrustums[6 * light + f].IsVisible(sphere))
+                mask |= (1u << f);
+        }
+        return mask;
+    }
+
+    //////////////////////////////////////////
+    // we set the FBO and the viewport, and we clear all the faces of all the cube maps
+    void BindForWriting()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
+        glViewport(0, 0, this->resolution, this->resolution);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    //////////////////////////////////////////
+    // we pass to the Shader Program (already active) of the shadow pass the data of a light
+    void SetLightUniforms(GLuint program, GLuint light, const glm::vec3& position)
+    {
+        glUniformMatrix4fv(glGetUniformLocation(program, "faceMatrices"), 6, GL_FALSE, glm::value_ptr(this->faceMatrices[6 * light]));
+        glUniform1i(glGetUniformLocation(program, "lightIndex"), light);
+        glUniform3fv(glGetUniformLocation(program, "lightPosition"), 1, glm::value_ptr(position));
+        glUniform1f(glGetUniformLocation(program, "farPlane"), this->farPlane);
+    }
+
+    //////////////////////////////////////////
+    // we bind the cube map array to a texture unit, and we pass it to the Shader Program (already active) of the color pass
+    void BindForReading(GLuint program, GLuint textureUnit)
+    {
+        glActiveTexture(GL_TEXTURE0 + textureUnit);
+        glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, this->cubeArray);
+        glUniform1i(glGetUniformLocation(program, "pointShadows"), textureUnit);
+        glUniform1f(glGetUniformLocation(program, "shadowFarPlane"), this->farPlane);
+    }
+};
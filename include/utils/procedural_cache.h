@@ -0,0 +1,257 @@
+/*
+ProceduralTextureCache class
+- render-to-texture cache for procedural patterns: the procedural shaders of the course calculate the pattern for each fragment at each frame, even if the parameters
+  (frequency, power, colors, ...) do not change. The cache renders the pattern once in a texture (in UV space), for each unique combination of pattern
+  and parameters (ProceduralKey), and it returns the same texture until the parameters change: the objects are then rendered with a single texture fetch
+- animated patterns: the time must be part of the key, otherwise the cached texture would be frozen. We make the time periodic and quantized
+  (ProceduralFrameTime()): after the first period, all the frames of the animation are in the cache and nothing is rendered anymore
+- the memory is limited by a budget of bytes: when a new texture exceeds the budget, the Least Recently Used entries are evicted (and their OpenGL
+  textures are reused for the new entry)
+
+To render the pattern in UV space, the Fragment shader of the pattern must be used with "38_procedural_bake.vert", which draws a quad covering the texture
+and passes the UV coordinates of the texels in interp_UV. The objects are then rendered with "39_procedural_cached.frag".
+
+Usage:
+    Shader bake_shader("38_procedural_bake.vert", "08_random_patterns.frag");
+    ProceduralTextureCache cache(512, 32 * 1024 * 1024);
+    ...
+    ProceduralKey key;
+    key.pattern = "Turbulence";
+    key.parameters.push_back(frequency); ...
+    GLuint texture = cache.Acquire(key, [&]() {
+        bake_shader.Use();
+        ... // subroutine and uniforms of the pattern
+    });
+    ...
+    cache.Clear();      // before the destruction of the OpenGL context
+
+N.B. 1) the texture contains the RGBA color of the pattern. The texels of the fragments discarded by the pattern have alpha = 0: the shader of the objects
+discards them too
+N.B. 2) the pattern is rendered in texture space: the antialiasing based on derivatives (aastep, fwidth) works on the texels, and the mipmaps filter the
+pattern on screen. The resolution of the cache limits the finest details of the pattern
+N.B. 3) all the textures used in a frame must fit in the budget: the entries are evicted only when a new pattern is rendered
+
+see:
+https://learnopengl.com/Advanced-OpenGL/Framebuffers
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <cmath>
+#include <iostream>
+
+// key of a cached pattern: name of the pattern (e.g., the name of the subroutine), and values of its parameters
+struct ProceduralKey {
+    string pattern;
+    vector<float> parameters;
+
+    bool operator<(const ProceduralKey& other) const
+    {
+        if (this->pattern != other.pattern)
+            return this->pattern < other.pattern;
+        return this->parameters < other.parameters;
+    }
+};
+
+//////////////////////////////////////////
+// for animated patterns: the time is made periodic (with the given period, in seconds), and quantized in "frames" steps for each period.
+// It returns the time of the frame, to be used both as parameter of the key and as value of the timer uniform
+inline float ProceduralFrameTime(float time, float period, int frames)
+{
+    int frame = (int)(fmod(time, period) / period * frames);
+    return (frame % frames) * period / frames;
+}
+
+/////////////////// PROCEDURALTEXTURECACHE class ///////////////////////
+class ProceduralTextureCache
+{
+public:
+    // size (width and height) of the textures
+    GLsizei size;
+    // maximum memory of the textures, in bytes
+    size_t budget;
+    // statistics: patterns found in the cache, patterns rendered, and evicted entries
+    unsigned int hits, misses, evictions;
+
+    // ProceduralTextureCache is not copyable (the destructor deletes the OpenGL objects)
+    ProceduralTextureCache(const ProceduralTextureCache& copy) = delete;
+    ProceduralTextureCache& operator=(const ProceduralTextureCache&) = delete;
+
+    //////////////////////////////////////////
+    // constructor (the OpenGL objects are created at the first rendering)
+    ProceduralTextureCache(GLsizei size = 512, size_t budget = 32 * 1024 * 1024)
+        : size(size), budget(budget), hits(0), misses(0), evictions(0), FBO(0), VAO(0) {}
+
+    //////////////////////////////////////////
+    // destructor
+    ~ProceduralTextureCache()
+    {
+        this->Clear();
+    }
+
+    //////////////////////////////////////////
+    // we return the texture with the pattern of the key. If it is not in the cache, we render it: "render" is called to install the Shader Program
+    // of the pattern (with 38_procedural_bake.vert as Vertex shader) and to set its uniforms, then we draw the quad covering the texture
+    template<typename Func>
+    GLuint Acquire(const ProceduralKey& key, Func render)
+    {
+        map<ProceduralKey, list<Entry>::iterator>::iterator found = this->entries.find(key);
+        if (found != this->entries.end())
+        {
+            // we move the entry to the front of the list (= most recently used)
+            this->lru.splice(this->lru.begin(), this->lru, found->second);
+            this->hits++;
+            return found->second->texture;
+        }
+        this->misses++;
+
+        // we evict the least recently used entries until the new texture fits in the budget. The texture of the last evicted entry is reused
+        GLuint texture = 0;
+        while (!this->lru.empty() && (this->lru.size() + 1) * this->TextureSize() > this->budget)
+        {
+            if (texture != 0)
+                glDeleteTextures(1, &texture);
+            texture = this->lru.back().texture;
+            this->entries.erase(this->lru.back().key);
+            this->lru.pop_back();
+            this->evictions++;
+        }
+        if (texture == 0)
+            texture = this->CreateTexture();
+
+        this->Render(texture, render);
+
+        Entry entry;
+        entry.key = key;
+        entry.texture = texture;
+        this->lru.push_front(entry);
+        this->entries[key] = this->lru.begin();
+        return texture;
+    }
+
+    //////////////////////////////////////////
+    // we delete all the textures and the OpenGL objects
+    void Clear()
+    {
+        for (list<Entry>::iterator it = this->lru.begin(); it != this->lru.end(); ++it)
+            glDeleteTextures(1, &it->texture);
+        this->lru.clear();
+        this->entries.clear();
+        if (this->FBO != 0)
+            glDeleteFramebuffers(1, &this->FBO);
+        if (this->VAO != 0)
+            glDeleteVertexArrays(1, &this->VAO);
+        this->FBO = this->VAO = 0;
+    }
+
+    //////////////////////////////////////////
+    // number of cached patterns
+    size_t NumEntries() const { return this->lru.size(); }
+
+    //////////////////////////////////////////
+    // memory of the cached textures, in bytes
+    size_t MemorySize() const { return this->lru.size() * this->TextureSize(); }
+
+    //////////////////////////////////////////
+    // we print on console the statistics of the cache
+    void PrintStats() const
+    {
+        std::cout << "Procedural cache: " << this->NumEntries() << " patterns (" << this->MemorySize() / 1024 << " KB of " << this->budget / 1024 << " KB) - "
+                  << this->hits << " hits, " << this->misses << " rendered, " << this->evictions << " evicted" << std::endl;
+    }
+
+private:
+    // a cached pattern
+    struct Entry {
+        ProceduralKey key;
+        GLuint texture;
+    };
+    // entries in order of use (the most recently used at the front), and search of the entries by key
+    list<Entry> lru;
+    map<ProceduralKey, list<Entry>::iterator> entries;
+    // FBO used to render the patterns, and empty VAO for the quad (the vertices are generated in the Vertex shader from gl_VertexID)
+    GLuint FBO, VAO;
+
+    //////////////////////////////////////////
+    // memory of a texture: RGBA8 with the mipmaps (about 4/3 of the base level)
+    size_t TextureSize() const
+    {
+        return (size_t)this->size * this->size * 4 * 4 / 3;
+    }
+
+    //////////////////////////////////////////
+    // we create a texture for a pattern, with all the mipmap levels
+    GLuint CreateTexture()
+    {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, this->size, this->size, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    }
+
+    //////////////////////////////////////////
+    // we render the pattern in the texture, and we generate the mipmaps. The state changed for the rendering (framebuffer, viewport, depth test,
+    // polygon mode) is restored at the end
+    template<typename Func>
+    void Render(GLuint texture, Func render)
+    {
+        if (this->FBO == 0)
+        {
+            glGenFramebuffers(1, &this->FBO);
+            glGenVertexArrays(1, &this->VAO);
+        }
+        GLint viewport[4], polygonMode[2];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::PROCEDURALCACHE:: Framebuffer is not complete!" << std::endl;
+        glViewport(0, 0, this->size, this->size);
+        glDisable(GL_DEPTH_TEST);
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        // the texels of the discarded fragments remain transparent
+        GLfloat clearColor[4];
+        glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+
+        render();
+        glBindVertexArray(this->VAO);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glBindVertexArray(0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+        if (depthTest)
+            glEnable(GL_DEPTH_TEST);
+    }
+};
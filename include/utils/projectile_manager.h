@@ -0,0 +1,112 @@
+/*
+ProjectileManager class
+- management of the projectiles "shot" in a Bullet world (e.g., the spheres of lecture06b): without a limit, each shot adds a new rigid body, and the cost of the
+  simulation and of the rendering grows with the duration of the session
+- the number of live projectiles is limited by a cap: when a new projectile is fired at the cap, the oldest one is removed from the world.
+  Update() removes also the projectiles which have left the bounds of the scene (e.g., fallen from the plane)
+- the bodies and the Motion States are allocated in the pools of the Physics class (see include/utils/physics.h), and the shape is shared by all the projectiles
+  with the same size: with a cap smaller than the size of the pools, firing and recycling the projectiles does not call the allocator of the system
+
+Usage:
+    ProjectileManager projectiles(bulletSimulation, 200, glm::vec3(-200.0f, -20.0f, -200.0f), glm::vec3(200.0f, 200.0f, 200.0f));
+    ...
+    btRigidBody* sphere = projectiles.Fire(SPHERE, position, size, 1.0f, 0.3f, 0.3f);
+    sphere->applyCentralImpulse(impulse);
+    ...
+    bulletSimulation.dynamicsWorld->stepSimulation(deltaTime, 10);
+    projectiles.Update();
+
+N.B.) Bullet removes an object from the world moving the last object in its position. If the application identifies the objects by their index in the world
+(as lecture06b does), the projectiles must be created after all the other objects: then, the removal of a projectile moves only other projectiles
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <deque>
+
+#include <utils/physics.h>
+
+/////////////////// PROJECTILEMANAGER class ///////////////////////
+class ProjectileManager
+{
+public:
+    // maximum number of live projectiles
+    size_t maxLive;
+    // bounds of the scene: the projectiles outside the box are removed
+    glm::vec3 boundsMin, boundsMax;
+    // statistics: projectiles fired, and projectiles removed because of the cap or because out of bounds
+    unsigned int fired, recycled, outOfBounds;
+
+    // ProjectileManager is not copyable (it removes its bodies from the world)
+    ProjectileManager(const ProjectileManager& copy) = delete;
+    ProjectileManager& operator=(const ProjectileManager&) = delete;
+
+    //////////////////////////////////////////
+    // constructor
+    ProjectileManager(Physics& physics, size_t maxLive, glm::vec3 boundsMin, glm::vec3 boundsMax)
+        : maxLive(maxLive), boundsMin(boundsMin), boundsMax(boundsMax), fired(0), recycled(0), outOfBounds(0), physics(physics) {}
+
+    //////////////////////////////////////////
+    // we create a new projectile (with a null rotation, and with the model matrix written in "instances", if not NULL). If the cap has been reached, we remove the oldest projectile before
+    btRigidBody* Fire(int type, glm::vec3 pos, glm::vec3 size, float m, float friction, float restitution, InstanceArray* instances = NULL)
+    {
+        while (!this->live.empty() && this->live.size() >= this->maxLive)
+        {
+            this->physics.removeRigidBody(this->live.front());
+            this->live.pop_front();
+            this->recycled++;
+        }
+        btRigidBody* body = this->physics.createRigidBody(type, pos, size, glm::vec3(0.0f, 0.0f, 0.0f), m, friction, restitution, instances);
+        this->live.push_back(body);
+        this->fired++;
+        return body;
+    }
+
+    //////////////////////////////////////////
+    // we remove the projectiles outside the bounds of the scene. It must be called after the update of the simulation
+    void Update()
+    {
+        deque<btRigidBody*>::iterator it = this->live.begin();
+        while (it != this->live.end())
+        {
+            const btVector3& p = (*it)->getWorldTransform().getOrigin();
+            if (p.x() < this->boundsMin.x || p.y() < this->boundsMin.y || p.z() < this->boundsMin.z ||
+                p.x() > this->boundsMax.x || p.y() > this->boundsMax.y || p.z() > this->boundsMax.z)
+            {
+                this->physics.removeRigidBody(*it);
+                it = this->live.erase(it);
+                this->outOfBounds++;
+            }
+            else
+                ++it;
+        }
+    }
+
+    //////////////////////////////////////////
+    // we remove all the projectiles from the world
+    void Clear()
+    {
+        for (size_t i = 0; i < this->live.size(); i++)
+            this->physics.removeRigidBody(this->live[i]);
+        this->live.clear();
+    }
+
+    //////////////////////////////////////////
+    // number of live projectiles
+    size_t NumLive() const { return this->live.size(); }
+
+private:
+    // world of the projectiles
+    Physics& physics;
+    // live projectiles, from the oldest to the newest
+    deque<btRigidBody*> live;
+};
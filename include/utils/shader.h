@@ -1,6 +1,7 @@
 /*
 Shader class
 - loading Shader source code, Shader Program creation
+- an optional geometry shader can be added between the vertex and the fragment shaders (e.g., for layered rendering)
 
 N.B. ) adaptation of https://github.com/JoeyDeVries/LearnOpenGL/blob/master/includes/learnopengl/shader.h
 
@@ -32,42 +33,68 @@ public:
     //constructor
     Shader(const GLchar* vertexPath, const GLchar* fragmentPath)
     {
-        // Step 1: we retrieve shaders source code from provided filepaths
-        string vertexCode;
-        string fragmentCode;
-        ifstream vShaderFile;
-        ifstream fShaderFile;
+        this->Build(vertexPath, nullptr, fragmentPath);
+    }
+
+    //////////////////////////////////////////
+
+    //constructor with a geometry shader
+    Shader(const GLchar* vertexPath, const GLchar* geometryPath, const GLchar* fragmentPath)
+    {
+        this->Build(vertexPath, geometryPath, fragmentPath);
+    }
 
+    //////////////////////////////////////////
+
+    // We activate the Shader Program as part of the current rendering process
+    void Use() { glUseProgram(this->Program); }
+
+    // We delete the Shader Program when application closes
+    void Delete() { glDeleteProgram(this->Program); }
+
+private:
+    //////////////////////////////////////////
+
+    // we read a shader source code from file
+    string readFile(const GLchar* path)
+    {
+        ifstream shaderFile;
         // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (ifstream::failbit | ifstream::badbit);
-        fShaderFile.exceptions (ifstream::failbit | ifstream::badbit);
+        shaderFile.exceptions (ifstream::failbit | ifstream::badbit);
         try
         {
-            // Open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            stringstream vShaderStream, fShaderStream;
-            // Read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
+            // Open file
+            shaderFile.open(path);
+            stringstream shaderStream;
+            // Read file's buffer contents into stream
+            shaderStream << shaderFile.rdbuf();
+            // close file handler
+            shaderFile.close();
             // Convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
+            return shaderStream.str();
         }
         catch (ifstream::failure const&)
         {
             cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << endl;
         }
+        return string();
+    }
+
+    //////////////////////////////////////////
+
+    // compilation and linking of the Shader Program (geometryPath can be nullptr)
+    void Build(const GLchar* vertexPath, const GLchar* geometryPath, const GLchar* fragmentPath)
+    {
+        // Step 1: we retrieve shaders source code from provided filepaths
+        string vertexCode = readFile(vertexPath);
+        string fragmentCode = readFile(fragmentPath);
 
         // Convert strings to char pointers
         const GLchar* vShaderCode = vertexCode.c_str();
         const GLchar * fShaderCode = fragmentCode.c_str();
 
         // Step 2: we compile the shaders
-        GLuint vertex, fragment;
+        GLuint vertex, fragment, geometry = 0;
 
         // Vertex Shader
         vertex = glCreateShader(GL_VERTEX_SHADER);
@@ -83,9 +110,22 @@ public:
         // check compilation errors
         checkCompileErrors(fragment, "FRAGMENT");
 
+        // Geometry Shader (optional)
+        if (geometryPath != nullptr)
+        {
+            string geometryCode = readFile(geometryPath);
+            const GLchar * gShaderCode = geometryCode.c_str();
+            geometry = glCreateShader(GL_GEOMETRY_SHADER);
+            glShaderSource(geometry, 1, &gShaderCode, NULL);
+            glCompileShader(geometry);
+            checkCompileErrors(geometry, "GEOMETRY");
+        }
+
         // Step 3: Shader Program creation
         this->Program = glCreateProgram();
         glAttachShader(this->Program, vertex);
+        if (geometry != 0)
+            glAttachShader(this->Program, geometry);
         glAttachShader(this->Program, fragment);
         glLinkProgram(this->Program);
         // check linking errors
@@ -94,19 +134,12 @@ public:
         // Step 4: we delete the shaders because they are linked to the Shader Program, and we do not need them anymore
         glDeleteShader(vertex);
         glDeleteShader(fragment);
+        if (geometry != 0)
+            glDeleteShader(geometry);
     }
 
     //////////////////////////////////////////
 
-    // We activate the Shader Program as part of the current rendering process
-    void Use() { glUseProgram(this->Program); }
-
-    // We delete the Shader Program when application closes
-    void Delete() { glDeleteProgram(this->Program); }
-
-private:
-    //////////////////////////////////////////
-
     // Check compilation and linking errors
     void checkCompileErrors(GLuint shader, string type)
 	{
@@ -0,0 +1,227 @@
+/*
+ShadowAtlas class
+- a single large depth texture (the "atlas"), shared by the shadow maps of many lights: each shadow map is a square tile of the atlas
+- all the shadow maps are rendered in a single FBO: the tile of each shadow map is selected with the viewport (with viewport arrays, a geometry shader can send each triangle
+  to a different tile, see 37_atlas_shadow.geom in lecture05a)
+- the memory is bounded by the dimension of the atlas, independently from the number of lights
+
+Allocation of the tiles: the tiles have power-of-two dimensions, and they are allocated with a quadtree ("buddy" allocator). A free square node is split in 4 children
+until the requested dimension is reached. The atlas is re-packed at each frame: the requests are sorted by decreasing dimension (= importance of the light), and in this
+order the quadtree packs the tiles without fragmentation. If a request does not fit, its dimension is halved until a minimum dimension: the less important lights lose resolution first.
+
+The tiles and the matrices of the shadow maps are passed to the shaders in a Uniform Buffer Object, with std140 layout:
+    layout (std140) uniform ShadowAtlasData { mat4 atlasMatrices[N]; vec4 atlasTiles[N]; };
+where atlasTiles[i] = (x, y, width, height) of the tile i in UV coordinates (width = 0 if the tile has not been allocated)
+
+see:
+https://en.wikipedia.org/wiki/Buddy_memory_allocation
+https://learnopengl.com/Advanced-OpenGL/Advanced-GLSL (Uniform buffer objects)
+https://www.khronos.org/opengl/wiki/Vertex_Post-Processing#Viewport_transform
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// a tile of the atlas (in texels). size = 0 if the tile has not been allocated
+struct AtlasTile {
+    GLuint x, y, size;
+};
+
+/////////////////// SHADOWATLAS class ///////////////////////
+class ShadowAtlas
+{
+public:
+    // dimension of the atlas, minimum dimension of a tile, maximum number of tiles
+    GLuint size, minTile, maxTiles;
+    // FBO, depth texture and UBO
+    GLuint FBO, depthMap, UBO;
+    // tiles allocated in the current frame
+    vector<AtlasTile> tiles;
+
+    // ShadowAtlas is not copyable (the destructor deletes the OpenGL objects)
+    ShadowAtlas(const ShadowAtlas& copy) = delete;
+    ShadowAtlas& operator=(const ShadowAtlas&) = delete;
+
+    //////////////////////////////////////////
+    // constructor: size and minTile must be powers of two
+    ShadowAtlas(GLuint size = 2048, GLuint minTile = 64, GLuint maxTiles = 64) : size(size), minTile(minTile), maxTiles(maxTiles)
+    {
+        // number of levels of the quadtree: level 0 is the whole atlas, the last level has tiles of dimension minTile
+        GLuint levels = 1;
+        for (GLuint s = size; s > minTile; s >>= 1)
+            levels++;
+        this->freeNodes.resize(levels);
+
+        glGenTextures(1, &this->depthMap);
+        glBindTexture(GL_TEXTURE_2D, this->depthMap);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        // the atlas is sampled with a sampler2DShadow: hardware comparison, with bilinear filtering of the results
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glGenFramebuffers(1, &this->FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, this->depthMap, 0);
+        // we do not calculate nor save color data
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::SHADOWATLAS:: Framebuffer is not complete!" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // UBO: maxTiles matrices, followed by maxTiles vec4 (with std140 layout, the stride of both the arrays is a multiple of 16 bytes)
+        glGenBuffers(1, &this->UBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, this->UBO);
+        glBufferData(GL_UNIFORM_BUFFER, maxTiles * (sizeof(glm::mat4) + sizeof(glm::vec4)), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    //////////////////////////////////////////
+    // destructor
+    ~ShadowAtlas()
+    {
+        glDeleteTextures(1, &this->depthMap);
+        glDeleteFramebuffers(1, &this->FBO);
+        glDeleteBuffers(1, &this->UBO);
+    }
+
+    //////////////////////////////////////////
+    // we re-pack the atlas: requests[i] is the requested dimension of the tile i (a power of two, or 0 if the tile is not needed)
+    // the result is saved in the tiles vector, with the same order of the requests
+    void Pack(const vector<GLuint>& requests)
+    {
+        // the whole atlas is free
+        for (size_t l = 0; l < this->freeNodes.size(); l++)
+            this->freeNodes[l].clear();
+        this->freeNodes[0].push_back(glm::uvec2(0, 0));
+
+        // we allocate the tiles by decreasing dimension (the order is stable, so tiles with the same dimension keep the order of the requests)
+        vector<GLuint> order(requests.size());
+        for (size_t i = 0; i < order.size(); i++)
+            order[i] = (GLuint)i;
+        std::stable_sort(order.begin(), order.end(), [&requests](GLuint a, GLuint b) { return requests[a] > requests[b]; });
+
+        this->tiles.assign(requests.size(), AtlasTile{0, 0, 0});
+        this->usedTexels = 0;
+        for (size_t k = 0; k < order.size(); k++)
+        {
+            GLuint i = order[k];
+            if (requests[i] == 0)
+                continue;
+            // if the tile does not fit, we halve its dimension until the minimum
+            for (GLuint tileSize = glm::clamp(requests[i], this->minTile, this->size); tileSize >= this->minTile; tileSize >>= 1)
+            {
+                if (this->Allocate(tileSize, this->tiles[i]))
+                {
+                    this->usedTexels += tileSize * tileSize;
+                    break;
+                }
+            }
+        }
+    }
+
+    //////////////////////////////////////////
+    // we upload in the UBO the matrices of the shadow maps, and the tiles in UV coordinates
+    void Upload(const vector<glm::mat4>& matrices)
+    {
+        GLuint n = glm::min((GLuint)matrices.size(), this->maxTiles);
+        vector<glm::vec4> rects(n);
+        for (GLuint i = 0; i < n && i < this->tiles.size(); i++)
+            rects[i] = glm::vec4(this->tiles[i].x, this->tiles[i].y, this->tiles[i].size, this->tiles[i].size) / (GLfloat)this->size;
+        glBindBuffer(GL_UNIFORM_BUFFER, this->UBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, n * sizeof(glm::mat4), glm::value_ptr(matrices[0]));
+        glBufferSubData(GL_UNIFORM_BUFFER, this->maxTiles * sizeof(glm::mat4), n * sizeof(glm::vec4), glm::value_ptr(rects[0]));
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    //////////////////////////////////////////
+    // we bind the atlas FBO (the only FBO switch of the shadow pass), and we clear the whole atlas
+    void BindForWriting()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
+        glViewport(0, 0, this->size, this->size);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    //////////////////////////////////////////
+    // we set the viewport (and the scissor rectangle, to be sure that nothing is rendered outside the tile) with index "index" on a tile
+    void SetViewport(GLuint index, const AtlasTile& tile)
+    {
+        glViewportIndexedf(index, (GLfloat)tile.x, (GLfloat)tile.y, (GLfloat)tile.size, (GLfloat)tile.size);
+        glScissorIndexed(index, tile.x, tile.y, tile.size, tile.size);
+    }
+
+    //////////////////////////////////////////
+    // we bind the atlas to a texture unit, and the UBO to a binding point, and we connect them to the Shader Program
+    void BindForReading(GLuint program, GLuint textureUnit, GLuint bindingPoint = 0)
+    {
+        glActiveTexture(GL_TEXTURE0 + textureUnit);
+        glBindTexture(GL_TEXTURE_2D, this->depthMap);
+        glUniform1i(glGetUniformLocation(program, "shadowAtlas"), textureUnit);
+        GLuint blockIndex = glGetUniformBlockIndex(program, "ShadowAtlasData");
+        if (blockIndex != GL_INVALID_INDEX)
+            glUniformBlockBinding(program, blockIndex, bindingPoint);
+        glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, this->UBO);
+    }
+
+    // fraction of the atlas used by the tiles of the current frame
+    GLfloat Occupancy() const { return (GLfloat)this->usedTexels / ((GLfloat)this->size * this->size); }
+
+private:
+    // free nodes of the quadtree for each level (position of the top-left corner, in texels)
+    vector<vector<glm::uvec2>> freeNodes;
+    // texels used by the tiles of the current frame
+    GLuint usedTexels = 0;
+
+    //////////////////////////////////////////
+    // allocation of a tile of dimension tileSize: we search a free node at the level of tileSize, or at the first level above it, and we split it
+    bool Allocate(GLuint tileSize, AtlasTile& tile)
+    {
+        GLuint level = 0;
+        for (GLuint s = this->size; s > tileSize; s >>= 1)
+            level++;
+
+        // we search the smallest free node large enough
+        GLint l = (GLint)level;
+        while (l >= 0 && this->freeNodes[l].empty())
+            l--;
+        if (l < 0)
+            return false;
+
+        // we split the node until the requested level: at each split, 3 children are added to the free nodes, and the first one is split again
+        glm::uvec2 node = this->freeNodes[l].back();
+        this->freeNodes[l].pop_back();
+        for (; l < (GLint)level; l++)
+        {
+            GLuint half = (this->size >> l) >> 1;
+            // the children are added in reverse order, so that the next allocations are "top-left" first
+            this->freeNodes[l + 1].push_back(node + glm::uvec2(half, half));
+            this->freeNodes[l + 1].push_back(node + glm::uvec2(0, half));
+            this->freeNodes[l + 1].push_back(node + glm::uvec2(half, 0));
+        }
+        tile.x = node.x;
+        tile.y = node.y;
+        tile.size = tileSize;
+        return true;
+    }
+};
@@ -0,0 +1,192 @@
+/*
+ShadowCascades class
+- Cascaded Shadow Maps (CSM) for a directional light
+- the view frustum of the camera (up to a maximum shadow distance) is split in 2-4 partitions along the depth. Each partition has its own shadow map, with an orthographic projection fitted on the partition:
+  the partitions near the camera are small, so their shadow maps have a high resolution in world units, while the far partitions cover larger areas with the same number of texels
+- the shadow maps are the layers of a single depth texture array (GL_TEXTURE_2D_ARRAY)
+
+The split distances are a blend between a logarithmic and a uniform distribution ("practical split scheme"):
+    split_i = lambda * near * (far/near)^(i/N) + (1 - lambda) * (near + (far - near) * i/N)
+
+To avoid the "shimmering" of the shadow borders when the camera moves or rotates:
+- each partition is enclosed in a bounding sphere: the dimension of the orthographic projection depends only on the radius, which does not change with the rotation of the camera
+- the center of the projection is "snapped" to the texels of the shadow map: the scene is always rasterized with the same sub-texel offsets
+
+The near plane of each orthographic projection is moved towards the light, in order to include the objects outside the partition which can cast shadows inside it.
+
+In the fragment shader, the partition of a fragment is chosen using its depth in view coordinates (see 22_ggx_tex_shadow.frag in lecture06a).
+
+see:
+https://developer.nvidia.com/gpugems/gpugems3/part-ii-light-and-shadows/chapter-10-parallel-split-shadow-maps-programmable-gpus
+https://learn.microsoft.com/en-us/windows/win32/dxtecharts/cascaded-shadow-maps
+https://learnopengl.com/Guest-Articles/2021/CSM
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <string>
+#include <cmath>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// maximum number of cascades (it must be equal to the size of the arrays in the shader)
+#define MAX_CASCADES 4
+
+/////////////////// SHADOWCASCADES class ///////////////////////
+class ShadowCascades
+{
+public:
+    // number of cascades, and resolution of each shadow map
+    GLuint numCascades, resolution;
+    // blend factor between logarithmic (1) and uniform (0) splits
+    GLfloat lambda;
+    // distance of the near plane of the projections from the partitions, towards the light
+    GLfloat casterDistance;
+    // far distance of each partition (in view coordinates)
+    GLfloat splits[MAX_CASCADES];
+    // projection * view matrices of the light for each cascade
+    glm::mat4 lightSpaceMatrices[MAX_CASCADES];
+    // scale to convert a distance along the light direction in a difference of depth in the shadow map (= 1 / depth range of the projection)
+    GLfloat depthScale[MAX_CASCADES];
+
+    // FBO and texture array
+    GLuint FBO, depthArray;
+
+    // ShadowCascades is not copyable (the destructor deletes the OpenGL objects)
+    ShadowCascades(const ShadowCascades& copy) = delete;
+    ShadowCascades& operator=(const ShadowCascades&) = delete;
+
+    //////////////////////////////////////////
+    // constructor
+    ShadowCascades(GLuint numCascades = 3, GLuint resolution = 512, GLfloat lambda = 0.75f, GLfloat casterDistance = 20.0f)
+        : numCascades(0), resolution(resolution), lambda(lambda), casterDistance(casterDistance), depthArray(0)
+    {
+        glGenFramebuffers(1, &this->FBO);
+        this->SetNumCascades(numCascades);
+    }
+
+    ~ShadowCascades()
+    {
+        glDeleteTextures(1, &this->depthArray);
+        glDeleteFramebuffers(1, &this->FBO);
+    }
+
+    //////////////////////////////////////////
+    // we (re)create the texture array with the given number of layers (clamped to [2, MAX_CASCADES])
+    void SetNumCascades(GLuint n)
+    {
+        n = glm::clamp(n, 2u, (GLuint)MAX_CASCADES);
+        if (n == this->numCascades)
+            return;
+        this->numCascades = n;
+
+        if (this->depthArray)
+            glDeleteTextures(1, &this->depthArray);
+        glGenTextures(1, &this->depthArray);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, this->depthArray);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, this->resolution, this->resolution, n, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        // as in the single shadow map, the areas outside the projection are considered in light
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        GLfloat borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+
+    //////////////////////////////////////////
+    // we calculate the splits and the matrices of the light for each cascade
+    // the parameters of the camera projection must be the same used for the camera (N.B.: fovY is passed to glm::perspective, which interprets it in radians)
+    // shadowDistance is the far distance of the last cascade (beyond it, there are no shadows)
+    // lightDir is the direction towards the light
+    void Update(const glm::mat4& view, GLfloat fovY, GLfloat aspect, GLfloat zNear, GLfloat shadowDistance, const glm::vec3& lightDir)
+    {
+        // we use a fixed orientation for the light (the same for all the cascades), so that the texel snapping is consistent
+        glm::mat4 lightView = glm::lookAt(glm::normalize(lightDir), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 inverseView = glm::inverse(view);
+
+        GLfloat previous = zNear;
+        for (GLuint i = 0; i < this->numCascades; i++)
+        {
+            // practical split scheme
+            GLfloat t = (GLfloat)(i+1) / this->numCascades;
+            GLfloat logSplit = zNear * powf(shadowDistance / zNear, t);
+            GLfloat uniformSplit = zNear + (shadowDistance - zNear) * t;
+            this->splits[i] = this->lambda * logSplit + (1.0f - this->lambda) * uniformSplit;
+
+            // corners of the partition in world coordinates: we "unproject" the corners of the NDC cube, using the projection of the partition
+            glm::mat4 inverseProjection = glm::inverse(glm::perspective(fovY, aspect, previous, this->splits[i]));
+            glm::vec3 corners[8];
+            glm::vec3 center(0.0f);
+            for (int c = 0; c < 8; c++)
+            {
+                glm::vec4 p = inverseView * inverseProjection * glm::vec4((c & 1) ? 1.0f : -1.0f, (c & 2) ? 1.0f : -1.0f, (c & 4) ? 1.0f : -1.0f, 1.0f);
+                corners[c] = glm::vec3(p) / p.w;
+                center += corners[c];
+            }
+            center /= 8.0f;
+
+            // bounding sphere of the partition. The radius is rounded up, to avoid small variations due to numerical errors
+            GLfloat radius = 0.0f;
+            for (int c = 0; c < 8; c++)
+                radius = glm::max(radius, glm::length(corners[c] - center));
+            radius = ceilf(radius * 16.0f) / 16.0f;
+
+            // center in light coordinates, snapped to the texels of the shadow map
+            glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+            GLfloat texelSize = 2.0f * radius / this->resolution;
+            lightCenter.x = floorf(lightCenter.x / texelSize) * texelSize;
+            lightCenter.y = floorf(lightCenter.y / texelSize) * texelSize;
+
+            // the light "looks" towards the negative z axis: the near plane is moved towards the light to include the casters outside the partition
+            GLfloat nearPlane = -lightCenter.z - radius - this->casterDistance;
+            GLfloat farPlane = -lightCenter.z + radius;
+            glm::mat4 lightProjection = glm::ortho(lightCenter.x - radius, lightCenter.x + radius, lightCenter.y - radius, lightCenter.y + radius, nearPlane, farPlane);
+            this->lightSpaceMatrices[i] = lightProjection * lightView;
+            this->depthScale[i] = 1.0f / (farPlane - nearPlane);
+
+            previous = this->splits[i];
+        }
+    }
+
+    //////////////////////////////////////////
+    // we set the FBO and the viewport for the rendering of a cascade, and we clear its depth
+    void BindForWriting(GLuint cascade)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, this->depthArray, 0, cascade);
+        // we do not calculate nor save color data
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        glViewport(0, 0, this->resolution, this->resolution);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    //////////////////////////////////////////
+    // we bind the texture array to a texture unit, and we pass to the Shader Program (already active) the data of the cascades
+    void BindForReading(GLuint program, GLuint textureUnit)
+    {
+        glActiveTexture(GL_TEXTURE0 + textureUnit);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, this->depthArray);
+        glUniform1i(glGetUniformLocation(program, "shadowCascades"), textureUnit);
+        glUniform1i(glGetUniformLocation(program, "numCascades"), this->numCascades);
+        glUniformMatrix4fv(glGetUniformLocation(program, "cascadeMatrices"), this->numCascades, GL_FALSE, glm::value_ptr(this->lightSpaceMatrices[0]));
+        glUniform1fv(glGetUniformLocation(program, "cascadeSplits"), this->numCascades, this->splits);
+        glUniform1fv(glGetUniformLocation(program, "cascadeDepthScale"), this->numCascades, this->depthScale);
+    }
+
+    // total memory of the shadow maps (in bytes, considering 4 bytes for each texel)
+    size_t MemorySize() const { return (size_t)this->resolution * this->resolution * this->numCascades * 4; }
+};
@@ -0,0 +1,112 @@
+/*
+simd4: a minimal wrapper for SIMD operations on 4 floats
+- SSE2 on x86/x64 (always available on 64 bit CPUs), NEON on ARM (e.g., Apple Silicon), and a scalar implementation for the other platforms
+- the code using the wrapper is written once, and it processes 4 elements at the same time on all the platforms
+
+The data must be organized in "Structure of Arrays" (SoA) layout: e.g., to test 4 boxes at the same time, the minimum x coordinates of the 4 boxes are contiguous in memory,
+then the minimum y coordinates, etc. The functions Load and Store do not require aligned memory.
+
+Defining SIMD4_SCALAR before the inclusion of this header, the scalar implementation is used on all the platforms (useful for debugging and for comparisons).
+
+see:
+https://www.intel.com/content/www/us/en/docs/intrinsics-guide/index.html
+https://developer.arm.com/architectures/instruction-sets/intrinsics/
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+#if !defined(SIMD4_SCALAR)
+    #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define SIMD4_SSE2
+        #include <emmintrin.h>
+    #elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+        #define SIMD4_NEON
+        #include <arm_neon.h>
+    #else
+        #define SIMD4_SCALAR
+    #endif
+#endif
+
+// 4 floats (or, for the results of the comparisons, 4 masks with all the bits set to 1 (true) or 0 (false))
+struct float4
+{
+#if defined(SIMD4_SSE2)
+    __m128 v;
+#elif defined(SIMD4_NEON)
+    float32x4_t v;
+#else
+    float v[4];
+#endif
+};
+
+#if defined(SIMD4_SSE2)
+
+inline float4 Set1(float a) { float4 r; r.v = _mm_set1_ps(a); return r; }
+inline float4 Set(float a, float b, float c, float d) { float4 r; r.v = _mm_setr_ps(a, b, c, d); return r; }
+inline float4 Load(const float* p) { float4 r; r.v = _mm_loadu_ps(p); return r; }
+inline void Store(float* p, const float4& a) { _mm_storeu_ps(p, a.v); }
+inline float4 operator+(const float4& a, const float4& b) { float4 r; r.v = _mm_add_ps(a.v, b.v); return r; }
+inline float4 operator-(const float4& a, const float4& b) { float4 r; r.v = _mm_sub_ps(a.v, b.v); return r; }
+inline float4 operator*(const float4& a, const float4& b) { float4 r; r.v = _mm_mul_ps(a.v, b.v); return r; }
+inline float4 Min(const float4& a, const float4& b) { float4 r; r.v = _mm_min_ps(a.v, b.v); return r; }
+inline float4 Max(const float4& a, const float4& b) { float4 r; r.v = _mm_max_ps(a.v, b.v); return r; }
+inline float4 CmpLE(const float4& a, const float4& b) { float4 r; r.v = _mm_cmple_ps(a.v, b.v); return r; }
+inline float4 CmpLT(const float4& a, const float4& b) { float4 r; r.v = _mm_cmplt_ps(a.v, b.v); return r; }
+inline float4 And(const float4& a, const float4& b) { float4 r; r.v = _mm_and_ps(a.v, b.v); return r; }
+// for each element, mask ? a : b
+inline float4 Select(const float4& mask, const float4& a, const float4& b) { float4 r; r.v = _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); return r; }
+// a bit for each element of a mask (bit i = element i)
+inline int MoveMask(const float4& mask) { return _mm_movemask_ps(mask.v); }
+
+#elif defined(SIMD4_NEON)
+
+inline float4 Set1(float a) { float4 r; r.v = vdupq_n_f32(a); return r; }
+inline float4 Set(float a, float b, float c, float d) { float tmp[4] = { a, b, c, d }; float4 r; r.v = vld1q_f32(tmp); return r; }
+inline float4 Load(const float* p) { float4 r; r.v = vld1q_f32(p); return r; }
+inline void Store(float* p, const float4& a) { vst1q_f32(p, a.v); }
+inline float4 operator+(const float4& a, const float4& b) { float4 r; r.v = vaddq_f32(a.v, b.v); return r; }
+inline float4 operator-(const float4& a, const float4& b) { float4 r; r.v = vsubq_f32(a.v, b.v); return r; }
+inline float4 operator*(const float4& a, const float4& b) { float4 r; r.v = vmulq_f32(a.v, b.v); return r; }
+inline float4 Min(const float4& a, const float4& b) { float4 r; r.v = vminq_f32(a.v, b.v); return r; }
+inline float4 Max(const float4& a, const float4& b) { float4 r; r.v = vmaxq_f32(a.v, b.v); return r; }
+inline float4 CmpLE(const float4& a, const float4& b) { float4 r; r.v = vreinterpretq_f32_u32(vcleq_f32(a.v, b.v)); return r; }
+inline float4 CmpLT(const float4& a, const float4& b) { float4 r; r.v = vreinterpretq_f32_u32(vcltq_f32(a.v, b.v)); return r; }
+inline float4 And(const float4& a, const float4& b) { float4 r; r.v = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a.v), vreinterpretq_u32_f32(b.v))); return r; }
+inline float4 Select(const float4& mask, const float4& a, const float4& b) { float4 r; r.v = vbslq_f32(vreinterpretq_u32_f32(mask.v), a.v, b.v); return r; }
+// NEON does not have a "movemask" instruction: we extract the sign bit of each element
+inline int MoveMask(const float4& mask)
+{
+    uint32x4_t m = vshrq_n_u32(vreinterpretq_u32_f32(mask.v), 31);
+    return (int)(vgetq_lane_u32(m, 0) | (vgetq_lane_u32(m, 1) << 1) | (vgetq_lane_u32(m, 2) << 2) | (vgetq_lane_u32(m, 3) << 3));
+}
+
+#else
+
+// scalar implementation: the masks are saved as floats with all the bits set to 1 or 0
+#include <cstring>
+
+inline float SIMD4_MaskValue(bool b) { unsigned int bits = (b ? 0xFFFFFFFFu : 0u); float f; memcpy(&f, &bits, sizeof(float)); return f; }
+inline unsigned int SIMD4_Bits(float f) { unsigned int bits; memcpy(&bits, &f, sizeof(float)); return bits; }
+
+inline float4 Set1(float a) { float4 r; for (int i = 0; i < 4; i++) r.v[i] = a; return r; }
+inline float4 Set(float a, float b, float c, float d) { float4 r; r.v[0] = a; r.v[1] = b; r.v[2] = c; r.v[3] = d; return r; }
+inline float4 Load(const float* p) { float4 r; for (int i = 0; i < 4; i++) r.v[i] = p[i]; return r; }
+inline void Store(float* p, const float4& a) { for (int i = 0; i < 4; i++) p[i] = a.v[i]; }
+inline float4 operator+(const float4& a, const float4& b) { float4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] + b.v[i]; return r; }
+inline float4 operator-(const float4& a, const float4& b) { float4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] - b.v[i]; return r; }
+inline float4 operator*(const float4& a, const float4& b) { float4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] * b.v[i]; return r; }
+inline float4 Min(const float4& a, const float4& b) { float4 r; for (int i = 0; i < 4; i++) r.v[i] = (a.v[i] < b.v[i] ? a.v[i] : b.v[i]); return r; }
+inline float4 Max(const float4& a, const float4& b) { float4 r; for (int i = 0; i < 4; i++) r.v[i] = (a.v[i] > b.v[i] ? a.v[i] : b.v[i]); return r; }
+inline float4 CmpLE(const float4& a, const float4& b) { float4 r; for (int i = 0; i < 4; i++) r.v[i] = SIMD4_MaskValue(a.v[i] <= b.v[i]); return r; }
+inline float4 CmpLT(const float4& a, const float4& b) { float4 r; for (int i = 0; i < 4; i++) r.v[i] = SIMD4_MaskValue(a.v[i] < b.v[i]); return r; }
+inline float4 And(const float4& a, const float4& b) { float4 r; for (int i = 0; i < 4; i++) { unsigned int bits = SIMD4_Bits(a.v[i]) & SIMD4_Bits(b.v[i]); memcpy(&r.v[i], &bits, sizeof(float)); } return r; }
+inline float4 Select(const float4& mask, const float4& a, const float4& b) { float4 r; for (int i = 0; i < 4; i++) r.v[i] = (SIMD4_Bits(mask.v[i]) ? a.v[i] : b.v[i]); return r; }
+inline int MoveMask(const float4& mask) { int bits = 0; for (int i = 0; i < 4; i++) bits |= (SIMD4_Bits(mask.v[i]) >> 31) << i; return bits; }
+
+#endif
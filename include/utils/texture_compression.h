@@ -0,0 +1,309 @@
+/*
+Texture compression functions, used by the texture baker (tools/texture_baker)
+- generation of the mipmap chain on the CPU, with a box filter applied in linear space ("gamma-correct" mipmaps): the color channels of the images are sRGB encoded,
+  so they are converted to linear values before the averaging, and converted back to sRGB after it. Averaging directly the sRGB values makes the smaller levels darker
+- encoding of the levels in the block compression formats supported by the GPUs:
+    - BC1 (DXT1): for each 4x4 block, two RGB565 endpoint colors and a 2 bit index for each texel, which selects one of 4 colors interpolated between the endpoints
+    - BC4 (RGTC1): for a single channel, two 8 bit endpoints and a 3 bit index for each texel, which selects one of 8 values interpolated between the endpoints
+    - BC3 (DXT5): a BC4 block for the alpha channel, followed by a BC1 block for the colors
+  The endpoints of BC1 are chosen along the principal axis of the colors of the block (the direction of maximum variance, calculated with the power iteration
+  on the covariance matrix), and they are moved slightly inside the range of the colors, to reduce the average error of the interpolated colors
+
+The encoding of the blocks is independent, so the blocks of a level are encoded in parallel using a JobSystem.
+
+see:
+https://learn.microsoft.com/en-us/windows/win32/direct3d10/d3d10-graphics-programming-guide-resources-block-compression
+https://www.reedbeta.com/blog/understanding-bcn-texture-compression-formats/
+https://github.com/nothings/stb/blob/master/stb_dxt.h
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+
+#include <utils/job_system.h>
+#include <utils/texture_container.h>
+
+//////////////////////////////////////////
+// minimum between two integers (used to clamp the coordinates)
+inline int MinInt(int a, int b)
+{
+    return (a < b ? a : b);
+}
+
+//////////////////////////////////////////
+// conversion between sRGB values (in [0,255]) and linear values (in [0,1]), using the exact sRGB curve
+inline float SRGBToLinear(unsigned char v)
+{
+    float c = v / 255.0f;
+    return (c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f));
+}
+
+inline unsigned char LinearToSRGB(float c)
+{
+    c = (c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f);
+    c = (c < 0.0f ? 0.0f : (c > 1.0f ? 1.0f : c));
+    return (unsigned char)(c * 255.0f + 0.5f);
+}
+
+//////////////////////////////////////////
+// we calculate the next level of the mipmap chain, with a 2x2 box filter. For the images with odd dimensions, the last row/column is clamped
+// if gammaCorrect is true, the first 3 channels are averaged in linear space (the alpha channel, and the images with less than 3 channels, are always considered linear)
+inline void DownsampleImage(const vector<unsigned char>& src, int w, int h, int channels, bool gammaCorrect, vector<unsigned char>& dst, int& dw, int& dh)
+{
+    dw = (w > 1 ? w / 2 : 1);
+    dh = (h > 1 ? h / 2 : 1);
+    dst.resize((size_t)dw * dh * channels);
+
+    // look-up table for the conversion to linear space
+    float toLinear[256];
+    for (int v = 0; v < 256; v++)
+        toLinear[v] = SRGBToLinear((unsigned char)v);
+    int colorChannels = (gammaCorrect && channels >= 3 ? 3 : 0);
+
+    for (int y = 0; y < dh; y++)
+    {
+        int y0 = MinInt(2 * y, h - 1), y1 = MinInt(2 * y + 1, h - 1);
+        for (int x = 0; x < dw; x++)
+        {
+            int x0 = MinInt(2 * x, w - 1), x1 = MinInt(2 * x + 1, w - 1);
+            const unsigned char* p[4] = { &src[((size_t)y0 * w + x0) * channels], &src[((size_t)y0 * w + x1) * channels],
+                                          &src[((size_t)y1 * w + x0) * channels], &src[((size_t)y1 * w + x1) * channels] };
+            unsigned char* out = &dst[((size_t)y * dw + x) * channels];
+            for (int c = 0; c < channels; c++)
+            {
+                if (c < colorChannels)
+                    out[c] = LinearToSRGB(0.25f * (toLinear[p[0][c]] + toLinear[p[1][c]] + toLinear[p[2][c]] + toLinear[p[3][c]]));
+                else
+                    out[c] = (unsigned char)((p[0][c] + p[1][c] + p[2][c] + p[3][c] + 2) / 4);
+            }
+        }
+    }
+}
+
+//////////////////////////////////////////
+// conversion of an RGB color to RGB565, and back to 8 bits for each channel (the high bits are replicated in the low bits, as in the GPU decoder)
+inline uint16_t PackRGB565(const float* c)
+{
+    int r = (int)(c[0] * 31.0f / 255.0f + 0.5f), g = (int)(c[1] * 63.0f / 255.0f + 0.5f), b = (int)(c[2] * 31.0f / 255.0f + 0.5f);
+    r = (r < 0 ? 0 : (r > 31 ? 31 : r));
+    g = (g < 0 ? 0 : (g > 63 ? 63 : g));
+    b = (b < 0 ? 0 : (b > 31 ? 31 : b));
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+inline void UnpackRGB565(uint16_t v, int* c)
+{
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    c[0] = (r << 3) | (r >> 2);
+    c[1] = (g << 2) | (g >> 4);
+    c[2] = (b << 3) | (b >> 2);
+}
+
+//////////////////////////////////////////
+// BC1 encoding of a 4x4 block (texels: 16 RGBA colors, in row order). The result (8 bytes) is written in "out"
+inline void EncodeBC1Block(const unsigned char texels[16][4], unsigned char* out)
+{
+    // mean and covariance matrix of the colors
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 3; c++)
+            mean[c] += texels[i][c] / 16.0f;
+    float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; i++)
+    {
+        float r = texels[i][0] - mean[0], g = texels[i][1] - mean[1], b = texels[i][2] - mean[2];
+        cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+        cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+    }
+
+    // principal axis with the power iteration
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int it = 0; it < 8; it++)
+    {
+        float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        float len = fmaxf(fabsf(x), fmaxf(fabsf(y), fabsf(z)));
+        if (len < 1e-6f)
+            break;
+        axis[0] = x / len; axis[1] = y / len; axis[2] = z / len;
+    }
+
+    // range of the projections of the colors on the axis
+    float tMin = 1e30f, tMax = -1e30f;
+    float norm = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    for (int i = 0; i < 16; i++)
+    {
+        float t = ((texels[i][0] - mean[0]) * axis[0] + (texels[i][1] - mean[1]) * axis[1] + (texels[i][2] - mean[2]) * axis[2]) / norm;
+        tMin = fminf(tMin, t);
+        tMax = fmaxf(tMax, t);
+    }
+    // the endpoints are moved inside the range by 1/16 of its length
+    float inset = (tMax - tMin) / 16.0f;
+    tMin += inset;
+    tMax -= inset;
+    float e0[3], e1[3];
+    for (int c = 0; c < 3; c++)
+    {
+        e0[c] = mean[c] + axis[c] * tMax;
+        e1[c] = mean[c] + axis[c] * tMin;
+    }
+    uint16_t c0 = PackRGB565(e0), c1 = PackRGB565(e1);
+    // c0 > c1 selects the mode with 4 colors
+    if (c0 < c1)
+    {
+        uint16_t t = c0; c0 = c1; c1 = t;
+    }
+
+    uint32_t indices = 0;
+    if (c0 != c1)
+    {
+        // palette: the endpoints and 2 colors interpolated at 1/3 and 2/3
+        int p[4][3];
+        UnpackRGB565(c0, p[0]);
+        UnpackRGB565(c1, p[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            p[2][c] = (2 * p[0][c] + p[1][c]) / 3;
+            p[3][c] = (p[0][c] + 2 * p[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestDistance = 1 << 30;
+            for (int k = 0; k < 4; k++)
+            {
+                int dr = texels[i][0] - p[k][0], dg = texels[i][1] - p[k][1], db = texels[i][2] - p[k][2];
+                int d = dr * dr + dg * dg + db * db;
+                if (d < bestDistance)
+                {
+                    bestDistance = d;
+                    best = k;
+                }
+            }
+            indices |= (uint32_t)best << (2 * i);
+        }
+    }
+
+    // the values are stored in little endian order
+    out[0] = c0 & 0xFF; out[1] = c0 >> 8;
+    out[2] = c1 & 0xFF; out[3] = c1 >> 8;
+    for (int b = 0; b < 4; b++)
+        out[4 + b] = (indices >> (8 * b)) & 0xFF;
+}
+
+//////////////////////////////////////////
+// BC4 encoding of a 4x4 block of a single channel (values: 16 values, in row order). The result (8 bytes) is written in "out"
+inline void EncodeBC4Block(const unsigned char values[16], unsigned char* out)
+{
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; i++)
+    {
+        a0 = (values[i] > a0 ? values[i] : a0);
+        a1 = (values[i] < a1 ? values[i] : a1);
+    }
+
+    uint64_t indices = 0;
+    if (a0 != a1)
+    {
+        // a0 > a1 selects the mode with 8 values: the endpoints, and 6 values interpolated between them
+        int p[8];
+        p[0] = a0;
+        p[1] = a1;
+        for (int k = 1; k < 7; k++)
+            p[k + 1] = ((7 - k) * a0 + k * a1) / 7;
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestDistance = 256;
+            for (int k = 0; k < 8; k++)
+            {
+                int d = abs(values[i] - p[k]);
+                if (d < bestDistance)
+                {
+                    bestDistance = d;
+                    best = k;
+                }
+            }
+            indices |= (uint64_t)best << (3 * i);
+        }
+    }
+
+    out[0] = (unsigned char)a0;
+    out[1] = (unsigned char)a1;
+    for (int b = 0; b < 6; b++)
+        out[2 + b] = (indices >> (8 * b)) & 0xFF;
+}
+
+//////////////////////////////////////////
+// we encode a whole level (w x h texels, with "channels" channels) in the given format. The rows of blocks are encoded in parallel
+// the blocks at the borders of the images with dimensions not multiple of 4 are completed by clamping the coordinates
+inline void EncodeLevel(const vector<unsigned char>& image, int w, int h, int channels, uint32_t format, vector<unsigned char>& out, JobSystem* jobs)
+{
+    int blocksX = (w + 3) / 4, blocksY = (h + 3) / 4;
+    uint32_t blockSize = TextureFormatBlockSize(format);
+    out.resize((size_t)blocksX * blocksY * blockSize);
+
+    auto encodeRows = [&image, &out, w, h, channels, format, blocksX, blockSize](size_t begin, size_t end)
+    {
+        unsigned char texels[16][4];
+        unsigned char values[16];
+        for (size_t by = begin; by < end; by++)
+        {
+            for (int bx = 0; bx < blocksX; bx++)
+            {
+                // we read the texels of the block, converted to RGBA
+                for (int i = 0; i < 16; i++)
+                {
+                    int x = MinInt(bx * 4 + (i & 3), w - 1), y = MinInt((int)by * 4 + (i >> 2), h - 1);
+                    const unsigned char* p = &image[((size_t)y * w + x) * channels];
+                    if (channels >= 3)
+                    {
+                        texels[i][0] = p[0]; texels[i][1] = p[1]; texels[i][2] = p[2];
+                        texels[i][3] = (channels == 4 ? p[3] : 255);
+                    }
+                    else
+                    {
+                        // grayscale (with alpha, if channels = 2)
+                        texels[i][0] = texels[i][1] = texels[i][2] = p[0];
+                        texels[i][3] = (channels == 2 ? p[1] : 255);
+                    }
+                }
+
+                unsigned char* block = &out[((size_t)by * blocksX + bx) * blockSize];
+                if (format == TEXTURE_FORMAT_BC1)
+                    EncodeBC1Block(texels, block);
+                else if (format == TEXTURE_FORMAT_BC3)
+                {
+                    for (int i = 0; i < 16; i++)
+                        values[i] = texels[i][3];
+                    EncodeBC4Block(values, block);
+                    EncodeBC1Block(texels, block + 8);
+                }
+                else
+                {
+                    for (int i = 0; i < 16; i++)
+                        values[i] = texels[i][0];
+                    EncodeBC4Block(values, block);
+                }
+            }
+        }
+    };
+
+    // a job for each group of 4 rows of blocks
+    if (jobs != nullptr)
+        jobs->ParallelFor((size_t)blocksY, 4, encodeRows);
+    else
+        encodeRows(0, (size_t)blocksY);
+}
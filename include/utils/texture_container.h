@@ -0,0 +1,199 @@
+/*
+Baked texture container (".rtex" files)
+- file format of the textures pre-processed offline by the texture baker (tools/texture_baker): the whole mipmap chain, already compressed in a block format
+  which can be uploaded directly to the GPU (BC1 / BC3 / RGTC1), so at runtime there is no decoding of PNG/JPEG images and no generation of the mipmaps
+- the file is designed to be memory mapped: the header and the table of the levels are followed by the data of the levels, each one aligned to 16 bytes,
+  and the loader passes to glCompressedTexImage2D pointers directly inside the mapped file
+
+Layout of the file:
+    TextureFileHeader                  (magic "RTEX", version, format, dimensions, number of levels)
+    TextureFileLevel[numLevels]        (offset from the beginning of the file, size in bytes and dimensions of each level)
+    data of the levels                 (level 0 = largest level)
+
+The MappedFile class maps a file in memory (read-only), using mmap on Linux/MacOS and CreateFileMapping on Windows.
+
+see:
+https://learn.microsoft.com/en-us/windows/win32/direct3d10/d3d10-graphics-programming-guide-resources-block-compression
+https://registry.khronos.org/KTX/specs/1.0/ktxspec.v1.html
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#ifdef _WIN32
+    // we include only the essential part of the Win32 API (for the file mapping): without NOMINMAX, the min and max macros would break
+    // glm::min and glm::max in the files including this header
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+    // the legacy near and far macros would replace the names of variables (e.g., the planes of the camera frustum)
+    #undef near
+    #undef far
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+// OpenGL internal formats of the S3TC blocks: they are not part of the OpenGL core profile (and they are not defined by glad), but they are supported
+// by all the desktop GPUs (EXT_texture_compression_s3tc)
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+    #define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+    #define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// version of the format: files with a different version are rejected by the loader, and they must be baked again
+#define TEXTURE_FILE_VERSION 1
+
+// block formats of the baked textures
+enum texture_file_formats {
+    TEXTURE_FORMAT_BC1 = 1,     // RGB, 8 bytes for each 4x4 block (4 bits per texel)
+    TEXTURE_FORMAT_BC3 = 2,     // RGBA, 16 bytes for each 4x4 block (8 bits per texel): BC1 color + interpolated alpha
+    TEXTURE_FORMAT_RGTC1 = 3    // single channel (also known as BC4), 8 bytes for each 4x4 block
+};
+
+// header of the file
+struct TextureFileHeader {
+    char magic[4];          // "RTEX"
+    uint32_t version;
+    uint32_t format;        // one of texture_file_formats
+    uint32_t width, height;
+    uint32_t numLevels;
+    uint32_t channels;      // number of channels of the original image
+    uint32_t reserved;
+};
+
+// description of a mipmap level
+struct TextureFileLevel {
+    uint32_t offset;        // from the beginning of the file
+    uint32_t size;          // in bytes
+    uint32_t width, height;
+};
+
+//////////////////////////////////////////
+// size in bytes of a 4x4 block
+inline uint32_t TextureFormatBlockSize(uint32_t format)
+{
+    return (format == TEXTURE_FORMAT_BC3 ? 16 : 8);
+}
+
+//////////////////////////////////////////
+// size in bytes of a level of dimensions w x h: the dimensions are rounded up to multiples of the blocks
+inline uint32_t TextureLevelSize(uint32_t format, uint32_t w, uint32_t h)
+{
+    return ((w + 3) / 4) * ((h + 3) / 4) * TextureFormatBlockSize(format);
+}
+
+/////////////////// MAPPEDFILE class ///////////////////////
+// a file mapped in memory (read-only). The memory is released by the destructor
+class MappedFile
+{
+public:
+    // MappedFile is not copyable (the destructor releases the mapping)
+    MappedFile(const MappedFile& copy) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    //////////////////////////////////////////
+    // constructor: we map the whole file. If the file cannot be opened, Data() returns nullptr
+    MappedFile(const string& path) : data(nullptr), size(0)
+    {
+#ifdef _WIN32
+        this->file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        this->mapping = NULL;
+        if (this->file == INVALID_HANDLE_VALUE)
+            return;
+        LARGE_INTEGER fileSize;
+        GetFileSizeEx(this->file, &fileSize);
+        this->mapping = CreateFileMappingA(this->file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (this->mapping == NULL)
+            return;
+        this->data = (const unsigned char*)MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0);
+        if (this->data != nullptr)
+            this->size = (size_t)fileSize.QuadPart;
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            void* p = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED)
+            {
+                this->data = (const unsigned char*)p;
+                this->size = (size_t)info.st_size;
+            }
+        }
+        // the mapping remains valid after the file has been closed
+        close(fd);
+#endif
+    }
+
+    //////////////////////////////////////////
+    // destructor
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        if (this->data != nullptr)
+            UnmapViewOfFile(this->data);
+        if (this->mapping != NULL)
+            CloseHandle(this->mapping);
+        if (this->file != INVALID_HANDLE_VALUE)
+            CloseHandle(this->file);
+#else
+        if (this->data != nullptr)
+            munmap((void*)this->data, this->size);
+#endif
+    }
+
+    const unsigned char* Data() const { return this->data; }
+    size_t Size() const { return this->size; }
+
+private:
+    const unsigned char* data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file, mapping;
+#endif
+};
+
+//////////////////////////////////////////
+// we validate the header and the table of the levels of a mapped file. It returns the header, or nullptr if the file is not valid
+inline const TextureFileHeader* ValidateTextureFile(const MappedFile& file)
+{
+    if (file.Data() == nullptr || file.Size() < sizeof(TextureFileHeader))
+        return nullptr;
+    const TextureFileHeader* header = (const TextureFileHeader*)file.Data();
+    if (memcmp(header->magic, "RTEX", 4) != 0 || header->version != TEXTURE_FILE_VERSION || header->numLevels == 0)
+        return nullptr;
+    if (file.Size() < sizeof(TextureFileHeader) + header->numLevels * sizeof(TextureFileLevel))
+        return nullptr;
+    // the data of each level must be inside the file
+    const TextureFileLevel* levels = (const TextureFileLevel*)(file.Data() + sizeof(TextureFileHeader));
+    for (uint32_t l = 0; l < header->numLevels; l++)
+    {
+        if ((size_t)levels[l].offset + levels[l].size > file.Size())
+            return nullptr;
+    }
+    return header;
+}
@@ -0,0 +1,546 @@
+/*
+TextureManager class
+- loading of the 2D textures from disk, with a cache of the textures already loaded
+- the textures are identified by the path of the image and the loading parameters (wrapping mode, mipmaps): if the same texture is requested more than once,
+  the image is decoded and uploaded only the first time, and the following requests receive the same OpenGL texture
+- each texture has a reference counter: Acquire() increments it, Release() decrements it, and the texture is deleted when the last reference is released
+- the manager keeps track of the (estimated) GPU memory used by the textures, and of the number of decoded images and of the cache hits
+- baked textures: the paths with extension ".rtex" are loaded from the files created by the texture baker (tools/texture_baker, format in include/utils/texture_container.h).
+  The file is memory mapped, and its levels (already block-compressed, with all the mipmaps) are uploaded with glCompressedTexImage2D: there is no decoding and no glGenerateMipmap
+- packed environments: AcquireCube() accepts also the ".renv" files created by the environment converter (tools/environment_converter, format in
+  include/utils/environment_container.h): the 6 faces of all the levels are in a single memory mapped file, and each level is uploaded with a single call (with OpenGL 4.5)
+- parallel loading: AcquireMany() and AcquireCube() decode all the requested images at the same time, using the worker threads of a JobSystem (include/utils/job_system.h),
+  and then they upload the textures in the calling thread. The loading time is close to the decoding time of the largest image, instead of the sum of the decoding times.
+  If usePBO is true, the decoded pixels are copied (again in parallel) in a Pixel Buffer Object, and the textures are specified from the buffer: the driver can transfer
+  the data to the GPU asynchronously, and glTexImage2D returns without copying the pixels
+
+Usage:
+    GLuint tex = textureManager.Acquire("../../textures/SoilCracked.png");   // it replaces the LoadTexture() function of the lectures
+    vector<GLuint> texs = textureManager.AcquireMany(paths, &jobs);           // parallel decoding of a group of images
+    GLuint cube = textureManager.AcquireCube("../../textures/cube/Maskonaive2/", &jobs);
+    GLuint cube = textureManager.AcquireCube("../../textures/cube/Maskonaive2.renv", nullptr);  // packed environment
+    ...
+    textureManager.Release(tex);                                            // optional: the remaining textures are deleted by Clear() or by the destructor
+
+N.B. 1) the implementation of stb_image must be included in the application (#define STB_IMAGE_IMPLEMENTATION before including stb_image.h)
+N.B. 2) the methods call OpenGL functions: they must be called in the thread which owns the OpenGL context. Only the decoding of the images (and the copy in the PBO) is executed by the workers
+N.B. 3) stb_image is thread-safe, as long as the global settings (e.g., stbi_set_flip_vertically_on_load) are not changed during the loading
+
+see:
+https://www.khronos.org/opengl/wiki/Pixel_Buffer_Object
+http://www.songho.ca/opengl/gl_pbo.html
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <string>
+#include <vector>
+#include <map>
+#include <cstring>
+#include <iostream>
+
+#include "stb_image/stb_image.h"
+
+#include <utils/job_system.h>
+#include <utils/texture_container.h>
+#include <utils/environment_container.h>
+
+/////////////////// TEXTUREMANAGER class ///////////////////////
+class TextureManager
+{
+public:
+    // number of images decoded from disk, and number of requests satisfied by the cache
+    unsigned int decodes, hits;
+    // if true, the textures loaded by AcquireMany() and AcquireCube() are uploaded using a Pixel Buffer Object
+    bool usePBO;
+
+    // TextureManager is not copyable (the destructor deletes the OpenGL textures)
+    TextureManager(const TextureManager& copy) = delete;
+    TextureManager& operator=(const TextureManager&) = delete;
+
+    //////////////////////////////////////////
+    // constructor
+    TextureManager() : decodes(0), hits(0), usePBO(true) {}
+
+    //////////////////////////////////////////
+    // destructor
+    ~TextureManager()
+    {
+        this->Clear();
+    }
+
+    //////////////////////////////////////////
+    // we return the texture of the image in "path", loaded with the given parameters, and we add a reference to it
+    // the image is loaded from disk only if it is not already in the cache. It returns 0 if the image cannot be loaded
+    GLuint Acquire(const string& path, GLint wrap = GL_REPEAT, GLboolean mipmaps = GL_TRUE)
+    {
+        return this->AcquireMany(vector<string>(1, path), nullptr, wrap, mipmaps)[0];
+    }
+
+    //////////////////////////////////////////
+    // as Acquire(), but for a group of images: the images not in the cache are decoded in parallel by the workers of the JobSystem (serially, if jobs is nullptr)
+    vector<GLuint> AcquireMany(const vector<string>& paths, JobSystem* jobs, GLint wrap = GL_REPEAT, GLboolean mipmaps = GL_TRUE)
+    {
+        vector<GLuint> result(paths.size(), 0);
+        // images to decode, and for each request the index of its image (the same image can be requested more than once in the group)
+        vector<string> pending;
+        vector<int> pendingIndex(paths.size(), -1);
+        for (size_t i = 0; i < paths.size(); i++)
+        {
+            string key = TextureKey(paths[i], wrap, mipmaps);
+            map<string, GLuint>::iterator cached = this->keys.find(key);
+            if (cached != this->keys.end())
+            {
+                this->textures[cached->second].references++;
+                this->hits++;
+                result[i] = cached->second;
+                continue;
+            }
+            // the baked textures do not need decoding: they are loaded immediately
+            if (IsBakedTexture(paths[i]))
+            {
+                result[i] = this->LoadBaked(key, paths[i], wrap, mipmaps);
+                continue;
+            }
+            for (size_t p = 0; p < pending.size() && pendingIndex[i] < 0; p++)
+            {
+                if (pending[p] == paths[i])
+                {
+                    pendingIndex[i] = (int)p;
+                    this->hits++;
+                }
+            }
+            if (pendingIndex[i] < 0)
+            {
+                pendingIndex[i] = (int)pending.size();
+                pending.push_back(paths[i]);
+            }
+        }
+
+        // we decode the images (we keep the original number of channels of each image)
+        vector<DecodedImage> images(pending.size());
+        this->DecodeAll(pending, images, 0, jobs);
+
+        // we create the textures
+        vector<const void*> pixels = this->BeginUpload(images, jobs);
+        vector<GLuint> created(pending.size(), 0);
+        for (size_t p = 0; p < pending.size(); p++)
+        {
+            if (images[p].pixels == nullptr)
+                continue;
+            created[p] = this->CreateTexture2D(TextureKey(pending[p], wrap, mipmaps), images[p], pixels[p], wrap, mipmaps);
+        }
+        this->EndUpload(images);
+
+        // the first request of each image gets the reference created with the texture, the following requests add a reference
+        vector<bool> used(pending.size(), false);
+        for (size_t i = 0; i < paths.size(); i++)
+        {
+            if (pendingIndex[i] < 0)
+                continue;
+            result[i] = created[pendingIndex[i]];
+            if (result[i] != 0 && used[pendingIndex[i]])
+                this->textures[result[i]].references++;
+            used[pendingIndex[i]] = true;
+        }
+        return result;
+    }
+
+    //////////////////////////////////////////
+    // we return the cube map with the 6 images in "folder" (named posx, negx, posy, negy, posz, negz or right, left, top, bottom, front, back), and we add a reference to it
+    // the 6 images are decoded in parallel by the workers of the JobSystem (serially, if jobs is nullptr).
+    // If "folder" is a ".renv" file, the packed environment is loaded instead (jobs is not used)
+    GLuint AcquireCube(const string& folder, JobSystem* jobs)
+    {
+        string key = folder + "|cube";
+        map<string, GLuint>::iterator cached = this->keys.find(key);
+        if (cached != this->keys.end())
+        {
+            this->textures[cached->second].references++;
+            this->hits++;
+            return cached->second;
+        }
+        if (folder.size() > 5 && folder.compare(folder.size() - 5, 5, ".renv") == 0)
+            return this->LoadEnvironment(key, folder);
+
+        vector<string> paths = CubeFacePaths(folder);
+        // the faces are converted to RGB
+        vector<DecodedImage> images(6);
+        this->DecodeAll(paths, images, 3, jobs);
+
+        GLuint textureImage;
+        glGenTextures(1, &textureImage);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, textureImage);
+        vector<const void*> pixels = this->BeginUpload(images, jobs);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        size_t bytes = 0;
+        for (int f = 0; f < 6; f++)
+        {
+            // we set the image as one of the faces of the cube map
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + f, 0, GL_RGB, images[f].width, images[f].height, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels[f]);
+            bytes += (size_t)images[f].width * images[f].height * 4;
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        this->EndUpload(images);
+
+        // we set the filtering for minification and magnification
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        // we set how to consider the texture coordinates outside [0,1] range
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+        this->AddEntry(key, textureImage, bytes);
+        return textureImage;
+    }
+
+    //////////////////////////////////////////
+    // we add a reference to a texture already loaded
+    void AddReference(GLuint texture)
+    {
+        map<GLuint, TextureEntry>::iterator it = this->textures.find(texture);
+        if (it != this->textures.end())
+            it->second.references++;
+    }
+
+    //////////////////////////////////////////
+    // we remove a reference to a texture: when the last reference is released, the texture is deleted
+    void Release(GLuint texture)
+    {
+        map<GLuint, TextureEntry>::iterator it = this->textures.find(texture);
+        if (it == this->textures.end())
+            return;
+        if (--it->second.references > 0)
+            return;
+        this->memory -= it->second.bytes;
+        this->keys.erase(it->second.key);
+        glDeleteTextures(1, &texture);
+        this->textures.erase(it);
+    }
+
+    //////////////////////////////////////////
+    // we delete all the textures, independently from their references
+    void Clear()
+    {
+        for (map<GLuint, TextureEntry>::iterator it = this->textures.begin(); it != this->textures.end(); ++it)
+        {
+            GLuint texture = it->first;
+            glDeleteTextures(1, &texture);
+        }
+        this->textures.clear();
+        this->keys.clear();
+        this->memory = 0;
+    }
+
+    // number of textures currently loaded
+    size_t NumTextures() const { return this->textures.size(); }
+    // estimated GPU memory of the textures currently loaded (in bytes)
+    size_t MemorySize() const { return this->memory; }
+
+    //////////////////////////////////////////
+    // we print on console the statistics of the manager
+    void PrintStats() const
+    {
+        std::cout << "Textures: " << this->textures.size() << " - decoded images: " << this->decodes << " - cache hits: " << this->hits
+                  << " - GPU memory: " << (this->memory / 1024) << " KB" << std::endl;
+    }
+
+private:
+    // an image decoded in memory
+    struct DecodedImage {
+        unsigned char* pixels;
+        int width, height, channels;
+        DecodedImage() : pixels(nullptr), width(0), height(0), channels(0) {}
+    };
+
+    // Pixel Buffer Object used for the current upload (0 = the pixels are read directly from the decoded images)
+    GLuint uploadPBO = 0;
+
+    // key of a 2D texture in the cache
+    static string TextureKey(const string& path, GLint wrap, GLboolean mipmaps)
+    {
+        return path + "|" + to_string(wrap) + "|" + to_string((int)mipmaps);
+    }
+
+    // the baked textures are identified by the extension of the file
+    static bool IsBakedTexture(const string& path)
+    {
+        return (path.size() > 5 && path.compare(path.size() - 5, 5, ".rtex") == 0);
+    }
+
+    //////////////////////////////////////////
+    // we load a baked texture: the file is memory mapped, and the levels are uploaded directly from the mapped memory
+    // if mipmaps is false, only the first level is uploaded
+    GLuint LoadBaked(const string& key, const string& path, GLint wrap, GLboolean mipmaps)
+    {
+        MappedFile file(path);
+        const TextureFileHeader* header = ValidateTextureFile(file);
+        if (header == nullptr)
+        {
+            std::cout << "Failed to load baked texture: " << path << std::endl;
+            return 0;
+        }
+        const TextureFileLevel* levels = (const TextureFileLevel*)(file.Data() + sizeof(TextureFileHeader));
+        GLenum internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        if (header->format == TEXTURE_FORMAT_BC3)
+            internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        else if (header->format == TEXTURE_FORMAT_RGTC1)
+            internalFormat = GL_COMPRESSED_RED_RGTC1;
+
+        GLuint textureImage;
+        glGenTextures(1, &textureImage);
+        glBindTexture(GL_TEXTURE_2D, textureImage);
+        GLuint numLevels = (mipmaps ? header->numLevels : 1);
+        size_t bytes = 0;
+        for (GLuint l = 0; l < numLevels; l++)
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, l, internalFormat, levels[l].width, levels[l].height, 0, levels[l].size, file.Data() + levels[l].offset);
+            bytes += levels[l].size;
+        }
+        // we tell OpenGL which levels are available (the texture is complete even if the chain is incomplete)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, numLevels - 1);
+        // single channel textures are replicated on the RGB channels, as in CreateTexture2D()
+        if (header->format == TEXTURE_FORMAT_RGTC1)
+        {
+            GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+            glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        this->AddEntry(key, textureImage, bytes);
+        return textureImage;
+    }
+
+    //////////////////////////////////////////
+    // we load a packed environment: the file is memory mapped, and the levels (with the 6 faces one after the other) are uploaded directly from the mapped memory
+    GLuint LoadEnvironment(const string& key, const string& path)
+    {
+        MappedFile file(path);
+        const EnvironmentFileHeader* header = ValidateEnvironmentFile(file);
+        if (header == nullptr)
+        {
+            std::cout << "Failed to load packed environment: " << path << std::endl;
+            return 0;
+        }
+        const EnvironmentFileLevel* levels = (const EnvironmentFileLevel*)(file.Data() + sizeof(EnvironmentFileHeader));
+        bool half = (header->format == ENVIRONMENT_FORMAT_RGB16F);
+        GLenum internalFormat = (half ? GL_RGB16F : GL_RGB8);
+        GLenum type = (half ? GL_HALF_FLOAT : GL_UNSIGNED_BYTE);
+
+        GLuint textureImage;
+        glGenTextures(1, &textureImage);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, textureImage);
+        // the rows of the RGB8 faces are not aligned to 4 bytes
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        size_t bytes = 0;
+        if (GLAD_GL_VERSION_4_5)
+        {
+            // with immutable storage, glTextureSubImage3D considers the cube map as 6 layers: a single call uploads the 6 faces of a level
+            glTexStorage2D(GL_TEXTURE_CUBE_MAP, header->numLevels, internalFormat, header->faceSize, header->faceSize);
+            for (GLuint l = 0; l < header->numLevels; l++)
+                glTextureSubImage3D(textureImage, l, 0, 0, 0, levels[l].faceSize, levels[l].faceSize, 6, GL_RGB, type, file.Data() + levels[l].offset);
+        }
+        else
+        {
+            for (GLuint l = 0; l < header->numLevels; l++)
+            {
+                GLuint faceBytes = levels[l].size / 6;
+                for (int f = 0; f < 6; f++)
+                    glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + f, l, internalFormat, levels[l].faceSize, levels[l].faceSize, 0, GL_RGB, type, file.Data() + levels[l].offset + f * faceBytes);
+            }
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        // the GPU stores the RGB texels with 4 components
+        for (GLuint l = 0; l < header->numLevels; l++)
+            bytes += (size_t)levels[l].size / 3 * 4;
+
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, header->numLevels - 1);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+        this->AddEntry(key, textureImage, bytes);
+        return textureImage;
+    }
+
+    //////////////////////////////////////////
+    // we decode the images in paths (desiredChannels = 0 -> original number of channels). This is the only part of the loading executed by the workers
+    void DecodeAll(const vector<string>& paths, vector<DecodedImage>& images, int desiredChannels, JobSystem* jobs)
+    {
+        auto decode = [&paths, &images, desiredChannels](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                DecodedImage& image = images[i];
+                image.pixels = stbi_load(paths[i].c_str(), &image.width, &image.height, &image.channels, desiredChannels);
+                if (desiredChannels != 0)
+                    image.channels = desiredChannels;
+            }
+        };
+        // a job for each image
+        if (jobs != nullptr)
+            jobs->ParallelFor(paths.size(), 1, decode);
+        else
+            decode(0, paths.size());
+
+        for (size_t i = 0; i < paths.size(); i++)
+        {
+            if (images[i].pixels == nullptr)
+                std::cout << "Failed to load texture: " << paths[i] << std::endl;
+            else
+                this->decodes++;
+        }
+    }
+
+    //////////////////////////////////////////
+    // we prepare the upload of the decoded images, and we return the "pixels" parameter to pass to glTexImage2D for each image.
+    // Without PBO, it is the pointer to the decoded image. With PBO, the images are copied in parallel in a single buffer (which remains bound to
+    // GL_PIXEL_UNPACK_BUFFER until EndUpload()), and the parameter is the offset of the image in the buffer
+    vector<const void*> BeginUpload(const vector<DecodedImage>& images, JobSystem* jobs)
+    {
+        vector<const void*> pixels(images.size(), nullptr);
+        vector<size_t> offsets(images.size(), 0);
+        size_t total = 0;
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            offsets[i] = total;
+            total += (size_t)images[i].width * images[i].height * images[i].channels;
+        }
+        // for a single image, the PBO would add only an additional copy
+        if (!this->usePBO || images.size() < 2 || total == 0)
+        {
+            for (size_t i = 0; i < images.size(); i++)
+                pixels[i] = images[i].pixels;
+            return pixels;
+        }
+
+        glGenBuffers(1, &this->uploadPBO);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, this->uploadPBO);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, total, NULL, GL_STREAM_DRAW);
+        unsigned char* mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, total, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        // the copy in the mapped buffer does not call OpenGL functions: it can be executed by the workers
+        auto copy = [&images, &offsets, mapped](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                if (images[i].pixels != nullptr)
+                    memcpy(mapped + offsets[i], images[i].pixels, (size_t)images[i].width * images[i].height * images[i].channels);
+            }
+        };
+        if (jobs != nullptr)
+            jobs->ParallelFor(images.size(), 1, copy);
+        else
+            copy(0, images.size());
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        for (size_t i = 0; i < images.size(); i++)
+            pixels[i] = (const void*)offsets[i];
+        return pixels;
+    }
+
+    //////////////////////////////////////////
+    // end of the upload: we release the PBO (the driver keeps the data until the transfer is completed), and we free the decoded images
+    void EndUpload(vector<DecodedImage>& images)
+    {
+        if (this->uploadPBO != 0)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            glDeleteBuffers(1, &this->uploadPBO);
+            this->uploadPBO = 0;
+        }
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            stbi_image_free(images[i].pixels);
+            images[i].pixels = nullptr;
+        }
+    }
+
+    //////////////////////////////////////////
+    // we create a 2D texture from a decoded image ("pixels" is the pointer or the PBO offset returned by BeginUpload)
+    GLuint CreateTexture2D(const string& key, const DecodedImage& image, const void* pixels, GLint wrap, GLboolean mipmaps)
+    {
+        GLuint textureImage;
+        glGenTextures(1, &textureImage);
+        glBindTexture(GL_TEXTURE_2D, textureImage);
+        // 1 channel = R, 2 channels = RG, 3 channels = RGB ; 4 channels = RGBA
+        const GLenum formats[4] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+        GLenum format = formats[image.channels - 1];
+        // the rows of the image are tightly packed: with 1-3 channels, they can be not aligned to 4 bytes (the default alignment of OpenGL)
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, pixels);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        // for grayscale images (with or without alpha), the value is replicated on the RGB channels, so that the shaders can always use the .rgb components
+        if (image.channels <= 2)
+        {
+            GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, (image.channels == 2 ? GL_GREEN : GL_ONE) };
+            glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+        }
+        // we set how to consider UVs outside [0,1] range
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+        // we set the filtering for minification and magnification
+        if (mipmaps)
+        {
+            glGenerateMipmap(GL_TEXTURE_2D);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        }
+        else
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        // we set the binding to 0 once we have finished
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        // estimated memory: the drivers usually store RGB textures as RGBA, and the mipmaps add 1/3 of the memory of the base level
+        size_t texelSize = (image.channels == 3 ? 4 : image.channels);
+        size_t bytes = (size_t)image.width * image.height * texelSize;
+        if (mipmaps)
+            bytes += bytes / 3;
+        this->AddEntry(key, textureImage, bytes);
+        return textureImage;
+    }
+
+    //////////////////////////////////////////
+    // we add a new texture to the cache, with a single reference
+    void AddEntry(const string& key, GLuint texture, size_t bytes)
+    {
+        TextureEntry entry;
+        entry.key = key;
+        entry.references = 1;
+        entry.bytes = bytes;
+        this->keys[key] = texture;
+        this->textures[texture] = entry;
+        this->memory += bytes;
+    }
+
+    // data of a loaded texture
+    struct TextureEntry {
+        string key;
+        unsigned int references;
+        size_t bytes;
+    };
+
+    // cache key (path + parameters) -> texture
+    map<string, GLuint> keys;
+    // texture -> data
+    map<GLuint, TextureEntry> textures;
+    // total estimated memory
+    size_t memory = 0;
+};
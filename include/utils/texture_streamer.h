@@ -0,0 +1,426 @@
+/*
+TextureStreamer class
+- progressive streaming of the mipmap levels of large textures: the application receives the texture immediately, and the levels are uploaded in the following frames,
+  from the smallest to the largest, without blocking the rendering
+- the storage for the whole mipmap chain is allocated when the texture is requested (with glTexStorage2D, if available), but only the levels already uploaded are used:
+  GL_TEXTURE_BASE_LEVEL is clamped to the finest uploaded level, and it is lowered each time a new level arrives
+- the sources of the levels are:
+    - the ".rtex" files created by the texture baker (include/utils/texture_container.h): the file is memory mapped, and the levels are already available
+    - the other images (PNG, JPEG, ...): the image is decoded, and the mipmap chain is generated, by a job of a JobSystem, in background. Only the dimensions of the image
+      are read when the texture is requested (with stbi_info), and a gray 1x1 level is used until the decoding is completed
+- priority: the application sets the dimension on screen (in pixels) of each texture. The finest level needed is the one with a texel for each pixel: the levels finer than it
+  are not uploaded, and the textures with the largest difference between the needed level and the uploaded level are served first. The uploads of each frame are limited by a budget of bytes
+- memory cap: if the memory of the textures exceeds memoryBudget, the textures are re-allocated without the levels finer than the needed one, starting from the smallest ones on screen.
+  When a texture needs again a finer level (e.g., the camera moves closer), it is re-allocated with the whole chain, and the levels are streamed again.
+  The levels uploaded again after a re-allocation are counted in the upload budget of the frame too
+
+N.B. 1) since a texture can be re-allocated, the application must read the OpenGL texture (the "texture" member) at each frame, and it must not save it
+N.B. 2) the decoded levels of the images which are not baked are kept in memory, to be able to upload them again after an eviction
+N.B. 3) glTexStorage2D is part of OpenGL 4.2: with a 4.1 context, the levels are allocated with glTexImage2D (the result is the same, but the storage is mutable)
+
+see:
+https://www.khronos.org/opengl/wiki/Texture_Storage
+https://developer.nvidia.com/gpugems/gpugems2/part-iii-high-quality-rendering/chapter-27-texture-streaming (general concepts)
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#pragma once
+
+using namespace std;
+
+// Std. Includes
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "stb_image/stb_image.h"
+
+#include <utils/job_system.h>
+#include <utils/texture_container.h>
+#include <utils/texture_compression.h>
+
+/////////////////// STREAMEDTEXTURE structure ///////////////////////
+// a texture managed by the TextureStreamer. The levels are identified by their index in the complete mipmap chain (0 = full resolution)
+struct StreamedTexture {
+    // OpenGL texture: it contains the levels [allocatedLevel, numLevels-1] of the chain (level allocatedLevel of the chain = level 0 of the texture)
+    GLuint texture;
+    string path;
+    GLuint width, height, numLevels;
+    int channels;
+    bool compressed;
+    GLenum internalFormat;
+
+    // finest level allocated, finest level uploaded, and finest level needed on screen
+    GLint allocatedLevel, uploadedLevel, neededLevel;
+    // dimension on screen set by the application (in pixels)
+    GLfloat screenSize;
+
+    // source of the levels: a mapped file (baked textures), or the levels decoded in background (the decoding is completed when "decoding" is 0)
+    MappedFile* file;
+    vector<vector<unsigned char> > levels;
+    JobCounter decoding;
+    // true if the uploaded level is the gray placeholder used during the decoding
+    bool placeholder;
+
+    StreamedTexture() : texture(0), width(0), height(0), numLevels(0), channels(0), compressed(false), internalFormat(0), allocatedLevel(0), uploadedLevel(0),
+                        neededLevel(0), screenSize(0.0f), file(nullptr), decoding(0), placeholder(false) {}
+};
+
+/////////////////// TEXTURESTREAMER class ///////////////////////
+class TextureStreamer
+{
+public:
+    // maximum number of bytes uploaded at each frame
+    size_t uploadBudget;
+    // maximum memory of the textures (in bytes): beyond it, the textures smallest on screen lose the levels finer than the needed one
+    size_t memoryBudget;
+
+    // statistics: bytes uploaded in the last Update(), and number of re-allocations (evictions and restorations of the top levels)
+    size_t uploadedBytes;
+    unsigned int reallocations;
+
+    // TextureStreamer is not copyable (the destructor deletes the OpenGL textures)
+    TextureStreamer(const TextureStreamer& copy) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    //////////////////////////////////////////
+    // constructor: the images are decoded by the workers of the JobSystem
+    TextureStreamer(JobSystem& jobs, size_t uploadBudget = 1024 * 1024, size_t memoryBudget = 64 * 1024 * 1024)
+        : uploadBudget(uploadBudget), memoryBudget(memoryBudget), uploadedBytes(0), reallocations(0), jobs(jobs) {}
+
+    //////////////////////////////////////////
+    // destructor
+    ~TextureStreamer()
+    {
+        this->Clear();
+    }
+
+    //////////////////////////////////////////
+    // we create a streamed texture: the function returns immediately, and the levels are uploaded by the following calls to Update()
+    // it returns nullptr if the file cannot be read
+    StreamedTexture* Request(const string& path)
+    {
+        StreamedTexture* t = new StreamedTexture();
+        t->path = path;
+
+        if (path.size() > 5 && path.compare(path.size() - 5, 5, ".rtex") == 0)
+        {
+            // baked texture: we map the file, and all the levels are immediately available
+            t->file = new MappedFile(path);
+            const TextureFileHeader* header = ValidateTextureFile(*t->file);
+            if (header == nullptr)
+            {
+                std::cout << "Failed to load baked texture: " << path << std::endl;
+                delete t->file;
+                delete t;
+                return nullptr;
+            }
+            t->width = header->width;
+            t->height = header->height;
+            t->numLevels = header->numLevels;
+            t->channels = header->channels;
+            t->compressed = true;
+            t->internalFormat = (header->format == TEXTURE_FORMAT_BC3 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT :
+                                (header->format == TEXTURE_FORMAT_RGTC1 ? GL_COMPRESSED_RED_RGTC1 : GL_COMPRESSED_RGB_S3TC_DXT1_EXT));
+        }
+        else
+        {
+            // we read only the dimensions of the image, and we decode it in background
+            int w, h, channels;
+            if (!stbi_info(path.c_str(), &w, &h, &channels))
+            {
+                std::cout << "Failed to load texture: " << path << std::endl;
+                delete t;
+                return nullptr;
+            }
+            // we load the images with 3 or 4 channels
+            t->channels = (channels == 4 || channels == 2 ? 4 : 3);
+            t->width = w;
+            t->height = h;
+            t->numLevels = 1 + (GLuint)floorf(log2f((float)max(w, h)));
+            t->compressed = false;
+            t->internalFormat = (t->channels == 4 ? GL_RGBA8 : GL_RGB8);
+            this->jobs.Submit(t->decoding, [t]() { DecodeLevels(t); });
+        }
+
+        // the texture starts with the whole chain, and with only the smallest levels (up to 64x64 texels) already uploaded
+        t->neededLevel = 0;
+        t->uploadedLevel = max((GLint)t->numLevels - 7, 0);
+        this->Allocate(t, 0);
+        this->textures.push_back(t);
+        return t;
+    }
+
+    //////////////////////////////////////////
+    // we set the dimension on screen (in pixels) of a texture. The needed level is the one with a texel for each pixel
+    void SetScreenSize(StreamedTexture* t, GLfloat pixels)
+    {
+        t->screenSize = pixels;
+        GLfloat texels = (GLfloat)max(t->width, t->height);
+        GLint level = (pixels > 0.0f ? (GLint)floorf(log2f(max(texels / pixels, 1.0f))) : (GLint)t->numLevels - 1);
+        t->neededLevel = min(level, (GLint)t->numLevels - 1);
+    }
+
+    //////////////////////////////////////////
+    // dimension on screen (in pixels) of an object of dimension worldSize at distance "distance" from the camera
+    // projectionScale is the element [1][1] of the projection matrix, and screenHeight the height of the window
+    static GLfloat ProjectedSize(GLfloat worldSize, GLfloat distance, GLfloat projectionScale, GLfloat screenHeight)
+    {
+        return worldSize * projectionScale / max(distance, 0.01f) * 0.5f * screenHeight;
+    }
+
+    //////////////////////////////////////////
+    // we upload new levels (within the budget of the frame), and we apply the memory cap. It must be called once per frame
+    void Update()
+    {
+        this->uploadedBytes = 0;
+
+        // memory cap: the textures smallest on screen lose first the levels they do not need
+        vector<StreamedTexture*> bySize(this->textures);
+        std::sort(bySize.begin(), bySize.end(), [](const StreamedTexture* a, const StreamedTexture* b) { return a->screenSize < b->screenSize; });
+        for (size_t i = 0; i < bySize.size() && this->MemorySize() > this->memoryBudget; i++)
+        {
+            StreamedTexture* t = bySize[i];
+            if (t->neededLevel > t->allocatedLevel)
+                this->Allocate(t, t->neededLevel);
+        }
+        // the textures which need again finer levels are re-allocated, if the memory allows it (from the largest on screen)
+        for (size_t i = bySize.size(); i-- > 0; )
+        {
+            StreamedTexture* t = bySize[i];
+            if (t->neededLevel < t->allocatedLevel && this->MemorySize() + this->ChainSize(t, t->neededLevel) - this->ChainSize(t, t->allocatedLevel) <= this->memoryBudget)
+                this->Allocate(t, t->neededLevel);
+        }
+
+        // the textures with the largest number of missing levels are served first
+        vector<StreamedTexture*> byPriority(this->textures);
+        std::sort(byPriority.begin(), byPriority.end(), [](const StreamedTexture* a, const StreamedTexture* b)
+        {
+            GLint missingA = a->uploadedLevel - max(a->neededLevel, a->allocatedLevel);
+            GLint missingB = b->uploadedLevel - max(b->neededLevel, b->allocatedLevel);
+            return (missingA != missingB ? missingA > missingB : a->screenSize > b->screenSize);
+        });
+        for (size_t i = 0; i < byPriority.size() && this->uploadedBytes < this->uploadBudget; i++)
+        {
+            StreamedTexture* t = byPriority[i];
+            // the decoding of the image is not completed (or it has failed)
+            if (!t->compressed && (t->decoding.load() > 0 || t->levels.empty()))
+                continue;
+            GLint previous = t->uploadedLevel;
+            // when the decoding is completed, the placeholder is replaced by the real levels, starting again from the smallest one
+            if (t->placeholder)
+            {
+                t->placeholder = false;
+                t->uploadedLevel = (GLint)t->numLevels - 1;
+                this->uploadedBytes += this->UploadLevel(t, t->uploadedLevel);
+            }
+            // we upload one level at a time, until the needed level (and within the budget)
+            GLint target = max(t->neededLevel, t->allocatedLevel);
+            while (t->uploadedLevel > target && this->uploadedBytes < this->uploadBudget)
+            {
+                t->uploadedLevel--;
+                this->uploadedBytes += this->UploadLevel(t, t->uploadedLevel);
+            }
+            if (t->uploadedLevel != previous)
+                this->SetBaseLevel(t);
+        }
+    }
+
+    //////////////////////////////////////////
+    // we delete all the textures
+    void Clear()
+    {
+        for (size_t i = 0; i < this->textures.size(); i++)
+        {
+            StreamedTexture* t = this->textures[i];
+            // we wait for the decoding jobs still running
+            this->jobs.Wait(t->decoding);
+            glDeleteTextures(1, &t->texture);
+            delete t->file;
+            delete t;
+        }
+        this->textures.clear();
+    }
+
+    //////////////////////////////////////////
+    // memory of the allocated levels of all the textures (in bytes)
+    size_t MemorySize() const
+    {
+        size_t total = 0;
+        for (size_t i = 0; i < this->textures.size(); i++)
+            total += this->ChainSize(this->textures[i], this->textures[i]->allocatedLevel);
+        return total;
+    }
+
+    //////////////////////////////////////////
+    // number of levels still missing (uploaded level - needed level) for all the textures
+    GLuint MissingLevels() const
+    {
+        GLuint missing = 0;
+        for (size_t i = 0; i < this->textures.size(); i++)
+        {
+            const StreamedTexture* t = this->textures[i];
+            missing += (GLuint)max(0, t->uploadedLevel - max(t->neededLevel, t->allocatedLevel)) + (t->placeholder ? 1 : 0);
+        }
+        return missing;
+    }
+
+private:
+    JobSystem& jobs;
+    vector<StreamedTexture*> textures;
+
+    //////////////////////////////////////////
+    // dimensions of a level of the chain
+    static GLuint LevelWidth(const StreamedTexture* t, GLint level) { return max(1u, t->width >> level); }
+    static GLuint LevelHeight(const StreamedTexture* t, GLint level) { return max(1u, t->height >> level); }
+
+    //////////////////////////////////////////
+    // memory of a level (RGB textures are usually stored as RGBA on the GPU)
+    static size_t LevelSize(const StreamedTexture* t, GLint level)
+    {
+        if (t->compressed)
+            return TextureLevelSize(t->internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || t->internalFormat == GL_COMPRESSED_RED_RGTC1 ? TEXTURE_FORMAT_BC1 : TEXTURE_FORMAT_BC3,
+                                    LevelWidth(t, level), LevelHeight(t, level));
+        return (size_t)LevelWidth(t, level) * LevelHeight(t, level) * 4;
+    }
+
+    // memory of the levels from "first" to the end of the chain
+    size_t ChainSize(const StreamedTexture* t, GLint first) const
+    {
+        size_t total = 0;
+        for (GLint l = first; l < (GLint)t->numLevels; l++)
+            total += LevelSize(t, l);
+        return total;
+    }
+
+    //////////////////////////////////////////
+    // decoding of an image and generation of its mipmap chain (executed by a worker: no OpenGL calls)
+    static void DecodeLevels(StreamedTexture* t)
+    {
+        int w, h, channels;
+        unsigned char* pixels = stbi_load(t->path.c_str(), &w, &h, &channels, t->channels);
+        if (pixels == nullptr)
+        {
+            // the texture remains with the placeholder
+            std::cout << "Failed to load texture: " << t->path << std::endl;
+            return;
+        }
+        t->levels.resize(t->numLevels);
+        t->levels[0].assign(pixels, pixels + (size_t)w * h * t->channels);
+        stbi_image_free(pixels);
+        for (GLuint l = 1; l < t->numLevels; l++)
+        {
+            int nw, nh;
+            DownsampleImage(t->levels[l - 1], w, h, t->channels, true, t->levels[l], nw, nh);
+            w = nw;
+            h = nh;
+        }
+    }
+
+    //////////////////////////////////////////
+    // we (re)create the OpenGL texture with the levels [first, numLevels-1] of the chain, and we upload again the levels available (or the placeholder)
+    void Allocate(StreamedTexture* t, GLint first)
+    {
+        if (t->texture != 0)
+        {
+            glDeleteTextures(1, &t->texture);
+            this->reallocations++;
+        }
+        t->allocatedLevel = first;
+        GLsizei numLevels = (GLsizei)t->numLevels - first;
+
+        glGenTextures(1, &t->texture);
+        glBindTexture(GL_TEXTURE_2D, t->texture);
+        if (GLAD_GL_VERSION_4_2)
+            glTexStorage2D(GL_TEXTURE_2D, numLevels, t->internalFormat, LevelWidth(t, first), LevelHeight(t, first));
+        else
+        {
+            for (GLint l = 0; l < numLevels; l++)
+            {
+                if (t->compressed)
+                    glCompressedTexImage2D(GL_TEXTURE_2D, l, t->internalFormat, LevelWidth(t, first + l), LevelHeight(t, first + l), 0, (GLsizei)LevelSize(t, first + l), NULL);
+                else
+                    glTexImage2D(GL_TEXTURE_2D, l, t->internalFormat, LevelWidth(t, first + l), LevelHeight(t, first + l), 0, (t->channels == 4 ? GL_RGBA : GL_RGB), GL_UNSIGNED_BYTE, NULL);
+            }
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, numLevels - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        if (t->internalFormat == GL_COMPRESSED_RED_RGTC1)
+        {
+            GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+            glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+        }
+
+        // we upload again the levels already available, starting from the smallest ones, within the budget of the frame (the smallest level is always uploaded,
+        // so the texture is complete): the other levels are uploaded by the following calls of Update(). If the source is not ready, we upload a gray placeholder in the last level
+        GLint last = (GLint)t->numLevels - 1;
+        if (t->compressed || (t->decoding.load() == 0 && !t->levels.empty()))
+        {
+            t->placeholder = false;
+            GLint available = max(t->uploadedLevel, first);
+            t->uploadedLevel = last;
+            this->uploadedBytes += this->UploadLevel(t, last);
+            while (t->uploadedLevel > available && this->uploadedBytes < this->uploadBudget)
+            {
+                t->uploadedLevel--;
+                this->uploadedBytes += this->UploadLevel(t, t->uploadedLevel);
+            }
+        }
+        else
+        {
+            const unsigned char gray[4] = { 128, 128, 128, 255 };
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexSubImage2D(GL_TEXTURE_2D, last - first, 0, 0, 1, 1, (t->channels == 4 ? GL_RGBA : GL_RGB), GL_UNSIGNED_BYTE, gray);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            t->placeholder = true;
+            t->uploadedLevel = last;
+        }
+        this->SetBaseLevel(t);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    //////////////////////////////////////////
+    // we upload a level of the chain in the texture, and we return its size in bytes
+    size_t UploadLevel(StreamedTexture* t, GLint level)
+    {
+        GLint textureLevel = level - t->allocatedLevel;
+        if (textureLevel < 0)
+            return 0;
+        glBindTexture(GL_TEXTURE_2D, t->texture);
+        GLuint w = LevelWidth(t, level), h = LevelHeight(t, level);
+        size_t bytes = 0;
+        if (t->compressed)
+        {
+            const TextureFileLevel* levels = (const TextureFileLevel*)(t->file->Data() + sizeof(TextureFileHeader));
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, textureLevel, 0, 0, w, h, t->internalFormat, levels[level].size, t->file->Data() + levels[level].offset);
+            bytes = levels[level].size;
+        }
+        else if (!t->levels.empty())
+        {
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexSubImage2D(GL_TEXTURE_2D, textureLevel, 0, 0, w, h, (t->channels == 4 ? GL_RGBA : GL_RGB), GL_UNSIGNED_BYTE, &t->levels[level][0]);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            bytes = t->levels[level].size();
+        }
+        return bytes;
+    }
+
+    //////////////////////////////////////////
+    // we clamp the base level of the texture to the finest uploaded level
+    void SetBaseLevel(StreamedTexture* t)
+    {
+        glBindTexture(GL_TEXTURE_2D, t->texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, t->uploadedLevel - t->allocatedLevel);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+};
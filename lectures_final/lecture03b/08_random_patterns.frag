@@ -10,6 +10,13 @@ N.B. 3) we use simplex noise implementation from
         https://github.com/stegu/webgl-noise//wiki
         to generate the fragments colors
 
+N.B. 4) if useNoiseTextures is true, the noise is not calculated in the shader, but it is read from textures baked on the CPU by the application
+        (with the C++ port of the same noise, see include/utils/noise.h), for the same frequency and harmonics:
+        - noiseTextures (2D array): layer 0 = (noise, turbulence, turbulence with absolute values), layer 1 = the 3 noise values of NoiseColor
+        - animatedNoiseTexture (3D): the 3 noise values of NoiseColorAnimated, with the time as third coordinate. The texture covers a period of animationPeriod seconds,
+          and it repeats (the baked animation is made periodic, so it is similar, but not equal, to the calculated one)
+        The values are baked with power = 1: we multiply them for power (all the patterns are proportional to power, before aastep)
+
 
 author: Davide Gadia
 
@@ -37,6 +44,13 @@ uniform float timer;
 // number of octaves to create and sum
 uniform float harmonics;
 
+// if true, we read the noise from the baked textures, instead of calculating it
+uniform bool useNoiseTextures;
+uniform sampler2DArray noiseTextures;
+uniform sampler3D animatedNoiseTexture;
+// duration (in seconds) of the animation in animatedNoiseTexture
+uniform float animationPeriod;
+
 /////////////////////////////////////////////////////////////////////
 // we must copy and paste the code inside our shaders
 // it is not possible to include or to link an external file
@@ -167,7 +181,11 @@ subroutine(ran_patterns)
 vec4 Noise() // this name is the one which is detected by the SetupShaders() function in the main application, and the one used to swap subroutines
 {
   // we calculate a single noise octave, characterized by power and frequency, set by the user
-  float color = power*snoise(vec3(interp_UV*frequency, 0.0));
+  float color;
+  if (useNoiseTextures)
+    color = power*texture(noiseTextures, vec3(interp_UV, 0.0)).r;
+  else
+    color = power*snoise(vec3(interp_UV*frequency, 0.0));
 
   //in this case, we are creating a grayscale image
   return vec4(vec3(color),1.0);
@@ -181,6 +199,9 @@ vec4 NoiseColor()
   // we calculate 3 independent octaves, with the same power and frequency
   // but we change the third component of the vec3
   // we obtain the same pattern, but with 3 different shades of gray, in order to have a color when used as R,G and B channels
+  if (useNoiseTextures)
+    return vec4(power*texture(noiseTextures, vec3(interp_UV, 1.0)).rgb, 1.0);
+
   float r = power*snoise(vec3(interp_UV*frequency, 0.4));
   float g = power*snoise(vec3(interp_UV*frequency, -0.7));
   float b = power*snoise(vec3(interp_UV*frequency, 0.8));
@@ -197,6 +218,10 @@ vec4 NoiseColorAnimated()
   // but we change the third component of the vec3
   // we obtain the same pattern, but with 3 different shades of gray, in order to have a color when used as R,G and B channels
   // we animated the final pattern multiplying for the timer uniform
+  // (with the baked texture, the time is the third texture coordinate, and the texture repeats along it)
+  if (useNoiseTextures)
+    return vec4(power*texture(animatedNoiseTexture, vec3(interp_UV, timer/animationPeriod)).rgb, 1.0);
+
   float r = power*snoise(vec3(interp_UV*frequency, 0.4*timer));
   float g = power*snoise(vec3(interp_UV*frequency, -0.7*timer));
   float b = power*snoise(vec3(interp_UV*frequency, 0.8*timer));
@@ -215,12 +240,15 @@ vec4 Turbulence()
   float f = frequency;
 
   float value = 0.0;
-  for (int i=0;i<harmonics;i++)
-  {
-      value += p*snoise(vec3(interp_UV*f, 0.0));
-      p*=0.5;
-      f*=2.0;
-  }
+  if (useNoiseTextures)
+    value = p*texture(noiseTextures, vec3(interp_UV, 0.0)).g;
+  else
+    for (int i=0;i<harmonics;i++)
+    {
+        value += p*snoise(vec3(interp_UV*f, 0.0));
+        p*=0.5;
+        f*=2.0;
+    }
   //in this case, we are creating a grayscale image
   return vec4(vec3(value),1.0);
 }
@@ -236,12 +264,15 @@ vec4 TurbulenceAbs()
   float f = frequency;
 
   float value = 0.0;
-  for (int i=0;i<harmonics;i++)
-  {
-      value += p*abs(snoise(vec3(interp_UV*f, 0.0)));
-      p*=0.5;
-      f*=2.0;
-  }
+  if (useNoiseTextures)
+    value = p*texture(noiseTextures, vec3(interp_UV, 0.0)).b;
+  else
+    for (int i=0;i<harmonics;i++)
+    {
+        value += p*abs(snoise(vec3(interp_UV*f, 0.0)));
+        p*=0.5;
+        f*=2.0;
+    }
   //in this case, we are creating a grayscale image
   return vec4(vec3(value),1.0);
 }
@@ -257,12 +288,15 @@ vec4 TurbulenceAAstep()
   float f = frequency;
 
   float value = 0.0;
-  for (int i=0;i<harmonics;i++)
-  {
-      value += p*snoise(vec3(interp_UV*f, 0.0));
-      p*=0.5;
-      f*=2.0;
-  }
+  if (useNoiseTextures)
+    value = p*texture(noiseTextures, vec3(interp_UV, 0.0)).g;
+  else
+    for (int i=0;i<harmonics;i++)
+    {
+        value += p*snoise(vec3(interp_UV*f, 0.0));
+        p*=0.5;
+        f*=2.0;
+    }
 
   // we apply aastep to the turbulence result to obtain a "cow skin" effect
   value = aastep(0.05,value);
@@ -280,12 +314,15 @@ vec4 TurbulenceDiscard()
   float f = frequency;
 
   float value = 0.0;
-  for (int i=0;i<harmonics;i++)
-  {
-      value += p*snoise(vec3(interp_UV*f, 0.0));
-      p*=0.5;
-      f*=2.0;
-  }
+  if (useNoiseTextures)
+    value = p*texture(noiseTextures, vec3(interp_UV, 0.0)).g;
+  else
+    for (int i=0;i<harmonics;i++)
+    {
+        value += p*snoise(vec3(interp_UV*f, 0.0));
+        p*=0.5;
+        f*=2.0;
+    }
 
   // we apply aastep to the turbulence result to obtain a "cow skin" effect
   value = aastep(0.05,value);
@@ -0,0 +1,28 @@
+/*
+38_procedural_bake.vert: Vertex shader to render a procedural pattern in a texture, in UV space (see include/utils/procedural_cache.h)
+
+N.B. 1) it must be used with the Fragment shader of the pattern, which receives in interp_UV the UV coordinates of the texel
+
+N.B. 2) there are no vertex attributes: the 4 vertices of the quad covering the texture (drawn as a triangle strip) are generated from gl_VertexID
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+
+*/
+
+#version 410 core
+
+// the output variable for UV coordinates
+out vec2 interp_UV;
+
+void main()
+{
+    // gl_VertexID = 0, 1, 2, 3 -> UV = (0,0), (1,0), (0,1), (1,1)
+    interp_UV = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+
+    // the quad covers the whole viewport (= the texture): the center of each texel is rasterized with the UV coordinates of the center of the texel
+    gl_Position = vec4(interp_UV * 2.0 - 1.0, 0.0, 1.0);
+}
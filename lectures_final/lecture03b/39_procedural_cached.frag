@@ -0,0 +1,36 @@
+/*
+39_procedural_cached.frag: Fragment shader for the objects with a procedural pattern saved in the cache (see include/utils/procedural_cache.h)
+
+N.B. 1)  "06_procedural_base.vert" must be used as vertex shader
+
+N.B. 2)  the pattern has been rendered in a texture, in UV space: we need a single texture fetch, instead of the calculation of the pattern
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+
+*/
+
+#version 410 core
+
+// output shader variable
+out vec4 colorFrag;
+
+// UV texture coordinates, interpolated in each fragment by the rasterization process
+in vec2 interp_UV;
+
+// texture with the pattern
+uniform sampler2D proceduralTexture;
+
+void main(void)
+{
+    vec4 color = texture(proceduralTexture, interp_UV);
+
+    // the fragments discarded by the pattern have been saved with alpha = 0
+    if (color.a < 0.5)
+        discard;
+
+    colorFrag = vec4(color.rgb, 1.0);
+}
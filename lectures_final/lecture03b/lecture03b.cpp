@@ -1,6 +1,13 @@
 /*
 Es03b: Procedural shaders 1 (random patterns)
 - procedural shaders for noise patterns, pressing keys from 1 to 7
+- at the beginning, the noise used by the patterns is also baked in textures on the CPU (see include/utils/noise.h): the texels are calculated in parallel
+  by the workers of a JobSystem, 4 texels at a time with SIMD instructions. Pressing the T key, the shaders read the noise from the textures instead of calculating it
+- pressing the C key, the objects are rendered with a procedural cache (see include/utils/procedural_cache.h): the pattern is rendered in a texture only when
+  the subroutine or the parameters change, and the objects need a single texture fetch. The animated pattern is saved as CACHE_ANIMATION_FRAMES frames for each
+  period of ANIMATION_PERIOD seconds (so the animation is stepped, and it restarts at each period)
+- pressing the B key (with the procedural cache deactivated), we start a benchmark: each subroutine is used for some frames with the calculated noise and then with the baked textures, and the GPU times
+  of the rendering of the objects are printed on console
 
 N.B. 1)
 In this example we use Shaders Subroutines to do shader swapping:
@@ -17,6 +24,12 @@ N.B. 2) no texturing in this version of the classes
 
 N.B. 3) to test different parameters of the shaders, it is convenient to use some GUI library, like e.g. Dear ImGui (https://github.com/ocornut/imgui)
 
+N.B. 4) the baked textures trade the ALU cost of the octaves of noise (up to 4 x harmonics evaluations for each fragment) with a memory cost (a texture fetch, and the bandwidth).
+The textures are valid only for the frequency and harmonics used in the baking (they must be baked again if the parameters change), and their resolution limits the
+highest octave which can be represented (with the mipmaps, the octaves too small for the screen are filtered, instead of producing aliasing).
+The animation of the NoiseColorAnimated subroutine is baked in a 3D texture, with the time as third coordinate: to repeat the texture, the baked animation is made periodic
+(blending the noise with itself translated of a period), so it is similar, but not equal, to the calculated one
+
 author: Davide Gadia
 
 Real-Time Graphics Programming - a.a. 2024/2025
@@ -43,6 +56,7 @@ positive Z axis points "outside" the screen
 
 // Std. Includes
 #include <string>
+#include <chrono>
 
 // Loader estensions OpenGL
 // http://glad.dav1d.de/
@@ -67,6 +81,11 @@ positive Z axis points "outside" the screen
 // classes developed during lab lectures to manage shaders and to load models
 #include <utils/shader.h>
 #include <utils/model.h>
+// job system for the parallel baking of the noise textures, and CPU implementation of the noise
+#include <utils/job_system.h>
+#include <utils/noise.h>
+// render-to-texture cache for the procedural patterns
+#include <utils/procedural_cache.h>
 
 // we load the GLM classes used in the application
 #include <glm/glm.hpp>
@@ -117,6 +136,33 @@ GLfloat planeColor[] = {0.0,0.5,0.0};
 // variables used to store uniform location inside shaders
 GLint planeColorLocation, frequencyLocation, powerLocation, harmonicsLocation, timerLocation;
 
+// parameters of the baked noise textures: size of the 2D textures, size and number of frames of the animated 3D texture, and duration (in seconds) of the animation
+#define NOISE_TEXTURE_SIZE 512
+#define ANIMATED_NOISE_SIZE 128
+#define ANIMATED_NOISE_FRAMES 64
+#define ANIMATION_PERIOD 8.0f
+// boolean to read the noise from the baked textures, instead of calculating it in the shader
+GLboolean useNoiseTextures = GL_FALSE;
+
+// we bake the noise textures for the current frequency and harmonics
+void BakeNoiseTextures(JobSystem& jobs, GLuint& noiseTextures, GLuint& animatedNoiseTexture);
+
+// boolean to render the objects with the patterns saved in the procedural cache
+GLboolean useProceduralCache = GL_FALSE;
+// frames of the animated pattern saved in the cache, for each period of ANIMATION_PERIOD seconds
+#define CACHE_ANIMATION_FRAMES 32
+// cache of the patterns: 512x512 textures, with a budget of 64 MB (about 48 patterns)
+ProceduralTextureCache proceduralCache(512, 64 * 1024 * 1024);
+
+// parameters of the benchmark: each subroutine is used for BENCHMARK_FRAMES frames with the calculated noise, and then for BENCHMARK_FRAMES frames with the baked textures.
+// The first BENCHMARK_WARMUP frames of each step are not considered in the averages
+#define BENCHMARK_FRAMES 120
+#define BENCHMARK_WARMUP 5
+GLboolean benchmark = GL_FALSE;
+GLuint benchmarkStep = 0, benchmarkFrame = 0, benchmarkSamples = 0, benchmarkPreviousSubroutine = 0;
+GLboolean benchmarkPreviousMode = GL_FALSE;
+double benchmarkMs = 0.0, benchmarkCalculatedMs = 0.0;
+
 /////////////////// MAIN function ///////////////////////
 int main()
 {
@@ -179,6 +225,15 @@ int main()
     // we print on console the name of the first subroutine used
     PrintCurrentShader(current_subroutine);
 
+    // Shader Program which renders the patterns in the textures of the procedural cache (in UV space), and Shader Program for the objects with the cached patterns
+    Shader bake_shader("38_procedural_bake.vert", "08_random_patterns.frag");
+    Shader cached_shader("06_procedural_base.vert", "39_procedural_cached.frag");
+
+    // we bake the noise textures: the workers of the job system calculate the texels in parallel
+    JobSystem jobs;
+    GLuint noiseTextures, animatedNoiseTexture;
+    BakeNoiseTextures(jobs, noiseTextures, animatedNoiseTexture);
+
     // we load the model(s) (code of Model class is in include/utils/model.h)
     Model cubeModel("../../models/cube.obj");
     Model sphereModel("../../models/sphere.obj");
@@ -199,6 +254,13 @@ int main()
     glm::mat3 bunnyNormalMatrix = glm::mat3(1.0f);
     glm::mat4 planeModelMatrix = glm::mat4(1.0f);
 
+    // timer queries for the benchmark: the query of the current frame is issued, while the result of the query of the previous frame is read
+    // (so we do not stall the CPU waiting for the GPU)
+    GLuint timeQuery[2];
+    GLboolean queryIssued[2] = {GL_FALSE, GL_FALSE};
+    GLuint currentQuery = 0;
+    glGenQueries(2, timeQuery);
+
     // Rendering loop: this code is executed at each frame
     while(!glfwWindowShouldClose(window))
     {
@@ -249,28 +311,86 @@ int main()
 
 
         /////////////////// OBJECTS ////////////////////////////////////////////////
-        // We "install" the noise_shader Shader Program as part of the current rendering process
-        noise_shader.Use();
-        // we search inside the Shader Program the name of the subroutine currently selected, and we get the numerical index
-        GLuint index = glGetSubroutineIndex(noise_shader.Program, GL_FRAGMENT_SHADER, shaders[current_subroutine].c_str());
-        // we activate the subroutine using the index (this is where shaders swapping happens)
-        glUniformSubroutinesuiv( GL_FRAGMENT_SHADER, 1, &index);
-
-        // we determine the position in the Shader Program of the uniform variables
-        frequencyLocation = glGetUniformLocation(noise_shader.Program, "frequency");
-        powerLocation = glGetUniformLocation(noise_shader.Program, "power");
-        timerLocation = glGetUniformLocation(noise_shader.Program, "timer");
-        harmonicsLocation = glGetUniformLocation(noise_shader.Program, "harmonics");
+        // the Shader Program used for the objects
+        GLuint objectProgram;
+        if (useProceduralCache)
+        {
+            // the pattern is rendered in a texture only when the subroutine or the parameters change. For the animated pattern,
+            // the time is periodic and quantized: after a period, all the frames are in the cache
+            ProceduralKey key;
+            key.pattern = shaders[current_subroutine];
+            key.parameters.push_back(frequency);
+            key.parameters.push_back(power);
+            key.parameters.push_back(harmonics);
+            GLfloat patternTime = 0.0f;
+            if (key.pattern == "NoiseColorAnimated")
+            {
+                patternTime = ProceduralFrameTime(currentFrame, ANIMATION_PERIOD, CACHE_ANIMATION_FRAMES);
+                key.parameters.push_back(patternTime);
+            }
+            GLuint patternTexture = proceduralCache.Acquire(key, [&]()
+            {
+                // we use the same subroutine and uniforms in the Shader Program which renders the pattern in UV space
+                bake_shader.Use();
+                GLuint bakeIndex = glGetSubroutineIndex(bake_shader.Program, GL_FRAGMENT_SHADER, key.pattern.c_str());
+                glUniformSubroutinesuiv(GL_FRAGMENT_SHADER, 1, &bakeIndex);
+                glUniform1f(glGetUniformLocation(bake_shader.Program, "frequency"), frequency);
+                glUniform1f(glGetUniformLocation(bake_shader.Program, "power"), power);
+                glUniform1f(glGetUniformLocation(bake_shader.Program, "timer"), patternTime);
+                glUniform1f(glGetUniformLocation(bake_shader.Program, "harmonics"), harmonics);
+                // the noise is calculated (the samplers of the baked textures must be on different units anyway, because they have different types)
+                glUniform1i(glGetUniformLocation(bake_shader.Program, "noiseTextures"), 0);
+                glUniform1i(glGetUniformLocation(bake_shader.Program, "animatedNoiseTexture"), 1);
+                glUniform1i(glGetUniformLocation(bake_shader.Program, "useNoiseTextures"), GL_FALSE);
+            });
+
+            // the objects need only a texture fetch
+            cached_shader.Use();
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, patternTexture);
+            glUniform1i(glGetUniformLocation(cached_shader.Program, "proceduralTexture"), 0);
+            objectProgram = cached_shader.Program;
+        }
+        else
+        {
+            // We "install" the noise_shader Shader Program as part of the current rendering process
+            noise_shader.Use();
+            // we search inside the Shader Program the name of the subroutine currently selected, and we get the numerical index
+            GLuint index = glGetSubroutineIndex(noise_shader.Program, GL_FRAGMENT_SHADER, shaders[current_subroutine].c_str());
+            // we activate the subroutine using the index (this is where shaders swapping happens)
+            glUniformSubroutinesuiv( GL_FRAGMENT_SHADER, 1, &index);
+
+            // we determine the position in the Shader Program of the uniform variables
+            frequencyLocation = glGetUniformLocation(noise_shader.Program, "frequency");
+            powerLocation = glGetUniformLocation(noise_shader.Program, "power");
+            timerLocation = glGetUniformLocation(noise_shader.Program, "timer");
+            harmonicsLocation = glGetUniformLocation(noise_shader.Program, "harmonics");
+
+            // we assign the value to the uniform variable
+            glUniform1f(frequencyLocation, frequency);
+            glUniform1f(powerLocation, power);
+            glUniform1f(timerLocation, currentFrame);
+            glUniform1f(harmonicsLocation, harmonics);
+
+            // we bind the baked textures, and we select the source of the noise
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, noiseTextures);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_3D, animatedNoiseTexture);
+            glUniform1i(glGetUniformLocation(noise_shader.Program, "noiseTextures"), 0);
+            glUniform1i(glGetUniformLocation(noise_shader.Program, "animatedNoiseTexture"), 1);
+            glUniform1f(glGetUniformLocation(noise_shader.Program, "animationPeriod"), ANIMATION_PERIOD);
+            glUniform1i(glGetUniformLocation(noise_shader.Program, "useNoiseTextures"), useNoiseTextures);
+            objectProgram = noise_shader.Program;
+        }
 
-        // we assign the value to the uniform variable
-        glUniform1f(frequencyLocation, frequency);
-        glUniform1f(powerLocation, power);
-        glUniform1f(timerLocation, currentFrame);
-        glUniform1f(harmonicsLocation, harmonics);
+        // during the benchmark, we measure the GPU time of the rendering of the objects
+        if (benchmark)
+            glBeginQuery(GL_TIME_ELAPSED, timeQuery[currentQuery]);
 
         // we pass projection and view matrices to the Shader Program
-        glUniformMatrix4fv(glGetUniformLocation(noise_shader.Program, "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(projection));
-        glUniformMatrix4fv(glGetUniformLocation(noise_shader.Program, "viewMatrix"), 1, GL_FALSE, glm::value_ptr(view));
+        glUniformMatrix4fv(glGetUniformLocation(objectProgram, "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(projection));
+        glUniformMatrix4fv(glGetUniformLocation(objectProgram, "viewMatrix"), 1, GL_FALSE, glm::value_ptr(view));
 
         // SPHERE
         /*
@@ -291,8 +411,8 @@ int main()
         sphereModelMatrix = glm::scale(sphereModelMatrix, glm::vec3(0.8f, 0.8f, 0.8f));
         // if we cast a mat4 to a mat3, we are automatically considering the upper left 3x3 submatrix
         sphereNormalMatrix = glm::inverseTranspose(glm::mat3(view*sphereModelMatrix));
-        glUniformMatrix4fv(glGetUniformLocation(noise_shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(sphereModelMatrix));
-        glUniformMatrix3fv(glGetUniformLocation(noise_shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(sphereNormalMatrix));
+        glUniformMatrix4fv(glGetUniformLocation(objectProgram, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(sphereModelMatrix));
+        glUniformMatrix3fv(glGetUniformLocation(objectProgram, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(sphereNormalMatrix));
 
         // we render the model
         sphereModel.Draw();
@@ -306,8 +426,8 @@ int main()
         cubeModelMatrix = glm::rotate(cubeModelMatrix, glm::radians(orientationY), glm::vec3(0.0f, 1.0f, 0.0f));
         cubeModelMatrix = glm::scale(cubeModelMatrix, glm::vec3(0.8f, 0.8f, 0.8f));	// It's a bit too big for our scene, so scale it down
         cubeNormalMatrix = glm::inverseTranspose(glm::mat3(view*cubeModelMatrix));
-        glUniformMatrix4fv(glGetUniformLocation(noise_shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(cubeModelMatrix));
-        glUniformMatrix3fv(glGetUniformLocation(noise_shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(cubeNormalMatrix));
+        glUniformMatrix4fv(glGetUniformLocation(objectProgram, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(cubeModelMatrix));
+        glUniformMatrix3fv(glGetUniformLocation(objectProgram, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(cubeNormalMatrix));
 
         // we render the cube
         cubeModel.Draw();
@@ -321,12 +441,62 @@ int main()
         bunnyModelMatrix = glm::rotate(bunnyModelMatrix, glm::radians(orientationY), glm::vec3(0.0f, 1.0f, 0.0f));
         bunnyModelMatrix = glm::scale(bunnyModelMatrix, glm::vec3(0.3f, 0.3f, 0.3f));	// It's a bit too big for our scene, so scale it down
         bunnyNormalMatrix = glm::inverseTranspose(glm::mat3(view*bunnyModelMatrix));
-        glUniformMatrix4fv(glGetUniformLocation(noise_shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(bunnyModelMatrix));
-        glUniformMatrix3fv(glGetUniformLocation(noise_shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(bunnyNormalMatrix));
+        glUniformMatrix4fv(glGetUniformLocation(objectProgram, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(bunnyModelMatrix));
+        glUniformMatrix3fv(glGetUniformLocation(objectProgram, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(bunnyNormalMatrix));
 
         // Swapping back and front buffers
         bunnyModel.Draw();
 
+        if (benchmark)
+        {
+            glEndQuery(GL_TIME_ELAPSED);
+            queryIssued[currentQuery] = GL_TRUE;
+
+            // we read the result of the query of the previous frame, and we accumulate the GPU time (the first frames of each step are skipped,
+            // because the results are read with a delay of a frame)
+            GLuint previousQuery = 1 - currentQuery;
+            if (queryIssued[previousQuery])
+            {
+                GLuint64 elapsed;
+                glGetQueryObjectui64v(timeQuery[previousQuery], GL_QUERY_RESULT, &elapsed);
+                queryIssued[previousQuery] = GL_FALSE;
+                if (benchmarkFrame >= BENCHMARK_WARMUP)
+                {
+                    benchmarkMs += elapsed / 1000000.0;
+                    benchmarkSamples++;
+                }
+            }
+            currentQuery = previousQuery;
+
+            // after BENCHMARK_FRAMES frames, we move to the next step: the same subroutine with the baked textures, or the next subroutine with the calculated noise
+            if (++benchmarkFrame == BENCHMARK_FRAMES)
+            {
+                double ms = benchmarkMs / glm::max(benchmarkSamples, 1u);
+                if (!useNoiseTextures)
+                    benchmarkCalculatedMs = ms;
+                else
+                    std::cout << shaders[current_subroutine] << ": calculated noise " << benchmarkCalculatedMs << " ms - baked textures " << ms
+                              << " ms (speedup " << benchmarkCalculatedMs / glm::max(ms, 0.000001) << "x)" << std::endl;
+                benchmarkFrame = benchmarkSamples = 0;
+                benchmarkMs = 0.0;
+                // the result of the last query belongs to the previous step: we discard it
+                queryIssued[0] = queryIssued[1] = GL_FALSE;
+                if (++benchmarkStep == 2 * shaders.size())
+                {
+                    // at the end, we restore the subroutine and the mode used before the benchmark
+                    benchmark = GL_FALSE;
+                    current_subroutine = benchmarkPreviousSubroutine;
+                    useNoiseTextures = benchmarkPreviousMode;
+                    std::cout << "Benchmark completed" << std::endl;
+                }
+                else
+                {
+                    current_subroutine = benchmarkStep / 2;
+                    useNoiseTextures = (benchmarkStep % 2 == 1);
+                }
+            }
+        }
+
         // Faccio lo swap tra back e front buffer
         glfwSwapBuffers(window);
     }
@@ -335,6 +505,13 @@ int main()
     // we delete the Shader Programs
     plane_shader.Delete();
     noise_shader.Delete();
+    bake_shader.Delete();
+    cached_shader.Delete();
+    proceduralCache.Clear();
+    // we delete the baked textures and the queries
+    glDeleteTextures(1, &noiseTextures);
+    glDeleteTextures(1, &animatedNoiseTexture);
+    glDeleteQueries(2, timeQuery);
     // we close and delete the created context
     glfwTerminate();
     return 0;
@@ -388,6 +565,62 @@ void SetupShader(int program)
     }
 }
 
+//////////////////////////////////////////
+// we bake the noise used by the subroutines, with power = 1 (the shader multiplies the values for power):
+// - a 2D texture array with 2 layers: layer 0 = (noise, turbulence, turbulence with absolute values) of the Noise and Turbulence subroutines, layer 1 = the 3 values of NoiseColor
+// - a 3D texture with the 3 values of NoiseColorAnimated, with ANIMATED_NOISE_FRAMES frames along the time, for an animation of ANIMATION_PERIOD seconds.
+//   The animation is made periodic, to repeat the texture along the time
+// The internal format is half float (the values are in [-1,1] for the noise, and in [-2,2] for the turbulence)
+void BakeNoiseTextures(JobSystem& jobs, GLuint& noiseTextures, GLuint& animatedNoiseTexture)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    // the third coordinate of the noise and its speed along the time, for each channel (as in the subroutines of the shader)
+    vector<NoiseChannel> patterns, colors, animated;
+    patterns.push_back(NoiseChannel(NOISE_SIMPLEX, 0.0f, 0.0f));
+    patterns.push_back(NoiseChannel(NOISE_FBM, 0.0f, 0.0f));
+    patterns.push_back(NoiseChannel(NOISE_FBM_ABS, 0.0f, 0.0f));
+    colors.push_back(NoiseChannel(NOISE_SIMPLEX, 0.4f, 0.0f));
+    colors.push_back(NoiseChannel(NOISE_SIMPLEX, -0.7f, 0.0f));
+    colors.push_back(NoiseChannel(NOISE_SIMPLEX, 0.8f, 0.0f));
+    animated.push_back(NoiseChannel(NOISE_SIMPLEX, 0.0f, 0.4f));
+    animated.push_back(NoiseChannel(NOISE_SIMPLEX, 0.0f, -0.7f));
+    animated.push_back(NoiseChannel(NOISE_SIMPLEX, 0.0f, 0.8f));
+
+    // the 2 layers of the array are placed one after the other
+    vector<float> layer0, layer1, frames;
+    BakeNoise(NOISE_TEXTURE_SIZE, 1, 1.0f, patterns, frequency, (int)harmonics, NOISE_TILE_NONE, layer0, &jobs);
+    BakeNoise(NOISE_TEXTURE_SIZE, 1, 1.0f, colors, frequency, (int)harmonics, NOISE_TILE_NONE, layer1, &jobs);
+    layer0.insert(layer0.end(), layer1.begin(), layer1.end());
+    BakeNoise(ANIMATED_NOISE_SIZE, ANIMATED_NOISE_FRAMES, ANIMATION_PERIOD, animated, frequency, (int)harmonics, NOISE_TILE_TIME, frames, &jobs);
+    double bakeMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    // the UV coordinates of the models are in [0,1], and the baked noise is not periodic in UV: we clamp the coordinates
+    glGenTextures(1, &noiseTextures);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, noiseTextures);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB16F, NOISE_TEXTURE_SIZE, NOISE_TEXTURE_SIZE, 2, 0, GL_RGB, GL_FLOAT, &layer0[0]);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    // the animated texture repeats along the time
+    glGenTextures(1, &animatedNoiseTexture);
+    glBindTexture(GL_TEXTURE_3D, animatedNoiseTexture);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB16F, ANIMATED_NOISE_SIZE, ANIMATED_NOISE_SIZE, ANIMATED_NOISE_FRAMES, 0, GL_RGB, GL_FLOAT, &frames[0]);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    std::cout << "Noise textures baked in " << bakeMs << " ms with " << (jobs.NumWorkers() + 1) << " threads: " << NOISE_TEXTURE_SIZE << "x" << NOISE_TEXTURE_SIZE
+              << "x2 array, " << ANIMATED_NOISE_SIZE << "x" << ANIMATED_NOISE_SIZE << "x" << ANIMATED_NOISE_FRAMES << " animation" << std::endl;
+}
+
 //////////////////////////////////////////
 // we print on console the name of the currently used shader subroutine
 void PrintCurrentShader(int subroutine)
@@ -413,10 +646,38 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
   if(key == GLFW_KEY_L && action == GLFW_PRESS)
       wireframe=!wireframe;
 
+  // if T is pressed, we switch between the noise calculated in the shader and the baked textures
+  if(key == GLFW_KEY_T && action == GLFW_PRESS && !benchmark)
+  {
+      useNoiseTextures=!useNoiseTextures;
+      std::cout << "Noise: " << (useNoiseTextures ? "baked textures" : "calculated in the shader") << std::endl;
+  }
+
+  // if C is pressed, we activate/deactivate the procedural cache
+  if(key == GLFW_KEY_C && action == GLFW_PRESS && !benchmark)
+  {
+      useProceduralCache=!useProceduralCache;
+      std::cout << "Procedural cache: " << (useProceduralCache ? "on" : "off") << std::endl;
+      proceduralCache.PrintStats();
+  }
+
+  // if B is pressed, we start the benchmark of the subroutines (without the procedural cache)
+  if(key == GLFW_KEY_B && action == GLFW_PRESS && !benchmark && !useProceduralCache)
+  {
+      benchmark = GL_TRUE;
+      benchmarkPreviousSubroutine = current_subroutine;
+      benchmarkPreviousMode = useNoiseTextures;
+      benchmarkStep = benchmarkFrame = benchmarkSamples = 0;
+      benchmarkMs = 0.0;
+      current_subroutine = 0;
+      useNoiseTextures = GL_FALSE;
+      std::cout << "Benchmark of the subroutines, calculated noise vs baked textures (" << BENCHMARK_FRAMES << " frames each)" << std::endl;
+  }
+
     // pressing a key number, we change the shader applied to the models
     // if the key is between 1 and 9, we proceed and check if the pressed key corresponds to
     // a valid subroutine
-    if((key >= GLFW_KEY_1 && key <= GLFW_KEY_9) && action == GLFW_PRESS)
+    if((key >= GLFW_KEY_1 && key <= GLFW_KEY_9) && action == GLFW_PRESS && !benchmark)
     {
         // "1" to "9" -> ASCII codes from 49 to 59
         // we subtract 48 (= ASCII CODE of "0") to have integers from 1 to 9
@@ -1,6 +1,10 @@
 /*
 Es03c: Procedural shaders 2 (regular patterns)
 - procedural shaders for 2 regular patterns, with and without antialiasing, pressing keys from 1 to 6
+- pressing the UP and DOWN keys, we change the number of repetitions of the patterns
+- pressing the C key, the objects are rendered with a procedural cache (see include/utils/procedural_cache.h): the pattern is rendered in a texture only when
+  the subroutine or the parameters change, and the objects need a single texture fetch. The cache keeps the most recently used patterns, within a memory budget.
+  N.B.) in the cache, the pattern is rendered in UV space, and it is filtered by the mipmaps: also the versions without antialiasing are (mostly) antialiased
 
 N.B. 1)
 In this example we use Shaders Subroutines to do shader swapping:
@@ -67,6 +71,8 @@ positive Z axis points "outside" the screen
 // classes developed during lab lectures to manage shaders and to load models
 #include <utils/shader.h>
 #include <utils/model.h>
+// render-to-texture cache for the procedural patterns
+#include <utils/procedural_cache.h>
 
 // we load the GLM classes used in the application
 #include <glm/glm.hpp>
@@ -117,6 +123,11 @@ GLfloat planeColor[] = {0.0f,0.5f,0.0f};
 // variables used to store uniform location inside shaders
 GLint planeColorLocation, fragColorLocation1, fragColorLocation2, repeatLocation;
 
+// boolean to render the objects with the patterns saved in the procedural cache
+GLboolean useProceduralCache = GL_FALSE;
+// cache of the patterns: 512x512 textures, with a budget of 16 MB (about 12 patterns)
+ProceduralTextureCache proceduralCache(512, 16 * 1024 * 1024);
+
 
 /////////////////// MAIN function ///////////////////////
 int main()
@@ -180,6 +191,10 @@ int main()
     // we print on console the name of the first subroutine used
     PrintCurrentShader(current_subroutine);
 
+    // Shader Program which renders the patterns in the textures of the procedural cache (in UV space), and Shader Program for the objects with the cached patterns
+    Shader bake_shader("38_procedural_bake.vert", "07_regular_patterns.frag");
+    Shader cached_shader("06_procedural_base.vert", "39_procedural_cached.frag");
+
     // we load the model(s) (code of Model class is in include/utils/model.h)
     Model cubeModel("../../models/cube.obj");
     Model sphereModel("../../models/sphere.obj");
@@ -250,26 +265,58 @@ int main()
 
 
         /////////////////// OBJECTS ////////////////////////////////////////////////
-        // We "install" the pattern_shader Shader Program as part of the current rendering process
-        pattern_shader.Use();
-        // we search inside the Shader Program the name of the subroutine currently selected, and we get the numerical index
-        GLuint index = glGetSubroutineIndex(pattern_shader.Program, GL_FRAGMENT_SHADER, shaders[current_subroutine].c_str());
-        // we activate the subroutine using the index (this is where shaders swapping happens)
-        glUniformSubroutinesuiv( GL_FRAGMENT_SHADER, 1, &index);
-
-        // we determine the position in the Shader Program of the uniform variable
-        fragColorLocation1 = glGetUniformLocation(pattern_shader.Program, "color1");
-        fragColorLocation2 = glGetUniformLocation(pattern_shader.Program, "color2");
-        repeatLocation = glGetUniformLocation(pattern_shader.Program, "repeat");
-
-        // we assign the value to the uniform variable
-        glUniform3fv(fragColorLocation1, 1, myColor1);
-        glUniform3fv(fragColorLocation2, 1, myColor2);
-        glUniform1f(repeatLocation, repeat);
+        // the Shader Program used for the objects
+        GLuint objectProgram;
+        if (useProceduralCache)
+        {
+            // the pattern is rendered in a texture only when the subroutine or the parameters change
+            ProceduralKey key;
+            key.pattern = shaders[current_subroutine];
+            key.parameters.push_back(repeat);
+            key.parameters.insert(key.parameters.end(), myColor1, myColor1 + 3);
+            key.parameters.insert(key.parameters.end(), myColor2, myColor2 + 3);
+            GLuint patternTexture = proceduralCache.Acquire(key, [&]()
+            {
+                // we use the same subroutine and uniforms in the Shader Program which renders the pattern in UV space
+                bake_shader.Use();
+                GLuint bakeIndex = glGetSubroutineIndex(bake_shader.Program, GL_FRAGMENT_SHADER, key.pattern.c_str());
+                glUniformSubroutinesuiv(GL_FRAGMENT_SHADER, 1, &bakeIndex);
+                glUniform3fv(glGetUniformLocation(bake_shader.Program, "color1"), 1, myColor1);
+                glUniform3fv(glGetUniformLocation(bake_shader.Program, "color2"), 1, myColor2);
+                glUniform1f(glGetUniformLocation(bake_shader.Program, "repeat"), repeat);
+            });
+
+            // the objects need only a texture fetch
+            cached_shader.Use();
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, patternTexture);
+            glUniform1i(glGetUniformLocation(cached_shader.Program, "proceduralTexture"), 0);
+            objectProgram = cached_shader.Program;
+        }
+        else
+        {
+            // We "install" the pattern_shader Shader Program as part of the current rendering process
+            pattern_shader.Use();
+            // we search inside the Shader Program the name of the subroutine currently selected, and we get the numerical index
+            GLuint index = glGetSubroutineIndex(pattern_shader.Program, GL_FRAGMENT_SHADER, shaders[current_subroutine].c_str());
+            // we activate the subroutine using the index (this is where shaders swapping happens)
+            glUniformSubroutinesuiv( GL_FRAGMENT_SHADER, 1, &index);
+
+            // we determine the position in the Shader Program of the uniform variable
+            fragColorLocation1 = glGetUniformLocation(pattern_shader.Program, "color1");
+            fragColorLocation2 = glGetUniformLocation(pattern_shader.Program, "color2");
+            repeatLocation = glGetUniformLocation(pattern_shader.Program, "repeat");
+
+            // we assign the value to the uniform variable
+            glUniform3fv(fragColorLocation1, 1, myColor1);
+            glUniform3fv(fragColorLocation2, 1, myColor2);
+            glUniform1f(repeatLocation, repeat);
+            objectProgram = pattern_shader.Program;
+        }
 
         // we pass projection and view matrices to the Shader Program
-        glUniformMatrix4fv(glGetUniformLocation(pattern_shader.Program, "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(projection));
-        glUniformMatrix4fv(glGetUniformLocation(pattern_shader.Program, "viewMatrix"), 1, GL_FALSE, glm::value_ptr(view));
+        glUniformMatrix4fv(glGetUniformLocation(objectProgram, "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(projection));
+        glUniformMatrix4fv(glGetUniformLocation(objectProgram, "viewMatrix"), 1, GL_FALSE, glm::value_ptr(view));
 
         // SPHERE
         /*
@@ -290,8 +337,8 @@ int main()
         sphereModelMatrix = glm::scale(sphereModelMatrix, glm::vec3(0.8f, 0.8f, 0.8f));
         // if we cast a mat4 to a mat3, we are automatically considering the upper left 3x3 submatrix
         sphereNormalMatrix = glm::inverseTranspose(glm::mat3(view*sphereModelMatrix));
-        glUniformMatrix4fv(glGetUniformLocation(pattern_shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(sphereModelMatrix));
-        glUniformMatrix3fv(glGetUniformLocation(pattern_shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(sphereNormalMatrix));
+        glUniformMatrix4fv(glGetUniformLocation(objectProgram, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(sphereModelMatrix));
+        glUniformMatrix3fv(glGetUniformLocation(objectProgram, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(sphereNormalMatrix));
 
         // we render the model
         sphereModel.Draw();
@@ -305,8 +352,8 @@ int main()
         cubeModelMatrix = glm::rotate(cubeModelMatrix, glm::radians(orientationY), glm::vec3(0.0f, 1.0f, 0.0f));
         cubeModelMatrix = glm::scale(cubeModelMatrix, glm::vec3(0.8f, 0.8f, 0.8f));	// It's a bit too big for our scene, so scale it down
         cubeNormalMatrix = glm::inverseTranspose(glm::mat3(view*cubeModelMatrix));
-        glUniformMatrix4fv(glGetUniformLocation(pattern_shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(cubeModelMatrix));
-        glUniformMatrix3fv(glGetUniformLocation(pattern_shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(cubeNormalMatrix));
+        glUniformMatrix4fv(glGetUniformLocation(objectProgram, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(cubeModelMatrix));
+        glUniformMatrix3fv(glGetUniformLocation(objectProgram, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(cubeNormalMatrix));
 
         // we render the cube
         cubeModel.Draw();
@@ -320,8 +367,8 @@ int main()
         bunnyModelMatrix = glm::rotate(bunnyModelMatrix, glm::radians(orientationY), glm::vec3(0.0f, 1.0f, 0.0f));
         bunnyModelMatrix = glm::scale(bunnyModelMatrix, glm::vec3(0.3f, 0.3f, 0.3f));	// It's a bit too big for our scene, so scale it down
         bunnyNormalMatrix = glm::inverseTranspose(glm::mat3(view*bunnyModelMatrix));
-        glUniformMatrix4fv(glGetUniformLocation(pattern_shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(bunnyModelMatrix));
-        glUniformMatrix3fv(glGetUniformLocation(pattern_shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(bunnyNormalMatrix));
+        glUniformMatrix4fv(glGetUniformLocation(objectProgram, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(bunnyModelMatrix));
+        glUniformMatrix3fv(glGetUniformLocation(objectProgram, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(bunnyNormalMatrix));
 
         // Swapping back and front buffers
         bunnyModel.Draw();
@@ -334,6 +381,9 @@ int main()
     // we delete the Shader Programs
     plane_shader.Delete();
     pattern_shader.Delete();
+    bake_shader.Delete();
+    cached_shader.Delete();
+    proceduralCache.Clear();
     // we close and delete the created context
     glfwTerminate();
     return 0;
@@ -412,6 +462,21 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     if(key == GLFW_KEY_L && action == GLFW_PRESS)
         wireframe=!wireframe;
 
+    // if UP or DOWN are pressed, we change the number of repetitions of the patterns
+    if((key == GLFW_KEY_UP || key == GLFW_KEY_DOWN) && action == GLFW_PRESS)
+    {
+        repeat = glm::max(repeat + (key == GLFW_KEY_UP ? 1.0f : -1.0f), 1.0f);
+        std::cout << "Repetitions: " << repeat << std::endl;
+    }
+
+    // if C is pressed, we activate/deactivate the procedural cache
+    if(key == GLFW_KEY_C && action == GLFW_PRESS)
+    {
+        useProceduralCache=!useProceduralCache;
+        std::cout << "Procedural cache: " << (useProceduralCache ? "on" : "off") << std::endl;
+        proceduralCache.PrintStats();
+    }
+
     // pressing a key number, we change the shader applied to the models
     // if the key is between 1 and 9, we proceed and check if the pressed key corresponds to
     // a valid subroutine
@@ -1,5 +1,8 @@
 /*
-12_illumination_models_ML.frag: as 10_illumination_models.frag, but with multiple lights
+12_illumination_models_ML.frag: as 10_illumination_models.frag, but with multiple lights, using clustered light culling
+- the view frustum is split in a 3D grid of clusters, and, for each cluster, the application calculates the list of the lights whose sphere of influence intersects it (see include/utils/light_clusters.h)
+- each fragment finds its cluster, and it applies the illumination model only for the lights of the cluster
+- the contribution of each light is multiplied by its color and, if useAttenuation is true (stress scene), by a "windowed" attenuation, which is 0 at the radius of the light (see include/utils/point_lights.h)
 
 N.B. 1)  "11_illumination_models_ML.vert" must be used as vertex shader
 
@@ -11,6 +14,8 @@ N.B. 4)  only Blinn-Phong and GGX illumination models are considered in this sha
 
 N.B. 5) see note 2 in the vertex shader for considerations on multiple lights management
 
+N.B. 6) the data of the lights and of the clusters are read from Texture Buffer Objects, using samplerBuffers and texelFetch
+
 author: Davide Gadia
 
 Real-Time Graphics Programming - a.a. 2024/2025
@@ -21,17 +26,11 @@ Universita' degli Studi di Milano
 
 #version 410 core
 
-// number of lights in the scene
-#define NR_LIGHTS 3
-
 const float PI = 3.14159265359;
 
 // output shader variable
 out vec4 colorFrag;
 
-// array with lights incidence directions (calculated in vertex shader, interpolated by rasterization)
-in vec3 lightDirs[NR_LIGHTS];
-
 // the transformed normal has been calculated per-vertex in the vertex shader
 in vec3 vNormal;
 // vector from fragment to camera (in view coordinate)
@@ -54,6 +53,48 @@ uniform float shininess;
 uniform float alpha; // rugosity - 0 : smooth, 1: rough
 uniform float F0; // fresnel reflectance at normal incidence
 
+// lights: 2 texels for each light (position in view coordinates + radius, color)
+uniform samplerBuffer lightData;
+// clusters: offset of the first light in lightIndices, and number of lights
+uniform usamplerBuffer clusterData;
+// indices of the lights of each cluster
+uniform usamplerBuffer lightIndices;
+
+// dimensions of the grid of clusters, dimensions of the viewport, depth range of the exponential slices
+uniform ivec3 clusterDims;
+uniform vec2 screenSize;
+uniform float clusterNear;
+uniform float clusterFar;
+
+// if false, the lights are not attenuated (as in the previous lectures)
+uniform bool useAttenuation;
+
+// offset and number of the lights of the cluster of the current fragment (set in the main function)
+uint lightOffset;
+uint lightCount;
+
+//////////////////////////////////////////
+// we read the i-th light of the cluster, and we calculate the normalized incidence direction and the attenuated color of the light
+void GetLight(uint i, out vec3 L, out vec3 radiance)
+{
+    uint index = texelFetch(lightIndices, int(lightOffset + i)).r;
+    vec4 positionRadius = texelFetch(lightData, int(2u*index));
+    vec3 color = texelFetch(lightData, int(2u*index + 1u)).rgb;
+
+    // vViewPosition is already negated (= from the fragment to the camera), so the position of the fragment is -vViewPosition
+    vec3 lightDir = positionRadius.xyz + vViewPosition;
+    float dist = length(lightDir);
+    L = lightDir / max(dist, 0.0001);
+
+    radiance = color;
+    // "windowed" attenuation
+    if (useAttenuation)
+    {
+        float window = clamp(1.0 - pow(dist / positionRadius.w, 4.0), 0.0, 1.0);
+        radiance *= window * window;
+    }
+}
+
 ////////////////////////////////////////////////////////////////////
 
 // the "type" of the Subroutine
@@ -75,11 +116,12 @@ vec3 BlinnPhong_ML() // this name is the one which is detected by the SetupShade
     // normalization of the per-fragment normal
     vec3 N = normalize(vNormal);
 
-    //for all the lights in the scene
-    for(int i = 0; i < NR_LIGHTS; i++)
+    //for all the lights of the cluster
+    for(uint i = 0u; i < lightCount; i++)
     {
-        // normalization of the per-fragment light incidence direction
-        vec3 L = normalize(lightDirs[i]);
+        // per-fragment light incidence direction and light color
+        vec3 L, radiance;
+        GetLight(i, L, radiance);
 
         // Lambert coefficient
         float lambertian = max(dot(L,N), 0.0);
@@ -101,7 +143,7 @@ vec3 BlinnPhong_ML() // this name is the one which is detected by the SetupShade
             // We add diffusive and specular components to the final color
             // N.B. ): in this implementation, the sum of the components can be different than 1
             color += vec3( Kd * lambertian * diffuseColor +
-                            Ks * specular * specularColor);
+                            Ks * specular * specularColor) * radiance;
         }
     }
     return color;
@@ -137,11 +179,12 @@ vec3 GGX_ML() // this name is the one which is detected by the SetupShaders() fu
     // we initialize the final color
     vec3 color = vec3(0.0);
 
-    //for all the lights in the scene
-    for(int i = 0; i < NR_LIGHTS; i++)
+    //for all the lights of the cluster
+    for(uint i = 0u; i < lightCount; i++)
     {
-        // normalization of the per-fragment light incidence direction
-        vec3 L = normalize(lightDirs[i]);
+        // per-fragment light incidence direction and light color
+        vec3 L, radiance;
+        GetLight(i, L, radiance);
 
         // cosine angle between direction of light and normal
         float NdotL = max(dot(N, L), 0.0);
@@ -187,8 +230,8 @@ vec3 GGX_ML() // this name is the one which is detected by the SetupShaders() fu
             // the rendering equation is:
             //integral of: BRDF * Li * (cosine angle between N and L)
             // BRDF in our case is: the sum of Lambert and GGX
-            // Li is considered as equal to 1: light is white, and we have not applied attenuation. With colored lights, and with attenuation, the code must be modified and the Li factor must be multiplied to finalColor
-            color += (lambert + specular)*NdotL;
+            // Li is the color of the light, multiplied by the attenuation
+            color += (lambert + specular)*NdotL*radiance;
         }
     }
     return color;
@@ -198,6 +241,19 @@ vec3 GGX_ML() // this name is the one which is detected by the SetupShaders() fu
 // main
 void main(void)
 {
+    // we find the cluster of the fragment: the tile is given by the position on screen, the slice by the depth (the inverse of the exponential distribution used by the application)
+    float depth = vViewPosition.z;
+    int slice = 0;
+    if (depth > clusterNear)
+        slice = 1 + int(log(depth / clusterNear) / log(clusterFar / clusterNear) * float(clusterDims.z - 1));
+    slice = min(slice, clusterDims.z - 1);
+    ivec2 tile = clamp(ivec2(gl_FragCoord.xy / screenSize * vec2(clusterDims.xy)), ivec2(0), clusterDims.xy - 1);
+    int cluster = (slice * clusterDims.y + tile.y) * clusterDims.x + tile.x;
+
+    uvec2 data = texelFetch(clusterData, cluster).xy;
+    lightOffset = data.x;
+    lightCount = data.y;
+
     // we call the pointer function Illumination_Model_ML():
     // the subroutine selected in the main application will be called and executed
   	vec3 color = Illumination_Model_ML();
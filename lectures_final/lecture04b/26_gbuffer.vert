@@ -0,0 +1,40 @@
+/*
+26_gbuffer.vert: vertex shader for the geometry pass of deferred shading
+
+N.B.) "27_gbuffer.frag" must be used as fragment shader
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+
+*/
+
+#version 410 core
+
+// vertex position in world coordinates
+layout (location = 0) in vec3 position;
+// vertex normal in world coordinate
+layout (location = 1) in vec3 normal;
+
+// model matrix
+uniform mat4 modelMatrix;
+// view matrix
+uniform mat4 viewMatrix;
+// Projection matrix
+uniform mat4 projectionMatrix;
+
+// normals transformation matrix (= transpose of the inverse of the model-view matrix)
+uniform mat3 normalMatrix;
+
+// the transformed normal (in view coordinate)
+out vec3 vNormal;
+
+void main(){
+
+  // differently from the forward shader, we do not need the light directions and the view position: they are calculated in the lighting pass
+  vNormal = normalize( normalMatrix * normal );
+
+  gl_Position = projectionMatrix * viewMatrix * modelMatrix * vec4( position, 1.0 );
+}
@@ -0,0 +1,40 @@
+/*
+27_gbuffer.frag: fragment shader for the geometry pass of deferred shading
+- it does not apply any illumination model: it saves in the G-buffer the normal and the material parameters of the fragment (see include/utils/gbuffer.h for the layout)
+
+N.B.)  "26_gbuffer.vert" must be used as vertex shader
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+
+*/
+
+#version 410 core
+
+// the outputs are written in the color attachments of the G-buffer
+layout (location = 0) out vec4 gNormal;
+layout (location = 1) out vec4 gAlbedo;
+layout (location = 2) out vec4 gMaterial;
+
+// the transformed normal has been calculated per-vertex in the vertex shader
+in vec3 vNormal;
+
+// material parameters (passed from the application): the same used by the forward shader
+uniform vec3 diffuseColor;
+uniform float Ka;
+uniform float Kd;
+uniform float Ks;
+uniform float shininess;
+uniform float alpha;
+uniform float F0;
+
+void main(void)
+{
+    // the interpolated normal must be normalized again
+    gNormal = vec4(normalize(vNormal), alpha);
+    gAlbedo = vec4(diffuseColor, F0);
+    gMaterial = vec4(Ka, Kd, Ks, shininess);
+}
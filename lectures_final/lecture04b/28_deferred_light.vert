@@ -0,0 +1,45 @@
+/*
+28_deferred_light.vert: vertex shader for the lighting pass of deferred shading
+- if fullscreen = 1, it generates a triangle covering the whole screen (used to apply the ambient component to all the pixels). No vertex buffer is needed: the position is calculated from gl_VertexID
+- otherwise, it transforms the vertices of a sphere (the "light volume"), placed at the position of the light and scaled by its radius of influence:
+  the fragment shader is executed only for the pixels covered by the volume, which are the only pixels that can be illuminated by the light
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+
+*/
+
+#version 410 core
+
+// vertex position of the sphere mesh (with radius = 1)
+layout (location = 0) in vec3 position;
+
+// view matrix
+uniform mat4 viewMatrix;
+// Projection matrix
+uniform mat4 projectionMatrix;
+
+// position of the light (in world coordinates), and radius of the light volume
+uniform vec3 volumeCenter;
+uniform float volumeRadius;
+
+// 1 = fullscreen triangle, 0 = light volume
+uniform int fullscreen;
+
+void main(){
+
+  if (fullscreen == 1)
+  {
+    // gl_VertexID = 0, 1, 2 -> (0,0), (2,0), (0,2) -> a triangle in NDC with vertices (-1,-1), (3,-1), (-1,3), which contains the whole screen
+    vec2 uv = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+  }
+  else
+  {
+    // we do not need a model matrix: only translation and uniform scaling are applied to the sphere
+    gl_Position = projectionMatrix * viewMatrix * vec4(position * volumeRadius + volumeCenter, 1.0);
+  }
+}
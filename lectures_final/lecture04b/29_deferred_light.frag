@@ -0,0 +1,184 @@
+/*
+29_deferred_light.frag: fragment shader for the lighting pass of deferred shading (one light at time)
+- the data of the visible surface are read from the G-buffer (see include/utils/gbuffer.h), and the position in view coordinates is reconstructed from the depth
+- the contribution of the light is calculated using the same Blinn-Phong and GGX models of 12_illumination_models_ML.frag, multiplied by the color of the light and, if useAttenuation is true, by a "windowed" attenuation, which is 0 at the radius of the light (see include/utils/point_lights.h)
+- the results of the different lights are summed using additive blending
+
+N.B. 1)  "28_deferred_light.vert" must be used as vertex shader
+N.B. 2)  the illumination models are implemented using Shaders Subroutines
+N.B. 3)  the ambient component is added only once, in a fullscreen pass (see 30_deferred_ambient.frag)
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+
+*/
+
+#version 410 core
+
+const float PI = 3.14159265359;
+
+// output shader variable
+out vec4 colorFrag;
+
+// textures of the G-buffer
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedo;
+uniform sampler2D gMaterial;
+uniform sampler2D gDepth;
+
+// inverse of the projection matrix, to reconstruct the position in view coordinates
+uniform mat4 inverseProjectionMatrix;
+// dimensions of the G-buffer
+uniform vec2 screenSize;
+
+// position of the light (in view coordinates), color and radius of influence
+uniform vec3 lightPosition;
+uniform vec3 lightColor;
+uniform float lightRadius;
+// if false, the light is not attenuated (as in the previous lectures)
+uniform bool useAttenuation;
+
+// specular color (passed from the application)
+uniform vec3 specularColor;
+
+////////////////////////////////////////////////////////////////////
+
+// the "type" of the Subroutine
+// N: normal, V: view direction, L: light direction, albedo: diffuse color (xyz) and F0 (w), material: Ka, Kd, Ks, shininess, alpha: roughness
+subroutine vec3 ill_model(vec3 N, vec3 V, vec3 L, vec4 albedo, vec4 material, float alpha);
+
+// Subroutine Uniform (it is conceptually similar to a C pointer function)
+subroutine uniform ill_model Illumination_Model_Deferred;
+
+////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////
+// a subroutine for the Blinn-Phong model (diffusive and specular components of a single light)
+subroutine(ill_model)
+vec3 BlinnPhong_Deferred(vec3 N, vec3 V, vec3 L, vec4 albedo, vec4 material, float alpha)
+{
+    vec3 color = vec3(0.0);
+
+    // Lambert coefficient
+    float lambertian = max(dot(L,N), 0.0);
+
+    // if the lambert coefficient is positive, then I can calculate the specular component
+    if(lambertian > 0.0)
+    {
+        // half vector
+        vec3 H = normalize(L + V);
+
+        // we use H to calculate the specular component
+        float specAngle = max(dot(H, N), 0.0);
+        // shininess application to the specular component
+        float specular = pow(specAngle, material.w);
+
+        color = vec3( material.y * lambertian * albedo.rgb +
+                      material.z * specular * specularColor);
+    }
+    return color;
+}
+//////////////////////////////////////////
+
+//////////////////////////////////////////
+// Schlick-GGX method for geometry obstruction (used by GGX model)
+float G1(float angle, float alpha)
+{
+    float r = (alpha + 1.0);
+    float k = (r*r) / 8.0;
+
+    float num   = angle;
+    float denom = angle * (1.0 - k) + k;
+
+    return num / denom;
+}
+
+//////////////////////////////////////////
+// a subroutine for the GGX model (single light)
+subroutine(ill_model)
+vec3 GGX_Deferred(vec3 N, vec3 V, vec3 L, vec4 albedo, vec4 material, float alpha)
+{
+    // diffusive (Lambert) reflection component
+    vec3 lambert = (material.y*albedo.rgb)/PI;
+
+    vec3 color = vec3(0.0);
+
+    // cosine angle between direction of light and normal
+    float NdotL = max(dot(N, L), 0.0);
+
+    if(NdotL > 0.0)
+    {
+        // half vector
+        vec3 H = normalize(L + V);
+
+        float NdotH = max(dot(N, H), 0.0);
+        float NdotV = max(dot(N, V), 0.0);
+        float VdotH = max(dot(V, H), 0.0);
+        float alpha_Squared = alpha * alpha;
+        float NdotH_Squared = NdotH * NdotH;
+
+        // Geometric factor G2 (Smith’s method)
+        float G2 = G1(NdotV, alpha)*G1(NdotL, alpha);
+
+        // Rugosity D (GGX Distribution)
+        float D = alpha_Squared;
+        float denom = (NdotH_Squared*(alpha_Squared-1.0)+1.0);
+        D /= PI*denom*denom;
+
+        // Fresnel reflectance F (approx Schlick)
+        float F0 = albedo.w;
+        vec3 F = vec3(pow(1.0 - VdotH, 5.0));
+        F *= (1.0 - F0);
+        F += F0;
+
+        // we put everything together for the specular component
+        vec3 specular = (F * G2 * D) / (4.0 * NdotV * NdotL);
+
+        color = (lambert + specular)*NdotL;
+    }
+    return color;
+}
+//////////////////////////////////////////
+
+// main
+void main(void)
+{
+    // texture coordinates of the pixel in the G-buffer
+    vec2 uv = gl_FragCoord.xy / screenSize;
+
+    // if the depth is equal to the far plane, there is no surface in the pixel (background)
+    float depth = texture(gDepth, uv).r;
+    if (depth == 1.0)
+        discard;
+
+    // we reconstruct the position in view coordinates: from [0,1] to Normalized Device Coordinates, and then we apply the inverse of the projection (with perspective division)
+    vec4 viewPosition = inverseProjectionMatrix * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    viewPosition /= viewPosition.w;
+
+    // the light volume is slightly larger than the sphere of influence: we skip the pixels outside the sphere
+    vec3 lightDir = lightPosition - viewPosition.xyz;
+    float dist = length(lightDir);
+    if (dist >= lightRadius)
+        discard;
+
+    // "windowed" attenuation
+    float window = clamp(1.0 - pow(dist / lightRadius, 4.0), 0.0, 1.0);
+    float attenuation = (useAttenuation ? window * window : 1.0);
+
+    vec4 normal = texture(gNormal, uv);
+    vec4 albedo = texture(gAlbedo, uv);
+    vec4 material = texture(gMaterial, uv);
+
+    vec3 N = normalize(normal.xyz);
+    vec3 V = normalize(-viewPosition.xyz);
+    vec3 L = lightDir / dist;
+
+    // we call the pointer function Illumination_Model_Deferred():
+    // the subroutine selected in the main application will be called and executed
+    vec3 color = Illumination_Model_Deferred(N, V, L, albedo, material, normal.w);
+
+    colorFrag = vec4(color * lightColor * attenuation, 1.0);
+}
@@ -0,0 +1,40 @@
+/*
+30_deferred_ambient.frag: fragment shader for the ambient component in deferred shading
+- it is applied to the whole screen (fullscreen triangle generated in 28_deferred_light.vert), before the lights, and it writes the ambient component of each visible surface
+
+N.B.)  "28_deferred_light.vert" must be used as vertex shader
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+
+*/
+
+#version 410 core
+
+// output shader variable
+out vec4 colorFrag;
+
+// textures of the G-buffer
+uniform sampler2D gMaterial;
+uniform sampler2D gDepth;
+
+// dimensions of the G-buffer
+uniform vec2 screenSize;
+
+// ambient color (passed from the application)
+uniform vec3 ambientColor;
+
+void main(void)
+{
+    vec2 uv = gl_FragCoord.xy / screenSize;
+
+    // background pixels keep the "clear" color of the frame buffer
+    if (texture(gDepth, uv).r == 1.0)
+        discard;
+
+    // Ka is saved in the first component of the material texture
+    colorFrag = vec4(texture(gMaterial, uv).x * ambientColor, 1.0);
+}
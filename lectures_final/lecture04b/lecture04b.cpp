@@ -14,8 +14,10 @@ https://www.khronos.org/opengl/wiki/Shader_Compilation#Separate_programs
 https://riptutorial.com/opengl/example/26979/load-separable-shader-in-cplusplus
 
 N.B. 2)
-There are other methods (more efficient) to pass multiple data to the shaders, using for example Uniform Buffer Objects.
-With last versions of OpenGL, using structures like the one cited above, it is possible to pass a "dynamic" number of lights
+The lights are not passed to the shaders as an array of uniforms with a fixed size: we use clustered forward rendering, which supports a "dynamic" (and large) number of lights.
+At each frame, the view frustum is split in a 3D grid of clusters, and the application calculates on the CPU (using several threads, and SIMD instructions) the list of the lights influencing each cluster.
+The lists are uploaded in Texture Buffer Objects, and each fragment applies the illumination model only for the lights of its cluster (see include/utils/light_clusters.h).
+Other methods to pass multiple data to the shaders are Uniform Buffer Objects and (in OpenGL 4.3) Shader Storage Buffer Objects
 https://www.geeks3d.com/20140704/gpu-buffers-introduction-to-opengl-3-1-uniform-buffers-objects/
 https://learnopengl.com/Advanced-OpenGL/Advanced-GLSL (scroll down a bit)
 https://hub.packtpub.com/opengl-40-using-uniform-blocks-and-uniform-buffer-objects/
@@ -28,6 +30,19 @@ N.B. 5) to test different parameters of the shaders, it is convenient to use som
 
 N.B. 6) The Camera class has been added in include/utils
 
+N.B. 7) pressing the G key, we switch between forward and deferred rendering.
+In forward rendering, the fragment shader loops over the lights of its cluster: the cost is proportional to (number of fragments) x (number of lights in the cluster), also for the fragments later hidden by other objects.
+In deferred rendering:
+- a geometry pass saves normals and materials of the visible surfaces in a G-buffer (include/utils/gbuffer.h)
+- a lighting pass renders, for each light, a sphere with the radius of influence of the light (the "light volume"): the illumination model is applied only to the pixels covered by the volume, reading the data from the G-buffer, and the results are summed with additive blending
+  We render the back faces of the volumes with the depth test GL_GEQUAL against the depth of the G-buffer: a pixel is shaded only if its surface is in front of the back of the volume, so the surfaces far behind the light are skipped by the depth test
+  The cost of the lighting is thus proportional to the number of pixels actually illuminated by each light.
+By default, the scene is illuminated by the 3 "white" lights of the previous lectures, without attenuation. Pressing the C key, we switch to/from a stress scene for the
+clustered and deferred lighting: the 3 "white" lights plus a number of small colored lights (which can be doubled/halved using the + and - keys), with a "windowed" attenuation.
+The same Blinn-Phong and GGX models are available in both modes (keys 1 and 2), but in deferred rendering the selected model is applied to the plane too.
+
+N.B. 8) pressing the T key, the statistics of clustered light culling (CPU time, average number of lights for each cluster) are printed on console every second
+
 author: Davide Gadia
 
 Real-Time Graphics Programming - a.a. 2024/2025
@@ -54,6 +69,7 @@ positive Z axis points "outside" the screen
 
 // Std. Includes
 #include <string>
+#include <vector>
 
 // Loader for OpenGL extensions
 // http://glad.dav1d.de/
@@ -79,6 +95,11 @@ positive Z axis points "outside" the screen
 #include <utils/shader.h>
 #include <utils/model.h>
 #include <utils/camera.h>
+#include <utils/gbuffer.h>
+#include <utils/point_lights.h>
+#include <utils/light_clusters.h>
+#include <utils/job_system.h>
+#include <utils/frame_stats.h>
 
 
 // we load the GLM classes used in the application
@@ -87,9 +108,6 @@ positive Z axis points "outside" the screen
 #include <glm/gtc/matrix_inverse.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-// number of lights in the scene
-#define NR_LIGHTS 3
-
 // dimensions of application's window
 GLuint screenWidth = 1200, screenHeight = 900;
 
@@ -134,17 +152,42 @@ GLboolean spinning = GL_TRUE;
 // boolean to activate/deactivate wireframe rendering
 GLboolean wireframe = GL_FALSE;
 
+// boolean to switch between forward and deferred rendering
+GLboolean deferred = GL_FALSE;
+
+// enum data structure to assign labels to the different rendering paths of the objects
+enum render_passes{ FORWARD_PASS, GEOMETRY_PASS};
+
+// the objects are rendered with the forward illumination shader, or in the G-buffer
+void RenderObjects(Shader &shader, Model &planeModel, Model &cubeModel, Model &sphereModel, Model &bunnyModel, glm::mat4 &view, render_passes render_pass);
+
+// list of the lights in the scene: the "white" lights, plus a number of small colored lights
+vector<PointLight> lights;
+// boolean to activate/deactivate the stress scene (small colored lights, and attenuation of all the lights)
+GLboolean stressScene = GL_FALSE;
+// number of small colored lights in the stress scene (it can be changed using the + and - keys)
+GLuint numRandomLights = 256;
+// maximum number of small colored lights
+#define MAX_RANDOM_LIGHTS 8192
+// creation of the list of lights
+void SetupLights();
+
 // we create a camera. We pass the initial position as a parameter to the constructor. The last boolean tells that we want a camera "anchored" to the ground
 Camera camera(glm::vec3(0.0f, 0.0f, 7.0f), GL_TRUE);
 
-// Uniforms to pass to shaders
-// pointlights positions
+// positions of the "white" pointlights
 glm::vec3 lightPositions[] = {
     glm::vec3(5.0f, 10.0f, 10.0f),
     glm::vec3(-5.0f, 10.0f, 10.0f),
     glm::vec3(5.0f, 10.0f, -10.0f),
 };
 
+// number of "white" pointlights
+const GLuint numWhiteLights = sizeof(lightPositions) / sizeof(lightPositions[0]);
+
+// statistics printed on console (activated using the T key)
+FrameStats stats;
+
 // diffusive, specular and ambient components
 GLfloat diffuseColor[] = {1.0f,0.0f,0.0f};
 GLfloat specularColor[] = {1.0f,1.0f,1.0f};
@@ -228,28 +271,44 @@ int main()
     // we print on console the name of the first subroutine used
     PrintCurrentShader(current_subroutine);
 
+    // we create the Shader Programs used for deferred rendering:
+    // - geometry pass (it saves normals and materials in the G-buffer)
+    Shader gbuffer_shader("26_gbuffer.vert", "27_gbuffer.frag");
+    // - lighting pass, for each light (it presents the deferred versions of the subroutines of the illumination shader)
+    Shader light_shader("28_deferred_light.vert", "29_deferred_light.frag");
+    // - ambient component, for all the screen
+    Shader ambient_shader("28_deferred_light.vert", "30_deferred_ambient.frag");
+
     // we load the model(s) (code of Model class is in include/utils/model.h)
     Model cubeModel("../../models/cube.obj");
     Model sphereModel("../../models/sphere.obj");
     Model bunnyModel("../../models/bunny_lp.obj");
     Model planeModel("../../models/plane.obj");
 
+    // we create the G-buffer, with the same dimensions of the frame buffer
+    GBuffer gbuffer(width, height);
+    // the fullscreen triangle is generated in the vertex shader, but in Core profile a VAO must be bound anyway
+    GLuint fullscreenVAO;
+    glGenVertexArrays(1, &fullscreenVAO);
+    // we create the list of lights
+    SetupLights();
+
     // Projection matrix: FOV angle, aspect ratio, near and far planes
     glm::mat4 projection = glm::perspective(45.0f, (float)screenWidth/(float)screenHeight, 0.1f, 10000.0f);
+    // in deferred rendering, we need the inverse of the projection matrix to reconstruct the positions from the depth
+    glm::mat4 inverseProjection = glm::inverse(projection);
+
+    // clustered forward rendering: grid of 16x9x24 clusters, with exponential slices between 1 and 100 units from the camera
+    // N.B.) we use the same FOV value passed to glm::perspective (GLM interprets it in radians)
+    LightClusters clusters(16, 9, 24);
+    clusters.SetProjection(45.0f, (float)screenWidth/(float)screenHeight, 1.0f, 100.0f);
+    // the pool of threads used to build the lists of lights
+    JobSystem jobSystem;
+    stats.enabled = false;
 
     // View matrix: the camera moves, so we just set to indentity now
     glm::mat4 view = glm::mat4(1.0f);
 
-    // Model and Normal transformation matrices for the objects in the scene: we set to identity
-    glm::mat4 sphereModelMatrix = glm::mat4(1.0f);
-    glm::mat3 sphereNormalMatrix = glm::mat3(1.0f);
-    glm::mat4 cubeModelMatrix = glm::mat4(1.0f);
-    glm::mat3 cubeNormalMatrix = glm::mat3(1.0f);
-    glm::mat4 bunnyModelMatrix = glm::mat4(1.0f);
-    glm::mat3 bunnyNormalMatrix = glm::mat3(1.0f);
-    glm::mat4 planeModelMatrix = glm::mat4(1.0f);
-    glm::mat3 planeNormalMatrix = glm::mat3(1.0f);
-
     // Rendering loop: this code is executed at each frame
     while(!glfwWindowShouldClose(window))
     {
@@ -280,148 +339,281 @@ int main()
         if (spinning)
             orientationY+=(deltaTime*spin_speed);
 
-        /////////////////// PLANE ////////////////////////////////////////////////
-        // We render a plane under the objects. We apply the Blinn-Phong model only, and we do not apply the rotation applied to the other objects.
-        illumination_shader.Use();
-        // we search inside the Shader Program the name of the subroutine, and we get the numerical index
-        GLuint index = glGetSubroutineIndex(illumination_shader.Program, GL_FRAGMENT_SHADER, "BlinnPhong_ML");
-        // we activate the subroutine using the index (this is where shaders swapping happens)
-        glUniformSubroutinesuiv( GL_FRAGMENT_SHADER, 1, &index);
-
-        // we determine the position in the Shader Program of the uniform variables
-        matDiffuseLocation = glGetUniformLocation(illumination_shader.Program, "diffuseColor");
-        matAmbientLocation = glGetUniformLocation(illumination_shader.Program, "ambientColor");
-        matSpecularLocation = glGetUniformLocation(illumination_shader.Program, "specularColor");
-        kaLocation = glGetUniformLocation(illumination_shader.Program, "Ka");
-        kdLocation = glGetUniformLocation(illumination_shader.Program, "Kd");
-        ksLocation = glGetUniformLocation(illumination_shader.Program, "Ks");
-        shineLocation = glGetUniformLocation(illumination_shader.Program, "shininess");
-        alphaLocation = glGetUniformLocation(illumination_shader.Program, "alpha");
-        f0Location = glGetUniformLocation(illumination_shader.Program, "F0");
-
-         // we assign the value to the uniform variables
-        glUniform3fv(matAmbientLocation, 1, ambientColor);
-        glUniform3fv(matSpecularLocation, 1, specularColor);
-        glUniform1f(shineLocation, shininess);
-        glUniform1f(alphaLocation, alpha);
-        glUniform1f(f0Location, F0);
-        // for the plane, we make it mainly Lambertian, by setting at 0 the specular component
-        glUniform1f(kaLocation, 0.0f);
-        glUniform1f(kdLocation, 0.6f);
-        glUniform1f(ksLocation, 0.0f);
-
-        // we pass projection and view matrices to the Shader Program
-        glUniformMatrix4fv(glGetUniformLocation(illumination_shader.Program, "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(projection));
-        glUniformMatrix4fv(glGetUniformLocation(illumination_shader.Program, "viewMatrix"), 1, GL_FALSE, glm::value_ptr(view));
-
-        string number;
-        // we pass each light position to the shader
-        for (GLuint i = 0; i < NR_LIGHTS; i++)
+        if (!deferred)
         {
-            number = to_string(i);
-            glUniform3fv(glGetUniformLocation(illumination_shader.Program, ("lights[" + number + "]").c_str()), 1, glm::value_ptr(lightPositions[i]));
+            /////////////////// FORWARD RENDERING ////////////////////////////////////////////////
+            // each fragment of each object considers only the lights of its cluster
+            // we build the lists of lights of the clusters, and we upload them on the GPU
+            double start = FrameStats::Now();
+            clusters.Build(jobSystem, lights, view);
+            stats.Add("light binning CPU ms", FrameStats::Now() - start);
+            stats.Add("lights/cluster", (double)clusters.numIndices / (clusters.dimX * clusters.dimY * clusters.dimZ));
+            clusters.Upload();
+
+            illumination_shader.Use();
+
+            // we pass projection and view matrices to the Shader Program
+            glUniformMatrix4fv(glGetUniformLocation(illumination_shader.Program, "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(projection));
+            glUniformMatrix4fv(glGetUniformLocation(illumination_shader.Program, "viewMatrix"), 1, GL_FALSE, glm::value_ptr(view));
+
+            // we bind the lists of lights to the texture units 0, 1, 2
+            clusters.Bind(illumination_shader.Program, 0, width, height);
+            // the attenuation is applied only in the stress scene
+            glUniform1i(glGetUniformLocation(illumination_shader.Program, "useAttenuation"), stressScene);
+
+            RenderObjects(illumination_shader, planeModel, cubeModel, sphereModel, bunnyModel, view, FORWARD_PASS);
+        }
+        else
+        {
+            /////////////////// DEFERRED RENDERING ////////////////////////////////////////////////
+            // GEOMETRY PASS: we save normals and materials of the visible surfaces in the G-buffer
+            gbuffer.BindForWriting();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            gbuffer_shader.Use();
+            glUniformMatrix4fv(glGetUniformLocation(gbuffer_shader.Program, "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(projection));
+            glUniformMatrix4fv(glGetUniformLocation(gbuffer_shader.Program, "viewMatrix"), 1, GL_FALSE, glm::value_ptr(view));
+            RenderObjects(gbuffer_shader, planeModel, cubeModel, sphereModel, bunnyModel, view, GEOMETRY_PASS);
+
+            // LIGHTING PASS: we render in the FBO of the lighting pass, which has a copy of the depth of the G-buffer as depth buffer
+            gbuffer.BindForLighting();
+            // the light volumes are always rendered in fill mode
+            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            // the ambient component covers the whole screen: it does not need the depth test
+            glDisable(GL_DEPTH_TEST);
+
+            // AMBIENT COMPONENT: a fullscreen triangle, without vertex buffer
+            ambient_shader.Use();
+            gbuffer.BindForReading(ambient_shader.Program);
+            glUniform2f(glGetUniformLocation(ambient_shader.Program, "screenSize"), (GLfloat)width, (GLfloat)height);
+            glUniform3fv(glGetUniformLocation(ambient_shader.Program, "ambientColor"), 1, ambientColor);
+            glUniform1i(glGetUniformLocation(ambient_shader.Program, "fullscreen"), 1);
+            glBindVertexArray(fullscreenVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            glBindVertexArray(0);
+
+            // LIGHTS: the contributions of the lights are summed using additive blending
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE);
+            // we render the back faces of the light volumes: in this way, each pixel is shaded once for each light, even if the camera is inside the volume
+            glEnable(GL_CULL_FACE);
+            glCullFace(GL_FRONT);
+            // a back face passes the depth test only where the visible surface is in front of it (= the surface can be inside the volume). The depth buffer is not modified.
+            // With depth clamping, the back faces beyond the far plane are not clipped
+            glEnable(GL_DEPTH_TEST);
+            glDepthFunc(GL_GEQUAL);
+            glDepthMask(GL_FALSE);
+            glEnable(GL_DEPTH_CLAMP);
+
+            light_shader.Use();
+            // we activate the deferred version of the subroutine currently selected (e.g., "GGX_ML" -> "GGX_Deferred")
+            string name = shaders[current_subroutine];
+            name = name.substr(0, name.rfind("_ML")) + "_Deferred";
+            GLuint index = glGetSubroutineIndex(light_shader.Program, GL_FRAGMENT_SHADER, name.c_str());
+            glUniformSubroutinesuiv( GL_FRAGMENT_SHADER, 1, &index);
+
+            gbuffer.BindForReading(light_shader.Program);
+            glUniformMatrix4fv(glGetUniformLocation(light_shader.Program, "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(projection));
+            glUniformMatrix4fv(glGetUniformLocation(light_shader.Program, "viewMatrix"), 1, GL_FALSE, glm::value_ptr(view));
+            glUniformMatrix4fv(glGetUniformLocation(light_shader.Program, "inverseProjectionMatrix"), 1, GL_FALSE, glm::value_ptr(inverseProjection));
+            glUniform2f(glGetUniformLocation(light_shader.Program, "screenSize"), (GLfloat)width, (GLfloat)height);
+            glUniform3fv(glGetUniformLocation(light_shader.Program, "specularColor"), 1, specularColor);
+            glUniform1i(glGetUniformLocation(light_shader.Program, "fullscreen"), 0);
+            glUniform1i(glGetUniformLocation(light_shader.Program, "useAttenuation"), stressScene);
+
+            GLint volumeCenterLocation = glGetUniformLocation(light_shader.Program, "volumeCenter");
+            GLint volumeRadiusLocation = glGetUniformLocation(light_shader.Program, "volumeRadius");
+            GLint lightPositionLocation = glGetUniformLocation(light_shader.Program, "lightPosition");
+            GLint lightColorLocation = glGetUniformLocation(light_shader.Program, "lightColor");
+            GLint lightRadiusLocation = glGetUniformLocation(light_shader.Program, "lightRadius");
+
+            for (size_t i = 0; i < lights.size(); i++)
+            {
+                // the sphere mesh is a polyhedron inscribed in the unit sphere: we enlarge it a bit, so that it contains the whole sphere of influence
+                glUniform3fv(volumeCenterLocation, 1, glm::value_ptr(lights[i].position));
+                glUniform1f(volumeRadiusLocation, lights[i].radius * 1.1f);
+                // the lighting is calculated in view coordinates
+                glm::vec3 lightViewPosition = glm::vec3(view * glm::vec4(lights[i].position, 1.0f));
+                glUniform3fv(lightPositionLocation, 1, glm::value_ptr(lightViewPosition));
+                glUniform3fv(lightColorLocation, 1, glm::value_ptr(lights[i].color));
+                glUniform1f(lightRadiusLocation, lights[i].radius);
+
+                sphereModel.Draw();
+            }
+
+            // we restore the default state
+            glDisable(GL_CULL_FACE);
+            glCullFace(GL_BACK);
+            glDisable(GL_BLEND);
+            glDepthFunc(GL_LESS);
+            glDepthMask(GL_TRUE);
+            glDisable(GL_DEPTH_CLAMP);
+
+            // we copy the result in the default framebuffer
+            gbuffer.ResolveLighting();
         }
-
-        // the only difference with the other objects is the diffuse color of the plane (green)
-        // we assign green here, we will change to red for the other objects
-        glUniform3fv(matDiffuseLocation, 1, planeMaterial);
-
-        // we create the transformation matrix
-        // we reset to identity at each frame
-        planeModelMatrix = glm::mat4(1.0f);
-        planeNormalMatrix = glm::mat3(1.0f);
-        planeModelMatrix = glm::translate(planeModelMatrix, glm::vec3(0.0f, -1.0f, 0.0f));
-        planeModelMatrix = glm::scale(planeModelMatrix, glm::vec3(10.0f, 1.0f, 10.0f));
-        planeNormalMatrix = glm::inverseTranspose(glm::mat3(view*planeModelMatrix));
-        glUniformMatrix4fv(glGetUniformLocation(illumination_shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(planeModelMatrix));
-        glUniformMatrix3fv(glGetUniformLocation(illumination_shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(planeNormalMatrix));
-
-        // we render the plane
-        planeModel.Draw();
-
-
-        /////////////////// OBJECTS ////////////////////////////////////////////////
-        // we search inside the Shader Program the name of the subroutine currently selected, and we get the numerical index
-        index = glGetSubroutineIndex(illumination_shader.Program, GL_FRAGMENT_SHADER, shaders[current_subroutine].c_str());
-        // we activate the subroutine using the index (this is where shaders swapping happens)
-        glUniformSubroutinesuiv( GL_FRAGMENT_SHADER, 1, &index);
-
-        // we assign red as diffuse color for the objects here
-        glUniform3fv(matDiffuseLocation, 1, diffuseColor);
-        // we set other parameters for the objects
-        glUniform1f(ksLocation, Ka);
-        glUniform1f(ksLocation, Kd);
-        glUniform1f(ksLocation, Ks);
-
-        // SPHERE
-        /*
-          we create the transformation matrix
-
-          N.B.) the last defined is the first applied
-
-          We need also the matrix for normals transformation, which is the inverse of the transpose of the 3x3 submatrix (upper left) of the modelview. We do not consider the 4th column because we do not need translations for normals.
-          An explanation (where XT means the transpose of X, etc):
-            "Two column vectors X and Y are perpendicular if and only if XT.Y=0. If We're going to transform X by a matrix M, we need to transform Y by some matrix N so that (M.X)T.(N.Y)=0. Using the identity (A.B)T=BT.AT, this becomes (XT.MT).(N.Y)=0 => XT.(MT.N).Y=0. If MT.N is the identity matrix then this reduces to XT.Y=0. And MT.N is the identity matrix if and only if N=(MT)-1, i.e. N is the inverse of the transpose of M.
-
-        */
-
-        // we reset to identity at each frame
-        sphereModelMatrix = glm::mat4(1.0f);
-        sphereNormalMatrix = glm::mat3(1.0f);
-        sphereModelMatrix = glm::translate(sphereModelMatrix, glm::vec3(-3.0f, 0.0f, 0.0f));
-        sphereModelMatrix = glm::rotate(sphereModelMatrix, glm::radians(orientationY), glm::vec3(0.0f, 1.0f, 0.0f));
-        sphereModelMatrix = glm::scale(sphereModelMatrix, glm::vec3(0.8f, 0.8f, 0.8f));
-        // if we cast a mat4 to a mat3, we are automatically considering the upper left 3x3 submatrix
-        sphereNormalMatrix = glm::inverseTranspose(glm::mat3(view*sphereModelMatrix));
-        glUniformMatrix4fv(glGetUniformLocation(illumination_shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(sphereModelMatrix));
-        glUniformMatrix3fv(glGetUniformLocation(illumination_shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(sphereNormalMatrix));
-
-        // we render the sphere
-        sphereModel.Draw();
-
-        //CUBE
-        // we create the transformation matrix and the normals transformation matrix
-        // we reset to identity at each frame
-        cubeModelMatrix = glm::mat4(1.0f);
-        cubeNormalMatrix = glm::mat3(1.0f);
-        cubeModelMatrix = glm::translate(cubeModelMatrix, glm::vec3(0.0f, 0.0f, 0.0f));
-        cubeModelMatrix = glm::rotate(cubeModelMatrix, glm::radians(orientationY), glm::vec3(0.0f, 1.0f, 0.0f));
-        cubeModelMatrix = glm::scale(cubeModelMatrix, glm::vec3(0.8f, 0.8f, 0.8f));
-        cubeNormalMatrix = glm::inverseTranspose(glm::mat3(view*cubeModelMatrix));
-        glUniformMatrix4fv(glGetUniformLocation(illumination_shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(cubeModelMatrix));
-        glUniformMatrix3fv(glGetUniformLocation(illumination_shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(cubeNormalMatrix));
-
-        // we render the cube
-        cubeModel.Draw();
-
-        //BUNNY
-        // we create the transformation matrix and the normals transformation matrix
-        // we reset to identity at each frame
-        bunnyModelMatrix = glm::mat4(1.0f);
-        bunnyNormalMatrix = glm::mat3(1.0f);
-        bunnyModelMatrix = glm::translate(bunnyModelMatrix, glm::vec3(3.0f, 0.0f, 0.0f));
-        bunnyModelMatrix = glm::rotate(bunnyModelMatrix, glm::radians(orientationY), glm::vec3(0.0f, 1.0f, 0.0f));
-        bunnyModelMatrix = glm::scale(bunnyModelMatrix, glm::vec3(0.3f, 0.3f, 0.3f));
-        bunnyNormalMatrix = glm::inverseTranspose(glm::mat3(view*bunnyModelMatrix));
-        glUniformMatrix4fv(glGetUniformLocation(illumination_shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(bunnyModelMatrix));
-        glUniformMatrix3fv(glGetUniformLocation(illumination_shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(bunnyNormalMatrix));
-
-        // we render the bunny
-        bunnyModel.Draw();
 
         // Swapping back and front buffers
         glfwSwapBuffers(window);
+
+        // if activated, the statistics are printed every second
+        stats.EndFrame();
     }
 
     // when I exit from the graphics loop, it is because the application is closing
-    // we delete the Shader Program
+    // we delete the Shader Programs
     illumination_shader.Delete();
+    gbuffer_shader.Delete();
+    light_shader.Delete();
+    ambient_shader.Delete();
+    glDeleteVertexArrays(1, &fullscreenVAO);
     // we close and delete the created context
     glfwTerminate();
     return 0;
 }
 
 
+//////////////////////////////////////////
+// we render the plane and the objects. In the FORWARD_PASS, the illumination models are applied using the subroutines of the shader, while in the GEOMETRY_PASS the material parameters are saved in the G-buffer
+void RenderObjects(Shader &shader, Model &planeModel, Model &cubeModel, Model &sphereModel, Model &bunnyModel, glm::mat4 &view, render_passes render_pass)
+{
+    // Model and Normal transformation matrices for the objects in the scene
+    glm::mat4 planeModelMatrix, sphereModelMatrix, cubeModelMatrix, bunnyModelMatrix;
+    glm::mat3 planeNormalMatrix, sphereNormalMatrix, cubeNormalMatrix, bunnyNormalMatrix;
+    GLuint index;
+
+    /////////////////// PLANE ////////////////////////////////////////////////
+    // We render a plane under the objects. We apply the Blinn-Phong model only, and we do not apply the rotation applied to the other objects.
+    // N.B.) in deferred rendering, the illumination model is chosen in the lighting pass, and it is the same for all the objects
+    if (render_pass==FORWARD_PASS)
+    {
+        // we search inside the Shader Program the name of the subroutine, and we get the numerical index
+        index = glGetSubroutineIndex(shader.Program, GL_FRAGMENT_SHADER, "BlinnPhong_ML");
+        // we activate the subroutine using the index (this is where shaders swapping happens)
+        glUniformSubroutinesuiv( GL_FRAGMENT_SHADER, 1, &index);
+    }
+
+    // we determine the position in the Shader Program of the uniform variables
+    matDiffuseLocation = glGetUniformLocation(shader.Program, "diffuseColor");
+    matAmbientLocation = glGetUniformLocation(shader.Program, "ambientColor");
+    matSpecularLocation = glGetUniformLocation(shader.Program, "specularColor");
+    kaLocation = glGetUniformLocation(shader.Program, "Ka");
+    kdLocation = glGetUniformLocation(shader.Program, "Kd");
+    ksLocation = glGetUniformLocation(shader.Program, "Ks");
+    shineLocation = glGetUniformLocation(shader.Program, "shininess");
+    alphaLocation = glGetUniformLocation(shader.Program, "alpha");
+    f0Location = glGetUniformLocation(shader.Program, "F0");
+
+     // we assign the value to the uniform variables
+    glUniform3fv(matAmbientLocation, 1, ambientColor);
+    glUniform3fv(matSpecularLocation, 1, specularColor);
+    glUniform1f(shineLocation, shininess);
+    glUniform1f(alphaLocation, alpha);
+    glUniform1f(f0Location, F0);
+    // for the plane, we make it mainly Lambertian, by setting at 0 the specular component
+    glUniform1f(kaLocation, 0.0f);
+    glUniform1f(kdLocation, 0.6f);
+    glUniform1f(ksLocation, 0.0f);
+
+    // the only difference with the other objects is the diffuse color of the plane (green)
+    // we assign green here, we will change to red for the other objects
+    glUniform3fv(matDiffuseLocation, 1, planeMaterial);
+
+    // we create the transformation matrix
+    planeModelMatrix = glm::mat4(1.0f);
+    planeModelMatrix = glm::translate(planeModelMatrix, glm::vec3(0.0f, -1.0f, 0.0f));
+    planeModelMatrix = glm::scale(planeModelMatrix, glm::vec3(10.0f, 1.0f, 10.0f));
+    planeNormalMatrix = glm::inverseTranspose(glm::mat3(view*planeModelMatrix));
+    glUniformMatrix4fv(glGetUniformLocation(shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(planeModelMatrix));
+    glUniformMatrix3fv(glGetUniformLocation(shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(planeNormalMatrix));
+
+    // we render the plane
+    planeModel.Draw();
+
+
+    /////////////////// OBJECTS ////////////////////////////////////////////////
+    if (render_pass==FORWARD_PASS)
+    {
+        // we search inside the Shader Program the name of the subroutine currently selected, and we get the numerical index
+        index = glGetSubroutineIndex(shader.Program, GL_FRAGMENT_SHADER, shaders[current_subroutine].c_str());
+        // we activate the subroutine using the index (this is where shaders swapping happens)
+        glUniformSubroutinesuiv( GL_FRAGMENT_SHADER, 1, &index);
+    }
+
+    // we assign red as diffuse color for the objects here
+    glUniform3fv(matDiffuseLocation, 1, diffuseColor);
+    // we set other parameters for the objects
+    glUniform1f(kaLocation, Ka);
+    glUniform1f(kdLocation, Kd);
+    glUniform1f(ksLocation, Ks);
+
+    // SPHERE
+    /*
+      we create the transformation matrix
+
+      N.B.) the last defined is the first applied
+
+      We need also the matrix for normals transformation, which is the inverse of the transpose of the 3x3 submatrix (upper left) of the modelview. We do not consider the 4th column because we do not need translations for normals.
+      An explanation (where XT means the transpose of X, etc):
+        "Two column vectors X and Y are perpendicular if and only if XT.Y=0. If We're going to transform X by a matrix M, we need to transform Y by some matrix N so that (M.X)T.(N.Y)=0. Using the identity (A.B)T=BT.AT, this becomes (XT.MT).(N.Y)=0 => XT.(MT.N).Y=0. If MT.N is the identity matrix then this reduces to XT.Y=0. And MT.N is the identity matrix if and only if N=(MT)-1, i.e. N is the inverse of the transpose of M.
+
+    */
+    sphereModelMatrix = glm::mat4(1.0f);
+    sphereModelMatrix = glm::translate(sphereModelMatrix, glm::vec3(-3.0f, 0.0f, 0.0f));
+    sphereModelMatrix = glm::rotate(sphereModelMatrix, glm::radians(orientationY), glm::vec3(0.0f, 1.0f, 0.0f));
+    sphereModelMatrix = glm::scale(sphereModelMatrix, glm::vec3(0.8f, 0.8f, 0.8f));
+    // if we cast a mat4 to a mat3, we are automatically considering the upper left 3x3 submatrix
+    sphereNormalMatrix = glm::inverseTranspose(glm::mat3(view*sphereModelMatrix));
+    glUniformMatrix4fv(glGetUniformLocation(shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(sphereModelMatrix));
+    glUniformMatrix3fv(glGetUniformLocation(shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(sphereNormalMatrix));
+
+    // we render the sphere
+    sphereModel.Draw();
+
+    //CUBE
+    // we create the transformation matrix and the normals transformation matrix
+    cubeModelMatrix = glm::mat4(1.0f);
+    cubeModelMatrix = glm::translate(cubeModelMatrix, glm::vec3(0.0f, 0.0f, 0.0f));
+    cubeModelMatrix = glm::rotate(cubeModelMatrix, glm::radians(orientationY), glm::vec3(0.0f, 1.0f, 0.0f));
+    cubeModelMatrix = glm::scale(cubeModelMatrix, glm::vec3(0.8f, 0.8f, 0.8f));
+    cubeNormalMatrix = glm::inverseTranspose(glm::mat3(view*cubeModelMatrix));
+    glUniformMatrix4fv(glGetUniformLocation(shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(cubeModelMatrix));
+    glUniformMatrix3fv(glGetUniformLocation(shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(cubeNormalMatrix));
+
+    // we render the cube
+    cubeModel.Draw();
+
+    //BUNNY
+    // we create the transformation matrix and the normals transformation matrix
+    bunnyModelMatrix = glm::mat4(1.0f);
+    bunnyModelMatrix = glm::translate(bunnyModelMatrix, glm::vec3(3.0f, 0.0f, 0.0f));
+    bunnyModelMatrix = glm::rotate(bunnyModelMatrix, glm::radians(orientationY), glm::vec3(0.0f, 1.0f, 0.0f));
+    bunnyModelMatrix = glm::scale(bunnyModelMatrix, glm::vec3(0.3f, 0.3f, 0.3f));
+    bunnyNormalMatrix = glm::inverseTranspose(glm::mat3(view*bunnyModelMatrix));
+    glUniformMatrix4fv(glGetUniformLocation(shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(bunnyModelMatrix));
+    glUniformMatrix3fv(glGetUniformLocation(shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(bunnyNormalMatrix));
+
+    // we render the bunny
+    bunnyModel.Draw();
+}
+
+//////////////////////////////////////////
+// we create the list of lights: the "white" lights (with a radius large enough to cover the whole scene),
+// plus, in the stress scene, numRandomLights small colored lights placed above the plane
+void SetupLights()
+{
+    lights.clear();
+    for (GLuint i = 0; i < numWhiteLights; i++)
+    {
+        PointLight light;
+        light.position = lightPositions[i];
+        light.color = glm::vec3(1.0f);
+        light.radius = 50.0f;
+        lights.push_back(light);
+    }
+    if (stressScene)
+        GenerateRandomLights(lights, numRandomLights, glm::vec3(-12.0f, -0.8f, -12.0f), glm::vec3(12.0f, 1.5f, 12.0f), 1.5f, 4.0f);
+}
+
 ///////////////////////////////////////////
 // The function parses the content of the Shader Program, searches for the Subroutine type names,
 // the subroutines implemented for each type, print the names of the subroutines on the terminal, and add the names of
@@ -494,6 +686,39 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     if(key == GLFW_KEY_L && action == GLFW_PRESS)
         wireframe=!wireframe;
 
+    // if G is pressed, we switch between forward and deferred rendering
+    if(key == GLFW_KEY_G && action == GLFW_PRESS)
+    {
+        deferred=!deferred;
+        std::cout << (deferred ? "Deferred rendering" : "Clustered forward rendering") << " - lights: " << lights.size() << std::endl;
+    }
+
+    // if C is pressed, we activate/deactivate the stress scene
+    if(key == GLFW_KEY_C && action == GLFW_PRESS)
+    {
+        stressScene=!stressScene;
+        SetupLights();
+        std::cout << "Stress scene: " << (stressScene ? "ON" : "OFF") << " - lights: " << lights.size() << std::endl;
+    }
+
+    // if T is pressed, we activate/deactivate the statistics
+    if(key == GLFW_KEY_T && action == GLFW_PRESS)
+        stats.enabled = !stats.enabled;
+
+    // if + or - are pressed, we double or halve the number of small colored lights (they are used only in the stress scene)
+    if((key == GLFW_KEY_EQUAL || key == GLFW_KEY_KP_ADD) && action == GLFW_PRESS && numRandomLights < MAX_RANDOM_LIGHTS)
+    {
+        numRandomLights = (numRandomLights == 0 ? 1 : numRandomLights*2);
+        SetupLights();
+        std::cout << "Lights: " << lights.size() << std::endl;
+    }
+    if((key == GLFW_KEY_MINUS || key == GLFW_KEY_KP_SUBTRACT) && action == GLFW_PRESS && numRandomLights > 0)
+    {
+        numRandomLights /= 2;
+        SetupLights();
+        std::cout << "Lights: " << lights.size() << std::endl;
+    }
+
     // pressing a key number, we change the shader applied to the models
     // if the key is between 1 and 9, we proceed and check if the pressed key corresponds to
     // a valid subroutine
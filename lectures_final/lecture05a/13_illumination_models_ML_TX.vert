@@ -59,6 +59,9 @@ out vec3 vViewPosition;
 // the output variable for UV coordinates
 out vec2 interp_UV;
 
+// position in world coordinates, used for the lookup in the cube shadow maps of the lights
+out vec3 vWorldPosition;
+
 
 void main(){
 
@@ -66,6 +69,9 @@ void main(){
   // when I need to use coordinates in camera coordinates, I need to split the application of model and view transformations from the projection transformations
   vec4 mvPosition = viewMatrix * modelMatrix * vec4( position, 1.0 );
 
+  // vertex position in world coordinates
+  vWorldPosition = vec3(modelMatrix * vec4( position, 1.0 ));
+
   // view direction, negated to have vector from the vertex to the camera
   vViewPosition = -mvPosition.xyz;
 
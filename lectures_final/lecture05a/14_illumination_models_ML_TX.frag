@@ -11,6 +11,10 @@ N.B. 4)  only Blinn-Phong and GGX illumination models are considered in this sha
 
 N.B. 5) see note 2 in the vertex shader for considerations on multiple lights management
 
+N.B. 6) if shadowsEnabled = 1, the contribution of each light is weighted by the result of the shadow test on its cube shadow map (see include/utils/point_shadows.h)
+
+N.B. 7) if useAtlas = 1, the shadow maps of the faces are read from the tiles of a shadow atlas (see include/utils/shadow_atlas.h) instead of the cube map array
+
 author: Davide Gadia
 
 Real-Time Graphics Programming - a.a. 2024/2025
@@ -40,6 +44,31 @@ in vec3 vViewPosition;
 // interpolated texture coordinates
 in vec2 interp_UV;
 
+// position in world coordinates
+in vec3 vWorldPosition;
+
+// lights positions (the same uniform of the vertex shader)
+uniform vec3 lights[NR_LIGHTS];
+
+// cube shadow maps of the lights (layer i = light i). It is a "shadow" sampler: the result of a fetch is the (filtered) result of the shadow test
+uniform samplerCubeArrayShadow pointShadows;
+// far plane used for the cube shadow maps (the distances saved in the maps are divided by this value)
+uniform float shadowFarPlane;
+// 1 = shadows are considered
+uniform int shadowsEnabled;
+
+// shadow atlas: the shadow maps of the 6 faces of all the lights, in the tiles of a single 2D depth texture
+uniform sampler2DShadow shadowAtlas;
+// 1 = the shadow atlas is used instead of the cube map array
+uniform int useAtlas;
+// matrices of the faces (element 6 * light + face), and tiles in UV coordinates (x, y, width, height; width = 0 if the face has no tile)
+// N.B.) the dimension of the arrays must be equal to the maxTiles parameter of the ShadowAtlas class
+layout (std140) uniform ShadowAtlasData
+{
+    mat4 atlasMatrices[NR_LIGHTS * 6];
+    vec4 atlasTiles[NR_LIGHTS * 6];
+};
+
 // texture repetitions
 uniform float repeat;
 
@@ -72,6 +101,53 @@ subroutine uniform ill_model Illumination_Model_ML_TX;
 
 ////////////////////////////////////////////////////////////////////
 
+//////////////////////////////////////////
+// visibility of the light i using the shadow atlas
+float AtlasShadow(int i)
+{
+    vec3 fromLight = vWorldPosition - lights[i];
+    // we select the face of the cube as in the cube map lookup: the major axis of the direction from the light (faces: +X, -X, +Y, -Y, +Z, -Z)
+    vec3 a = abs(fromLight);
+    int face;
+    if (a.x >= a.y && a.x >= a.z)
+        face = fromLight.x > 0.0 ? 0 : 1;
+    else if (a.y >= a.z)
+        face = fromLight.y > 0.0 ? 2 : 3;
+    else
+        face = fromLight.z > 0.0 ? 4 : 5;
+
+    int idx = i * 6 + face;
+    vec4 tile = atlasTiles[idx];
+    // the face has no tile in the atlas: no shadows
+    if (tile.z == 0.0)
+        return 1.0;
+
+    // we project the fragment on the face, and we map the [0,1] coordinates of the face into the tile
+    vec4 clip = atlasMatrices[idx] * vec4(vWorldPosition, 1.0);
+    vec2 faceUV = clip.xy / clip.w * 0.5 + 0.5;
+    // the coordinates are clamped half a texel inside the tile, so that the bilinear filtering does not read the texels of the adjacent tiles
+    float halfTexel = 0.5 / float(textureSize(shadowAtlas, 0).x);
+    vec2 uv = clamp(tile.xy + faceUV * tile.zw, tile.xy + halfTexel, tile.xy + tile.zw - halfTexel);
+
+    float currentDistance = (length(fromLight) - 0.05) / shadowFarPlane;
+    return texture(shadowAtlas, vec3(uv, currentDistance));
+}
+
+//////////////////////////////////////////
+// visibility of the light i from the fragment: 1 = in light, 0 = in shadow
+float PointShadow(int i)
+{
+    if (shadowsEnabled == 0)
+        return 1.0;
+    if (useAtlas == 1)
+        return AtlasShadow(i);
+    // the direction from the light to the fragment is the lookup vector in the cube map
+    vec3 fromLight = vWorldPosition - lights[i];
+    // we compare the distances (divided by the far plane), with a small bias to avoid shadow acne
+    float currentDistance = (length(fromLight) - 0.05) / shadowFarPlane;
+    return texture(pointShadows, vec4(fromLight, float(i)), currentDistance);
+}
+
 //////////////////////////////////////////
 // a subroutine for the Blinn-Phong model for multiple lights and texturing
 subroutine(ill_model)
@@ -112,7 +188,8 @@ vec4 BlinnPhong_ML_TX() // this name is the one which is detected by the SetupSh
 
             // We add diffusive (= color sampled from texture) and specular components to the final color
             // N.B. ): in this implementation, the sum of the components can be different than 1
-            color += Kd * lambertian * surfaceColor + vec4(Ks * specular * specularColor,1.0);
+            // the contribution of the light is weighted by its visibility
+            color += PointShadow(i) * (Kd * lambertian * surfaceColor + vec4(Ks * specular * specularColor,1.0));
         }
     }
     return color;
@@ -204,7 +281,8 @@ vec4 GGX_ML_TX() // this name is the one which is detected by the SetupShaders()
             //integral of: BRDF * Li * (cosine angle between N and L)
             // BRDF in our case is: the sum of Lambert and GGX
             // Li is considered as equal to 1: light is white, and we have not applied attenuation. With colored lights, and with attenuation, the code must be modified and the Li factor must be multiplied to finalColor
-            color += (lambert + specular)*NdotL;
+            // the contribution of the light is weighted by its visibility
+            color += PointShadow(i) * (lambert + specular)*NdotL;
         }
     }
     return vec4(color,1.0);
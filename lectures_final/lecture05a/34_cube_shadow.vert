@@ -0,0 +1,24 @@
+/*
+34_cube_shadow.vert: vertex shader for the creation of the cube shadow maps of the point lights
+
+It applies only the model transformation: the view and projection transformations of the 6 faces of the cube map are applied in the geometry shader
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#version 410 core
+
+// vertex position in world coordinates
+layout (location = 0) in vec3 position;
+
+// model matrix
+uniform mat4 modelMatrix;
+
+void main()
+{
+    gl_Position = modelMatrix * vec4(position, 1.0);
+}
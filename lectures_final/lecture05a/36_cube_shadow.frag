@@ -0,0 +1,27 @@
+/*
+36_cube_shadow.frag: fragment shader for the creation of the cube shadow maps of the point lights
+
+Instead of the depth of the perspective projection, we save in the cube map the distance of the fragment from the light, divided by the far plane (to have values in [0,1])
+
+N.B.) "34_cube_shadow.vert" must be used as vertex shader, and "35_cube_shadow.geom" as geometry shader
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#version 410 core
+
+// position in world coordinates (from the geometry shader)
+in vec3 worldPosition;
+
+// position of the light (in world coordinates), and far plane of the projections
+uniform vec3 lightPosition;
+uniform float farPlane;
+
+void main()
+{
+    gl_FragDepth = length(worldPosition - lightPosition) / farPlane;
+}
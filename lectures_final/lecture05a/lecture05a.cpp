@@ -21,7 +21,17 @@ https://hub.packtpub.com/opengl-40-using-uniform-blocks-and-uniform-buffer-objec
 
 N.B. 3) we have considered point lights only, the code must be modified for different light sources
 
-N.B. 4) to test different parameters of the shaders, it is convenient to use some GUI library, like e.g. Dear ImGui (https://github.com/ocornut/imgui)
+N.B. 4) omnidirectional shadows for the point lights (H key to activate/deactivate them): the cube shadow maps of all the lights are rendered in a cube map array using layered rendering
+(code in include/utils/point_shadows.h). A geometry shader with 6 invocations sends each triangle to the faces of the cube map, so each object is submitted only once for each light.
+The objects outside the frustums of all the faces are not submitted, and the faces not containing the object are skipped in the geometry shader. Pressing T, the statistics of the shadow pass are printed on console.
+Pressing G, the shadow maps of the faces are rendered in the tiles of a single shadow atlas (code in include/utils/shadow_atlas.h), with dimensions proportional to the importance of the lights on screen:
+the atlas is re-packed at each frame, all the tiles are rendered with a single FBO (each face is sent to its tile using viewport arrays), and the memory does not depend on the number of lights
+
+N.B. 5) the textures are streamed (code in include/utils/texture_streamer.h): the images are decoded in background, and the mipmap levels are uploaded progressively,
+from the smallest to the largest, up to the level needed by the dimension of the texture on screen. Pressing B, the memory budget of the textures is reduced, to show the eviction
+of the top levels. The statistics of the streaming are printed with the ones of the shadow pass (T key)
+
+N.B. 6) to test different parameters of the shaders, it is convenient to use some GUI library, like e.g. Dear ImGui (https://github.com/ocornut/imgui)
 
 author: Davide Gadia
 
@@ -74,6 +84,11 @@ positive Z axis points "outside" the screen
 #include <utils/shader.h>
 #include <utils/model.h>
 #include <utils/camera.h>
+#include <utils/point_shadows.h>
+#include <utils/shadow_atlas.h>
+#include <utils/frame_stats.h>
+#include <utils/job_system.h>
+#include <utils/texture_streamer.h>
 
 // we load the GLM classes used in the application
 #include <glm/glm.hpp>
@@ -108,8 +123,8 @@ void SetupShader(int shader_program);
 // print on console the name of current shader subroutine
 void PrintCurrentShader(int subroutine);
 
-// load image from disk and create an OpenGL texture
-GLint LoadTexture(const char* path);
+// dimension of the tiles in the shadow atlas for a light, based on its importance on screen
+GLuint AtlasTileSize(const glm::vec3& lightPosition);
 
 // we initialize an array of booleans for each keyboard key
 bool keys[1024];
@@ -135,6 +150,15 @@ GLboolean spinning = GL_TRUE;
 // boolean to activate/deactivate wireframe rendering
 GLboolean wireframe = GL_FALSE;
 
+// boolean to activate/deactivate the shadows of the point lights
+GLboolean pointShadowsEnabled = GL_TRUE;
+// boolean to use the shadow atlas instead of the cube map array
+GLboolean useShadowAtlas = GL_FALSE;
+// boolean to use a very small memory budget for the streamed textures
+GLboolean smallTextureBudget = GL_FALSE;
+// statistics of the shadow pass, printed on console every second (T key)
+FrameStats stats;
+
 // we create a camera. We pass the initial position as a parameter to the constructor. The last boolean tells that we want a camera "anchored" to the ground
 Camera camera(glm::vec3(0.0f, 0.0f, 7.0f), GL_TRUE);
 
@@ -226,6 +250,10 @@ int main()
 
     // we create the Shader Program used for objects (which presents different subroutines we can switch)
     Shader illumination_shader = Shader("13_illumination_models_ML_TX.vert", "14_illumination_models_ML_TX.frag");
+    // we create the Shader Program for the cube shadow maps (with a geometry shader for the layered rendering)
+    Shader cube_shadow_shader("34_cube_shadow.vert", "35_cube_shadow.geom", "36_cube_shadow.frag");
+    // we create the Shader Program for the shadow atlas (the geometry shader selects the viewport instead of the layer)
+    Shader atlas_shadow_shader("34_cube_shadow.vert", "37_atlas_shadow.geom", "36_cube_shadow.frag");
     // we parse the Shader Program to search for the number and names of the subroutines.
     // the names are placed in the shaders vector
     SetupShader(illumination_shader.Program);
@@ -237,9 +265,14 @@ int main()
     Model bunnyModel("../../models/bunny_lp.obj");
     Model planeModel("../../models/plane.obj");
 
-    // we load the images and store them in a vector
-    textureID.push_back(LoadTexture("../../textures/UV_Grid_Sm.png"));
-    textureID.push_back(LoadTexture("../../textures/SoilCracked.png"));
+    // we request the images: the textures are available immediately, and their levels are streamed during the rendering
+    // the images are decoded by the workers of the JobSystem
+    JobSystem jobs;
+    TextureStreamer textureStreamer(jobs);
+    vector<StreamedTexture*> streamedTextures;
+    streamedTextures.push_back(textureStreamer.Request("../../textures/UV_Grid_Sm.png"));
+    streamedTextures.push_back(textureStreamer.Request("../../textures/SoilCracked.png"));
+    textureID.resize(streamedTextures.size());
 
     // Projection matrix: FOV angle, aspect ratio, near and far planes
     glm::mat4 projection = glm::perspective(45.0f, (float)screenWidth/(float)screenHeight, 0.1f, 10000.0f);
@@ -257,6 +290,18 @@ int main()
     glm::mat4 planeModelMatrix = glm::mat4(1.0f);
     glm::mat3 planeNormalMatrix = glm::mat3(1.0f);
 
+    // cube shadow maps of the lights: 512x512 texels for each face, and far plane large enough to contain the whole scene
+    PointShadows pointShadows(NR_LIGHTS, 512, 0.1f, 40.0f);
+    // shadow atlas: 2048x2048 texels shared by the 6 faces of all the lights, with tiles between 64x64 and 512x512 texels
+    ShadowAtlas shadowAtlas(2048, 64, 6 * NR_LIGHTS);
+    vector<GLuint> tileRequests(6 * NR_LIGHTS);
+    stats.enabled = false;
+
+    // models, model matrices and bounding spheres (for the per-face culling) of the objects, used in the shadow pass
+    BoundingSphere bounds[4] = { ComputeModelBoundingSphere(planeModel), ComputeModelBoundingSphere(sphereModel), ComputeModelBoundingSphere(cubeModel), ComputeModelBoundingSphere(bunnyModel) };
+    Model* objectModels[4] = { &planeModel, &sphereModel, &cubeModel, &bunnyModel };
+    const glm::mat4* objectMatrices[4] = { &planeModelMatrix, &sphereModelMatrix, &cubeModelMatrix, &bunnyModelMatrix };
+
     // Rendering loop: this code is executed at each frame
     while(!glfwWindowShouldClose(window))
     {
@@ -273,6 +318,140 @@ int main()
         // View matrix (=camera): position, view direction, camera "up" vector
         view = camera.GetViewMatrix();
 
+        // if animated rotation is activated, than we increment the rotation angle using delta time and the rotation speed parameter
+        if (spinning)
+            orientationY+=(deltaTime*spin_speed);
+
+        // we calculate the model matrices of the objects: they are used both in the shadow pass and in the color pass
+        // N.B.) the last defined is the first applied
+        planeModelMatrix = glm::mat4(1.0f);
+        planeModelMatrix = glm::translate(planeModelMatrix, glm::vec3(0.0f, -1.0f, 0.0f));
+        planeModelMatrix = glm::scale(planeModelMatrix, glm::vec3(10.0f, 1.0f, 10.0f));
+
+        sphereModelMatrix = glm::mat4(1.0f);
+        sphereModelMatrix = glm::translate(sphereModelMatrix, glm::vec3(-3.0f, 0.0f, 0.0f));
+        sphereModelMatrix = glm::rotate(sphereModelMatrix, glm::radians(orientationY), glm::vec3(0.0f, 1.0f, 0.0f));
+        sphereModelMatrix = glm::scale(sphereModelMatrix, glm::vec3(0.8f, 0.8f, 0.8f));
+
+        cubeModelMatrix = glm::mat4(1.0f);
+        cubeModelMatrix = glm::translate(cubeModelMatrix, glm::vec3(0.0f, 0.0f, 0.0f));
+        cubeModelMatrix = glm::rotate(cubeModelMatrix, glm::radians(orientationY), glm::vec3(0.0f, 1.0f, 0.0f));
+        cubeModelMatrix = glm::scale(cubeModelMatrix, glm::vec3(0.8f, 0.8f, 0.8f));
+
+        bunnyModelMatrix = glm::mat4(1.0f);
+        bunnyModelMatrix = glm::translate(bunnyModelMatrix, glm::vec3(3.0f, 0.0f, 0.0f));
+        bunnyModelMatrix = glm::rotate(bunnyModelMatrix, glm::radians(orientationY), glm::vec3(0.0f, 1.0f, 0.0f));
+        bunnyModelMatrix = glm::scale(bunnyModelMatrix, glm::vec3(0.3f, 0.3f, 0.3f));
+
+        /////////////////// TEXTURE STREAMING ////////////////////////////////////////////////
+        // we estimate the dimension on screen of the textures. On the plane, the texture is repeated 80 times on 20 units, and the nearest point is under the camera.
+        // On the objects, the texture covers about 1.6 units, and we consider the nearest object
+        GLfloat objectsDistance = glm::min(glm::length(camera.Position - glm::vec3(sphereModelMatrix[3])),
+                                  glm::min(glm::length(camera.Position - glm::vec3(cubeModelMatrix[3])), glm::length(camera.Position - glm::vec3(bunnyModelMatrix[3]))));
+        GLfloat planeDistance = glm::abs(camera.Position.y - planeModelMatrix[3].y);
+        if (streamedTextures[0] != nullptr)
+            textureStreamer.SetScreenSize(streamedTextures[0], TextureStreamer::ProjectedSize(1.6f, objectsDistance, projection[1][1], (GLfloat)height));
+        if (streamedTextures[1] != nullptr)
+            textureStreamer.SetScreenSize(streamedTextures[1], TextureStreamer::ProjectedSize(20.0f / 80.0f, planeDistance, projection[1][1], (GLfloat)height));
+        textureStreamer.memoryBudget = (smallTextureBudget ? 256 * 1024 : 64 * 1024 * 1024);
+        textureStreamer.Update();
+        // the textures can be re-allocated by the streamer: we read them at each frame
+        for (size_t i = 0; i < streamedTextures.size(); i++)
+            textureID[i] = (streamedTextures[i] != nullptr ? streamedTextures[i]->texture : 0);
+        stats.Add("texture KB uploaded", textureStreamer.uploadedBytes / 1024.0);
+        stats.Add("texture memory KB", textureStreamer.MemorySize() / 1024.0);
+        stats.Add("texture levels missing", textureStreamer.MissingLevels());
+
+        /////////////////// SHADOW PASS: SHADOW ATLAS ////////////////////////////////////////////////
+        if (pointShadowsEnabled && useShadowAtlas)
+        {
+            // we calculate the matrices of the faces, and the dimension of the tiles of each light (the same for all its faces)
+            for (GLuint i = 0; i < NR_LIGHTS; i++)
+            {
+                pointShadows.SetLight(i, lightPositions[i]);
+                GLuint tileSize = AtlasTileSize(lightPositions[i]);
+                for (GLuint f = 0; f < 6; f++)
+                    tileRequests[6 * i + f] = tileSize;
+            }
+            // we re-pack the atlas, and we upload the tiles and the matrices in the UBO
+            shadowAtlas.Pack(tileRequests);
+            shadowAtlas.Upload(pointShadows.faceMatrices);
+
+            atlas_shadow_shader.Use();
+            // a single FBO for all the lights: we clear the whole atlas once
+            shadowAtlas.BindForWriting();
+            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            // the scissor test (with a rectangle for each viewport) guarantees that the triangles are not rasterized outside their tiles
+            glEnable(GL_SCISSOR_TEST);
+            for (GLuint i = 0; i < NR_LIGHTS; i++)
+            {
+                // the viewport f is set on the tile of the face f, and we exclude from the rendering the faces without a tile
+                GLuint tileMask = 0;
+                for (GLuint f = 0; f < 6; f++)
+                {
+                    const AtlasTile& tile = shadowAtlas.tiles[6 * i + f];
+                    if (tile.size == 0)
+                    {
+                        stats.Add("atlas faces without tile", 1);
+                        continue;
+                    }
+                    shadowAtlas.SetViewport(f, tile);
+                    tileMask |= (1u << f);
+                }
+                pointShadows.SetLightUniforms(atlas_shadow_shader.Program, i, lightPositions[i]);
+                for (GLuint o = 0; o < 4; o++)
+                {
+                    GLuint faceMask = tileMask & pointShadows.FaceMask(i, TransformBoundingSphere(bounds[o], *objectMatrices[o]));
+                    if (faceMask == 0)
+                        continue;
+                    glUniformMatrix4fv(glGetUniformLocation(atlas_shadow_shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(*objectMatrices[o]));
+                    glUniform1i(glGetUniformLocation(atlas_shadow_shader.Program, "faceMask"), faceMask);
+                    objectModels[o]->Draw();
+                    stats.Add("shadow draw calls", 1);
+                }
+            }
+            glDisable(GL_SCISSOR_TEST);
+            stats.Add("atlas occupancy %", 100.0f * shadowAtlas.Occupancy());
+            // we activate back the standard Frame Buffer (glViewport sets all the viewports of the array)
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, width, height);
+        }
+
+        /////////////////// SHADOW PASS: CUBE SHADOW MAPS OF THE POINT LIGHTS ////////////////////////////////////////////////
+        else if (pointShadowsEnabled)
+        {
+            cube_shadow_shader.Use();
+            // we activate the FBO with the cube map array, and we clear all the faces
+            pointShadows.BindForWriting();
+            // the shadow maps are always rendered with filled polygons
+            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            for (GLuint i = 0; i < NR_LIGHTS; i++)
+            {
+                pointShadows.SetLight(i, lightPositions[i]);
+                pointShadows.SetLightUniforms(cube_shadow_shader.Program, i, lightPositions[i]);
+                for (GLuint o = 0; o < 4; o++)
+                {
+                    // per-face culling: the object is submitted only if its bounding sphere is inside the frustum of at least one face
+                    GLuint faceMask = pointShadows.FaceMask(i, TransformBoundingSphere(bounds[o], *objectMatrices[o]));
+                    GLuint faces = 0;
+                    for (GLuint f = 0; f < 6; f++)
+                        faces += (faceMask >> f) & 1;
+                    stats.Add("shadow faces rendered", faces);
+                    stats.Add("shadow faces culled", 6 - faces);
+                    if (faceMask == 0)
+                        continue;
+                    glUniformMatrix4fv(glGetUniformLocation(cube_shadow_shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(*objectMatrices[o]));
+                    glUniform1i(glGetUniformLocation(cube_shadow_shader.Program, "faceMask"), faceMask);
+                    // a single submission for all the faces of the cube map
+                    objectModels[o]->Draw();
+                    stats.Add("shadow draw calls", 1);
+                }
+            }
+            // we activate back the standard Frame Buffer
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, width, height);
+        }
+
         // we "clear" the frame and z buffer
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -283,10 +462,6 @@ int main()
         else
             glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-        // if animated rotation is activated, than we increment the rotation angle using delta time and the rotation speed parameter
-        if (spinning)
-            orientationY+=(deltaTime*spin_speed);
-
         /////////////////// PLANE ////////////////////////////////////////////////
          // We render a plane under the objects. We apply the Blinn-Phong model only, and we do not apply the rotation applied to the other objects.
         illumination_shader.Use();
@@ -322,6 +497,13 @@ int main()
         glUniformMatrix4fv(glGetUniformLocation(illumination_shader.Program, "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(projection));
         glUniformMatrix4fv(glGetUniformLocation(illumination_shader.Program, "viewMatrix"), 1, GL_FALSE, glm::value_ptr(view));
 
+        // we bind the cube shadow maps to the texture unit 2
+        pointShadows.BindForReading(illumination_shader.Program, 2);
+        // we bind the shadow atlas to the texture unit 3, and its UBO to the binding point 0
+        shadowAtlas.BindForReading(illumination_shader.Program, 3, 0);
+        glUniform1i(glGetUniformLocation(illumination_shader.Program, "useAtlas"), useShadowAtlas);
+        glUniform1i(glGetUniformLocation(illumination_shader.Program, "shadowsEnabled"), pointShadowsEnabled);
+
         string number;
         // we pass each light position to the shader
         for (GLuint i = 0; i < NR_LIGHTS; i++)
@@ -338,12 +520,7 @@ int main()
         glUniform1i(textureLocation, 1);
         glUniform1f(repeatLocation, 80.0f);
 
-        // we create the transformation matrix
-        // we reset to identity at each frame
-        planeModelMatrix = glm::mat4(1.0f);
-        planeNormalMatrix = glm::mat3(1.0f);
-        planeModelMatrix = glm::translate(planeModelMatrix, glm::vec3(0.0f, -1.0f, 0.0f));
-        planeModelMatrix = glm::scale(planeModelMatrix, glm::vec3(10.0f, 1.0f, 10.0f));
+        // we create the normals transformation matrix
         planeNormalMatrix = glm::inverseTranspose(glm::mat3(view*planeModelMatrix));
         glUniformMatrix4fv(glGetUniformLocation(illumination_shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(planeModelMatrix));
         glUniformMatrix3fv(glGetUniformLocation(illumination_shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(planeNormalMatrix));
@@ -372,21 +549,13 @@ int main()
 
         // SPHERE
         /*
-          we create the transformation matrix
-
-          N.B.) the last defined is the first applied
+          the model matrix has been calculated before the shadow pass
 
           We need also the matrix for normals transformation, which is the inverse of the transpose of the 3x3 submatrix (upper left) of the modelview. We do not consider the 4th column because we do not need translations for normals.
           An explanation (where XT means the transpose of X, etc):
             "Two column vectors X and Y are perpendicular if and only if XT.Y=0. If We're going to transform X by a matrix M, we need to transform Y by some matrix N so that (M.X)T.(N.Y)=0. Using the identity (A.B)T=BT.AT, this becomes (XT.MT).(N.Y)=0 => XT.(MT.N).Y=0. If MT.N is the identity matrix then this reduces to XT.Y=0. And MT.N is the identity matrix if and only if N=(MT)-1, i.e. N is the inverse of the transpose of M.
 
         */
-       // we reset to identity at each frame
-        sphereModelMatrix = glm::mat4(1.0f);
-        sphereNormalMatrix = glm::mat3(1.0f);
-        sphereModelMatrix = glm::translate(sphereModelMatrix, glm::vec3(-3.0f, 0.0f, 0.0f));
-        sphereModelMatrix = glm::rotate(sphereModelMatrix, glm::radians(orientationY), glm::vec3(0.0f, 1.0f, 0.0f));
-        sphereModelMatrix = glm::scale(sphereModelMatrix, glm::vec3(0.8f, 0.8f, 0.8f));
         // if we cast a mat4 to a mat3, we are automatically considering the upper left 3x3 submatrix
         sphereNormalMatrix = glm::inverseTranspose(glm::mat3(view*sphereModelMatrix));
         glUniformMatrix4fv(glGetUniformLocation(illumination_shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(sphereModelMatrix));
@@ -396,13 +565,7 @@ int main()
         sphereModel.Draw();
 
         //CUBE
-        // we create the transformation matrix and the normals transformation matrix
-        // we reset to identity at each frame
-        cubeModelMatrix = glm::mat4(1.0f);
-        cubeNormalMatrix = glm::mat3(1.0f);
-        cubeModelMatrix = glm::translate(cubeModelMatrix, glm::vec3(0.0f, 0.0f, 0.0f));
-        cubeModelMatrix = glm::rotate(cubeModelMatrix, glm::radians(orientationY), glm::vec3(0.0f, 1.0f, 0.0f));
-        cubeModelMatrix = glm::scale(cubeModelMatrix, glm::vec3(0.8f, 0.8f, 0.8f));
+        // we create the normals transformation matrix
         cubeNormalMatrix = glm::inverseTranspose(glm::mat3(view*cubeModelMatrix));
         glUniformMatrix4fv(glGetUniformLocation(illumination_shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(cubeModelMatrix));
         glUniformMatrix3fv(glGetUniformLocation(illumination_shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(cubeNormalMatrix));
@@ -411,13 +574,7 @@ int main()
         cubeModel.Draw();
 
         //BUNNY
-        // we create the transformation matrix and the normals transformation matrix
-        // we reset to identity at each frame
-        bunnyModelMatrix = glm::mat4(1.0f);
-        bunnyNormalMatrix = glm::mat3(1.0f);
-        bunnyModelMatrix = glm::translate(bunnyModelMatrix, glm::vec3(3.0f, 0.0f, 0.0f));
-        bunnyModelMatrix = glm::rotate(bunnyModelMatrix, glm::radians(orientationY), glm::vec3(0.0f, 1.0f, 0.0f));
-        bunnyModelMatrix = glm::scale(bunnyModelMatrix, glm::vec3(0.3f, 0.3f, 0.3f));
+        // we create the normals transformation matrix
         bunnyNormalMatrix = glm::inverseTranspose(glm::mat3(view*bunnyModelMatrix));
         glUniformMatrix4fv(glGetUniformLocation(illumination_shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(bunnyModelMatrix));
         glUniformMatrix3fv(glGetUniformLocation(illumination_shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(bunnyNormalMatrix));
@@ -427,12 +584,19 @@ int main()
 
         // Swapping back and front buffers
         glfwSwapBuffers(window);
+
+        // if activated, the statistics are printed every second
+        stats.EndFrame();
     }
 
    // when I exit from the graphics loop, it is because the application is closing
     // we delete the Shader Program
     illumination_shader.Delete();
+    cube_shadow_shader.Delete();
+    atlas_shadow_shader.Delete();
 
+    // we delete the textures (the OpenGL context must still exist)
+    textureStreamer.Clear();
     // we close and delete the created context
     glfwTerminate();
     return 0;
@@ -487,40 +651,18 @@ void SetupShader(int program)
 }
 
 //////////////////////////////////////////
-// we load the image from disk and we create an OpenGL texture
-GLint LoadTexture(const char* path)
+// importance of a light on screen: we approximate its area of influence with a sphere, and we estimate the dimension in pixels of its projection on screen.
+// The dimension of the tiles is this value rounded up to a power of two, and clamped to [64, 512]: the lights far from the camera get smaller tiles
+GLuint AtlasTileSize(const glm::vec3& lightPosition)
 {
-    GLuint textureImage;
-    int w, h, channels;
-    unsigned char* image;
-    image = stbi_load(path, &w, &h, &channels, STBI_rgb);
-
-    if (image == nullptr)
-        std::cout << "Failed to load texture!" << std::endl;
-
-    glGenTextures(1, &textureImage);
-    glBindTexture(GL_TEXTURE_2D, textureImage);
-    // 3 channels = RGB ; 4 channel = RGBA
-    if (channels==3)
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-    else if (channels==4)
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    // we set how to consider UVs outside [0,1] range
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    // we set the filtering for minification and magnification
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST_MIPMAP_NEAREST);
-
-    // we free the memory once we have created an OpenGL texture
-    stbi_image_free(image);
-
-    // we set the binding to 0 once we have finished
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    return textureImage;
-
+    // radius of the area of influence of the light (in world units)
+    const GLfloat influenceRadius = 5.0f;
+    GLfloat distance = glm::max(glm::length(lightPosition - camera.Position), 0.1f);
+    GLfloat pixels = screenHeight * influenceRadius / distance;
+    GLuint tileSize = 64;
+    while (tileSize < pixels && tileSize < 512)
+        tileSize <<= 1;
+    return tileSize;
 }
 
 //////////////////////////////////////////
@@ -549,6 +691,31 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     if(key == GLFW_KEY_L && action == GLFW_PRESS)
         wireframe=!wireframe;
 
+    // if H is pressed, we activate/deactivate the shadows of the point lights
+    if(key == GLFW_KEY_H && action == GLFW_PRESS)
+    {
+        pointShadowsEnabled=!pointShadowsEnabled;
+        std::cout << "Point light shadows: " << (pointShadowsEnabled ? "ON" : "OFF") << std::endl;
+    }
+
+    // if G is pressed, we switch between the cube map array and the shadow atlas
+    if(key == GLFW_KEY_G && action == GLFW_PRESS)
+    {
+        useShadowAtlas=!useShadowAtlas;
+        std::cout << "Point light shadows in: " << (useShadowAtlas ? "shadow atlas" : "cube map array") << std::endl;
+    }
+
+    // if B is pressed, we switch the memory budget of the streamed textures between 64 MB and 256 KB
+    if(key == GLFW_KEY_B && action == GLFW_PRESS)
+    {
+        smallTextureBudget=!smallTextureBudget;
+        std::cout << "Texture memory budget: " << (smallTextureBudget ? "256 KB" : "64 MB") << std::endl;
+    }
+
+    // if T is pressed, we activate/deactivate the print of the statistics
+    if(key == GLFW_KEY_T && action == GLFW_PRESS)
+        stats.enabled=!stats.enabled;
+
     // pressing a key number, we change the shader applied to the models
     // if the key is between 1 and 9, we proceed and check if the pressed key corresponds to
     // a valid subroutine
@@ -5,6 +5,10 @@ N.B. 1)  "15_reflect_refract.vert" must be used as vertex shader
 
 N.B. 2)  the different effects are implemented using Shaders Subroutines
 
+N.B. 3)  the GGX_IBL subroutine uses the cube map as a source of ambient light (Image Based Lighting), with the data precomputed on the CPU
+         (see include/utils/ibl_baker.h and include/utils/image_based_lighting.h): the SH coefficients of the irradiance for the diffuse component,
+         and the pre-filtered cube map + the BRDF table for the specular component (split-sum approximation)
+
 author: Davide Gadia
 
 Real-Time Graphics Programming - a.a. 2024/2025
@@ -38,6 +42,21 @@ uniform float Eta;
 // exponent of Fresnel equation (= 5 in literature, but we can change its value to have more artistic control on the final effect)
 uniform float mFresnelPower;
 
+// uniforms for GGX model
+uniform vec3 diffuseColor; // color of the object
+uniform float Kd; // weight of diffuse reflection
+uniform float alpha; // rugosity - 0 : smooth, 1: rough
+uniform float F0; // fresnel reflectance at normal incidence
+
+// Image Based Lighting data
+// pre-filtered environment: level l contains the environment convolved with the GGX lobe of alpha = l / (specularLevels-1)
+uniform samplerCube specularMap;
+uniform float specularLevels;
+// split-sum BRDF table: scale and bias of F0, indexed by (N.V, alpha)
+uniform sampler2D brdfLUT;
+// SH coefficients of the irradiance (already convolved with the cosine lobe and divided by PI)
+uniform vec3 shCoefficients[9];
+
 
 ////////////////////////////////////////////////////////////////////
 
@@ -112,6 +131,82 @@ vec4 Fresnel() // this name is the one which is detected by the SetupShaders() f
 }
 //////////////////////////////////////////
 
+//////////////////////////////////////////
+// irradiance (divided by PI) for the normal N, evaluated from the 9 SH coefficients
+vec3 IrradianceSH(vec3 N)
+{
+    vec3 irradiance = shCoefficients[0] * 0.282095
+                    + shCoefficients[1] * 0.488603 * N.y
+                    + shCoefficients[2] * 0.488603 * N.z
+                    + shCoefficients[3] * 0.488603 * N.x
+                    + shCoefficients[4] * 1.092548 * N.x * N.y
+                    + shCoefficients[5] * 1.092548 * N.y * N.z
+                    + shCoefficients[6] * 0.315392 * (3.0 * N.z * N.z - 1.0)
+                    + shCoefficients[7] * 1.092548 * N.x * N.z
+                    + shCoefficients[8] * 0.546274 * (N.x * N.x - N.y * N.y);
+    // with only 3 bands, the approximation can become slightly negative in the directions opposite to strong lights
+    return max(irradiance, vec3(0.0));
+}
+
+//////////////////////////////////////////
+// Schlick-GGX method for geometry obstruction (used by GGX model)
+float G1(float angle, float alpha)
+{
+    // for the point light we use the k factor of the analytic lights (for the Image Based Lighting, k=(alpha*alpha)/2 is already considered in the BRDF table)
+    float r = (alpha + 1.0);
+    float k = (r*r) / 8.0;
+
+    float num   = angle;
+    float denom = angle * (1.0 - k) + k;
+
+    return num / denom;
+}
+
+//////////////////////////////////////////
+// a subroutine for the GGX model, with the point light and the Image Based Lighting from the environment
+subroutine(refl_refra)
+vec4 GGX_IBL() // this name is the one which is detected by the SetupShaders() function in the main application, and the one used to swap subroutines
+{
+    vec3 N = normalize(worldNormal);
+    // vector from the fragment to the camera, and from the fragment to the light, in world coordinates
+    vec3 V = normalize(cameraPosition - worldPosition.xyz);
+    vec3 L = normalize(pointLightPosition - worldPosition.xyz);
+    float NdotV = max(dot(N, V), 0.0001);
+
+    // diffusive (Lambert) reflection component
+    vec3 lambert = (Kd*diffuseColor)/PI;
+
+    // point light, as in the GGX shaders of the previous lectures
+    vec3 color = vec3(0.0);
+    float NdotL = max(dot(N, L), 0.0);
+    if (NdotL > 0.0)
+    {
+        vec3 H = normalize(L + V);
+        float NdotH = max(dot(N, H), 0.0);
+        float VdotH = max(dot(V, H), 0.0);
+        float alpha_Squared = alpha * alpha;
+        float denom = (NdotH*NdotH*(alpha_Squared-1.0)+1.0);
+        float D = alpha_Squared / (PI*denom*denom);
+        float G2 = G1(NdotV, alpha)*G1(NdotL, alpha);
+        float F = F0 + (1.0 - F0) * pow(1.0 - VdotH, 5.0);
+        vec3 specular = vec3((F * G2 * D) / (4.0 * NdotV * NdotL));
+        color += (lambert + specular)*NdotL;
+    }
+
+    // Image Based Lighting
+    // diffuse component: the SH coefficients give the irradiance divided by PI, so we multiply directly by the diffuse color
+    vec3 ambientDiffuse = Kd * diffuseColor * IrradianceSH(N);
+    // specular component (split-sum approximation): pre-filtered environment in the reflection direction (1 fetch, in the level corresponding to alpha),
+    // multiplied by the integral of the BRDF (1 fetch of the table)
+    vec3 R = reflect(-V, N);
+    vec3 prefiltered = textureLod(specularMap, R, alpha * (specularLevels - 1.0)).rgb;
+    vec2 brdf = texture(brdfLUT, vec2(NdotV, alpha)).rg;
+    vec3 ambientSpecular = prefiltered * (F0 * brdf.x + brdf.y);
+
+    return vec4(color + ambientDiffuse + ambientSpecular, 1.0);
+}
+//////////////////////////////////////////
+
 // main
 void main(void)
 {
@@ -1,6 +1,9 @@
 /*
 Es05b: cubemap used for environment mapping, shaders for reflections and refractions
 - swapping shaders pressing keys from 1 to 4
+- the GGX_IBL subroutine uses the cube map for Image Based Lighting (ambient light from the environment): the SH coefficients of the irradiance, the pre-filtered
+  cube map and the BRDF table are baked on the CPU in parallel at the first execution, and then loaded from cache files (code in include/utils/ibl_baker.h and
+  include/utils/image_based_lighting.h). Pressing the UP and DOWN arrow keys, we change the rugosity of the object
 
 N.B. 1)
 In this example we use Shaders Subroutines to do shader swapping:
@@ -13,6 +16,10 @@ https://www.informit.com/articles/article.aspx?p=2731929&seqNum=7
 https://www.khronos.org/opengl/wiki/Shader_Compilation#Separate_programs
 https://riptutorial.com/opengl/example/26979/load-separable-shader-in-cplusplus
 
+N.B. 2) the 6 images of the cube map are decoded in parallel on a pool of threads, and then uploaded through a Pixel Buffer Object (code in include/utils/texture_manager.h):
+the loading time is close to the decoding time of the slowest image, and it is printed on console. If the packed file textures/cube/Maskonaive2.renv exists (created with
+tools/environment_converter), the cube map is loaded from it instead: a single memory mapping and an upload for each level, already with the mipmaps
+
 author: Davide Gadia
 
 Real-Time Graphics Programming - a.a. 2024/2025
@@ -64,6 +71,9 @@ positive Z axis points "outside" the screen
 #include <utils/shader.h>
 #include <utils/model.h>
 #include <utils/camera.h>
+#include <utils/job_system.h>
+#include <utils/texture_manager.h>
+#include <utils/image_based_lighting.h>
 
 // we load the GLM classes used in the application
 #include <glm/glm.hpp>
@@ -95,9 +105,6 @@ void SetupShader(int shader_program);
 // print on console the name of current shader subroutine
 void PrintCurrentShader(int subroutine);
 
-// load the 6 images from disk and create an OpenGL cubemap
-GLint LoadTextureCube(string path);
-
 // we initialize an array of booleans for each keyboard key
 bool keys[1024];
 
@@ -135,6 +142,15 @@ GLfloat Eta = 1.0f/1.52f;
 // < 5 -> technically not physically correct, but it gives more "artistic" results
 GLfloat mFresnelPower = 5.0f;
 
+// parameters of the GGX model (GGX_IBL subroutine)
+glm::vec3 diffuseColor(0.8f, 0.8f, 0.8f);
+// weight for the diffusive component
+GLfloat Kd = 0.8f;
+// roughness index for GGX shader
+GLfloat alpha = 0.3f;
+// Fresnel reflectance at 0 degree (Schlik's approximation)
+GLfloat F0 = 0.9f;
+
 // texture unit for the cube map
 GLuint textureCube;
 // variables used to store uniform location inside shaders
@@ -204,7 +220,21 @@ int main()
     Shader skybox_shader("17_skybox.vert", "18_skybox.frag");
 
     // we load the cube map (we pass the path to the folder containing the 6 views)
-    textureCube = LoadTextureCube("../../textures/cube/Maskonaive2/");
+    // the 6 images are decoded in parallel by the worker threads of the JobSystem, and then uploaded with a Pixel Buffer Object (code in include/utils/texture_manager.h)
+    TextureManager textureManager;
+    // the data for the Image Based Lighting are read from the cache files, or baked on the CPU using the same JobSystem (code in include/utils/ibl_baker.h)
+    ImageBasedLighting ibl;
+    {
+        JobSystem jobs;
+        double loadStart = glfwGetTime();
+        // if the environment has been converted in a packed file (tools/environment_converter), we load it with a single memory mapping, without decoding the images
+        string packedEnvironment = "../../textures/cube/Maskonaive2.renv";
+        textureCube = textureManager.AcquireCube(FileModificationTime(packedEnvironment) >= 0 ? packedEnvironment : "../../textures/cube/Maskonaive2/", &jobs);
+        std::cout << "Cube map loaded in " << (glfwGetTime() - loadStart) * 1000.0 << " ms (" << jobs.NumWorkers() << " workers)" << std::endl;
+        loadStart = glfwGetTime();
+        ibl.Load("../../textures/cube/Maskonaive2/", "../../textures/cube/brdf_lut.ibl", &jobs);
+        std::cout << "IBL data ready in " << (glfwGetTime() - loadStart) * 1000.0 << " ms" << std::endl;
+    }
 
     // we load the model(s)
     Model cubeModel("../../models/cube.obj"); // used for the environment map
@@ -276,6 +306,12 @@ int main()
         glUniform1f(etaLocation, Eta);
         glUniform1f(powerLocation, mFresnelPower);
         glUniform3fv(pointLightLocation, 1, glm::value_ptr(lightPos0));
+        // parameters of the GGX model, and data for the Image Based Lighting (texture units 1 and 2)
+        glUniform3fv(glGetUniformLocation(reflection_shader.Program, "diffuseColor"), 1, glm::value_ptr(diffuseColor));
+        glUniform1f(glGetUniformLocation(reflection_shader.Program, "Kd"), Kd);
+        glUniform1f(glGetUniformLocation(reflection_shader.Program, "alpha"), alpha);
+        glUniform1f(glGetUniformLocation(reflection_shader.Program, "F0"), F0);
+        ibl.Bind(reflection_shader.Program, 1, 2);
 
         // we pass projection and view matrices to the Shader Program
         glUniformMatrix4fv(glGetUniformLocation(reflection_shader.Program, "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(projection));
@@ -338,69 +374,14 @@ int main()
     // we delete the Shader Program
     reflection_shader.Delete();
     skybox_shader.Delete();
+    // we delete the textures (the OpenGL context must still exist)
+    textureManager.Clear();
+    ibl.Clear();
     // we close and delete the created context
     glfwTerminate();
     return 0;
 }
 
-///////////////////////////////////////////
-// load one side of the cubemap, passing the name of the file and the side of the corresponding OpenGL cubemap
-void LoadTextureCubeSide(string path, string side_image, GLuint side_name)
-{
-    int w, h;
-    unsigned char* image;
-    string fullname;
-
-    // full name and path of the side of the cubemap
-    fullname = path + side_image;
-    // we load the image file
-    image = stbi_load(fullname.c_str(), &w, &h, 0, STBI_rgb);
-    if (image == nullptr)
-        std::cout << "Failed to load texture!" << std::endl;
-    // we set the image file as one of the side of the cubemap (passed as a parameter)
-    glTexImage2D(side_name, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-    // we free the memory once we have created an OpenGL texture
-    stbi_image_free(image);
-}
-
-
-//////////////////////////////////////////
-// we load the 6 images from disk and we create an OpenGL cube map
-GLint LoadTextureCube(string path)
-{
-    GLuint textureImage;
-
-    // we create and activate the OpenGL cubemap texture
-    glGenTextures(1, &textureImage);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureImage);
-
-    // we load and set the 6 images corresponding to the 6 views of the cubemap
-    // we use as convention that the names of the 6 images are "posx, negx, posy, negy, posz, negz", placed at the path passed as parameter
-    // we load the images individually and we assign them to the correct sides of the cube map
-    LoadTextureCubeSide(path, std::string("posx.jpg"), GL_TEXTURE_CUBE_MAP_POSITIVE_X);
-    LoadTextureCubeSide(path, std::string("negx.jpg"), GL_TEXTURE_CUBE_MAP_NEGATIVE_X);
-    LoadTextureCubeSide(path, std::string("posy.jpg"), GL_TEXTURE_CUBE_MAP_POSITIVE_Y);
-    LoadTextureCubeSide(path, std::string("negy.jpg"), GL_TEXTURE_CUBE_MAP_NEGATIVE_Y);
-    LoadTextureCubeSide(path, std::string("posz.jpg"), GL_TEXTURE_CUBE_MAP_POSITIVE_Z);
-    LoadTextureCubeSide(path, std::string("negz.jpg"), GL_TEXTURE_CUBE_MAP_NEGATIVE_Z);
-
-    // we set the filtering for minification and magnification
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    // we set how to consider the texture coordinates outside [0,1] range
-    // in this case we have a cube map, so
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    // we set the binding to 0 once we have finished
-    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-
-    return textureImage;
-
-}
-
 ///////////////////////////////////////////
 // The function parses the content of the Shader Program, searches for the Subroutine type names,
 // the subroutines implemented for each type, print the names of the subroutines on the terminal, and add the names of
@@ -473,6 +454,13 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     if(key == GLFW_KEY_L && action == GLFW_PRESS)
         wireframe=!wireframe;
 
+    // pressing the UP and DOWN arrow keys, we change the rugosity used by the GGX_IBL subroutine
+    if((key == GLFW_KEY_UP || key == GLFW_KEY_DOWN) && action == GLFW_PRESS)
+    {
+        alpha = glm::clamp(alpha + (key == GLFW_KEY_UP ? 0.1f : -0.1f), 0.0f, 1.0f);
+        std::cout << "Rugosity (alpha): " << alpha << std::endl;
+    }
+
     // pressing a key number, we change the shader applied to the models
     // if the key is between 1 and 9, we proceed and check if the pressed key corresponds to
     // a valid subroutine
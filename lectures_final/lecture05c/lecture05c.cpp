@@ -66,6 +66,7 @@ positive Z axis points "outside" the screen
 #include <utils/shader.h>
 #include <utils/model.h>
 #include <utils/camera.h>
+#include <utils/texture_manager.h>
 
 // we load the GLM classes used in the application
 #include <glm/glm.hpp>
@@ -89,9 +90,6 @@ void apply_camera_movements();
 // in this application, we have isolated the models rendering using a function, which will be called in each rendering step
 void RenderObjects(Shader &shader, Model &planeModel, Model &cubeModel, Model &sphereModel, Model &bunnyModel);
 
-// load image from disk and create an OpenGL texture
-GLint LoadTexture(const char* path);
-
 // we initialize an array of booleans for each keyboard key
 bool keys[1024];
 
@@ -205,8 +203,11 @@ int main()
     Shader illumination_shader = Shader("21_ggx_tex_shadow_work.vert", "22_ggx_tex_shadow_work.frag");
 
     // we load the images and store them in a vector
-    textureID.push_back(LoadTexture("../../textures/UV_Grid_Sm.png"));
-    textureID.push_back(LoadTexture("../../textures/SoilCracked.png"));
+    // the textures are managed by the TextureManager class (code in include/utils/texture_manager.h): an image requested more than once is decoded and uploaded only once
+    TextureManager textureManager;
+    textureID.push_back(textureManager.Acquire("../../textures/UV_Grid_Sm.png"));
+    textureID.push_back(textureManager.Acquire("../../textures/SoilCracked.png"));
+    textureManager.PrintStats();
 
     // we load the model(s) (code of Model class is in include/utils/model.h)
     Model cubeModel("../../models/cube.obj");
@@ -310,6 +311,8 @@ int main()
     // when I exit from the graphics loop, it is because the application is closing
     // we delete the Shader Programs
     illumination_shader.Delete();
+    // we delete the textures (the OpenGL context must still exist)
+    textureManager.Clear();
     // chiudo e cancello il contesto creato
     glfwTerminate();
     return 0;
@@ -401,42 +404,6 @@ void RenderObjects(Shader &shader, Model &planeModel, Model &cubeModel, Model &s
 
 }
 
-//////////////////////////////////////////
-// we load the image from disk and we create an OpenGL texture
-GLint LoadTexture(const char* path)
-{
-    GLuint textureImage;
-    int w, h, channels;
-    unsigned char* image;
-    image = stbi_load(path, &w, &h, &channels, STBI_rgb);
-
-    if (image == nullptr)
-        std::cout << "Failed to load texture!" << std::endl;
-
-    glGenTextures(1, &textureImage);
-    glBindTexture(GL_TEXTURE_2D, textureImage);
-    // 3 channels = RGB ; 4 channel = RGBA
-    if (channels==3)
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-    else if (channels==4)
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    // we set how to consider UVs outside [0,1] range
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    // we set the filtering for minification and magnification
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST_MIPMAP_NEAREST);
-
-    // we free the memory once we have created an OpenGL texture
-    stbi_image_free(image);
-
-    // we set the binding to 0 once we have finished
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    return textureImage;
-}
-
 //////////////////////////////////////////
 // If one of the WASD keys is pressed, the camera is moved accordingly (the code is in utils/camera.h)
 void apply_camera_movements()
@@ -52,6 +52,12 @@ out vec2 interp_UV;
 // for the correct rendering of the shadows, we need to calculate the vertex coordinates also in "light coordinates" (= using light as a camera)
 out vec4 posLightSpace;
 
+// with Cascaded Shadow Maps, the light matrix depends on the cascade chosen for the fragment: we pass the position in world coordinates, and the transformation is applied in the fragment shader
+out vec3 vWorldPosition;
+
+// the position must be invariant, because it must be exactly equal to the one calculated in the depth pre-pass (see 25_depth_prepass.vert)
+invariant gl_Position;
+
 
 void main(){
 
@@ -78,4 +84,7 @@ void main(){
   // vertex position in "light coordinates"
   posLightSpace = lightSpaceMatrix * mPosition;
 
+  // vertex position in world coordinates, for the Cascaded Shadow Maps
+  vWorldPosition = mPosition.xyz;
+
 }
@@ -7,6 +7,11 @@ N.B. 2) the shader considers only a directional light (simpler to manage for the
 
 N.B. 3)  the different effects are implemented using Shaders Subroutines
 
+N.B. 4)  Shadow_Cascaded uses the Cascaded Shadow Maps (see include/utils/shadow_cascades.h): the shadow map is chosen considering the depth of the fragment in view coordinates
+
+N.B. 5)  Shadow_PCF_Hardware samples the same depth map using a sampler2DShadow (the depth comparison is performed by the hardware, with bilinear filtering of the results), while
+         Shadow_VSM and Shadow_ESM use a "filterable" shadow map (see 31_shadow_moments.frag), already blurred in the application: a single texture fetch is needed for soft shadows
+
 author: Davide Gadia
 
 Real-Time Graphics Programming - a.a. 2024/2025
@@ -35,14 +40,41 @@ in vec2 interp_UV;
 // for the correct rendering of the shadows, we need to calculate the vertex coordinates also in "light coordinates" (= using light as a camera)
 in vec4 posLightSpace;
 
+// position in world coordinates (used by the Cascaded Shadow Maps)
+in vec3 vWorldPosition;
+
 // texture repetitions
 uniform float repeat;
 
-// texture sampler
-uniform sampler2D tex;
+// textures of the materials, packed in the layers of a texture array (see include/utils/material_library.h), and the layer of the current material
+uniform sampler2DArray materialTextures;
+uniform int materialLayer;
 // texture sampler for the depth map
 uniform sampler2D shadowMap;
 
+// the same depth map, sampled with depth comparison (GL_TEXTURE_COMPARE_MODE is set in the sampler object bound to the texture unit)
+uniform sampler2DShadow shadowMapCompare;
+// filterable shadow map for VSM and ESM (R,G = moments of the depth, B = exp(esmExponent * depth))
+uniform sampler2D shadowMoments;
+// exponent of ESM (it must be the same used in 31_shadow_moments.frag)
+uniform float esmExponent;
+
+// Cascaded Shadow Maps: texture array with a depth map for each cascade
+uniform sampler2DArray shadowCascades;
+// number of cascades
+uniform int numCascades;
+// transformation (projection and view) matrix of the light for each cascade
+uniform mat4 cascadeMatrices[4];
+// far distance of each cascade, in view coordinates
+uniform float cascadeSplits[4];
+// conversion from distances in world units to differences of depth in each cascade
+uniform float cascadeDepthScale[4];
+// if 1, the fragments are tinted with a different color for each cascade
+uniform int showCascades;
+
+// index of the cascade used for the fragment (-1 if Cascaded Shadow Maps are not used, or if the fragment is beyond the last cascade)
+int cascadeIndex = -1;
+
 uniform float alpha; // rugosity - 0 : smooth, 1: rough
 uniform float F0; // fresnel reflectance at normal incidence
 uniform float Kd; // weight of diffuse reflection
@@ -147,6 +179,124 @@ float Shadow_PCF_Final() // this name is the one which is detected by the SetupS
     return shadow;
 }
 
+//////////////////////////////////////////
+// it applies PCF using the hardware comparison: each fetch on a sampler2DShadow with linear filtering compares the 4 nearest texels, and it returns the bilinear interpolation of the results.
+// With 4 fetches at the corners of the central texel, we obtain a smooth filter on a 3x3 area (with "tent" weights) using less than half the fetches of Shadow_PCF_Final
+subroutine(shadow_map)
+float Shadow_PCF_Hardware() // this name is the one which is detected by the SetupShaders() function in the main application, and the one used to swap subroutines
+{
+    vec3 projCoords = posLightSpace.xyz / posLightSpace.w;
+    projCoords = projCoords * 0.5 + 0.5;
+    if (projCoords.z > 1.0)
+        return 0.0;
+
+    // the same adaptive bias of Shadow_PCF_Final
+    vec3 normal = normalize(vNormal);
+    float bias = max(0.05 * (1.0 - dot(normal, lightDir)), 0.005);
+
+    // the third coordinate is the reference value for the comparison: the result is 1 if the fragment is in light
+    float light = 0.0;
+    vec2 texelSize = 1.0 / textureSize(shadowMapCompare, 0);
+    for(int x = 0; x <= 1; ++x)
+    {
+        for(int y = 0; y <= 1; ++y)
+        {
+            light += texture(shadowMapCompare, vec3(projCoords.xy + (vec2(x, y) - 0.5) * texelSize, projCoords.z - bias));
+        }
+    }
+    return 1.0 - light / 4.0;
+}
+
+//////////////////////////////////////////
+// Variance Shadow Maps: from the mean and the variance of the depth in the filter area, we estimate the fraction of the area in light using the Chebyshev's inequality
+subroutine(shadow_map)
+float Shadow_VSM() // this name is the one which is detected by the SetupShaders() function in the main application, and the one used to swap subroutines
+{
+    vec3 projCoords = posLightSpace.xyz / posLightSpace.w;
+    projCoords = projCoords * 0.5 + 0.5;
+    if (projCoords.z > 1.0)
+        return 0.0;
+
+    vec2 moments = texture(shadowMoments, projCoords.xy).rg;
+    float currentDepth = projCoords.z;
+    // the fragment is in front of the mean depth of the casters: it is in light
+    if (currentDepth <= moments.x)
+        return 0.0;
+
+    // the variance has a minimum value, to avoid numerical problems
+    float variance = max(moments.y - moments.x * moments.x, 0.00002);
+    float d = currentDepth - moments.x;
+    // upper bound of the probability of being in light
+    float pMax = variance / (variance + d * d);
+    // we reduce the "light bleeding" (areas wrongly in light where the shadows of different casters overlap), cutting the lower values of pMax
+    pMax = clamp((pMax - 0.2) / 0.8, 0.0, 1.0);
+
+    return 1.0 - pMax;
+}
+
+//////////////////////////////////////////
+// Exponential Shadow Maps: the shadow test is approximated by exp(-c * (currentDepth - depth)), which can be computed on the filtered values of exp(c * depth)
+subroutine(shadow_map)
+float Shadow_ESM() // this name is the one which is detected by the SetupShaders() function in the main application, and the one used to swap subroutines
+{
+    vec3 projCoords = posLightSpace.xyz / posLightSpace.w;
+    projCoords = projCoords * 0.5 + 0.5;
+    if (projCoords.z > 1.0)
+        return 0.0;
+
+    float expDepth = texture(shadowMoments, projCoords.xy).b;
+    float light = clamp(expDepth * exp(-esmExponent * projCoords.z), 0.0, 1.0);
+
+    return 1.0 - light;
+}
+
+//////////////////////////////////////////
+// it applies PCF on the Cascaded Shadow Maps. The cascade is chosen considering the distance of the fragment from the camera, along the view direction
+subroutine(shadow_map)
+float Shadow_Cascaded() // this name is the one which is detected by the SetupShaders() function in the main application, and the one used to swap subroutines
+{
+    // vViewPosition is negated: its z component is the (positive) distance from the camera along the view direction
+    float depth = vViewPosition.z;
+    for (int i = 0; i < numCascades; ++i)
+    {
+        if (depth < cascadeSplits[i])
+        {
+            cascadeIndex = i;
+            break;
+        }
+    }
+    // the fragments beyond the last cascade are considered in light
+    if (cascadeIndex < 0)
+        return 0.0;
+
+    // we transform the position in the coordinates of the light for the chosen cascade
+    vec4 posCascade = cascadeMatrices[cascadeIndex] * vec4(vWorldPosition, 1.0);
+    vec3 projCoords = posCascade.xyz / posCascade.w;
+    projCoords = projCoords * 0.5 + 0.5;
+    float currentDepth = projCoords.z;
+    if (currentDepth > 1.0)
+        return 0.0;
+
+    // the depth range of each cascade is different: we define the bias in world units (in the range [0.01,0.1]), and we convert it in depth values for the cascade
+    vec3 normal = normalize(vNormal);
+    float bias = max(0.1 * (1.0 - dot(normal, normalize(lightDir))), 0.01) * cascadeDepthScale[cascadeIndex];
+
+    // PCF on the 3x3 neighbourhood, on the layer of the cascade
+    float shadow = 0.0;
+    vec2 texelSize = 1.0 / textureSize(shadowCascades, 0).xy;
+    for(int x = -1; x <= 1; ++x)
+    {
+        for(int y = -1; y <= 1; ++y)
+        {
+            float pcfDepth = texture(shadowCascades, vec3(projCoords.xy + vec2(x, y) * texelSize, cascadeIndex)).r;
+            shadow += currentDepth - bias > pcfDepth  ? 1.0 : 0.0;
+        }
+    }
+    shadow /= 9.0;
+
+    return shadow;
+}
+
 //////////////////////////////////////////
 // Schlick-GGX method for geometry obstruction (used by GGX model)
 float G1(float angle, float alpha)
@@ -167,7 +317,7 @@ void main()
 {
     // we repeat the UVs and we sample the texture
     vec2 repeated_UV = mod(interp_UV*repeat, 1.0);
-    vec4 surfaceColor = texture(tex, repeated_UV);
+    vec4 surfaceColor = texture(materialTextures, vec3(repeated_UV, materialLayer));
 
     // normalization of the per-fragment normal
     vec3 N = normalize(vNormal);
@@ -234,5 +384,12 @@ void main()
     // Therefore, we use (1-shadow) as weight to apply to the illumination model
     vec3 finalColor = (1.0 - shadow)*(lambert + specular)*NdotL;
 
+    // debug visualization of the cascades (red, green, blue, yellow)
+    if (showCascades == 1 && cascadeIndex >= 0)
+    {
+        const vec3 cascadeColors[4] = vec3[4](vec3(1.0, 0.3, 0.3), vec3(0.3, 1.0, 0.3), vec3(0.3, 0.3, 1.0), vec3(1.0, 1.0, 0.3));
+        finalColor = mix(finalColor, finalColor * cascadeColors[cascadeIndex], 0.6);
+    }
+
     colorFrag = vec4(finalColor, 1.0);
 }
@@ -0,0 +1,44 @@
+/*
+25_depth_prepass.vert: vertex shader for the depth pre-pass
+
+It is the position-only path of 19_shadowmap.vert, but the vertex is transformed using the camera matrices instead of the light matrices.
+The depth buffer filled by this pass is then used by the color pass with the GL_EQUAL depth test: only the visible fragments are shaded.
+
+N.B. 1) to pass the GL_EQUAL depth test, the depth values of the color pass must be exactly the same of the ones calculated in this pass.
+Thus, gl_Position is calculated with exactly the same operations (and in the same order) used in 21_ggx_tex_shadow.vert, and it is declared invariant in both the shaders
+(otherwise, the compiler could apply different optimizations to the two shaders, and produce slightly different values)
+
+N.B. 2) "20_shadowmap.frag" (which does nothing) must be used as fragment shader
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#version 410 core
+
+// vertex position in world coordinates
+layout (location = 0) in vec3 position;
+
+// model matrix
+uniform mat4 modelMatrix;
+// view matrix
+uniform mat4 viewMatrix;
+// Projection matrix
+uniform mat4 projectionMatrix;
+
+// the same declaration is present in 21_ggx_tex_shadow.vert
+invariant gl_Position;
+
+void main()
+{
+  // vertex position in world coordinates
+  vec4 mPosition = modelMatrix * vec4( position, 1.0 );
+  // vertex position in camera coordinates
+  vec4 mvPosition = viewMatrix * mPosition;
+
+  // we apply the projection transformation
+  gl_Position = projectionMatrix * mvPosition;
+}
@@ -0,0 +1,39 @@
+/*
+31_shadow_moments.frag: fragment shader for the creation of a "filterable" shadow map, used by Variance Shadow Maps (VSM) and Exponential Shadow Maps (ESM)
+
+Instead of the depth alone, for each texel we save:
+- R, G: the first two moments of the depth distribution (depth and depth^2), used by VSM
+- B: exp(c * depth), used by ESM
+Unlike a standard depth map, these values can be filtered (e.g., with a blur or with bilinear filtering) before the shadow test: the filtered values still give a meaningful estimate of the
+fraction of the filter area which is in light. Thus, soft shadows require a single texture fetch in the fragment shader, independently from the size of the filter kernel
+
+N.B. 1)  "19_shadowmap.vert" must be used as vertex shader
+N.B. 2)  the light uses an orthographic projection, so the depth in gl_FragCoord.z is linear
+
+see:
+https://developer.nvidia.com/gpugems/gpugems3/part-ii-light-and-shadows/chapter-8-summed-area-variance-shadow-maps
+https://jankautz.com/publications/esm_gi08.pdf
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#version 410 core
+
+// output shader variable
+out vec4 moments;
+
+// exponent of ESM: higher values reduce the light bleeding, but they can cause overflows in the filtering
+uniform float esmExponent;
+
+void main()
+{
+    float depth = gl_FragCoord.z;
+    // we add to the second moment the variance of the depth inside the pixel (estimated using the derivatives), to reduce the shadow acne of VSM
+    float dx = dFdx(depth);
+    float dy = dFdy(depth);
+    moments = vec4(depth, depth * depth + 0.25 * (dx * dx + dy * dy), exp(esmExponent * depth), 1.0);
+}
@@ -0,0 +1,23 @@
+/*
+32_fullscreen.vert: vertex shader for the post-processing passes (e.g., the blur of the filterable shadow maps)
+
+It generates a triangle covering the whole viewport. No vertex buffer is needed: the position is calculated from gl_VertexID (see also 28_deferred_light.vert in lecture04b)
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#version 410 core
+
+// UV coordinates of the vertex
+out vec2 interp_UV;
+
+void main()
+{
+    // gl_VertexID = 0, 1, 2 -> (0,0), (2,0), (0,2) -> a triangle in NDC with vertices (-1,-1), (3,-1), (-1,3), which contains the whole viewport
+    interp_UV = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(interp_UV * 2.0 - 1.0, 0.0, 1.0);
+}
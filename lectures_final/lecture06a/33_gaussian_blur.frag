@@ -0,0 +1,46 @@
+/*
+33_gaussian_blur.frag: fragment shader for a separable gaussian blur
+
+A 2D gaussian filter with radius r requires (2r+1)^2 texture fetches for each pixel. The gaussian is separable: the same result is obtained applying a 1D filter
+along the horizontal direction, and then a 1D filter along the vertical direction on the result. Thus, the two passes require 2*(2r+1) fetches for each pixel
+
+N.B.)  "32_fullscreen.vert" must be used as vertex shader
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#version 410 core
+
+// output shader variable
+out vec4 colorFrag;
+
+// UV coordinates (interpolated)
+in vec2 interp_UV;
+
+// the texture to blur
+uniform sampler2D image;
+// direction of the blur: (1,0) for the horizontal pass, (0,1) for the vertical pass
+uniform vec2 direction;
+// radius of the filter (in texels)
+uniform int radius;
+
+void main()
+{
+    vec2 texelSize = 1.0 / textureSize(image, 0);
+    // the standard deviation is set in order to have the filter practically zero at the borders of the kernel
+    float sigma = max(float(radius) * 0.5, 0.5);
+
+    vec4 sum = vec4(0.0);
+    float weightSum = 0.0;
+    for (int i = -radius; i <= radius; ++i)
+    {
+        float weight = exp(-float(i * i) / (2.0 * sigma * sigma));
+        sum += weight * texture(image, interp_UV + direction * float(i) * texelSize);
+        weightSum += weight;
+    }
+    colorFrag = sum / weightSum;
+}
@@ -2,6 +2,22 @@
 Es06a: shadow rendering with shadow mapping technique - PART 2
 - swapping (pressing keys from 1 to 3) between basic shadow mapping (with a lot of aliasing/shadow "acne"), adaptive bias to avoid shadow "acne", and PCF to smooth shadow borders
 - conclusion of Es05c, with object shaders now using the shadow map computed in the first rendering step
+- pressing the Z key, we activate/deactivate a depth pre-pass: the scene is rendered a first time writing only the depth buffer (using a position-only shader, like the one used for the shadow map),
+  and then a second time with the GGX shader, using GL_EQUAL as depth test and with depth writes disabled. In this way, the expensive GGX+PCF fragment shader is executed only once for each pixel, even with complex overlapping objects
+- pressing the O key, we activate/deactivate a measurement mode: using occlusion queries (GL_SAMPLES_PASSED) and timer queries (GL_TIME_ELAPSED), the number of shaded fragments and the GPU time of the color pass are printed on console every second
+- selecting the Shadow_Cascaded subroutine (key 4), we use Cascaded Shadow Maps (code in include/utils/shadow_cascades.h): the camera frustum (up to shadowDistance) is split in 2-4 partitions, each one with
+  its own shadow map fitted on the partition, saved in the layers of a depth texture array. Pressing the C key, we change the number of cascades (2 -> 3 -> 4 -> 2), while pressing the V key
+  we activate/deactivate the visualization of the cascades (each cascade is tinted with a different color)
+- pressing the K key, we activate/deactivate the cached shadow map (for the single shadow map): the static casters are rendered only once in a persistent depth buffer, which is copied in the
+  shadow map at each frame before rendering the dynamic casters on top of it. The cache is invalidated automatically when the light direction or the set of static casters changes
+  (the plane is always static, while the other objects are static only when their rotation is stopped), or when the culling of the casters is changed (X key). The light can be rotated using the LEFT and RIGHT arrow keys
+- pressing the X key, we change the culling of the shadow casters (code in include/utils/culling.h): no culling -> culling against the light frustum (extended towards the light, using GL_DEPTH_CLAMP)
+  -> culling against the light frustum + receiver-aware culling (the objects are culled if their shadow cannot fall inside the camera frustum). The number of rendered and culled casters is printed in measurement mode
+- the Shadow_PCF_Hardware subroutine samples the shadow map with a sampler2DShadow (hardware depth comparison with bilinear filtering, configured in a sampler object), while Shadow_VSM and Shadow_ESM use
+  Variance and Exponential Shadow Maps: the scene is rendered in a "filterable" shadow map, which is blurred with a separable gaussian filter (N and M keys to decrease/increase the radius).
+  Pressing the B key, we start a benchmark: each subroutine is used for some frames, and the number of texture fetches, the filter area and the GPU times of the shadow and color passes are printed on console
+- the textures of the objects are managed by a MaterialLibrary (code in include/utils/material_library.h): the images are resized to a common size and packed in the layers of a texture array,
+  which is bound once, while each draw call passes only the layer of its material. The number of bindings of the texture arrays is printed in measurement mode
 
 N.B. 1)
 In this example we use Shaders Subroutines to do shader swapping:
@@ -51,6 +67,7 @@ positive Z axis points "outside" the screen
 
 // Std. Includes
 #include <string>
+#include <cmath>
 
 // Loader for OpenGL extensions
 // http://glad.dav1d.de/
@@ -76,6 +93,10 @@ positive Z axis points "outside" the screen
 #include <utils/shader.h>
 #include <utils/model.h>
 #include <utils/camera.h>
+#include <utils/frame_stats.h>
+#include <utils/shadow_cascades.h>
+#include <utils/culling.h>
+#include <utils/material_library.h>
 
 // we load the GLM classes used in the application
 #include <glm/glm.hpp>
@@ -91,7 +112,13 @@ positive Z axis points "outside" the screen
 GLuint screenWidth = 1200, screenHeight = 900;
 
 // the rendering steps used in the application
-enum render_passes{ SHADOWMAP, RENDER};
+enum render_passes{ SHADOWMAP, RENDER, DEPTH_PREPASS};
+
+// the objects of the scene, as bits of a mask (used to render only a subset of the scene)
+enum scene_objects{ PLANE_OBJECT = 1, SPHERE_OBJECT = 2, CUBE_OBJECT = 4, BUNNY_OBJECT = 8, ALL_OBJECTS = 15};
+
+// the modes for the culling of the shadow casters
+enum caster_culling_modes{ NO_CASTER_CULLING, LIGHT_CULLING, RECEIVER_CULLING, NUM_CASTER_CULLING_MODES};
 
 // callback functions for keyboard and mouse events
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode);
@@ -110,11 +137,18 @@ void SetupShader(int shader_program);
 // print on console the name of current shader subroutine
 void PrintCurrentShader(int subroutine);
 
+// cost of a shadow subroutine: number of texture fetches for each shaded fragment, and number of texels of the shadow map considered by the filter
+void ShadowCost(const std::string& subroutine, GLuint &fetches, GLuint &filterTexels);
+
 // in this application, we have isolated the models rendering using a function, which will be called in each rendering step
-void RenderObjects(Shader &shader, Model &planeModel, Model &cubeModel, Model &sphereModel, Model &bunnyModel, GLint render_pass, GLuint depthMap);
+// we calculate the model matrices of the objects for the current frame
+void UpdateModelMatrices();
 
-// load image from disk and create an OpenGL texture
-GLint LoadTexture(const char* path);
+// culling of the shadow casters: it returns the mask of the objects (among the ones in the objects mask) which must be rendered in the shadow map
+GLuint CullShadowCasters(const glm::mat4& lightSpaceMatrix, const Frustum& cameraFrustum, GLuint objects, GLboolean receiverAware);
+
+// the objects parameter is a mask of scene_objects values: only the objects in the mask are rendered
+void RenderObjects(Shader &shader, Model &planeModel, Model &cubeModel, Model &sphereModel, Model &bunnyModel, GLint render_pass, GLuint depthMap, GLuint objects = ALL_OBJECTS);
 
 // we initialize an array of booleans for each keyboard key
 bool keys[1024];
@@ -139,6 +173,13 @@ GLboolean spinning = GL_TRUE;
 // boolean to activate/deactivate wireframe rendering
 GLboolean wireframe = GL_FALSE;
 
+// boolean to activate/deactivate the depth pre-pass
+GLboolean depthPrepass = GL_FALSE;
+// boolean to activate/deactivate the measurement of the shaded fragments (using occlusion queries)
+GLboolean measureFragments = GL_FALSE;
+// statistics printed on console in measurement mode
+FrameStats stats;
+
 // View matrix: the camera moves, so we just set to indentity now
 glm::mat4 view = glm::mat4(1.0f);
 
@@ -162,6 +203,36 @@ glm::vec3 lightDir0 = glm::vec3(1.0f, 1.0f, 1.0f);
 glm::mat4 lightProjection, lightView, lightSpaceMatrix;
 GLfloat near_plane = -10.0f, far_plane = 10.0f, frustumSize = 5.0f;
 
+// parameters for the Cascaded Shadow Maps: number of cascades, and far distance of the last cascade from the camera
+GLuint numCascades = 3;
+GLfloat shadowDistance = 30.0f;
+// boolean to activate/deactivate the visualization of the cascades
+GLboolean showCascades = GL_FALSE;
+
+// boolean to activate/deactivate the cached shadow map for the static casters
+GLboolean cachedShadows = GL_FALSE;
+// validity of the cached shadow map (global, because the change of the culling of the casters in the keyboard callback invalidates it)
+GLboolean cacheValid = GL_FALSE;
+
+// radius (in texels) of the gaussian blur applied to the filterable shadow map of VSM and ESM
+GLint blurRadius = 2;
+// exponent of ESM
+GLfloat esmExponent = 80.0f;
+
+// parameters of the benchmark of the shadow techniques: each subroutine is used for BENCHMARK_FRAMES frames, and the first BENCHMARK_WARMUP frames are not considered in the averages
+#define BENCHMARK_FRAMES 120
+#define BENCHMARK_WARMUP 5
+GLboolean benchmark = GL_FALSE;
+GLuint benchmarkFrame = 0, benchmarkSamples = 0, benchmarkPreviousSubroutine = 0;
+double benchmarkShadowMs = 0.0, benchmarkColorMs = 0.0;
+// rotation speed of the light around the Y axis (LEFT and RIGHT arrow keys)
+GLfloat light_speed = 30.0f;
+
+// current mode for the culling of the shadow casters
+GLuint casterCulling = NO_CASTER_CULLING;
+// bounding spheres of the models (in model coordinates), used for the culling of the shadow casters
+BoundingSphere planeBounds, sphereBounds, cubeBounds, bunnyBounds;
+
 // weight for the diffusive component
 GLfloat Kd = 3.0f;
 // roughness index for GGX shader
@@ -169,13 +240,16 @@ GLfloat alpha = 0.2f;
 // Fresnel reflectance at 0 degree (Schlik's approximation)
 GLfloat F0 = 0.9f;
 
-// vector for the textures IDs
-vector<GLint> textureID;
+// library of the materials: the textures are packed in the layers of texture arrays. We use layers of 512x512 texels, so the two textures of the scene
+// (1024x1024 and 340x340) are in the same array
+MaterialLibrary materials(512);
+// materials of the plane and of the other objects
+GLuint planeMaterial, objectMaterial;
 
 // UV repetitions
 GLfloat repeat = 1.0;
 // variables used to store uniform location inside shaders
-GLint lightDirLocation, kdLocation, alphaLocation, f0Location, textureLocation, repeatLocation, shadowLocation;
+GLint lightDirLocation, kdLocation, alphaLocation, f0Location, textureLocation, layerLocation, repeatLocation, shadowLocation;
 
 /////////////////// MAIN function ///////////////////////
 int main()
@@ -232,6 +306,11 @@ int main()
     Shader shadow_shader("19_shadowmap.vert", "20_shadowmap.frag");
     // we create the Shader Program used for objects (which presents different subroutines we can switch)
     Shader illumination_shader = Shader("21_ggx_tex_shadow.vert", "22_ggx_tex_shadow.frag");
+    // we create the Shader Program for the depth pre-pass (position only, and the same "empty" fragment shader of the shadow map)
+    Shader depth_shader("25_depth_prepass.vert", "20_shadowmap.frag");
+    // we create the Shader Programs for the filterable shadow map (VSM and ESM), and for its blur
+    Shader moments_shader("19_shadowmap.vert", "31_shadow_moments.frag");
+    Shader blur_shader("32_fullscreen.vert", "33_gaussian_blur.frag");
 
     // we parse the Shader Program to search for the number and names of the subroutines.
     // the names are placed in the shaders vector
@@ -239,9 +318,11 @@ int main()
     // we print on console the name of the first subroutine used
     PrintCurrentShader(current_subroutine);
 
-    // we load the images and store them in a vector
-    textureID.push_back(LoadTexture("../../textures/UV_Grid_Sm.png"));
-    textureID.push_back(LoadTexture("../../textures/SoilCracked.png"));
+    // we load the images of the materials, and we create the texture arrays
+    objectMaterial = materials.Add("../../textures/UV_Grid_Sm.png");
+    planeMaterial = materials.Add("../../textures/SoilCracked.png");
+    materials.Build();
+    materials.PrintStats();
 
     // we load the model(s) (code of Model class is in include/utils/model.h)
     Model cubeModel("../../models/cube.obj");
@@ -249,6 +330,12 @@ int main()
     Model bunnyModel("../../models/bunny_lp.obj");
     Model planeModel("../../models/plane.obj");
 
+    // we calculate the bounding spheres of the models
+    planeBounds = ComputeModelBoundingSphere(planeModel);
+    sphereBounds = ComputeModelBoundingSphere(sphereModel);
+    cubeBounds = ComputeModelBoundingSphere(cubeModel);
+    bunnyBounds = ComputeModelBoundingSphere(bunnyModel);
+
     /////////////////// CREATION OF BUFFER FOR THE  DEPTH MAP /////////////////////////////////////////
     // buffer dimension: too large -> performance may slow down if we have many lights; too small -> strong aliasing
     const GLuint SHADOW_WIDTH = 1024, SHADOW_HEIGHT = 1024;
@@ -260,7 +347,8 @@ int main()
     glGenTextures(1, &depthMap);
     glBindTexture(GL_TEXTURE_2D, depthMap);
     // in the texture, we will save only the depth data of the fragments. Thus, we specify that we need to render only depth in the first rendering step
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    // N.B.) we use an explicit (sized) format, because the cached shadow map (see below) is copied in this texture, and the copy of the depth requires the same format
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     // we set to clamp the uv coordinates outside [0,1] to the color of the border
@@ -282,10 +370,96 @@ int main()
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     ///////////////////////////////////////////////////////////////////
 
+    /////////////////// CREATION OF THE BUFFER FOR THE CACHED SHADOW MAP /////////////////////////////////////////
+    // the static casters are rendered in this buffer only when the cache is invalid. It is never sampled by the shaders (it is only copied in the shadow map), so we can use a renderbuffer
+    GLuint staticDepthFBO, staticDepthBuffer;
+    glGenFramebuffers(1, &staticDepthFBO);
+    glGenRenderbuffers(1, &staticDepthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, staticDepthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, SHADOW_WIDTH, SHADOW_HEIGHT);
+    glBindFramebuffer(GL_FRAMEBUFFER, staticDepthFBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, staticDepthBuffer);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // state of the cache: the light direction and the static casters used to render it
+    glm::vec3 cachedLightDir;
+    GLuint cachedStaticObjects = 0;
+    ///////////////////////////////////////////////////////////////////
+
+    /////////////////// SAMPLER OBJECT FOR THE HARDWARE COMPARISON /////////////////////////////////////////
+    // a sampler object overrides the sampling parameters of the texture bound to the same texture unit: in this way, the same depth map can be read as a standard texture
+    // (in the texture unit 2, for the other subroutines) and with depth comparison (in the texture unit 4, for the sampler2DShadow of Shadow_PCF_Hardware)
+    GLuint compareSampler;
+    glGenSamplers(1, &compareSampler);
+    // with GL_LINEAR, the results of the comparisons on the 4 nearest texels are interpolated
+    glSamplerParameteri(compareSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glSamplerParameteri(compareSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glSamplerParameteri(compareSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glSamplerParameteri(compareSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glSamplerParameterfv(compareSampler, GL_TEXTURE_BORDER_COLOR, borderColor);
+    // the result of a fetch is 1 if the reference value (the depth of the fragment) is <= the value in the texture (= the fragment is in light)
+    glSamplerParameteri(compareSampler, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glSamplerParameteri(compareSampler, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    ///////////////////////////////////////////////////////////////////
+
+    /////////////////// CREATION OF THE BUFFERS FOR THE FILTERABLE SHADOW MAP (VSM and ESM) /////////////////////////////////////////
+    // we use 2 textures: the moments are rendered in the first one, then the horizontal blur writes in the second one, and the vertical blur writes back in the first one
+    // the shadow map is blurred, so we can use a lower resolution than the depth map
+    const GLuint MOMENTS_SIZE = 512;
+    GLuint momentsFBO[2], momentsMap[2], momentsDepth;
+    glGenFramebuffers(2, momentsFBO);
+    glGenTextures(2, momentsMap);
+    // outside the light frustum, the values correspond to depth = 1 (= in light)
+    GLfloat momentsBorder[] = { 1.0f, 1.0f, expf(esmExponent), 1.0f };
+    for (GLuint i = 0; i < 2; i++)
+    {
+        glBindTexture(GL_TEXTURE_2D, momentsMap[i]);
+        // exp(esmExponent * depth) requires 32 bit floating point values
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, MOMENTS_SIZE, MOMENTS_SIZE, 0, GL_RGBA, GL_FLOAT, NULL);
+        // unlike the depth map, the moments can be filtered
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, momentsBorder);
+        glBindFramebuffer(GL_FRAMEBUFFER, momentsFBO[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, momentsMap[i], 0);
+    }
+    // the rendering of the moments needs a depth buffer (only in the first FBO: the blur passes do not use the depth test)
+    glGenRenderbuffers(1, &momentsDepth);
+    glBindRenderbuffer(GL_RENDERBUFFER, momentsDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, MOMENTS_SIZE, MOMENTS_SIZE);
+    glBindFramebuffer(GL_FRAMEBUFFER, momentsFBO[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, momentsDepth);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // the fullscreen triangle of the blur is generated in the vertex shader, but in Core profile a VAO must be bound anyway
+    GLuint fullscreenVAO;
+    glGenVertexArrays(1, &fullscreenVAO);
+    ///////////////////////////////////////////////////////////////////
+
+    /////////////////// CREATION OF THE CASCADED SHADOW MAPS /////////////////////////////////////////
+    // each cascade covers only a part of the visible scene: 512x512 texels for each cascade give a resolution comparable (near the camera, even higher) to the 1024x1024 map covering a fixed area
+    ShadowCascades cascades(numCascades, 512);
+    std::cout << "Shadow map memory: single map " << (SHADOW_WIDTH*SHADOW_HEIGHT*4)/1024 << " KB - cascades " << cascades.MemorySize()/1024 << " KB" << std::endl;
+    ///////////////////////////////////////////////////////////////////
+
 
     // Projection matrix of the camera: FOV angle, aspect ratio, near and far planes
     glm::mat4 projection = glm::perspective(45.0f, (float)screenWidth/(float)screenHeight, 0.1f, 10000.0f);
 
+    /////////////////// QUERIES FOR THE MEASUREMENT MODE /////////////////////////////////////////
+    // we use two sets of queries: the queries of the current frame are issued, while the results of the queries of the previous frame are read
+    // in this way, we do not stall the CPU waiting for the completion of the rendering on the GPU
+    GLuint samplesQuery[2], timeQuery[2], shadowTimeQuery[2];
+    GLboolean queryIssued[2] = {GL_FALSE, GL_FALSE};
+    GLuint currentQuery = 0;
+    glGenQueries(2, samplesQuery);
+    glGenQueries(2, timeQuery);
+    glGenQueries(2, shadowTimeQuery);
+    stats.enabled = GL_FALSE;
+    ///////////////////////////////////////////////////////////////////
+
     // Rendering loop: this code is executed at each frame
     while(!glfwWindowShouldClose(window))
     {
@@ -300,31 +474,144 @@ int main()
         // we apply FPS camera movements
         apply_camera_movements();
 
+        // the GPU queries are used both in measurement mode and during the benchmark
+        GLboolean measuring = measureFragments || benchmark;
+
+        // if one of the LEFT and RIGHT arrow keys is pressed, we rotate the light direction around the Y axis
+        if (keys[GLFW_KEY_LEFT] ^ keys[GLFW_KEY_RIGHT])
+        {
+            GLfloat angle = (keys[GLFW_KEY_LEFT] ? 1.0f : -1.0f) * light_speed * deltaTime;
+            lightDir0 = glm::vec3(glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::vec4(lightDir0, 0.0f));
+        }
+
+        // we get the view matrix from the Camera class (the Cascaded Shadow Maps are fitted on the camera frustum, so we need it already in the first step)
+        view = camera.GetViewMatrix();
+
+        // if animated rotation is activated, than we increment the rotation angle using delta time and the rotation speed parameter
+        if (spinning)
+            orientationY+=(deltaTime*spin_speed);
+        // we calculate the model matrices, used in both the rendering steps
+        UpdateModelMatrices();
+
+        // frustum of the camera, for the receiver-aware culling of the shadow casters
+        Frustum cameraFrustum(projection * view);
+        GLboolean receiverAware = (casterCulling == RECEIVER_CULLING);
+        // the casters between the light and the near plane of the light frustum are not culled: we clamp their depth to the near plane, instead of clipping them
+        if (casterCulling != NO_CASTER_CULLING)
+            glEnable(GL_DEPTH_CLAMP);
+
         /////////////////// STEP 1 - SHADOW MAP: RENDERING OF SCENE FROM LIGHT POINT OF VIEW ////////////////////////////////////////////////
-        // we set view and projection matrix for the rendering using light as a camera
-        // for a directional light, the projection is orthographic. For point lights, we should use a perspective projection
-        lightProjection = glm::ortho(-frustumSize, frustumSize, -frustumSize, frustumSize, near_plane, far_plane);
-        // the light is directional, so technically it has no position. We need a view matrix, so we consider a position on the direction vector of the light
-        lightView = glm::lookAt(lightDir0, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        // transformation matrix for the light
-        lightSpaceMatrix = lightProjection * lightView;
+        // in measurement mode, we measure also the GPU time of the shadow pass
+        if (measuring)
+            glBeginQuery(GL_TIME_ELAPSED, shadowTimeQuery[currentQuery]);
+
         /// We "install" the  Shader Program for the shadow mapping creation
         shadow_shader.Use();
-        // we pass the transformation matrix as uniform
-        glUniformMatrix4fv(glGetUniformLocation(shadow_shader.Program, "lightSpaceMatrix"), 1, GL_FALSE, glm::value_ptr(lightSpaceMatrix));
-        // we set the viewport for the first rendering step = dimensions of the depth texture
-        glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-        // we activate the FBO for the depth map rendering
-        glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-        glClear(GL_DEPTH_BUFFER_BIT);
+        if (shaders[current_subroutine] == "Shadow_Cascaded")
+        {
+            // we split the camera frustum, and we calculate the light matrices for each partition
+            // N.B.) the parameters must be the same of the camera projection
+            cascades.SetNumCascades(numCascades);
+            cascades.Update(view, 45.0f, (float)screenWidth/(float)screenHeight, 0.1f, shadowDistance, lightDir0);
+            // we render the scene in each layer of the texture array
+            for (GLuint i = 0; i < cascades.numCascades; i++)
+            {
+                glUniformMatrix4fv(glGetUniformLocation(shadow_shader.Program, "lightSpaceMatrix"), 1, GL_FALSE, glm::value_ptr(cascades.lightSpaceMatrices[i]));
+                cascades.BindForWriting(i);
+                RenderObjects(shadow_shader, planeModel, cubeModel, sphereModel, bunnyModel, SHADOWMAP, depthMap, CullShadowCasters(cascades.lightSpaceMatrices[i], cameraFrustum, ALL_OBJECTS, receiverAware));
+            }
+        }
+        else
+        {
+            // we set view and projection matrix for the rendering using light as a camera
+            // for a directional light, the projection is orthographic. For point lights, we should use a perspective projection
+            lightProjection = glm::ortho(-frustumSize, frustumSize, -frustumSize, frustumSize, near_plane, far_plane);
+            // the light is directional, so technically it has no position. We need a view matrix, so we consider a position on the direction vector of the light
+            lightView = glm::lookAt(lightDir0, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+            // transformation matrix for the light
+            lightSpaceMatrix = lightProjection * lightView;
+            // we pass the transformation matrix as uniform
+            glUniformMatrix4fv(glGetUniformLocation(shadow_shader.Program, "lightSpaceMatrix"), 1, GL_FALSE, glm::value_ptr(lightSpaceMatrix));
+            // we set the viewport for the first rendering step = dimensions of the depth texture
+            glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
+
+            if (shaders[current_subroutine] == "Shadow_VSM" || shaders[current_subroutine] == "Shadow_ESM")
+            {
+                // we render the moments in the filterable shadow map, using the same light matrix
+                moments_shader.Use();
+                glUniformMatrix4fv(glGetUniformLocation(moments_shader.Program, "lightSpaceMatrix"), 1, GL_FALSE, glm::value_ptr(lightSpaceMatrix));
+                glUniform1f(glGetUniformLocation(moments_shader.Program, "esmExponent"), esmExponent);
+                glViewport(0, 0, MOMENTS_SIZE, MOMENTS_SIZE);
+                glBindFramebuffer(GL_FRAMEBUFFER, momentsFBO[0]);
+                // the areas without casters have depth = 1
+                glClearColor(1.0f, 1.0f, expf(esmExponent), 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                glClearColor(0.26f, 0.46f, 0.98f, 1.0f);
+                RenderObjects(moments_shader, planeModel, cubeModel, sphereModel, bunnyModel, SHADOWMAP, depthMap, CullShadowCasters(lightSpaceMatrix, cameraFrustum, ALL_OBJECTS, receiverAware));
+
+                // separable gaussian blur: horizontal pass (momentsMap[0] -> momentsMap[1]), then vertical pass (momentsMap[1] -> momentsMap[0])
+                if (blurRadius > 0)
+                {
+                    blur_shader.Use();
+                    glUniform1i(glGetUniformLocation(blur_shader.Program, "radius"), blurRadius);
+                    glUniform1i(glGetUniformLocation(blur_shader.Program, "image"), 0);
+                    glDisable(GL_DEPTH_TEST);
+                    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+                    glBindVertexArray(fullscreenVAO);
+                    glActiveTexture(GL_TEXTURE0);
+                    for (GLuint pass = 0; pass < 2; pass++)
+                    {
+                        glBindFramebuffer(GL_FRAMEBUFFER, momentsFBO[1 - pass]);
+                        glBindTexture(GL_TEXTURE_2D, momentsMap[pass]);
+                        glUniform2f(glGetUniformLocation(blur_shader.Program, "direction"), (pass == 0) ? 1.0f : 0.0f, (pass == 0) ? 0.0f : 1.0f);
+                        glDrawArrays(GL_TRIANGLES, 0, 3);
+                    }
+                    glBindVertexArray(0);
+                    glEnable(GL_DEPTH_TEST);
+                }
+            }
+            else if (cachedShadows)
+            {
+                // the plane is always static, while the other objects are static only if they are not rotating
+                GLuint staticObjects = spinning ? PLANE_OBJECT : ALL_OBJECTS;
+                // if the light or the set of static casters has changed, we render again the static casters in the cache
+                if (!cacheValid || lightDir0 != cachedLightDir || staticObjects != cachedStaticObjects)
+                {
+                    glBindFramebuffer(GL_FRAMEBUFFER, staticDepthFBO);
+                    glClear(GL_DEPTH_BUFFER_BIT);
+                    // N.B.) the cache does not depend on the camera, so we do not apply the receiver-aware culling to the static casters
+                    RenderObjects(shadow_shader, planeModel, cubeModel, sphereModel, bunnyModel, SHADOWMAP, depthMap, CullShadowCasters(lightSpaceMatrix, cameraFrustum, staticObjects, GL_FALSE));
+                    cacheValid = GL_TRUE;
+                    cachedLightDir = lightDir0;
+                    cachedStaticObjects = staticObjects;
+                    stats.Add("shadow cache updates", 1);
+                }
+                // we copy the depth of the static casters in the shadow map (the copy is much cheaper than the rendering of the static casters)
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, staticDepthFBO);
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, depthMapFBO);
+                glBlitFramebuffer(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT, 0, 0, SHADOW_WIDTH, SHADOW_HEIGHT, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+                // we render only the dynamic casters on top of the static ones (if all the objects are static, nothing is rendered)
+                glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+                if (staticObjects != ALL_OBJECTS)
+                    RenderObjects(shadow_shader, planeModel, cubeModel, sphereModel, bunnyModel, SHADOWMAP, depthMap, CullShadowCasters(lightSpaceMatrix, cameraFrustum, ALL_OBJECTS & ~staticObjects, receiverAware));
+            }
+            else
+            {
+                // we activate the FBO for the depth map rendering
+                glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+                glClear(GL_DEPTH_BUFFER_BIT);
+
+                // we render the scene, using the shadow shader
+                RenderObjects(shadow_shader, planeModel, cubeModel, sphereModel, bunnyModel, SHADOWMAP, depthMap, CullShadowCasters(lightSpaceMatrix, cameraFrustum, ALL_OBJECTS, receiverAware));
+            }
+        }
 
-        // we render the scene, using the shadow shader
-        RenderObjects(shadow_shader, planeModel, cubeModel, sphereModel, bunnyModel, SHADOWMAP, depthMap);
+        glDisable(GL_DEPTH_CLAMP);
 
-        /////////////////// STEP 2 - SCENE RENDERING FROM CAMERA ////////////////////////////////////////////////
+        if (measuring)
+            glEndQuery(GL_TIME_ELAPSED);
 
-        // we get the view matrix from the Camera class
-        view = camera.GetViewMatrix();
+        /////////////////// STEP 2 - SCENE RENDERING FROM CAMERA ////////////////////////////////////////////////
 
         // we activate back the standard Frame Buffer
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -339,13 +626,33 @@ int main()
         else
             glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-        // if animated rotation is activated, than we increment the rotation angle using delta time and the rotation speed parameter
-        if (spinning)
-            orientationY+=(deltaTime*spin_speed);
-
         // we set the viewport for the final rendering step
         glViewport(0, 0, width, height);
 
+        // DEPTH PRE-PASS: we render only the depth of the scene, using the position-only Shader Program
+        if (depthPrepass)
+        {
+            depth_shader.Use();
+            glUniformMatrix4fv(glGetUniformLocation(depth_shader.Program, "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(projection));
+            glUniformMatrix4fv(glGetUniformLocation(depth_shader.Program, "viewMatrix"), 1, GL_FALSE, glm::value_ptr(view));
+            // we do not write the color buffer
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            RenderObjects(depth_shader, planeModel, cubeModel, sphereModel, bunnyModel, DEPTH_PREPASS, depthMap);
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+            // in the color pass, only the fragments with the same depth saved in the depth buffer (= the visible ones) are shaded
+            // the depth buffer is already complete, so we do not need to write it again
+            glDepthFunc(GL_EQUAL);
+            glDepthMask(GL_FALSE);
+        }
+
+        // in measurement mode, we count the fragments passing the depth test in the color pass (= the shaded fragments), and the GPU time of the pass
+        if (measuring)
+        {
+            glBeginQuery(GL_SAMPLES_PASSED, samplesQuery[currentQuery]);
+            glBeginQuery(GL_TIME_ELAPSED, timeQuery[currentQuery]);
+        }
+
         // We "install" the selected Shader Program as part of the current rendering process. We pass to the shader the light transformation matrix, and the depth map rendered in the first rendering step
         illumination_shader.Use();
          // we search inside the Shader Program the name of the subroutine currently selected, and we get the numerical index
@@ -357,6 +664,19 @@ int main()
         glUniformMatrix4fv(glGetUniformLocation(illumination_shader.Program, "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(projection));
         glUniformMatrix4fv(glGetUniformLocation(illumination_shader.Program, "viewMatrix"), 1, GL_FALSE, glm::value_ptr(view));
         glUniformMatrix4fv(glGetUniformLocation(illumination_shader.Program, "lightSpaceMatrix"), 1, GL_FALSE, glm::value_ptr(lightSpaceMatrix));
+        // we pass the texture array and the data of the cascades (we bind the texture array also when it is not used, to avoid having samplers of different types on the same texture unit)
+        cascades.BindForReading(illumination_shader.Program, 3);
+        glUniform1i(glGetUniformLocation(illumination_shader.Program, "showCascades"), showCascades);
+        // we bind the depth map also to the texture unit 4, with the sampler object for the hardware comparison
+        glActiveTexture(GL_TEXTURE4);
+        glBindTexture(GL_TEXTURE_2D, depthMap);
+        glBindSampler(4, compareSampler);
+        glUniform1i(glGetUniformLocation(illumination_shader.Program, "shadowMapCompare"), 4);
+        // we bind the filterable shadow map to the texture unit 5
+        glActiveTexture(GL_TEXTURE5);
+        glBindTexture(GL_TEXTURE_2D, momentsMap[0]);
+        glUniform1i(glGetUniformLocation(illumination_shader.Program, "shadowMoments"), 5);
+        glUniform1f(glGetUniformLocation(illumination_shader.Program, "esmExponent"), esmExponent);
 
         // we determine the position in the Shader Program of the uniform variables
         lightDirLocation = glGetUniformLocation(illumination_shader.Program, "lightVector");
@@ -373,24 +693,191 @@ int main()
         // we render the scene
         RenderObjects(illumination_shader, planeModel, cubeModel, sphereModel, bunnyModel, RENDER, depthMap);
 
+        if (measuring)
+        {
+            glEndQuery(GL_TIME_ELAPSED);
+            glEndQuery(GL_SAMPLES_PASSED);
+            queryIssued[currentQuery] = GL_TRUE;
+
+            // we read the results of the queries of the previous frame, only if all of them are available: otherwise, GL_QUERY_RESULT would stall the CPU
+            // until the GPU completes them, and we skip the results of this frame
+            GLuint previousQuery = 1 - currentQuery;
+            GLint available = 0;
+            if (queryIssued[previousQuery])
+            {
+                GLint samplesAvailable = 0, timeAvailable = 0, shadowTimeAvailable = 0;
+                glGetQueryObjectiv(samplesQuery[previousQuery], GL_QUERY_RESULT_AVAILABLE, &samplesAvailable);
+                glGetQueryObjectiv(timeQuery[previousQuery], GL_QUERY_RESULT_AVAILABLE, &timeAvailable);
+                glGetQueryObjectiv(shadowTimeQuery[previousQuery], GL_QUERY_RESULT_AVAILABLE, &shadowTimeAvailable);
+                available = samplesAvailable && timeAvailable && shadowTimeAvailable;
+            }
+            if (available)
+            {
+                GLuint samples;
+                GLuint64 elapsed, shadowElapsed;
+                glGetQueryObjectuiv(samplesQuery[previousQuery], GL_QUERY_RESULT, &samples);
+                glGetQueryObjectui64v(timeQuery[previousQuery], GL_QUERY_RESULT, &elapsed);
+                glGetQueryObjectui64v(shadowTimeQuery[previousQuery], GL_QUERY_RESULT, &shadowElapsed);
+                stats.Add("shaded fragments", samples);
+                // average number of shaded fragments for each pixel of the window (= 1 if each pixel is shaded once)
+                stats.Add("fragments/pixel", (double)samples / (width*height));
+                stats.Add("color pass GPU ms", elapsed / 1000000.0);
+                stats.Add("shadow pass GPU ms", shadowElapsed / 1000000.0);
+                // during the benchmark, we accumulate the GPU times (the first frames of each subroutine are skipped, because the results are read with a delay of a frame)
+                if (benchmark && benchmarkFrame >= BENCHMARK_WARMUP)
+                {
+                    benchmarkShadowMs += shadowElapsed / 1000000.0;
+                    benchmarkColorMs += elapsed / 1000000.0;
+                    benchmarkSamples++;
+                }
+            }
+            currentQuery = previousQuery;
+        }
+
+        // we restore the default depth test
+        if (depthPrepass)
+        {
+            glDepthFunc(GL_LESS);
+            glDepthMask(GL_TRUE);
+        }
+
         // Swapping back and front buffers
         glfwSwapBuffers(window);
+
+        // in measurement mode, the statistics are printed every second
+        stats.EndFrame();
+
+        // benchmark: after BENCHMARK_FRAMES frames, we print the results for the current subroutine, and we move to the next one
+        if (benchmark && ++benchmarkFrame == BENCHMARK_FRAMES)
+        {
+            GLuint fetches, filterTexels;
+            ShadowCost(shaders[current_subroutine], fetches, filterTexels);
+            GLuint n = glm::max(benchmarkSamples, 1u);
+            std::cout << shaders[current_subroutine] << ": " << fetches << " fetches/fragment - filter area " << filterTexels << " texels - shadow pass "
+                      << benchmarkShadowMs / n << " ms - color pass " << benchmarkColorMs / n << " ms" << std::endl;
+            benchmarkFrame = benchmarkSamples = 0;
+            benchmarkShadowMs = benchmarkColorMs = 0.0;
+            if (++current_subroutine == shaders.size())
+            {
+                // at the end, we restore the subroutine used before the benchmark
+                benchmark = GL_FALSE;
+                current_subroutine = benchmarkPreviousSubroutine;
+                std::cout << "Benchmark completed" << std::endl;
+                PrintCurrentShader(current_subroutine);
+            }
+        }
     }
 
     // when I exit from the graphics loop, it is because the application is closing
     // we delete the Shader Programs
     illumination_shader.Delete();
     shadow_shader.Delete();
+    depth_shader.Delete();
+    moments_shader.Delete();
+    blur_shader.Delete();
+    glDeleteSamplers(1, &compareSampler);
+    glDeleteTextures(2, momentsMap);
+    glDeleteFramebuffers(2, momentsFBO);
+    glDeleteRenderbuffers(1, &momentsDepth);
+    glDeleteVertexArrays(1, &fullscreenVAO);
+    glDeleteQueries(2, samplesQuery);
+    glDeleteQueries(2, timeQuery);
+    glDeleteQueries(2, shadowTimeQuery);
+    glDeleteRenderbuffers(1, &staticDepthBuffer);
+    glDeleteFramebuffers(1, &staticDepthFBO);
+    // we delete the texture arrays of the materials (the OpenGL context must still exist)
+    materials.Clear();
     // chiudo e cancello il contesto creato
     glfwTerminate();
     return 0;
 }
 
 
+//////////////////////////////////////////
+// we calculate the model matrices of the objects for the current frame. The matrices are calculated once, before the rendering steps, because
+// they are used also for the culling of the shadow casters
+void UpdateModelMatrices()
+{
+    // N.B.) the last defined is the first applied
+    // PLANE
+    planeModelMatrix = glm::mat4(1.0f);
+    planeModelMatrix = glm::translate(planeModelMatrix, glm::vec3(0.0f, -1.0f, 0.0f));
+    planeModelMatrix = glm::scale(planeModelMatrix, glm::vec3(10.0f, 1.0f, 10.0f));
+
+    // SPHERE
+    sphereModelMatrix = glm::mat4(1.0f);
+    sphereModelMatrix = glm::translate(sphereModelMatrix, glm::vec3(-3.0f, 1.0f, 0.0f));
+    sphereModelMatrix = glm::rotate(sphereModelMatrix, glm::radians(orientationY), glm::vec3(0.0f, 1.0f, 0.0f));
+    sphereModelMatrix = glm::scale(sphereModelMatrix, glm::vec3(0.8f, 0.8f, 0.8f));
+
+    // CUBE
+    cubeModelMatrix = glm::mat4(1.0f);
+    cubeModelMatrix = glm::translate(cubeModelMatrix, glm::vec3(0.0f, 1.0f, 0.0f));
+    cubeModelMatrix = glm::rotate(cubeModelMatrix, glm::radians(orientationY), glm::vec3(0.0f, 1.0f, 0.0f));
+    cubeModelMatrix = glm::scale(cubeModelMatrix, glm::vec3(0.8f, 0.8f, 0.8f));
+
+    // BUNNY
+    bunnyModelMatrix = glm::mat4(1.0f);
+    bunnyModelMatrix = glm::translate(bunnyModelMatrix, glm::vec3(3.0f, 1.0f, 0.0f));
+    bunnyModelMatrix = glm::rotate(bunnyModelMatrix, glm::radians(orientationY), glm::vec3(0.0f, 1.0f, 0.0f));
+    bunnyModelMatrix = glm::scale(bunnyModelMatrix, glm::vec3(0.3f, 0.3f, 0.3f));
+}
+
+//////////////////////////////////////////
+// culling of the shadow casters: we test the bounding sphere of each object in the objects mask, and we return the mask of the objects to render in the shadow map
+GLuint CullShadowCasters(const glm::mat4& lightSpaceMatrix, const Frustum& cameraFrustum, GLuint objects, GLboolean receiverAware)
+{
+    const GLuint bits[4] = { PLANE_OBJECT, SPHERE_OBJECT, CUBE_OBJECT, BUNNY_OBJECT };
+    const BoundingSphere* bounds[4] = { &planeBounds, &sphereBounds, &cubeBounds, &bunnyBounds };
+    const glm::mat4* modelMatrices[4] = { &planeModelMatrix, &sphereModelMatrix, &cubeModelMatrix, &bunnyModelMatrix };
+
+    if (casterCulling == NO_CASTER_CULLING)
+    {
+        for (int i = 0; i < 4; i++)
+            if (objects & bits[i])
+                stats.Add("shadow casters rendered", 1);
+        return objects;
+    }
+
+    Frustum lightFrustum(lightSpaceMatrix);
+    // direction of propagation of the light (the opposite of the direction towards the light)
+    glm::vec3 lightPropagation = -glm::normalize(lightDir0);
+
+    GLuint visible = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        if (!(objects & bits[i]))
+            continue;
+        BoundingSphere sphere = TransformBoundingSphere(*bounds[i], *modelMatrices[i]);
+
+        // the object is outside the light frustum (not considering the near plane)
+        if (!lightFrustum.IsCasterVisible(sphere))
+        {
+            stats.Add("shadow casters culled (light)", 1);
+            continue;
+        }
+        // the shadow of the object can reach at most the far plane of the light frustum: if the volume swept by the object until the far plane is outside the camera frustum,
+        // the shadow is not visible
+        if (receiverAware)
+        {
+            GLfloat sweepLength = glm::max(lightFrustum.Distance(FAR_PLANE, sphere.center), 0.0f);
+            if (!IsShadowVisible(cameraFrustum, sphere, lightPropagation * sweepLength))
+            {
+                stats.Add("shadow casters culled (receiver)", 1);
+                continue;
+            }
+        }
+        visible |= bits[i];
+        stats.Add("shadow casters rendered", 1);
+    }
+    return visible;
+}
+
 //////////////////////////////////////////
 // we render the objects. We pass also the current rendering step, and the depth map generated in the first step, which is used by the shaders of the second step
-void RenderObjects(Shader &shader, Model &planeModel, Model &cubeModel, Model &sphereModel, Model &bunnyModel, GLint render_pass, GLuint depthMap)
+void RenderObjects(Shader &shader, Model &planeModel, Model &cubeModel, Model &sphereModel, Model &bunnyModel, GLint render_pass, GLuint depthMap, GLuint objects)
 {
+    // N.B.) in the SHADOWMAP and DEPTH_PREPASS steps, the Shader Programs use only the model matrix: the other uniforms are ignored (glUniform calls on location -1 are silently ignored)
     // For the second rendering step -> we pass the shadow map to the shaders
     if (render_pass==RENDER)
     {
@@ -400,122 +887,71 @@ void RenderObjects(Shader &shader, Model &planeModel, Model &cubeModel, Model &s
         glUniform1i(shadowLocation, 2);
     }
     // we pass the needed uniforms
-    textureLocation = glGetUniformLocation(shader.Program, "tex");
+    // the texture arrays of the materials use the texture unit 1: an array is bound only if it is different from the one bound for the previous draw call
+    textureLocation = glGetUniformLocation(shader.Program, "materialTextures");
+    layerLocation = glGetUniformLocation(shader.Program, "materialLayer");
     repeatLocation = glGetUniformLocation(shader.Program, "repeat");
+    glUniform1i(textureLocation, 1);
+    GLuint boundArray = 0;
 
     // PLANE
-    // we activate the texture of the plane
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, textureID[1]);
-    glUniform1i(textureLocation, 1);
+    // we select the material of the plane
+    GLuint previousArray = boundArray;
+    boundArray = materials.Bind(planeMaterial, 1, layerLocation, boundArray);
+    if (render_pass==RENDER && boundArray != previousArray)
+        stats.Add("material array binds", 1);
     glUniform1f(repeatLocation, 80.0);
 
     /*
-      we create the transformation matrix
-
-      N.B.) the last defined is the first applied
+      the model matrices have been calculated in UpdateModelMatrices()
 
       We need also the matrix for normals transformation, which is the inverse of the transpose of the 3x3 submatrix (upper left) of the modelview. We do not consider the 4th column because we do not need translations for normals.
       An explanation (where XT means the transpose of X, etc):
         "Two column vectors X and Y are perpendicular if and only if XT.Y=0. If We're going to transform X by a matrix M, we need to transform Y by some matrix N so that (M.X)T.(N.Y)=0. Using the identity (A.B)T=BT.AT, this becomes (XT.MT).(N.Y)=0 => XT.(MT.N).Y=0. If MT.N is the identity matrix then this reduces to XT.Y=0. And MT.N is the identity matrix if and only if N=(MT)-1, i.e. N is the inverse of the transpose of M.
     */
-    // we reset to identity at each frame
-    planeModelMatrix = glm::mat4(1.0f);
-    planeNormalMatrix = glm::mat3(1.0f);
-    planeModelMatrix = glm::translate(planeModelMatrix, glm::vec3(0.0f, -1.0f, 0.0f));
-    planeModelMatrix = glm::scale(planeModelMatrix, glm::vec3(10.0f, 1.0f, 10.0f));
     planeNormalMatrix = glm::inverseTranspose(glm::mat3(view*planeModelMatrix));
     glUniformMatrix4fv(glGetUniformLocation(shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(planeModelMatrix));
     glUniformMatrix3fv(glGetUniformLocation(shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(planeNormalMatrix));
     // we render the plane
-    planeModel.Draw();
+    if (objects & PLANE_OBJECT)
+        planeModel.Draw();
 
     // SPHERE
-    // we activate the texture of the object
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textureID[0]);
-    glUniform1i(textureLocation, 0);
+    // we select the material of the objects: it is in the same texture array of the plane, so only the layer changes
+    previousArray = boundArray;
+    boundArray = materials.Bind(objectMaterial, 1, layerLocation, boundArray);
+    if (render_pass==RENDER && boundArray != previousArray)
+        stats.Add("material array binds", 1);
     glUniform1f(repeatLocation, repeat);
 
-    // we reset to identity at each frame
-    sphereModelMatrix = glm::mat4(1.0f);
-    sphereNormalMatrix = glm::mat3(1.0f);
-    sphereModelMatrix = glm::translate(sphereModelMatrix, glm::vec3(-3.0f, 1.0f, 0.0f));
-    sphereModelMatrix = glm::rotate(sphereModelMatrix, glm::radians(orientationY), glm::vec3(0.0f, 1.0f, 0.0f));
-    sphereModelMatrix = glm::scale(sphereModelMatrix, glm::vec3(0.8f, 0.8f, 0.8f));
     sphereNormalMatrix = glm::inverseTranspose(glm::mat3(view*sphereModelMatrix));
     glUniformMatrix4fv(glGetUniformLocation(shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(sphereModelMatrix));
     glUniformMatrix3fv(glGetUniformLocation(shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(sphereNormalMatrix));
 
     // we render the sphere
-    sphereModel.Draw();
+    if (objects & SPHERE_OBJECT)
+        sphereModel.Draw();
 
     // CUBE
-    // we reset to identity at each frame
-    cubeModelMatrix = glm::mat4(1.0f);
-    cubeNormalMatrix = glm::mat3(1.0f);
-    cubeModelMatrix = glm::translate(cubeModelMatrix, glm::vec3(0.0f, 1.0f, 0.0f));
-    cubeModelMatrix = glm::rotate(cubeModelMatrix, glm::radians(orientationY), glm::vec3(0.0f, 1.0f, 0.0f));
-    cubeModelMatrix = glm::scale(cubeModelMatrix, glm::vec3(0.8f, 0.8f, 0.8f));
     cubeNormalMatrix = glm::inverseTranspose(glm::mat3(view*cubeModelMatrix));
     glUniformMatrix4fv(glGetUniformLocation(shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(cubeModelMatrix));
     glUniformMatrix3fv(glGetUniformLocation(shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(cubeNormalMatrix));
 
     // we render the cube
-    cubeModel.Draw();
+    if (objects & CUBE_OBJECT)
+        cubeModel.Draw();
 
     // BUNNY
-    // we reset to identity at each frame
-    bunnyModelMatrix = glm::mat4(1.0f);
-    bunnyNormalMatrix = glm::mat3(1.0f);
-    bunnyModelMatrix = glm::translate(bunnyModelMatrix, glm::vec3(3.0f, 1.0f, 0.0f));
-    bunnyModelMatrix = glm::rotate(bunnyModelMatrix, glm::radians(orientationY), glm::vec3(0.0f, 1.0f, 0.0f));
-    bunnyModelMatrix = glm::scale(bunnyModelMatrix, glm::vec3(0.3f, 0.3f, 0.3f));
     bunnyNormalMatrix = glm::inverseTranspose(glm::mat3(view*bunnyModelMatrix));
     glUniformMatrix4fv(glGetUniformLocation(shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(bunnyModelMatrix));
     glUniformMatrix3fv(glGetUniformLocation(shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(bunnyNormalMatrix));
 
     // we render the bunny
-    bunnyModel.Draw();
+    if (objects & BUNNY_OBJECT)
+        bunnyModel.Draw();
 
 }
 
-//////////////////////////////////////////
-// we load the image from disk and we create an OpenGL texture
-GLint LoadTexture(const char* path)
-{
-    GLuint textureImage;
-    int w, h, channels;
-    unsigned char* image;
-    image = stbi_load(path, &w, &h, &channels, STBI_rgb);
-
-    if (image == nullptr)
-        std::cout << "Failed to load texture!" << std::endl;
-
-    glGenTextures(1, &textureImage);
-    glBindTexture(GL_TEXTURE_2D, textureImage);
-    // 3 channels = RGB ; 4 channel = RGBA
-    if (channels==3)
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-    else if (channels==4)
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    // we set how to consider UVs outside [0,1] range
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    // we set the filtering for minification and magnification
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST_MIPMAP_NEAREST);
-
-    // we free the memory once we have created an OpenGL texture
-    stbi_image_free(image);
-
-    // we set the binding to 0 once we have finished
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    return textureImage;
-}
-
 ///////////////////////////////////////////
 // The function parses the content of the Shader Program, searches for the Subroutine type names,
 // the subroutines implemented for each type, print the names of the subroutines on the terminal, and add the names of
@@ -563,6 +999,24 @@ void SetupShader(int program)
     }
 }
 
+//////////////////////////////////////////
+// cost of a shadow subroutine: texture fetches for each shaded fragment, and texels of the shadow map considered by the filter (a larger area gives softer shadows)
+// N.B.) for VSM and ESM, the blur has a cost of 2*(2*blurRadius+1) fetches for each texel of the filterable shadow map, independently from the number of shaded fragments
+void ShadowCost(const std::string& subroutine, GLuint &fetches, GLuint &filterTexels)
+{
+    GLuint kernel = 2 * blurRadius + 1;
+    if (subroutine == "Shadow_PCF_Final" || subroutine == "Shadow_Cascaded")
+        fetches = 9, filterTexels = 9;
+    // each fetch with hardware comparison considers 4 texels
+    else if (subroutine == "Shadow_PCF_Hardware")
+        fetches = 4, filterTexels = 9;
+    // the filterable shadow map has half the resolution of the depth map: each of its texels covers 4 texels of the depth map
+    else if (subroutine == "Shadow_VSM" || subroutine == "Shadow_ESM")
+        fetches = 1, filterTexels = 4 * kernel * kernel;
+    else
+        fetches = 1, filterTexels = 1;
+}
+
 /////////////////////////////////////////
 // we print on console the name of the currently used shader subroutine
 void PrintCurrentShader(int subroutine)
@@ -610,6 +1064,67 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     if(key == GLFW_KEY_L && action == GLFW_PRESS)
         wireframe=!wireframe;
 
+    // if Z is pressed, we activate/deactivate the depth pre-pass
+    if(key == GLFW_KEY_Z && action == GLFW_PRESS)
+    {
+        depthPrepass=!depthPrepass;
+        std::cout << "Depth pre-pass: " << (depthPrepass ? "ON" : "OFF") << std::endl;
+    }
+
+    // if O is pressed, we activate/deactivate the measurement of the shaded fragments
+    if(key == GLFW_KEY_O && action == GLFW_PRESS)
+    {
+        measureFragments=!measureFragments;
+        stats.enabled = measureFragments;
+        std::cout << "Measurement of shaded fragments: " << (measureFragments ? "ON" : "OFF") << std::endl;
+    }
+
+    // if C is pressed, we change the number of cascades (2 -> 3 -> 4 -> 2)
+    if(key == GLFW_KEY_C && action == GLFW_PRESS)
+    {
+        numCascades = (numCascades < MAX_CASCADES) ? numCascades + 1 : 2;
+        std::cout << "Number of cascades: " << numCascades << std::endl;
+    }
+
+    // if V is pressed, we activate/deactivate the visualization of the cascades
+    if(key == GLFW_KEY_V && action == GLFW_PRESS)
+        showCascades=!showCascades;
+
+    // if N or M are pressed, we decrease/increase the radius of the blur of the filterable shadow map
+    if((key == GLFW_KEY_N || key == GLFW_KEY_M) && action == GLFW_PRESS)
+    {
+        blurRadius = glm::clamp(blurRadius + (key == GLFW_KEY_M ? 1 : -1), 0, 16);
+        std::cout << "Blur radius: " << blurRadius << " (" << 2 * (2 * blurRadius + 1) << " fetches for each texel of the filterable shadow map)" << std::endl;
+    }
+
+    // if B is pressed, we start the benchmark of the shadow subroutines
+    if(key == GLFW_KEY_B && action == GLFW_PRESS && !benchmark)
+    {
+        benchmark = GL_TRUE;
+        benchmarkPreviousSubroutine = current_subroutine;
+        current_subroutine = 0;
+        benchmarkFrame = benchmarkSamples = 0;
+        benchmarkShadowMs = benchmarkColorMs = 0.0;
+        std::cout << "Benchmark of the shadow subroutines (" << BENCHMARK_FRAMES << " frames each)" << std::endl;
+    }
+
+    // if K is pressed, we activate/deactivate the cached shadow map
+    if(key == GLFW_KEY_K && action == GLFW_PRESS)
+    {
+        cachedShadows=!cachedShadows;
+        std::cout << "Cached shadow map: " << (cachedShadows ? "ON" : "OFF") << std::endl;
+    }
+
+    // if X is pressed, we change the mode for the culling of the shadow casters
+    if(key == GLFW_KEY_X && action == GLFW_PRESS)
+    {
+        const char* modes[NUM_CASTER_CULLING_MODES] = { "OFF", "light frustum", "light frustum + receiver-aware" };
+        casterCulling = (casterCulling + 1) % NUM_CASTER_CULLING_MODES;
+        // the static casters in the cache have been culled (and clamped) with the previous mode: the cache must be rendered again
+        cacheValid = GL_FALSE;
+        std::cout << "Shadow caster culling: " << modes[casterCulling] << std::endl;
+    }
+
     // pressing a key number, we change the shader applied to the models
     // if the key is between 1 and 9, we proceed and check if the pressed key corresponds to
     // a valid subroutine
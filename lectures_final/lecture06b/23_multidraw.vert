@@ -0,0 +1,77 @@
+/*
+23_multidraw.vert: as 09_illumination_models.vert, but model matrix, normal matrix and diffuse color are fetched from a Texture Buffer Object, using the index of the current draw
+
+The index of the draw is provided by an instanced vertex attribute (see include/utils/draw_commands.h):
+- using glMultiDrawElementsIndirect (OpenGL >= 4.3), its value is given by the baseInstance field of each indirect command
+- using the OpenGL 4.1 fallback, its value is set by the application before each draw call
+
+N.B.) "24_multidraw.frag" must be used as fragment shader
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+#version 410 core
+
+// number of texels (vec4) used for each draw in the Texture Buffer Object (must be equal to DRAW_DATA_TEXELS in draw_commands.h)
+#define DRAW_DATA_TEXELS 8
+
+// vertex position in world coordinates
+layout (location = 0) in vec3 position;
+// vertex normal in world coordinate
+layout (location = 1) in vec3 normal;
+// index of the draw
+layout (location = 5) in uint drawID;
+// the numbers used for the location in the layout qualifier are the positions of the vertex attribute
+// as defined in the Mesh class and in the MeshBatch class
+
+// per-draw data: 4 texels for the model matrix, 3 texels for the normal matrix, 1 texel for the diffuse color
+uniform samplerBuffer drawData;
+
+// view matrix
+uniform mat4 viewMatrix;
+// Projection matrix
+uniform mat4 projectionMatrix;
+
+// the position of the point light is passed as uniform
+uniform vec3 pointLightPosition;
+
+// light incidence direction (in view coordinates)
+out vec3 lightDir;
+// the transformed normal (in view coordinate)
+out vec3 vNormal;
+// view direction (in view coordinates)
+out vec3 vViewPosition;
+// diffuse color of the current draw (the same for all the fragments -> no interpolation)
+flat out vec3 vDiffuseColor;
+
+
+void main(){
+
+  // first texel of the data of the current draw
+  int base = int(drawID) * DRAW_DATA_TEXELS;
+
+  // we rebuild the matrices from the texels
+  mat4 modelMatrix = mat4(texelFetch(drawData, base), texelFetch(drawData, base+1), texelFetch(drawData, base+2), texelFetch(drawData, base+3));
+  mat3 normalMatrix = mat3(texelFetch(drawData, base+4).xyz, texelFetch(drawData, base+5).xyz, texelFetch(drawData, base+6).xyz);
+  vDiffuseColor = texelFetch(drawData, base+7).rgb;
+
+  // vertex position in ModelView coordinate
+  vec4 mvPosition = viewMatrix * modelMatrix * vec4( position, 1.0 );
+
+  // view direction, negated to have vector from the vertex to the camera
+  vViewPosition = -mvPosition.xyz;
+
+  // transformations are applied to the normal
+  vNormal = normalize( normalMatrix * normal );
+
+  // light incidence direction (in view coordinate)
+  vec4 lightPos = viewMatrix  * vec4(pointLightPosition, 1.0);
+  lightDir = lightPos.xyz - mvPosition.xyz;
+
+  // we apply the projection transformation
+  gl_Position = projectionMatrix * mvPosition;
+}
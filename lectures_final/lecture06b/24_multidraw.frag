@@ -0,0 +1,98 @@
+/*
+24_multidraw.frag: GGX illumination model (the same of the GGX subroutine in 10_illumination_models.frag), with the diffuse color provided per-draw by the vertex shader
+
+N.B. 1)  "23_multidraw.vert" must be used as vertex shader
+
+N.B. 2) all the draws of a multi-draw call share the same uniforms, so the per-object parameters must be passed as per-draw data
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+
+*/
+
+#version 410 core
+
+const float PI = 3.14159265359;
+
+// output shader variable
+out vec4 colorFrag;
+
+// light incidence direction (calculated in vertex shader, interpolated by rasterization)
+in vec3 lightDir;
+// the transformed normal has been calculated per-vertex in the vertex shader
+in vec3 vNormal;
+// vector from fragment to camera (in view coordinate)
+in vec3 vViewPosition;
+// diffuse color of the current draw
+flat in vec3 vDiffuseColor;
+
+// weight of the diffusive component
+uniform float Kd;
+
+// uniforms for GGX model
+uniform float alpha; // rugosity - 0 : smooth, 1: rough
+uniform float F0; // fresnel reflectance at normal incidence
+
+//////////////////////////////////////////
+// Schlick-GGX method for geometry obstruction (used by GGX model)
+float G1(float angle, float alpha)
+{
+    float r = (alpha + 1.0);
+    float k = (r*r) / 8.0;
+
+    float num   = angle;
+    float denom = angle * (1.0 - k) + k;
+
+    return num / denom;
+}
+
+// main
+void main(void)
+{
+    // normalization of the per-fragment normal
+    vec3 N = normalize(vNormal);
+    // normalization of the per-fragment light incidence direction
+    vec3 L = normalize(lightDir.xyz);
+
+    // cosine angle between direction of light and normal
+    float NdotL = max(dot(N, L), 0.0);
+
+    // diffusive (Lambert) reflection component
+    vec3 lambert = (Kd*vDiffuseColor)/PI;
+
+    // we initialize the specular component
+    vec3 specular = vec3(0.0);
+
+    // if the cosine of the angle between direction of light and normal is positive, then I can calculate the specular component
+    if(NdotL > 0.0)
+    {
+        vec3 V = normalize( vViewPosition );
+        vec3 H = normalize(L + V);
+
+        float NdotH = max(dot(N, H), 0.0);
+        float NdotV = max(dot(N, V), 0.0);
+        float VdotH = max(dot(V, H), 0.0);
+        float alpha_Squared = alpha * alpha;
+        float NdotH_Squared = NdotH * NdotH;
+
+        // Geometric factor G2
+        float G2 = G1(NdotV, alpha)*G1(NdotL, alpha);
+
+        // GGX Distribution
+        float D = alpha_Squared;
+        float denom = (NdotH_Squared*(alpha_Squared-1.0)+1.0);
+        D /= PI*denom*denom;
+
+        // Fresnel reflectance F (approx Schlick)
+        vec3 F = vec3(pow(1.0 - VdotH, 5.0));
+        F *= (1.0 - F0);
+        F += F0;
+
+        specular = (F * G2 * D) / (4.0 * NdotV * NdotL);
+    }
+
+    colorFrag = vec4((lambert + specular)*NdotL, 1.0);
+}
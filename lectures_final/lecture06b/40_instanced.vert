@@ -0,0 +1,74 @@
+/*
+40_instanced.vert: as 09_illumination_models.vert, but the model matrix is an instanced vertex attribute (one matrix for each instance), and the diffuse color is
+the same for all the instances of the draw
+
+The model matrices are written by the Motion States of the rigid bodies in a contiguous array, which is uploaded as-is in the buffer of the attribute
+(see include/utils/instance_motion_state.h and the InstanceBuffer class in include/utils/draw_commands.h)
+
+N.B. 1) the normal matrix is calculated in the shader, for each vertex: the CPU does not need to calculate it for each object
+N.B. 2) "24_multidraw.frag" must be used as fragment shader
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+
+*/
+
+#version 410 core
+
+// vertex position in world coordinates
+layout (location = 0) in vec3 position;
+// vertex normal in world coordinate
+layout (location = 1) in vec3 normal;
+// model matrix of the instance (locations 6, 7, 8, 9: one for each column)
+layout (location = 6) in mat4 modelMatrix;
+// the numbers used for the location in the layout qualifier are the positions of the vertex attribute
+// as defined in the Mesh class and in the MeshBatch and InstanceBuffer classes
+
+// view matrix
+uniform mat4 viewMatrix;
+// Projection matrix
+uniform mat4 projectionMatrix;
+
+// diffuse color of all the instances
+uniform vec3 diffuseColor;
+
+// the position of the point light is passed as uniform
+uniform vec3 pointLightPosition;
+
+// light incidence direction (in view coordinates)
+out vec3 lightDir;
+// the transformed normal (in view coordinate)
+out vec3 vNormal;
+// view direction (in view coordinates)
+out vec3 vViewPosition;
+// diffuse color of the current draw (the same for all the fragments -> no interpolation)
+flat out vec3 vDiffuseColor;
+
+
+void main(){
+
+  // model-view matrix of the instance
+  mat4 modelViewMatrix = viewMatrix * modelMatrix;
+
+  // vertex position in ModelView coordinate
+  vec4 mvPosition = modelViewMatrix * vec4( position, 1.0 );
+
+  // view direction, negated to have vector from the vertex to the camera
+  vViewPosition = -mvPosition.xyz;
+
+  // normals transformation matrix (= transpose of the inverse of the model-view matrix)
+  mat3 normalMatrix = transpose(inverse(mat3(modelViewMatrix)));
+  vNormal = normalize( normalMatrix * normal );
+
+  vDiffuseColor = diffuseColor;
+
+  // light incidence direction (in view coordinate)
+  vec4 lightPos = viewMatrix  * vec4(pointLightPosition, 1.0);
+  lightDir = lightPos.xyz - mvPosition.xyz;
+
+  // we apply the projection transformation
+  gl_Position = projectionMatrix * mvPosition;
+}
@@ -2,6 +2,19 @@
 Es06b: physics simulation using Bullet library.
 Using Physics class (in include/utils), we set the gravity of the world, mass and physical characteristics of the objects in the scene.
 Pressing the space key, we "shoot" a sphere inside the scene, which it will collide with the other objects.
+The spheres are managed by a ProjectileManager (see include/utils/projectile_manager.h): at most MAX_PROJECTILES spheres are live at the same time (the oldest one is removed
+when a new one is shot), and the spheres which leave the scene are removed. The bodies are allocated in the pools of the Physics class, so the frame time remains stable
+even with a sustained firing.
+Pressing the M key, we swap between the rendering with a draw call for each object, and the rendering of a single list of commands for all the objects (see include/utils/draw_commands.h):
+- if the application has obtained an OpenGL 4.3 context, the list is rendered with a single glMultiDrawElementsIndirect call
+- otherwise (e.g., on MacOS, where the maximum version is 4.1), the list is rendered with a loop of glDrawElementsBaseVertex calls
+Pressing the J key, we swap between the building of the list of commands on the main thread, and the multithreaded building (with frustum culling) using a pool of threads (see include/utils/job_system.h and include/utils/draw_list_builder.h)
+Pressing the O key (only with the multithreaded building), we activate/deactivate occlusion culling: the falling cubes are rasterized on the CPU in a low resolution depth buffer, and the objects completely hidden by them are not rendered (see include/utils/occlusion.h)
+Pressing the I key, we swap to/from the instanced rendering: the Motion States of the rigid bodies write the model matrices in contiguous arrays (one for each model,
+see include/utils/instance_motion_state.h) only when the bodies move, and the arrays are uploaded as-is in buffers of instanced attributes. All the cubes
+(and all the spheres) are then rendered with a single glDrawElementsInstancedBaseVertex call, without any work on the CPU for each object.
+The multithreaded building of the list of commands and the occlusion culling read the model matrices from the same arrays
+Pressing the T key, we activate/deactivate the print of the statistics of the frames (CPU time needed to prepare the rendering, number of objects, etc) on console
 
 N.B. 1) to test different parameters of the shaders, it is convenient to use some GUI library, like e.g. Dear ImGui (https://github.com/ocornut/imgui)
 
@@ -57,6 +70,10 @@ positive Z axis points "outside" the screen
 #include <utils/model.h>
 #include <utils/camera.h>
 #include <utils/physics.h>
+#include <utils/projectile_manager.h>
+#include <utils/draw_commands.h>
+#include <utils/draw_list_builder.h>
+#include <utils/frame_stats.h>
 
 // we load the GLM classes used in the application
 #include <glm/glm.hpp>
@@ -97,6 +114,18 @@ GLfloat currentFrame = 0.0;
 // boolean to activate/deactivate wireframe rendering
 GLboolean wireframe = GL_FALSE;
 
+// boolean to activate/deactivate the rendering using a single list of commands
+GLboolean commandList = GL_TRUE;
+// boolean to activate/deactivate the multithreaded building of the list of commands
+GLboolean parallelBuild = GL_TRUE;
+// boolean to activate/deactivate the software occlusion culling
+GLboolean occlusionCulling = GL_FALSE;
+// boolean to activate/deactivate the instanced rendering
+GLboolean instancedRendering = GL_FALSE;
+
+// statistics of the frames (printed on console every second, activated with the T key)
+FrameStats stats;
+
 // view and projection matrices (global because we need to use them in the keyboard callback)
 glm::mat4 view, projection;
 
@@ -125,8 +154,15 @@ glm::vec3 sphere_size = glm::vec3(0.2f, 0.2f, 0.2f);
 // initial velocity of the bullet
 GLfloat shootInitialSpeed = 15.0f;
 
+// arrays of the model matrices of the rigid bodies, written by their Motion States (one array for each model and color)
+// N.B.) they must be declared before the physics class, because the Motion States remove their slots when they are deleted
+InstanceArray planeInstances, cubeInstances, sphereInstances;
 // instance of the physics class
 Physics bulletSimulation;
+// maximum number of live bullets
+#define MAX_PROJECTILES 200
+// manager of the bullets: the bullets outside the box around the plane are removed
+ProjectileManager projectiles(bulletSimulation, MAX_PROJECTILES, glm::vec3(-200.0f, -20.0f, -200.0f), glm::vec3(200.0f, 200.0f, 200.0f));
 // variables used to store uniform location inside shaders
 GLint objDiffuseLocation, pointLightLocation, kdLocation, alphaLocation, f0Location;
 
@@ -134,9 +170,10 @@ GLint objDiffuseLocation, pointLightLocation, kdLocation, alphaLocation, f0Locat
 // array of 16 floats = "native" matrix of OpenGL. We need it as an intermediate data structure to "convert" the Bullet matrix to a GLM matrix
 GLfloat matrix[16];
 btTransform bulletTransform;
-// we need two variables to manage the rendering of both cubes and bullets
+// we need three variables to manage the rendering of both cubes and bullets
 glm::vec3 obj_size;
 Model* objectModel;
+GLfloat* objectColor;
 int num_cobjs;
 
 ////////////////// MAIN function ///////////////////////
@@ -145,12 +182,12 @@ int main()
   // Initialization of OpenGL context using GLFW
   glfwInit();
   // We set OpenGL specifications required for this application
-  // In this case: 4.1 Core
+  // In this case: we try first with 4.3 Core (needed for glMultiDrawElementsIndirect), and then with 4.1 Core
   // If not supported by your graphics HW, the context will not be created and the application will close
   // N.B.) creating GLAD code to load extensions, try to take into account the specifications and any extensions you want to use,
   // in relation also to the values indicated in these GLFW commands
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
   glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
   // we set if the window is resizable
@@ -159,6 +196,12 @@ int main()
   // we create the application's window
     GLFWwindow* window = glfwCreateWindow(screenWidth, screenHeight, "RTGP_lecture06b", nullptr, nullptr);
     if (!window)
+    {
+        // 4.3 is not available -> we try with 4.1 (the command list will be rendered with the fallback path)
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+        window = glfwCreateWindow(screenWidth, screenHeight, "RTGP_lecture06b", nullptr, nullptr);
+    }
+    if (!window)
     {
         std::cout << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
@@ -193,11 +236,42 @@ int main()
 
     // the Shader Program for the objects used in the application
     Shader object_shader = Shader("09_illumination_models.vert", "10_illumination_models.frag");
+    // the Shader Program for the rendering of the list of commands (the per-draw data are read from a Texture Buffer Object)
+    Shader multidraw_shader = Shader("23_multidraw.vert", "24_multidraw.frag");
+    // the Shader Program for the instanced rendering (the model matrices are read from an instanced attribute)
+    Shader instanced_shader = Shader("40_instanced.vert", "24_multidraw.frag");
 
     // we load the model(s) (code of Model class is in include/utils/model.h)
     Model cubeModel("../../models/cube.obj");
     Model sphereModel("../../models/sphere.obj");
 
+    // we merge the meshes of the models in a single set of buffers, and we create the list of commands
+    MeshBatch meshBatch;
+    GLuint cubeBatchID = meshBatch.AddModel(cubeModel);
+    GLuint sphereBatchID = meshBatch.AddModel(sphereModel);
+    meshBatch.Setup();
+    DrawCommandList drawList;
+    // buffers of the instanced model matrices
+    InstanceBuffer planeBuffer, cubeBuffer, sphereBuffer;
+    // ID of the model in the batch, used in the rendering loop
+    GLuint objectBatchID;
+
+    // bounding spheres of the models, used for frustum culling
+    BoundingSphere cubeBounds = ComputeModelBoundingSphere(cubeModel);
+    BoundingSphere sphereBounds = ComputeModelBoundingSphere(sphereModel);
+    // pool of threads for the multithreaded building of the list of commands
+    JobSystem jobSystem;
+    DrawListBuilder builder;
+    // software occlusion culling: the occluders are the falling cubes, using a simplified version of the cube model
+    OcclusionBuffer occlusionBuffer(256, 192);
+    OccluderMesh cubeOccluder = SimplifyOccluder(cubeModel, 8);
+    std::cout << "JobSystem: " << jobSystem.NumWorkers() << " worker threads" << std::endl;
+    stats.enabled = false;
+    if (drawList.MultiDrawSupported())
+        std::cout << "Command list: rendering with glMultiDrawElementsIndirect" << std::endl;
+    else
+        std::cout << "Command list: OpenGL 4.3 not available, rendering with a loop of glDrawElementsBaseVertex" << std::endl;
+
     // dimensions and position of the static plane
     // we will use the cube mesh to simulate the plane, because we need some "height" in the mesh
     // in order to make it work with the physics simulation
@@ -207,7 +281,8 @@ int main()
 
     // we create a rigid body for the plane. In this case, it is static, so we pass mass = 0;
     // in this way, the plane will not fall following the gravity force.
-    btRigidBody* plane = bulletSimulation.createRigidBody(BOX,plane_pos,plane_size,plane_rot,0.0f,0.3f,0.3f);
+    // The model matrix of each body is written in the array of its model
+    btRigidBody* plane = bulletSimulation.createRigidBody(BOX,plane_pos,plane_size,plane_rot,0.0f,0.3f,0.3f,&planeInstances);
 
     // we create 25 rigid bodies for the cubes of the scene. In this case, we use BoxShape, with the same dimensions of the cubes, as collision shape of Bullet. For more complex cases, a Bounding Box of the model may have to be calculated, and its dimensions to be passed to the physics library
     GLint num_side = 5;
@@ -231,7 +306,7 @@ int main()
             // position of each cube in the grid (we add 3 to x to have a bigger displacement)
             cube_pos = glm::vec3((i - num_side)+3.0f, 1.0f, (num_side - j));
             // we create a rigid body (in this case, a dynamic body, with mass = 2)
-            cube = bulletSimulation.createRigidBody(BOX,cube_pos,cube_size,cube_rot,2.0f,0.3f,0.3f);
+            cube = bulletSimulation.createRigidBody(BOX,cube_pos,cube_size,cube_rot,2.0f,0.3f,0.3f,&cubeInstances);
 
         }
     }
@@ -283,25 +358,36 @@ int main()
       // For example, the executable for this code, with limited lighting, simple materials, no texturing, works correctly even setting:
       // bulletSimulation.dynamicsWorld->stepSimulation(1.0/60.0,10);
       bulletSimulation.dynamicsWorld->stepSimulation((deltaTime < maxSecPerFrame ? deltaTime : maxSecPerFrame),10);
+      // we remove the bullets which have left the scene
+      projectiles.Update();
 
       /////////////////// OBJECTS ////////////////////////////////////////////////
       // We "install" the selected Shader Program as part of the current rendering process
-      object_shader.Use();
-      // We search inside the Shader Program the name of a subroutine, and we get the numerical index
-      GLuint index = glGetSubroutineIndex(object_shader.Program, GL_FRAGMENT_SHADER, "GGX");
-      // we activate the subroutine using the index
-      glUniformSubroutinesuiv( GL_FRAGMENT_SHADER, 1, &index);
+      // with the list of commands, we use a specific Shader Program, which reads model matrix, normal matrix and color of each object from a Texture Buffer Object
+      // with the instanced rendering, a Shader Program reads the model matrix of each instance from an instanced attribute
+      Shader& current_shader = (instancedRendering ? instanced_shader : (commandList ? multidraw_shader : object_shader));
+      current_shader.Use();
+      if (!commandList && !instancedRendering)
+      {
+          // We search inside the Shader Program the name of a subroutine, and we get the numerical index
+          GLuint index = glGetSubroutineIndex(object_shader.Program, GL_FRAGMENT_SHADER, "GGX");
+          // we activate the subroutine using the index
+          glUniformSubroutinesuiv( GL_FRAGMENT_SHADER, 1, &index);
+      }
+      else if (commandList)
+          // we empty the list of commands of the previous frame
+          drawList.Clear();
 
       // we pass projection and view matrices to the Shader Program
-      glUniformMatrix4fv(glGetUniformLocation(object_shader.Program, "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(projection));
-      glUniformMatrix4fv(glGetUniformLocation(object_shader.Program, "viewMatrix"), 1, GL_FALSE, glm::value_ptr(view));
+      glUniformMatrix4fv(glGetUniformLocation(current_shader.Program, "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(projection));
+      glUniformMatrix4fv(glGetUniformLocation(current_shader.Program, "viewMatrix"), 1, GL_FALSE, glm::value_ptr(view));
 
       // we determine the position in the Shader Program of the uniform variables
-      objDiffuseLocation = glGetUniformLocation(object_shader.Program, "diffuseColor");
-      pointLightLocation = glGetUniformLocation(object_shader.Program, "pointLightPosition");
-      kdLocation = glGetUniformLocation(object_shader.Program, "Kd");
-      alphaLocation = glGetUniformLocation(object_shader.Program, "alpha");
-      f0Location = glGetUniformLocation(object_shader.Program, "F0");
+      objDiffuseLocation = glGetUniformLocation(current_shader.Program, "diffuseColor");
+      pointLightLocation = glGetUniformLocation(current_shader.Program, "pointLightPosition");
+      kdLocation = glGetUniformLocation(current_shader.Program, "Kd");
+      alphaLocation = glGetUniformLocation(current_shader.Program, "alpha");
+      f0Location = glGetUniformLocation(current_shader.Program, "F0");
 
       // we assign the value to the uniform variable
       glUniform3fv(pointLightLocation, 1, glm::value_ptr(lightPos0));
@@ -309,95 +395,203 @@ int main()
       glUniform1f(alphaLocation, alpha);
       glUniform1f(f0Location, F0);
 
-      /////
-      // STATIC PLANE
-      // we use a specific color for the plane
-      glUniform3fv(objDiffuseLocation, 1, planeMaterial);
-
-      // The plane is static, so its Collision Shape is not subject to forces, and it does not move. Thus, we do not need to use dynamicsWorld to acquire the rototraslations, but we can just use directly glm to manage the matrices
-      // if, for some reason, the plane becomes a dynamic rigid body, the following code must be modified
-      // we reset to identity at each frame
-      planeModelMatrix = glm::mat4(1.0f);
-      planeNormalMatrix = glm::mat3(1.0f);
-      planeModelMatrix = glm::translate(planeModelMatrix, plane_pos);
-      planeModelMatrix = glm::scale(planeModelMatrix, plane_size);
-      planeNormalMatrix = glm::inverseTranspose(glm::mat3(view*planeModelMatrix));
-      glUniformMatrix4fv(glGetUniformLocation(object_shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(planeModelMatrix));
-      glUniformMatrix3fv(glGetUniformLocation(object_shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(planeNormalMatrix));
-
-      // we render the plane
-      cubeModel.Draw();
-      planeModelMatrix = glm::mat4(1.0f);
-
-      /////
-      // DYNAMIC OBJECTS (FALLING CUBES + BULLETS)
       // we ask Bullet to provide the total number of Rigid Bodies in the scene
       // at the beginning they are 26 (the static plane + the falling cubes), but we can add several bullets by pressing the space key
       num_cobjs = bulletSimulation.dynamicsWorld->getNumCollisionObjects();
 
-      // we cycle among all the Rigid Bodies (starting from 1 to avoid the plane)
-      for (i=1; i<num_cobjs;i++)
+      // we measure the CPU time needed to prepare the rendering of the objects
+      double buildStart = FrameStats::Now();
+
+      if (instancedRendering)
       {
-          // the first 25 objects are the falling cubes
-          if (i <= total_cubes)
+          // we upload only the modified range of each array (the matrices of the sleeping bodies have not been written again)
+          planeBuffer.Upload(planeInstances.Data(), planeInstances.Size(), planeInstances.DirtyBegin(), planeInstances.DirtyEnd());
+          cubeBuffer.Upload(cubeInstances.Data(), cubeInstances.Size(), cubeInstances.DirtyBegin(), cubeInstances.DirtyEnd());
+          sphereBuffer.Upload(sphereInstances.Data(), sphereInstances.Size(), sphereInstances.DirtyBegin(), sphereInstances.DirtyEnd());
+          planeInstances.ResetDirty();
+          cubeInstances.ResetDirty();
+          sphereInstances.ResetDirty();
+
+          // a draw call for each model, with all its instances
+          glUniform3fv(objDiffuseLocation, 1, planeMaterial);
+          planeBuffer.Draw(meshBatch, cubeBatchID, (GLsizei)planeInstances.Size());
+          glUniform3fv(objDiffuseLocation, 1, diffuseColor);
+          cubeBuffer.Draw(meshBatch, cubeBatchID, (GLsizei)cubeInstances.Size());
+          glUniform3fv(objDiffuseLocation, 1, shootColor);
+          sphereBuffer.Draw(meshBatch, sphereBatchID, (GLsizei)sphereInstances.Size());
+      }
+      else if (commandList && parallelBuild)
+      {
+          builder.occlusion = nullptr;
+          if (occlusionCulling)
           {
-              // we point objectModel to the cube
-              objectModel = &cubeModel;
-              obj_size = cube_size;
-              // we pass red color to the shader
-              glUniform3fv(objDiffuseLocation, 1, diffuseColor);
+              // we rasterize the occluders, and we build the pyramid of depths, before the building of the list
+              double occlusionStart = FrameStats::Now();
+              occlusionBuffer.Clear(projection * view);
+              for (i = 1; i <= total_cubes && i < num_cobjs; i++)
+              {
+                  // the Motion State of the body has already calculated its model matrix
+                  btRigidBody* body = btRigidBody::upcast(bulletSimulation.dynamicsWorld->getCollisionObjectArray()[i]);
+                  occlusionBuffer.RenderOccluder(cubeOccluder, BodyModelMatrix(body, cube_size));
+              }
+              occlusionBuffer.BuildPyramid();
+              builder.occlusion = &occlusionBuffer;
+              stats.Add("occlusion raster ms", FrameStats::Now() - occlusionStart);
           }
-          // over 26, there are bullets (if any)
+
+          // the list of commands is built by the jobs of the JobSystem: acquisition of the transformations, frustum culling, packing of the per-draw data and sorting are executed in parallel
+          // the lambda function is called by different threads: it only reads the model matrices written by the Motion States during the simulation step
+          builder.Build(jobSystem, num_cobjs, [&](size_t idx, RenderItem& item)
+          {
+              // the index 0 is the static plane
+              if (idx == 0)
+              {
+                  item.model = cubeBatchID;
+                  item.modelMatrix = glm::scale(glm::translate(glm::mat4(1.0f), plane_pos), plane_size);
+                  item.diffuseColor = glm::make_vec3(planeMaterial);
+                  item.bounds = cubeBounds;
+                  return;
+              }
+              // the other indices are the rigid bodies (the first 25 are the falling cubes, the others are the bullets)
+              GLboolean isCube = (idx <= (size_t)total_cubes);
+              btRigidBody* body = btRigidBody::upcast(bulletSimulation.dynamicsWorld->getCollisionObjectArray()[idx]);
+              item.model = (isCube ? cubeBatchID : sphereBatchID);
+              item.modelMatrix = BodyModelMatrix(body, (isCube ? cube_size : sphere_size));
+              item.diffuseColor = glm::make_vec3(isCube ? diffuseColor : shootColor);
+              item.bounds = (isCube ? cubeBounds : sphereBounds);
+          }, meshBatch, view, projection, drawList);
+
+          stats.Add("visible objects", builder.numVisible);
+          if (occlusionCulling)
+              stats.Add("occluded objects", builder.numOccluded);
+      }
+      else
+      {
+          /////
+          // STATIC PLANE
+          // The plane is static, so its Collision Shape is not subject to forces, and it does not move. Thus, we do not need to use dynamicsWorld to acquire the rototraslations, but we can just use directly glm to manage the matrices
+          // if, for some reason, the plane becomes a dynamic rigid body, the following code must be modified
+          // we reset to identity at each frame
+          planeModelMatrix = glm::mat4(1.0f);
+          planeNormalMatrix = glm::mat3(1.0f);
+          planeModelMatrix = glm::translate(planeModelMatrix, plane_pos);
+          planeModelMatrix = glm::scale(planeModelMatrix, plane_size);
+          planeNormalMatrix = glm::inverseTranspose(glm::mat3(view*planeModelMatrix));
+
+          if (commandList)
+              // we add the plane to the list of commands, with its specific color
+              drawList.Add(meshBatch, cubeBatchID, planeModelMatrix, planeNormalMatrix, glm::make_vec3(planeMaterial));
           else
           {
-            // we point objectModel to the sphere
-              objectModel = &sphereModel;
-              obj_size = sphere_size;
-              // we pass yellow color to the shader
-              glUniform3fv(objDiffuseLocation, 1, shootColor);
-          }
+              // we use a specific color for the plane
+              glUniform3fv(objDiffuseLocation, 1, planeMaterial);
+              glUniformMatrix4fv(glGetUniformLocation(object_shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(planeModelMatrix));
+              glUniformMatrix3fv(glGetUniformLocation(object_shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(planeNormalMatrix));
 
-          // we take the Collision Object from the list
-          btCollisionObject* obj = bulletSimulation.dynamicsWorld->getCollisionObjectArray()[i];
+              // we render the plane
+              cubeModel.Draw();
+          }
+          planeModelMatrix = glm::mat4(1.0f);
 
-          // we upcast it in order to use the methods of the main class RigidBody
-          btRigidBody* body = btRigidBody::upcast(obj);
+          /////
+          // DYNAMIC OBJECTS (FALLING CUBES + BULLETS)
 
-          // we take the transformation matrix of the rigid boby, as calculated by the physics engine
-          body->getMotionState()->getWorldTransform(bulletTransform);
+          // we cycle among all the Rigid Bodies (starting from 1 to avoid the plane)
+          for (i=1; i<num_cobjs;i++)
+          {
+              // the first 25 objects are the falling cubes
+              if (i <= total_cubes)
+              {
+                  // we point objectModel to the cube
+                  objectModel = &cubeModel;
+                  objectBatchID = cubeBatchID;
+                  obj_size = cube_size;
+                  objectColor = diffuseColor;
+              }
+              // over 26, there are bullets (if any)
+              else
+              {
+                // we point objectModel to the sphere
+                  objectModel = &sphereModel;
+                  objectBatchID = sphereBatchID;
+                  obj_size = sphere_size;
+                  objectColor = shootColor;
+              }
+
+              // we take the Collision Object from the list
+              btCollisionObject* obj = bulletSimulation.dynamicsWorld->getCollisionObjectArray()[i];
+
+              // we upcast it in order to use the methods of the main class RigidBody
+              btRigidBody* body = btRigidBody::upcast(obj);
+
+              // we take the transformation matrix of the rigid boby, as calculated by the physics engine
+              body->getMotionState()->getWorldTransform(bulletTransform);
+
+              // we convert the Bullet matrix (transform) to an array of floats
+              bulletTransform.getOpenGLMatrix(matrix);
+
+              // we reset to identity at each frame
+              objModelMatrix = glm::mat4(1.0f);
+              objNormalMatrix = glm::mat3(1.0f);
+
+              // we create the GLM transformation matrix
+              // 1) we convert the array of floats to a GLM mat4 (using make_mat4 method)
+              // 2) Bullet matrix provides rotations and translations: it does not consider scale (usually the Collision Shape is generated using directly the scaled dimensions). If, like in our case, we have applied a scale to the original model, we need to multiply the scale to the rototranslation matrix created in 1). If we are working on an imported and not scaled model, we do not need to do this
+              objModelMatrix = glm::make_mat4(matrix) * glm::scale(objModelMatrix, obj_size);
+              // we create the normal matrix
+              objNormalMatrix = glm::inverseTranspose(glm::mat3(view*objModelMatrix));
+
+              if (commandList)
+                  // we just add a command to the list: the actual rendering is performed after the loop
+                  drawList.Add(meshBatch, objectBatchID, objModelMatrix, objNormalMatrix, glm::make_vec3(objectColor));
+              else
+              {
+                  // we pass the color to the shader
+                  glUniform3fv(objDiffuseLocation, 1, objectColor);
+                  glUniformMatrix4fv(glGetUniformLocation(object_shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(objModelMatrix));
+                  glUniformMatrix3fv(glGetUniformLocation(object_shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(objNormalMatrix));
+
+                  // we render the model
+                  // N.B.) if the number of models is relatively low, this approach (we render the same mesh several time from the same buffers) can work. If we must render hundreds or more of copies of the same mesh,
+                  // there are more advanced techniques to manage Instanced Rendering (see https://learnopengl.com/#!Advanced-OpenGL/Instancing for examples), or we can use the list of commands (M key)
+                  objectModel->Draw();
+              }
+              // we "reset" the matrix
+              objModelMatrix = glm::mat4(1.0f);
+          }
+      }
 
-          // we convert the Bullet matrix (transform) to an array of floats
-          bulletTransform.getOpenGLMatrix(matrix);
+      stats.Add("objects", num_cobjs);
+      stats.Add("collision shapes", bulletSimulation.numShapes());
+      stats.Add("live bullets", projectiles.NumLive());
+      stats.Add("recycled bullets", projectiles.recycled + projectiles.outOfBounds);
+      // number of model matrices written by the Motion States in this frame (= moved bodies, for each simulation substep)
+      stats.Add("moved bodies", cubeInstances.updates + sphereInstances.updates);
+      cubeInstances.updates = sphereInstances.updates = 0;
+      stats.Add("CPU build ms", FrameStats::Now() - buildStart);
 
-          // we reset to identity at each frame
-          objModelMatrix = glm::mat4(1.0f);
-          objNormalMatrix = glm::mat3(1.0f);
-
-          // we create the GLM transformation matrix
-          // 1) we convert the array of floats to a GLM mat4 (using make_mat4 method)
-          // 2) Bullet matrix provides rotations and translations: it does not consider scale (usually the Collision Shape is generated using directly the scaled dimensions). If, like in our case, we have applied a scale to the original model, we need to multiply the scale to the rototranslation matrix created in 1). If we are working on an imported and not scaled model, we do not need to do this
-          objModelMatrix = glm::make_mat4(matrix) * glm::scale(objModelMatrix, obj_size);
-          // we create the normal matrix
-          objNormalMatrix = glm::inverseTranspose(glm::mat3(view*objModelMatrix));
-          glUniformMatrix4fv(glGetUniformLocation(object_shader.Program, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(objModelMatrix));
-          glUniformMatrix3fv(glGetUniformLocation(object_shader.Program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(objNormalMatrix));
-
-          // we render the model
-          // N.B.) if the number of models is relatively low, this approach (we render the same mesh several time from the same buffers) can work. If we must render hundreds or more of copies of the same mesh,
-          // there are more advanced techniques to manage Instanced Rendering (see https://learnopengl.com/#!Advanced-OpenGL/Instancing for examples).
-          objectModel->Draw();
-          // we "reset" the matrix
-          objModelMatrix = glm::mat4(1.0f);
-      }
+      // we render the whole list of commands (texture unit 0 is used for the Texture Buffer Object with the per-draw data)
+      // the cost on the CPU side of the multi-draw call does not depend on the number of objects in the scene
+      if (commandList && !instancedRendering)
+          drawList.Submit(meshBatch, multidraw_shader.Program, 0);
 
       // Faccio lo swap tra back e front buffer
       glfwSwapBuffers(window);
+
+      // we update the statistics (they are printed every second)
+      stats.EndFrame();
   }
 
   // when I exit from the graphics loop, it is because the application is closing
   // we delete the Shader Programs
   object_shader.Delete();
+  multidraw_shader.Delete();
+  instanced_shader.Delete();
+  planeBuffer.Clear();
+  cubeBuffer.Clear();
+  sphereBuffer.Clear();
   // we delete the data of the physical simulation
+  projectiles.Clear();
   bulletSimulation.Clear();
   // we close and delete the created context
   glfwTerminate();
@@ -438,14 +632,44 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     if(key == GLFW_KEY_L && action == GLFW_PRESS)
         wireframe=!wireframe;
 
+    // if M is pressed, we activate/deactivate the rendering using a single list of commands
+    if(key == GLFW_KEY_M && action == GLFW_PRESS)
+    {
+        commandList=!commandList;
+        std::cout << "Rendering with a list of commands: " << (commandList ? "ON" : "OFF") << std::endl;
+    }
+
+    // if J is pressed, we activate/deactivate the multithreaded building of the list of commands
+    if(key == GLFW_KEY_J && action == GLFW_PRESS)
+    {
+        parallelBuild=!parallelBuild;
+        std::cout << "Multithreaded building of the list of commands: " << (parallelBuild ? "ON" : "OFF") << std::endl;
+    }
+
+    // if O is pressed, we activate/deactivate the software occlusion culling
+    if(key == GLFW_KEY_O && action == GLFW_PRESS)
+    {
+        occlusionCulling=!occlusionCulling;
+        std::cout << "Occlusion culling: " << (occlusionCulling ? "ON" : "OFF") << std::endl;
+    }
+
+    // if I is pressed, we activate/deactivate the instanced rendering
+    if(key == GLFW_KEY_I && action == GLFW_PRESS)
+    {
+        instancedRendering=!instancedRendering;
+        std::cout << "Instanced rendering: " << (instancedRendering ? "ON" : "OFF") << std::endl;
+    }
+
+    // if T is pressed, we activate/deactivate the print of the statistics on console
+    if(key == GLFW_KEY_T && action == GLFW_PRESS)
+        stats.enabled=!stats.enabled;
+
     ///////
     /// BULLET MANAGEMENT (SPACE KEY)
     // if space is pressed, we "shoot" a bullet in the scene
     // the initial trajectory of the bullet is given by a vector from the position of the camera to the mouse cursor position, which must be converted from Viewport Coordinates back to World Coordinate
 
     btVector3 impulse;
-    // we need a initial rotation, even if useless for a sphere
-    glm::vec3 rot = glm::vec3(0.0f, 0.0f, 0.0f);
     glm::vec4 shoot;
     // rigid body of the bullet
     btRigidBody* sphere;
@@ -455,8 +679,8 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     // if space is pressed
     if(key == GLFW_KEY_SPACE && action == GLFW_PRESS)
     {
-        // we create a Rigid Body with mass = 1
-        sphere = bulletSimulation.createRigidBody(SPHERE,camera.Position,sphere_size,rot,1.0f,0.3f,0.3f);
+        // we create a Rigid Body with mass = 1 (if there are already MAX_PROJECTILES bullets, the oldest one is removed), with its model matrix in the array of the spheres
+        sphere = projectiles.Fire(SPHERE,camera.Position,sphere_size,1.0f,0.3f,0.3f,&sphereInstances);
 
         // we must retro-project the coordinates of the mouse pointer, in order to have a point in world coordinate to be used to determine a vector from the camera (= direction and orientation of the bullet)
         // we convert the cursor position (taken from the mouse callback) from Viewport Coordinates to Normalized Device Coordinate (= [-1,1] in both coordinates)
@@ -0,0 +1,195 @@
+/*
+environment_converter: conversion of the environments in the packed ".renv" format (see include/utils/environment_container.h)
+
+Usage:
+    environment_converter.out <cube map folder | equirectangular image> <output .renv file> [-size <face size>] [-half]
+
+- input:
+    - a folder with the 6 faces of a cube map, in one of the naming conventions of the course (posx, negx, posy, negy, posz, negz or
+      right, left, top, bottom, front, back), with .jpg or .png images
+    - an equirectangular (latitude-longitude) image, with a 2:1 ratio: LDR (PNG, JPEG, ...) or HDR (Radiance .hdr)
+- the faces are resampled to -size (default: the size of the faces of the cube map, or 1/4 of the width of the equirectangular image), and the
+  whole mipmap chain is generated on the CPU (the LDR images are averaged in linear space)
+- -half saves the texels as half floats (RGB16F) instead of 8 bit RGB: it is always used for the HDR images, to keep the values > 1
+- the applications load the file with TextureManager::AcquireCube() (include/utils/texture_manager.h): a single memory mapping, and one upload for each level,
+  instead of the decoding of 6 images and the generation of the mipmaps
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+// Std. Includes
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstdlib>
+
+#include <utils/job_system.h>
+#include <utils/environment_container.h>
+#include <utils/ibl_baker.h>
+
+// we include the library for images loading
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image/stb_image.h"
+
+// elapsed time in milliseconds from "start"
+double ElapsedMs(const chrono::steady_clock::time_point& start)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+/////////////////// MAIN function ///////////////////////
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        std::cout << "Usage: " << argv[0] << " <cube map folder | equirectangular image> <output .renv file> [-size <face size>] [-half]" << std::endl;
+        return -1;
+    }
+    string inputPath = argv[1];
+    string outputPath = argv[2];
+    int size = 0;
+    bool half = false;
+    for (int a = 3; a < argc; a++)
+    {
+        string arg = argv[a];
+        if (arg == "-half")
+            half = true;
+        else if (arg == "-size" && a + 1 < argc)
+            size = atoi(argv[++a]);
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    JobSystem jobs;
+
+    // we load the source in a cube map of floats
+    CubeImage source;
+    bool hdr = false;
+    struct stat info;
+    if (stat(inputPath.c_str(), &info) == 0 && (info.st_mode & S_IFDIR))
+    {
+        if (inputPath.back() != '/' && inputPath.back() != '\\')
+            inputPath += "/";
+        if (!LoadCubeImage(CubeFacePaths(inputPath), source, &jobs))
+            return -1;
+    }
+    else
+    {
+        int w, h, channels;
+        vector<float> pixels;
+        hdr = (stbi_is_hdr(inputPath.c_str()) != 0);
+        if (hdr)
+        {
+            // the HDR images are loaded as linear floats
+            float* data = stbi_loadf(inputPath.c_str(), &w, &h, &channels, 3);
+            if (data != nullptr)
+            {
+                pixels.assign(data, data + (size_t)w * h * 3);
+                stbi_image_free(data);
+            }
+        }
+        else
+        {
+            unsigned char* data = stbi_load(inputPath.c_str(), &w, &h, &channels, 3);
+            if (data != nullptr)
+            {
+                pixels.resize((size_t)w * h * 3);
+                for (size_t i = 0; i < pixels.size(); i++)
+                    pixels[i] = data[i] / 255.0f;
+                stbi_image_free(data);
+            }
+        }
+        if (pixels.empty())
+        {
+            std::cout << "Failed to load image: " << inputPath << std::endl;
+            return -1;
+        }
+        EquirectangularToCube(&pixels[0], w, h, (size > 0 ? size : w / 4), source, &jobs);
+    }
+    // the HDR environments need half floats
+    half = half || hdr;
+
+    // we resample the faces, starting from the level of the mipmap chain of the source with the closest size (not smaller than the final one)
+    if (size > 0 && size != source.size)
+    {
+        vector<CubeImage> sourceChain;
+        BuildCubeMipChain(source, sourceChain, !hdr);
+        size_t l = 0;
+        while (l + 1 < sourceChain.size() && sourceChain[l + 1].size >= size)
+            l++;
+        CubeImage resampled;
+        ResampleCube(sourceChain[l], size, resampled, &jobs);
+        source = resampled;
+    }
+    vector<CubeImage> chain;
+    BuildCubeMipChain(source, chain, !hdr);
+
+    // header and table of the levels (the data of the levels are aligned to 16 bytes)
+    EnvironmentFileHeader header;
+    memcpy(header.magic, "RENV", 4);
+    header.version = ENVIRONMENT_FILE_VERSION;
+    header.format = (half ? ENVIRONMENT_FORMAT_RGB16F : ENVIRONMENT_FORMAT_RGB8);
+    header.faceSize = chain[0].size;
+    header.numLevels = (uint32_t)chain.size();
+    header.reserved[0] = header.reserved[1] = header.reserved[2] = 0;
+    uint32_t texelSize = EnvironmentTexelSize(header.format);
+    vector<EnvironmentFileLevel> levelTable(chain.size());
+    uint32_t offset = (uint32_t)(sizeof(EnvironmentFileHeader) + levelTable.size() * sizeof(EnvironmentFileLevel));
+    for (size_t l = 0; l < chain.size(); l++)
+    {
+        offset = (offset + 15) & ~15u;
+        levelTable[l].offset = offset;
+        levelTable[l].faceSize = chain[l].size;
+        levelTable[l].size = 6 * chain[l].size * chain[l].size * texelSize;
+        levelTable[l].reserved = 0;
+        offset += levelTable[l].size;
+    }
+
+    ofstream file(outputPath.c_str(), ios::binary);
+    if (!file)
+    {
+        std::cout << "Failed to create file: " << outputPath << std::endl;
+        return -1;
+    }
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)&levelTable[0], levelTable.size() * sizeof(EnvironmentFileLevel));
+    size_t written = sizeof(header) + levelTable.size() * sizeof(EnvironmentFileLevel);
+    const char padding[16] = { 0 };
+    for (size_t l = 0; l < chain.size(); l++)
+    {
+        file.write(padding, levelTable[l].offset - written);
+        // the 6 faces of the level, one after the other
+        vector<unsigned char> data(levelTable[l].size);
+        size_t p = 0;
+        for (int f = 0; f < 6; f++)
+        {
+            const vector<float>& face = chain[l].faces[f];
+            for (size_t i = 0; i < face.size(); i++)
+            {
+                if (half)
+                {
+                    uint16_t value = FloatToHalf(face[i]);
+                    memcpy(&data[p], &value, 2);
+                    p += 2;
+                }
+                else
+                {
+                    float c = glm::clamp(face[i], 0.0f, 1.0f);
+                    data[p++] = (unsigned char)(c * 255.0f + 0.5f);
+                }
+            }
+        }
+        file.write((const char*)&data[0], data.size());
+        written = levelTable[l].offset + data.size();
+    }
+    file.close();
+
+    std::cout << inputPath << " -> " << outputPath << ": " << header.faceSize << "x" << header.faceSize << " faces, " << header.numLevels << " levels, "
+              << (half ? "RGB16F" : "RGB8") << ", " << (written / 1024) << " KB, " << ElapsedMs(start) << " ms with " << (jobs.NumWorkers() + 1) << " threads" << std::endl;
+    return 0;
+}
@@ -0,0 +1,14 @@
+@echo off
+IF EXIST "C:\Program Files\Microsoft Visual Studio\2022\BuildTools\VC\Auxiliary\Build\vcvarsall.bat" (
+    call "C:\Program Files\Microsoft Visual Studio\2022\BuildTools\VC\Auxiliary\Build\vcvarsall.bat" x64
+) ELSE (
+    call "C:\Program Files\Microsoft Visual Studio\2022\Community\VC\Auxiliary\Build\vcvarsall.bat" x64
+)
+
+if [%1%]==[] (
+  nmake /f MakefileWin all
+) else (
+  nmake /f MakefileWin clean
+)
+
+
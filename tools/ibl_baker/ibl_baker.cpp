@@ -0,0 +1,87 @@
+/*
+ibl_baker: offline baking of the Image Based Lighting data of the cube maps (see include/utils/ibl_baker.h)
+
+Usage:
+    ibl_baker.out [-lut <BRDF table file>] <cube map folder> [<cube map folder> ...]
+
+- for each folder (containing the 6 faces posx, negx, posy, negy, posz, negz, in .jpg or .png), the SH coefficients of the irradiance and the
+  pre-filtered cube map are saved in the cache file "environment.ibl" inside the folder
+- the split-sum BRDF table is saved in the file given with -lut (default: ../../textures/cube/brdf_lut.ibl)
+- the applications use the same cache files (ImageBasedLighting::Load() in include/utils/image_based_lighting.h): if the files are already valid,
+  nothing is baked again. The tool can be used to avoid the baking at the first execution of the applications
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+// Std. Includes
+#include <string>
+#include <vector>
+#include <iostream>
+#include <chrono>
+
+#include <utils/job_system.h>
+#include <utils/ibl_baker.h>
+
+// we include the library for images loading
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image/stb_image.h"
+
+// elapsed time in milliseconds from "start"
+double ElapsedMs(const chrono::steady_clock::time_point& start)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+/////////////////// MAIN function ///////////////////////
+int main(int argc, char* argv[])
+{
+    string lutPath = "../../textures/cube/brdf_lut.ibl";
+    vector<string> folders;
+    for (int a = 1; a < argc; a++)
+    {
+        string arg = argv[a];
+        if (arg == "-lut" && a + 1 < argc)
+            lutPath = argv[++a];
+        else
+        {
+            // the folder must end with a separator
+            if (arg.back() != '/' && arg.back() != '\\')
+                arg += "/";
+            folders.push_back(arg);
+        }
+    }
+    if (folders.empty())
+    {
+        std::cout << "Usage: " << argv[0] << " [-lut <BRDF table file>] <cube map folder> [<cube map folder> ...]" << std::endl;
+        return -1;
+    }
+
+    JobSystem jobs;
+    IBLSettings settings;
+    bool fromCache;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vector<float> lut;
+    BakeBRDFLUT(lutPath, settings, lut, &jobs, fromCache);
+    std::cout << lutPath << ": " << settings.lutSize << "x" << settings.lutSize << (fromCache ? " (cache already valid)" : "") << ", " << ElapsedMs(start) << " ms" << std::endl;
+
+    int result = 0;
+    for (size_t i = 0; i < folders.size(); i++)
+    {
+        start = chrono::steady_clock::now();
+        EnvironmentIBL environment;
+        if (!BakeEnvironmentIBL(folders[i], settings, environment, &jobs, fromCache))
+        {
+            result = -1;
+            continue;
+        }
+        std::cout << folders[i] << "environment.ibl: " << settings.numLevels << " levels (" << settings.specularSize << "x" << settings.specularSize << " -> "
+                  << environment.specular.back().size << "x" << environment.specular.back().size << ")" << (fromCache ? " (cache already valid)" : "")
+                  << ", " << ElapsedMs(start) << " ms with " << (jobs.NumWorkers() + 1) << " threads" << std::endl;
+    }
+    return result;
+}
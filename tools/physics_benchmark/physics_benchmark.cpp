@@ -0,0 +1,135 @@
+/*
+physics_benchmark: scaling of the multithreaded physical simulation (see include/utils/physics.h) with the number of threads
+
+Usage:
+    physics_benchmark.out [-towers <N>] [-height <H>] [-steps <S>] [-threads <T>] [-scheduler jobsystem|default|openmp|tbb|ppl]
+
+- the scene is a grid of N x N towers of H boxes each, on a static plane, and a pyramid of boxes (a single large island of objects in contact).
+  The bodies never go to sleep, so all the steps simulate all the bodies
+- the scene is simulated with the single-threaded world, and then with the multithreaded world using 1 to T threads (default: all the hardware threads).
+  For each configuration, we measure the average time of S steps of 1/60 s (after some steps of warm-up, when the stacks are settling)
+- the results show the overhead of the multithreaded world (single-threaded world vs 1 thread) and the speedup with more threads.
+  If the Bullet library has been compiled without BT_THREADSAFE, Physics creates the single-threaded world in all the configurations (a message is printed)
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+// Std. Includes
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+
+#include <glm/glm.hpp>
+
+#include <utils/physics.h>
+
+// number of steps of warm-up, not considered in the averages
+#define WARMUP_STEPS 30
+
+//////////////////////////////////////////
+// we create the scene: a plane, a grid of towers x towers stacks of "height" boxes, and a pyramid with a base of "height" boxes
+void CreateScene(Physics& physics, int towers, int height)
+{
+    physics.createRigidBody(BOX, glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(200.0f, 1.0f, 200.0f), glm::vec3(0.0f), 0.0f, 0.5f, 0.0f);
+
+    // boxes with half size 0.5, placed 1 unit apart in height (they touch each other)
+    glm::vec3 halfSize(0.5f);
+    vector<btRigidBody*> bodies;
+    for (int i = 0; i < towers; i++)
+        for (int j = 0; j < towers; j++)
+            for (int k = 0; k < height; k++)
+                bodies.push_back(physics.createRigidBody(BOX, glm::vec3((i - towers / 2) * 3.0f, 0.5f + k, (j - towers / 2) * 3.0f), halfSize, glm::vec3(0.0f), 1.0f, 0.5f, 0.0f));
+
+    // the pyramid is placed beside the grid of towers
+    float pyramidZ = (towers / 2 + 2) * 3.0f;
+    for (int k = 0; k < height; k++)
+        for (int i = 0; i < height - k; i++)
+            bodies.push_back(physics.createRigidBody(BOX, glm::vec3(i - (height - k) * 0.5f, 0.5f + k, pyramidZ), halfSize, glm::vec3(0.0f), 1.0f, 0.5f, 0.0f));
+
+    for (size_t b = 0; b < bodies.size(); b++)
+        bodies[b]->setActivationState(DISABLE_DEACTIVATION);
+}
+
+//////////////////////////////////////////
+// we simulate the scene with the given settings, and we return the average time of a step in milliseconds
+double Measure(const PhysicsSettings& settings, int towers, int height, int steps)
+{
+    Physics physics(settings);
+    CreateScene(physics, towers, height);
+    for (int s = 0; s < WARMUP_STEPS; s++)
+        physics.dynamicsWorld->stepSimulation(1.0f / 60.0f, 1, 1.0f / 60.0f);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int s = 0; s < steps; s++)
+        physics.dynamicsWorld->stepSimulation(1.0f / 60.0f, 1, 1.0f / 60.0f);
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / steps;
+
+    physics.Clear();
+    return ms;
+}
+
+/////////////////// MAIN function ///////////////////////
+int main(int argc, char* argv[])
+{
+    int towers = 10, height = 16, steps = 300;
+    int maxThreads = (int)thread::hardware_concurrency();
+    PhysicsSettings settings;
+    settings.multithreaded = true;
+    for (int a = 1; a < argc; a++)
+    {
+        string arg = argv[a];
+        if (a + 1 >= argc)
+        {
+            std::cout << "Usage: " << argv[0] << " [-towers <N>] [-height <H>] [-steps <S>] [-threads <T>] [-scheduler jobsystem|default|openmp|tbb|ppl]" << std::endl;
+            return -1;
+        }
+        string value = argv[++a];
+        if (arg == "-towers")
+            towers = atoi(value.c_str());
+        else if (arg == "-height")
+            height = atoi(value.c_str());
+        else if (arg == "-steps")
+            steps = atoi(value.c_str());
+        else if (arg == "-threads")
+            maxThreads = atoi(value.c_str());
+        else if (arg == "-scheduler")
+        {
+            const char* names[5] = { "jobsystem", "default", "openmp", "tbb", "ppl" };
+            for (int s = 0; s < 5; s++)
+                if (value == names[s])
+                    settings.scheduler = s;
+        }
+    }
+    towers = glm::max(towers, 1);
+    height = glm::max(height, 1);
+    steps = glm::max(steps, 1);
+    maxThreads = glm::max(maxThreads, 1);
+
+    std::cout << "Scene: " << towers * towers << " towers of " << height << " boxes, and a pyramid of " << height * (height + 1) / 2 << " boxes - "
+              << steps << " steps" << std::endl;
+
+    // single-threaded world, as reference
+    double reference = Measure(PhysicsSettings(), towers, height, steps);
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "single-threaded world: " << reference << " ms/step" << std::endl;
+
+    // multithreaded world, from 1 to maxThreads threads
+    double oneThread = 0.0;
+    for (int t = 1; t <= maxThreads; t++)
+    {
+        settings.numThreads = t;
+        double ms = Measure(settings, towers, height, steps);
+        if (t == 1)
+            oneThread = ms;
+        std::cout << "multithreaded world, " << setw(2) << t << " threads: " << ms << " ms/step - speedup " << std::setprecision(2) << oneThread / ms
+                  << "x (vs single-threaded world " << reference / ms << "x)" << std::setprecision(3) << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,166 @@
+/*
+texture_baker: offline conversion of the images used as textures in the ".rtex" format (see include/utils/texture_container.h)
+
+Usage:
+    texture_baker.out <input image> <output .rtex file> [-linear]
+
+- the image is loaded with stb_image (PNG, JPEG, TGA, ...)
+- the whole mipmap chain is generated on the CPU, with the averaging of the colors in linear space (with -linear, the values are averaged directly:
+  it must be used for the images which do not contain colors, like normal maps or roughness maps)
+- each level is compressed in a block format (code in include/utils/texture_compression.h), with the blocks encoded in parallel on all the cores:
+    - 1 channel -> RGTC1 (BC4)
+    - 3 channels, or 4 channels with alpha always = 255 -> BC1
+    - 2 or 4 channels -> BC3
+- the levels are saved in a file which can be memory mapped and uploaded directly by the applications (TextureManager::Acquire() loads the ".rtex" files)
+
+With respect to the uncompressed RGBA textures, BC1 textures use 8 times less memory, and BC3/RGTC1 4 times less. Moreover, at runtime there is no decoding of the images,
+and no generation of the mipmaps.
+
+N.B.) BC7 (BPTC) would give a better quality for the RGBA images, but it requires OpenGL 4.2, while the applications use a 4.1 core context
+
+author: Davide Gadia
+
+Real-Time Graphics Programming - a.a. 2024/2025
+Master degree in Computer Science
+Universita' degli Studi di Milano
+*/
+
+// Std. Includes
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <chrono>
+
+#include <utils/job_system.h>
+#include <utils/texture_container.h>
+#include <utils/texture_compression.h>
+
+// we include the library for images loading
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image/stb_image.h"
+
+// elapsed time in milliseconds from "start"
+double ElapsedMs(const chrono::steady_clock::time_point& start)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+/////////////////// MAIN function ///////////////////////
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        std::cout << "Usage: " << argv[0] << " <input image> <output .rtex file> [-linear]" << std::endl;
+        return -1;
+    }
+    string inputPath = argv[1];
+    string outputPath = argv[2];
+    bool gammaCorrect = true;
+    for (int a = 3; a < argc; a++)
+    {
+        if (string(argv[a]) == "-linear")
+            gammaCorrect = false;
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    // we load the image, keeping the original number of channels
+    int w, h, channels;
+    unsigned char* pixels = stbi_load(inputPath.c_str(), &w, &h, &channels, 0);
+    if (pixels == nullptr)
+    {
+        std::cout << "Failed to load image: " << inputPath << std::endl;
+        return -1;
+    }
+    vector<unsigned char> image(pixels, pixels + (size_t)w * h * channels);
+    stbi_image_free(pixels);
+
+    // we choose the format: BC1 if the image is opaque, BC3 if it has an alpha channel, RGTC1 for a single channel
+    uint32_t format = TEXTURE_FORMAT_BC1;
+    if (channels == 1)
+        format = TEXTURE_FORMAT_RGTC1;
+    else if (channels == 2)
+        format = TEXTURE_FORMAT_BC3;
+    else if (channels == 4)
+    {
+        for (size_t i = 3; i < image.size(); i += 4)
+        {
+            if (image[i] != 255)
+            {
+                format = TEXTURE_FORMAT_BC3;
+                break;
+            }
+        }
+    }
+
+    // we generate and encode the levels, until the 1x1 level
+    JobSystem jobs;
+    vector<vector<unsigned char> > levels;
+    vector<TextureFileLevel> levelTable;
+    int lw = w, lh = h;
+    while (true)
+    {
+        TextureFileLevel level;
+        level.offset = 0;
+        level.width = lw;
+        level.height = lh;
+        levels.push_back(vector<unsigned char>());
+        EncodeLevel(image, lw, lh, channels, format, levels.back(), &jobs);
+        level.size = (uint32_t)levels.back().size();
+        levelTable.push_back(level);
+
+        if (lw == 1 && lh == 1)
+            break;
+        vector<unsigned char> next;
+        int nw, nh;
+        DownsampleImage(image, lw, lh, channels, gammaCorrect, next, nw, nh);
+        image.swap(next);
+        lw = nw;
+        lh = nh;
+    }
+
+    // offsets of the levels: after the header and the table, aligned to 16 bytes
+    TextureFileHeader header;
+    memcpy(header.magic, "RTEX", 4);
+    header.version = TEXTURE_FILE_VERSION;
+    header.format = format;
+    header.width = w;
+    header.height = h;
+    header.numLevels = (uint32_t)levels.size();
+    header.channels = channels;
+    header.reserved = 0;
+    uint32_t offset = (uint32_t)(sizeof(TextureFileHeader) + levelTable.size() * sizeof(TextureFileLevel));
+    for (size_t l = 0; l < levelTable.size(); l++)
+    {
+        offset = (offset + 15) & ~15u;
+        levelTable[l].offset = offset;
+        offset += levelTable[l].size;
+    }
+
+    ofstream file(outputPath.c_str(), ios::binary);
+    if (!file)
+    {
+        std::cout << "Failed to create file: " << outputPath << std::endl;
+        return -1;
+    }
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)&levelTable[0], levelTable.size() * sizeof(TextureFileLevel));
+    size_t written = sizeof(header) + levelTable.size() * sizeof(TextureFileLevel);
+    const char padding[16] = { 0 };
+    for (size_t l = 0; l < levels.size(); l++)
+    {
+        file.write(padding, levelTable[l].offset - written);
+        file.write((const char*)&levels[l][0], levels[l].size());
+        written = levelTable[l].offset + levels[l].size();
+    }
+    file.close();
+
+    // size of the uncompressed texture with mipmaps (RGB textures are usually stored as RGBA on the GPU)
+    size_t uncompressed = (size_t)w * h * (channels == 3 ? 4 : channels) * 4 / 3;
+    const char* formatNames[4] = { "", "BC1", "BC3", "RGTC1" };
+    std::cout << inputPath << " (" << w << "x" << h << ", " << channels << " channels) -> " << outputPath << ": " << formatNames[format] << ", "
+              << levels.size() << " levels, " << (written / 1024) << " KB (uncompressed: " << (uncompressed / 1024) << " KB), "
+              << ElapsedMs(start) << " ms with " << (jobs.NumWorkers() + 1) << " threads" << std::endl;
+    return 0;
+}